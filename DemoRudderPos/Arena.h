@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+#include <vector>
+
+
+/**
+ * Bump allocator for data that lives as long as its owner and is freed all at once, such as models assembled from
+ *  many small replies of the sim.
+ *
+ * Allocations are carved out of blocks of cbBlock bytes, or a block of their own when larger, and stay where they
+ *  are until Clear; a new block is only taken when the current one is full. Only types that need no destructor can
+ *  be allocated.
+ */
+class CArena
+{
+public:
+    explicit CArena (size_t cbBlock = 256 << 10) :
+        m_cbBlock (cbBlock),
+        m_pNext   (NULL),
+        m_pEnd    (NULL),
+        m_cbUsed  (0)
+    {
+    }
+
+    ~CArena ()
+    {
+        Clear ();
+    }
+
+    /**
+     * Room for cItems of T, aligned for T and value-initialized; NULL for none.
+     */
+    template <typename T>
+    T* Allocate (size_t cItems)
+    {
+        if (cItems == 0) return NULL;
+
+        void* p = Allocate (cItems * sizeof (T), alignof (T));
+        for (size_t i = 0; i < cItems; i++) new ((T*)p + i) T ();
+        return (T*)p;
+    }
+
+    void* Allocate (size_t cb,
+                    size_t cbAlign)
+    {
+        size_t ibPad = (cbAlign - (size_t)m_pNext % cbAlign) % cbAlign;
+
+        if (m_pNext == NULL || ibPad + cb > (size_t)(m_pEnd - m_pNext))
+        {
+            // Anything larger than a block gets one of its own; alignment of malloc covers every type
+            size_t cbNew = cb > m_cbBlock / 4 ? cb : m_cbBlock;
+            char*  pNew  = (char*)malloc (cbNew);
+            if (pNew == NULL) throw std::bad_alloc ();
+
+            m_blocks.push_back (pNew);
+            m_cbUsed += cbNew;
+            if (cbNew != m_cbBlock) return pNew;
+
+            m_pNext = pNew;
+            m_pEnd  = pNew + cbNew;
+            ibPad   = 0;
+        }
+
+        char* p = m_pNext + ibPad;
+        m_pNext = p + cb;
+        return p;
+    }
+
+    /**
+     * Free everything allocated.
+     */
+    void Clear ()
+    {
+        for (size_t i = 0; i < m_blocks.size (); i++) free (m_blocks[i]);
+        m_blocks.clear ();
+        m_pNext  = NULL;
+        m_pEnd   = NULL;
+        m_cbUsed = 0;
+    }
+
+    /**
+     * Bytes taken from the heap so far.
+     */
+    size_t Size () const
+    {
+        return m_cbUsed;
+    }
+
+private:
+    CArena (const CArena&);
+    CArena& operator= (const CArena&);
+
+
+    size_t              m_cbBlock;
+    char*               m_pNext;        // Free space left in the current block
+    char*               m_pEnd;
+    size_t              m_cbUsed;
+    std::vector<char*>  m_blocks;
+};
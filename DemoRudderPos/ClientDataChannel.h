@@ -0,0 +1,270 @@
+#pragma once
+
+#include <Windows.h>
+#include <SimConnect.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+
+/**
+ * Moves blocks of any size between add-ons through a client data area, for bulk data such as per-vehicle path tables
+ *  that SimVar definitions fit badly.
+ *
+ * An area holds at most SIMCONNECT_CLIENTDATA_MAX_SIZE bytes, so the writer splits a block into chunks and sets the
+ *  area to each in turn, with a header saying which block the chunk is part of and where in it it goes. The reader
+ *  asks for the area on every set, so every chunk reaches it as a message of its own, and assembles them in a back
+ *  buffer. Only a complete block is swapped to the front and handed to the reader's procedure, so the reader never
+ *  sees part of one block and part of another. A chunk that starts a newer block abandons the one being assembled.
+ *
+ * The writer is double-buffered as well: Write copies a block and returns, Pump sends a few chunks of the block in
+ *  flight at a time, and a block written while another is in flight waits for it to finish, replacing any block
+ *  already waiting. A writer that produces blocks faster than they go out so sends the latest one next rather than
+ *  falling ever further behind.
+ */
+class CClientDataChannel
+{
+public:
+    /**
+     * Receives a complete block, valid until the next one.
+     */
+    typedef void (CALLBACK* BlockProc) (const BYTE* pBlock,
+                                        DWORD       cbBlock,
+                                        DWORD       nBlock,
+                                        void*       pContext);
+
+    /**
+     * The channel owns the client data ID, definition ID and request ID.
+     */
+    CClientDataChannel (DWORD idClientData,
+                        DWORD idDefine,
+                        DWORD idRequest) :
+        m_hSimConnect       (NULL),
+        m_idClientData      (idClientData),
+        m_idDefine          (idDefine),
+        m_idRequest         (idRequest),
+        m_nBlock            (0),
+        m_ibSent            (0),
+        m_cChunksLeft       (0),
+        m_bPending          (false),
+        m_nBlockBack        (0),
+        m_ibBack            (0),
+        m_nBlockFront       (0),
+        m_cBlocksAbandoned  (0),
+        m_pfnBlock          (NULL),
+        m_pContext          (NULL)
+    {
+    }
+
+    /**
+     * Create the area szName, which fails with an exception from the sim if another add-on already has. Blocks are
+     *  written to it with Write and Pump.
+     */
+    HRESULT OpenWriter (HANDLE      hSimConnect,
+                        const char* szName)
+    {
+        HRESULT hr = Define (hSimConnect, szName);
+        if (FAILED (hr)) return hr;
+
+        return SimConnect_CreateClientData (m_hSimConnect, m_idClientData, sizeof (Chunk), SIMCONNECT_CREATE_CLIENT_DATA_FLAG_DEFAULT);
+    }
+
+    /**
+     * Read the blocks written to the area szName, which has to have been created. Each complete block goes to
+     *  pfnBlock, from OnClientData.
+     */
+    HRESULT OpenReader (HANDLE      hSimConnect,
+                        const char* szName,
+                        BlockProc   pfnBlock,
+                        void*       pContext)
+    {
+        HRESULT hr = Define (hSimConnect, szName);
+        if (FAILED (hr)) return hr;
+
+        m_pfnBlock = pfnBlock;
+        m_pContext = pContext;
+        return SimConnect_RequestClientData (m_hSimConnect, m_idClientData, m_idRequest, m_idDefine, SIMCONNECT_CLIENT_DATA_PERIOD_ON_SET);
+    }
+
+    /**
+     * Queue a block to send; pData is copied.
+     */
+    void Write (const void* pData,
+                DWORD       cbData)
+    {
+        m_pending.assign ((const BYTE*)pData, (const BYTE*)pData + cbData);
+        m_bPending = true;
+    }
+
+    /**
+     * Send up to cChunksMax chunks, moving on to the waiting block when the one in flight is done. Returns how many
+     *  were sent; 0 when there is nothing left to send.
+     */
+    DWORD Pump (DWORD cChunksMax)
+    {
+        DWORD cSent = 0;
+
+        while (cSent < cChunksMax)
+        {
+            if (m_cChunksLeft == 0)
+            {
+                if (!m_bPending) break;
+                StartBlock ();
+            }
+
+            DWORD cbChunk = (DWORD)std::min ((size_t)CHUNK_DATA_MAX, m_sending.size () - m_ibSent);
+
+            m_chunk.nBlock  = m_nBlock;
+            m_chunk.cbBlock = (DWORD)m_sending.size ();
+            m_chunk.ibChunk = (DWORD)m_ibSent;
+            m_chunk.cbChunk = cbChunk;
+            if (cbChunk > 0) memcpy (m_chunk.data, &m_sending[m_ibSent], cbChunk);
+
+            SimConnect_SetClientData (m_hSimConnect, m_idClientData, m_idDefine, SIMCONNECT_CLIENT_DATA_SET_FLAG_DEFAULT, 0, sizeof (m_chunk), &m_chunk);
+
+            m_ibSent += cbChunk;
+            m_cChunksLeft--;
+            cSent++;
+        }
+        return cSent;
+    }
+
+    /**
+     * Whether a block is in flight or waiting.
+     */
+    bool IsSending () const
+    {
+        return m_bPending || m_cChunksLeft > 0;
+    }
+
+    /**
+     * Pass on CLIENT_DATA messages; returns true if it was for this channel.
+     */
+    bool OnClientData (const SIMCONNECT_RECV_CLIENT_DATA* pClientData)
+    {
+        if (pClientData->dwRequestID != m_idRequest) return false;
+        if (pClientData->dwSize < sizeof (SIMCONNECT_RECV_CLIENT_DATA) - sizeof (DWORD) + sizeof (Chunk)) return true;
+
+        const Chunk* pChunk = (const Chunk*)&pClientData->dwData;
+        if (pChunk->cbChunk > CHUNK_DATA_MAX || pChunk->ibChunk > pChunk->cbBlock || pChunk->cbChunk > pChunk->cbBlock - pChunk->ibChunk) return true;
+
+        if (pChunk->nBlock != m_nBlockBack)
+        {
+            // Only the first chunk can start a block; without it the rest of the block is of no use
+            if (m_nBlockBack != 0) m_cBlocksAbandoned++;
+            if (pChunk->ibChunk != 0)
+            {
+                m_nBlockBack = 0;
+                m_back.clear ();
+                m_ibBack = 0;
+                return true;
+            }
+
+            m_nBlockBack = pChunk->nBlock;
+            m_back.resize (pChunk->cbBlock);
+            m_ibBack = 0;
+        }
+        else if (pChunk->ibChunk != m_ibBack)
+        {
+            return true;
+        }
+
+        if (pChunk->cbChunk > 0) memcpy (&m_back[m_ibBack], pChunk->data, pChunk->cbChunk);
+        m_ibBack += pChunk->cbChunk;
+
+        if (m_ibBack == m_back.size ())
+        {
+            m_front.swap (m_back);
+            m_nBlockFront = m_nBlockBack;
+            m_nBlockBack  = 0;
+            m_ibBack      = 0;
+
+            if (m_pfnBlock != NULL) m_pfnBlock (m_front.data (), (DWORD)m_front.size (), m_nBlockFront, m_pContext);
+        }
+        return true;
+    }
+
+    /**
+     * The last complete block received, and its number; 0 before the first.
+     */
+    const std::vector<BYTE>& Block () const
+    {
+        return m_front;
+    }
+
+    DWORD BlockNumber () const
+    {
+        return m_nBlockFront;
+    }
+
+    /**
+     * Blocks of which the reader got the start but not the end.
+     */
+    DWORD AbandonedCount () const
+    {
+        return m_cBlocksAbandoned;
+    }
+
+private:
+#pragma pack (push, 1)
+    typedef struct Chunk
+    {
+        DWORD nBlock;       // Counts up from 1 per writer
+        DWORD cbBlock;
+        DWORD ibChunk;      // Where in the block the data goes
+        DWORD cbChunk;
+        BYTE  data[SIMCONNECT_CLIENTDATA_MAX_SIZE - 4 * sizeof (DWORD)];
+    }
+    Chunk;
+#pragma pack (pop)
+
+    static const DWORD CHUNK_DATA_MAX = sizeof (((Chunk*)NULL)->data);
+
+
+    HRESULT Define (HANDLE      hSimConnect,
+                    const char* szName)
+    {
+        m_hSimConnect = hSimConnect;
+
+        HRESULT hr = SimConnect_MapClientDataNameToID (m_hSimConnect, szName, m_idClientData);
+        if (FAILED (hr)) return hr;
+
+        return SimConnect_AddToClientDataDefinition (m_hSimConnect, m_idDefine, 0, sizeof (Chunk));
+    }
+
+    void StartBlock ()
+    {
+        m_sending.swap (m_pending);
+        m_bPending = false;
+        m_ibSent   = 0;
+        m_nBlock++;
+
+        // An empty block is still one chunk
+        m_cChunksLeft = std::max ((DWORD)1, (DWORD)((m_sending.size () + CHUNK_DATA_MAX - 1) / CHUNK_DATA_MAX));
+    }
+
+    HANDLE              m_hSimConnect;
+    DWORD               m_idClientData;
+    DWORD               m_idDefine;
+    DWORD               m_idRequest;
+
+    // Writer
+    DWORD               m_nBlock;           // Of the block in flight
+    std::vector<BYTE>   m_sending;          // In flight, sent up to m_ibSent
+    size_t              m_ibSent;
+    DWORD               m_cChunksLeft;
+    std::vector<BYTE>   m_pending;          // Waiting, if m_bPending
+    bool                m_bPending;
+    Chunk               m_chunk;
+
+    // Reader
+    std::vector<BYTE>   m_back;             // Being assembled, up to m_ibBack
+    DWORD               m_nBlockBack;
+    size_t              m_ibBack;
+    std::vector<BYTE>   m_front;
+    DWORD               m_nBlockFront;
+    DWORD               m_cBlocksAbandoned;
+    BlockProc           m_pfnBlock;
+    void*               m_pContext;
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <Windows.h>
+#include <SimConnect.h>
+#include <vector>
+
+
+/**
+ * Services several SimConnect connections from one dispatch loop, e.g. to the sims of a comparison rig, each reached
+ *  through its own ConfigIndex in SimConnect.cfg.
+ *
+ * Every connection gets an event of its own for SimConnect to signal, and Dispatch waits on all of them at once. The
+ *  wait returns the first connection with something to dispatch; those after it are polled, so every connection
+ *  with messages waiting is dispatched once per call whatever its place in the list. Messages go to the dispatch
+ *  procedure and context the connection was opened with.
+ */
+class CConnectionMux
+{
+public:
+    CConnectionMux ()
+    {
+    }
+
+    ~CConnectionMux ()
+    {
+        while (!m_connections.empty ()) Close (m_connections.back ().hSimConnect);
+    }
+
+    /**
+     * Connect to the sim of dwConfigIndex, 0 for the local one. *phSimConnect is the handle for the SimConnect calls
+     *  as usual, and for Close; it is not to be passed to SimConnect_Close or SimConnect_CallDispatch.
+     */
+    HRESULT Open (LPCSTR       szName,
+                  DWORD        dwConfigIndex,
+                  DispatchProc pfnDispatch,
+                  void*        pContext,
+                  HANDLE*      phSimConnect)
+    {
+        *phSimConnect = NULL;
+        if (m_events.size () >= MAXIMUM_WAIT_OBJECTS) return E_FAIL;
+
+        HANDLE  hEvent = CreateEvent (NULL, FALSE, FALSE, NULL);
+        HRESULT hr     = SimConnect_Open (phSimConnect, szName, NULL, 0, hEvent, dwConfigIndex);
+        if (FAILED (hr))
+        {
+            CloseHandle (hEvent);
+            *phSimConnect = NULL;
+            return hr;
+        }
+
+        Connection connection;
+        connection.hSimConnect = *phSimConnect;
+        connection.pfnDispatch = pfnDispatch;
+        connection.pContext    = pContext;
+        m_connections.push_back (connection);
+        m_events.push_back (hEvent);
+        return S_OK;
+    }
+
+    /**
+     * May be called from a dispatch procedure, including for its own connection.
+     */
+    void Close (HANDLE hSimConnect)
+    {
+        for (size_t i = 0; i < m_connections.size (); i++)
+        {
+            if (m_connections[i].hSimConnect != hSimConnect) continue;
+
+            SimConnect_Close (hSimConnect);
+            CloseHandle (m_events[i]);
+
+            m_connections.erase (m_connections.begin () + i);
+            m_events.erase (m_events.begin () + i);
+            return;
+        }
+    }
+
+    /**
+     * Wait up to dwMilliseconds for any connection to have something, then dispatch every connection that has.
+     *  Returns how many were dispatched, 0 if the wait timed out.
+     */
+    DWORD Dispatch (DWORD dwMilliseconds)
+    {
+        if (m_events.empty ())
+        {
+            Sleep (dwMilliseconds);
+            return 0;
+        }
+
+        DWORD dwWait = WaitForMultipleObjects ((DWORD)m_events.size (), m_events.data (), FALSE, dwMilliseconds);
+        if (dwWait - WAIT_OBJECT_0 >= m_events.size ()) return 0;
+
+        // The connections before the first one are known to have nothing, and its event was reset by the wait
+        DWORD iFirst      = dwWait - WAIT_OBJECT_0;
+        DWORD cDispatched = 0;
+
+        for (DWORD i = iFirst; i < m_connections.size (); i++)
+        {
+            if (i != iFirst && WaitForSingleObject (m_events[i], 0) != WAIT_OBJECT_0) continue;
+
+            // A dispatch procedure may close connections, which moves the later ones down; they are then left for
+            //  the next call, their events still set
+            Connection connection = m_connections[i];
+            SimConnect_CallDispatch (connection.hSimConnect, connection.pfnDispatch, connection.pContext);
+            cDispatched++;
+        }
+        return cDispatched;
+    }
+
+    DWORD Count () const
+    {
+        return (DWORD)m_connections.size ();
+    }
+
+private:
+    typedef struct Connection
+    {
+        HANDLE       hSimConnect;
+        DispatchProc pfnDispatch;
+        void*        pContext;
+    }
+    Connection;
+
+
+    std::vector<Connection> m_connections;
+    std::vector<HANDLE>     m_events;       // Same order as m_connections, for WaitForMultipleObjects
+};
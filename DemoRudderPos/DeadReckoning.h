@@ -0,0 +1,230 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "FlatHashMap.h"
+#include "Geodesy.h"
+
+
+/**
+ * Dead reckoning for objects whose position is only received every few frames.
+ *
+ * Each object keeps its last fix, plus the ground speed, course and turn rate derived from the last two, and
+ *  Predict extrapolates along a circular arc at constant speed and turn rate. Every new fix is checked against what
+ *  was predicted for it, which sets how many frames should pass before the next one: the error of the model grows
+ *  with the square of the time since the fix, so the count doubles while the error stays below a quarter of the
+ *  tolerance, and halves as soon as it goes over.
+ */
+class CDeadReckoner
+{
+public:
+    /**
+     * dToleranceFt: prediction error above which fixes are needed more often.
+     * cFramesMax: most frames between two fixes, a power of two. This bounds the error when an object starts to
+     *  turn or brake between fixes, which no prediction sees coming: on a replayed taxi session 32 frames keep it
+     *  under a foot, 128 let it reach 14 ft.
+     */
+    explicit CDeadReckoner (double   dToleranceFt = 1.0,
+                            uint32_t cFramesMax   = 32) :
+        m_dToleranceFt (dToleranceFt),
+        m_cFramesMax   (cFramesMax)
+    {
+    }
+
+    /**
+     * A fix at dTime seconds: position in degrees and true heading in degrees. Returns the number of frames there
+     *  should be from one fix of the object to the next from now on.
+     */
+    uint32_t OnFix (uint32_t idObject,
+                    double   dTime,
+                    double   dLat,
+                    double   dLon,
+                    double   dHead)
+    {
+        bool      bInserted = false;
+        uint32_t& iSlot     = m_index.Insert (idObject, &bInserted);
+
+        if (bInserted)
+        {
+            iSlot = (uint32_t)m_ids.size ();
+            m_ids.push_back (idObject);
+            m_times.push_back (dTime);
+            m_lats.push_back (dLat);
+            m_lons.push_back (dLon);
+            m_heads.push_back (dHead);
+            m_speeds.push_back (0.0);
+            m_courses.push_back (0.0);
+            m_turns.push_back (0.0);
+            m_frames.push_back (1);
+            return 1;
+        }
+
+        uint32_t i   = iSlot;
+        double   dDt = dTime - m_times[i];
+
+        if (dDt > 0.0)
+        {
+            double dLatPredicted;
+            double dLonPredicted;
+            double dHeadPredicted;
+            Extrapolate (i, dTime, dLatPredicted, dLonPredicted, dHeadPredicted);
+
+            double dErrFt = DistanceFt (dLatPredicted, dLonPredicted, dLat, dLon);
+            if (dErrFt > m_dToleranceFt)
+            {
+                m_frames[i] = m_frames[i] > 1 ? m_frames[i] / 2 : 1;
+            }
+            else if (dErrFt < m_dToleranceFt / 4.0 && m_frames[i] < m_cFramesMax)
+            {
+                m_frames[i] *= 2;
+            }
+
+            double dNorthFt = (dLat - m_lats[i]) * CGeodesy::FT_PER_DEG;
+            double dEastFt  = WrapDeg (dLon - m_lons[i]) * CGeodesy::FT_PER_DEG * cos (CAngle::Degrees (dLat).Rad ());
+            double dTurn    = WrapDeg (dHead - m_heads[i]) / dDt;
+
+            // The chord between the two fixes points along the course halfway between them
+            m_speeds[i]  = sqrt (dNorthFt * dNorthFt + dEastFt * dEastFt) / dDt;
+            m_courses[i] = CAngle::Radians (atan2 (dEastFt, dNorthFt)).Deg () + dTurn * dDt / 2.0;
+            m_turns[i]   = dTurn;
+        }
+
+        m_times[i] = dTime;
+        m_lats[i]  = dLat;
+        m_lons[i]  = dLon;
+        m_heads[i] = dHead;
+        return m_frames[i];
+    }
+
+    /**
+     * Position and heading extrapolated to dTime seconds. Returns false if there is no fix for the object.
+     *  The demo steers by CKalmanBank instead, so only the bench calls this.
+     */
+    bool Predict (uint32_t idObject,
+                  double   dTime,
+                  double&  dLat,
+                  double&  dLon,
+                  double&  dHead) const
+    {
+        const uint32_t* piSlot = m_index.Find (idObject);
+        if (piSlot == NULL) return false;
+
+        Extrapolate (*piSlot, dTime, dLat, dLon, dHead);
+        return true;
+    }
+
+    /**
+     * Frames from one fix to the next the object needs at the moment; 1 for an unknown object.
+     */
+    uint32_t FramesOf (uint32_t idObject) const
+    {
+        const uint32_t* piSlot = m_index.Find (idObject);
+        return piSlot == NULL ? 1 : m_frames[*piSlot];
+    }
+
+    void Remove (uint32_t idObject)
+    {
+        const uint32_t* piSlot = m_index.Find (idObject);
+        if (piSlot == NULL) return;
+
+        // Move the last object into the hole so the arrays stay dense
+        uint32_t i     = *piSlot;
+        uint32_t iLast = (uint32_t)m_ids.size () - 1;
+        m_index.Erase (idObject);
+        if (i != iLast) *m_index.Find (m_ids[iLast]) = i;
+
+        m_ids[i]     = m_ids[iLast];
+        m_times[i]   = m_times[iLast];
+        m_lats[i]    = m_lats[iLast];
+        m_lons[i]    = m_lons[iLast];
+        m_heads[i]   = m_heads[iLast];
+        m_speeds[i]  = m_speeds[iLast];
+        m_courses[i] = m_courses[iLast];
+        m_turns[i]   = m_turns[iLast];
+        m_frames[i]  = m_frames[iLast];
+
+        m_ids.pop_back ();
+        m_times.pop_back ();
+        m_lats.pop_back ();
+        m_lons.pop_back ();
+        m_heads.pop_back ();
+        m_speeds.pop_back ();
+        m_courses.pop_back ();
+        m_turns.pop_back ();
+        m_frames.pop_back ();
+    }
+
+    uint32_t Count () const
+    {
+        return (uint32_t)m_ids.size ();
+    }
+
+private:
+    void Extrapolate (uint32_t i,
+                      double   dTime,
+                      double&  dLat,
+                      double&  dLon,
+                      double&  dHead) const
+    {
+        double dDt      = dTime - m_times[i];
+        double dCourse  = CAngle::Degrees (m_courses[i]).Rad ();
+        double dTurn    = CAngle::Degrees (m_turns[i]).Rad ();
+        double dNorthFt;
+        double dEastFt;
+
+        if (fabs (dTurn * dDt) < 1e-6)
+        {
+            dNorthFt = m_speeds[i] * dDt * cos (dCourse);
+            dEastFt  = m_speeds[i] * dDt * sin (dCourse);
+        }
+        else
+        {
+            // Arc of radius speed / turn rate
+            double dRadiusFt = m_speeds[i] / dTurn;
+            dNorthFt = dRadiusFt * (sin (dCourse + dTurn * dDt) - sin (dCourse));
+            dEastFt  = dRadiusFt * (cos (dCourse) - cos (dCourse + dTurn * dDt));
+        }
+
+        double dCosLat = cos (CAngle::Degrees (m_lats[i]).Rad ());
+
+        dLat  = m_lats[i] + dNorthFt / CGeodesy::FT_PER_DEG;
+        dLon  = m_lons[i] + (dCosLat > 1e-9 ? dEastFt / (CGeodesy::FT_PER_DEG * dCosLat) : 0.0);
+        dHead = CGeodesy::Mod (m_heads[i] + m_turns[i] * dDt, 360.0);
+    }
+
+    /**
+     * An angle difference in degrees brought into [-180, 180).
+     */
+    static double WrapDeg (double dDeg)
+    {
+        return CGeodesy::Mod (dDeg + 180.0, 360.0) - 180.0;
+    }
+
+    static double DistanceFt (double dLat0,
+                              double dLon0,
+                              double dLat1,
+                              double dLon1)
+    {
+        double dNorth = (dLat1 - dLat0) * CGeodesy::FT_PER_DEG;
+        double dEast  = WrapDeg (dLon1 - dLon0) * CGeodesy::FT_PER_DEG * cos (CAngle::Degrees (dLat0).Rad ());
+        return sqrt (dNorth * dNorth + dEast * dEast);
+    }
+
+
+    double                  m_dToleranceFt;
+    uint32_t                m_cFramesMax;
+
+    CFlatHashMap<uint32_t>  m_index;    // Object ID to index in the arrays below
+    std::vector<uint32_t>   m_ids;
+
+    // Last fix, and the motion derived from the last two
+    std::vector<double>     m_times;
+    std::vector<double>     m_lats;
+    std::vector<double>     m_lons;
+    std::vector<double>     m_heads;
+    std::vector<double>     m_speeds;   // Feet per second
+    std::vector<double>     m_courses;  // Degrees true
+    std::vector<double>     m_turns;    // Degrees per second, positive to the right
+    std::vector<uint32_t>   m_frames;
+};
@@ -0,0 +1,1319 @@
+#pragma once
+
+#include <Windows.h>
+#include <SimConnect.h>
+#include <comdef.h>
+#include <tchar.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <string.h>
+
+#include "ConnectionMux.h"
+#include "DeadReckoning.h"
+#include "FacilityCache.h"
+#include "FacilityFetcher.h"
+#include "FacilityRange.h"
+#include "Formation.h"
+#include "FrameScheduler.h"
+#include "Geodesy.h"
+#include "KalmanBank.h"
+#include "LocalFrame.h"
+#include "ObjectRegistry.h"
+#include "PathFollower.h"
+#include "SpatialGrid.h"
+#include "SubscriptionMux.h"
+#include "TaxiRouter.h"
+#include "TelemetryBus.h"
+#include "TelemetryRecorder.h"
+#include "TimerWheel.h"
+#include "WeatherCache.h"
+
+
+class CDemoRudderPos
+{
+public:
+    CDemoRudderPos () :
+        m_hSimConnect          (NULL),
+        m_hEventDispatch       (NULL),
+        m_pConnections         (NULL),
+        m_bQuit                (false),
+        m_bRecord              (false),
+        m_idObjGroundVehicle   (0),
+        m_bDataUserObjectSet   (false),
+        m_mux                  (DATA_DEF_ID_MUX_FIRST, DATA_REQ_ID_MUX_FIRST, MUX_GROUPS_MAX),
+        m_nScan                (0),
+        m_cScanPending         (0),
+        m_cSecondsToScan       (0),
+        m_idSubGroundVehicle   (0),
+        m_cFramesGroundVehicle (1),
+        m_idTimerScan          (0),
+        m_facilities           (DATA_REQ_ID_FACILITIES),
+        m_range                (DATA_REQ_ID_FACILITIES_IN_RANGE),
+        m_nAirportChanges      (0),
+        m_fetcher              (DATA_DEF_ID_FACILITY_DATA, DATA_REQ_ID_FACILITY_DATA),
+        m_pRouterAirport       (NULL),
+        m_iParking             (0),
+        m_weather              (DATA_REQ_ID_WEATHER)
+    {
+        m_grid.Reserve (4096);
+    }
+
+    void Run ()
+    {
+        if (!Open ()) return;
+
+        // Dispatch loop; SimConnect signals the event when there is something to dispatch
+        while (!m_bQuit)
+        {
+            WaitForSingleObject (m_hEventDispatch, DISPATCH_TIMEOUT_MS);
+            Dispatch ();
+        }
+
+        Close ();
+    }
+
+    /**
+     * Run a demo on each of several sims, given by their ConfigIndex in SimConnect.cfg, from one dispatch loop until
+     *  all of them have quit.
+     */
+    static void RunAll (const DWORD* pConfigIndices,
+                        DWORD        cConfigs,
+                        bool         bRecord = false)
+    {
+        CConnectionMux               connections;
+        std::vector<CDemoRudderPos*> demos;
+
+        for (DWORD i = 0; i < cConfigs; i++)
+        {
+            CDemoRudderPos* pDemo = new CDemoRudderPos ();
+            pDemo->SetRecord (bRecord);
+            if (pDemo->Open (connections, pConfigIndices[i]))
+            {
+                demos.push_back (pDemo);
+            }
+            else
+            {
+                delete pDemo;
+            }
+        }
+
+        while (connections.Count () > 0)
+        {
+            connections.Dispatch (DISPATCH_TIMEOUT_MS);
+
+            for (size_t i = 0; i < demos.size (); i++)
+            {
+                if (demos[i]->IsQuit () && demos[i]->m_hSimConnect != NULL) demos[i]->Close ();
+            }
+        }
+
+        for (size_t i = 0; i < demos.size (); i++) delete demos[i];
+    }
+
+    /**
+     * Connect to the sim and set up the events, subscriptions and data definitions. Returns false, after printing
+     *  why, if the sim could not be reached.
+     */
+    bool Open ()
+    {
+        m_hEventDispatch = CreateEvent (NULL, FALSE, FALSE, NULL);
+
+        HRESULT hr = SimConnect_Open (&m_hSimConnect, "DemoRudderPos", NULL, 0, m_hEventDispatch, 0);
+        if (FAILED (hr))
+        {
+            _com_error error (hr);
+            _tprintf (_T("Failed to connect to sim: %s\n"), error.ErrorMessage ());
+
+            CloseHandle (m_hEventDispatch);
+            m_hEventDispatch = NULL;
+            return false;
+        }
+
+        OpenBus (0);
+        Setup ();
+        return true;
+    }
+
+    /**
+     * Connect to the sim of dwConfigIndex through a multiplexer, which then dispatches for the demo instead of Run
+     *  or Dispatch.
+     */
+    bool Open (CConnectionMux& connections,
+               DWORD           dwConfigIndex)
+    {
+        HRESULT hr = connections.Open ("DemoRudderPos", dwConfigIndex, DispatchProc_, this, &m_hSimConnect);
+        if (FAILED (hr))
+        {
+            _com_error error (hr);
+            _tprintf (_T("Failed to connect to sim %u: %s\n"), dwConfigIndex, error.ErrorMessage ());
+            return false;
+        }
+
+        m_pConnections = &connections;
+        OpenBus (dwConfigIndex);
+        Setup ();
+        return true;
+    }
+
+    /**
+     * Handle whatever the sim has sent since the last call.
+     */
+    void Dispatch ()
+    {
+        SimConnect_CallDispatch (m_hSimConnect, DispatchProc_, this);
+    }
+
+    void Close ()
+    {
+        m_range.Close ();
+        m_fetcher.Close ();
+        m_router.Clear ();
+        m_pRouterAirport = NULL;
+        m_weather.Close ();
+
+        if (m_pConnections != NULL)
+        {
+            m_pConnections->Close (m_hSimConnect);
+            m_pConnections = NULL;
+        }
+        else
+        {
+            SimConnect_Close (m_hSimConnect);
+
+            CloseHandle (m_hEventDispatch);
+            m_hEventDispatch = NULL;
+        }
+        m_hSimConnect = NULL;
+        m_bus.Close ();
+        m_recorder.Close ();
+        m_facilities.Close ();
+    }
+
+    bool IsQuit () const
+    {
+        return m_bQuit;
+    }
+
+    /**
+     * Also record what is published on the bus to "DemoRudderPos.<ConfigIndex>.trec", from the next Open on.
+     */
+    void SetRecord (bool bRecord)
+    {
+        m_bRecord = bRecord;
+    }
+
+    HANDLE SimConnect () const
+    {
+        return m_hSimConnect;
+    }
+
+    // Client IDs; public so that a stand-in for the sim can address the demo
+    enum EVENT_ID
+    {
+        EVENT_ID_CREATE,
+        EVENT_ID_RUDDER_RIGHT,
+        EVENT_ID_RUDDER_LEFT,
+        EVENT_ID_QUIT,
+        EVENT_ID_FOLLOW,
+        EVENT_ID_NEARBY,
+        EVENT_ID_OBJECT_ADDED,
+        EVENT_ID_OBJECT_REMOVED,
+        EVENT_ID_1SEC,
+        EVENT_ID_FRAME,
+        EVENT_ID_6HZ,
+        EVENT_ID_PAUSE
+    };
+
+    static const DWORD SPAWN_VEHICLES_MAX = 1024;   // Of a formation, each created with a request ID of its own
+
+    enum DATA_REQ_ID
+    {
+        DATA_REQ_ID_GROUND_VEHICLE,
+        DATA_REQ_ID_SCAN_AIRCRAFT,
+        DATA_REQ_ID_SCAN_GROUND,
+        DATA_REQ_ID_FACILITIES,
+        DATA_REQ_ID_FACILITIES_IN_RANGE,
+        DATA_REQ_ID_FACILITY_DATA = DATA_REQ_ID_FACILITIES_IN_RANGE + 2 * FACILITY_CACHE_TYPES,
+        DATA_REQ_ID_WEATHER       = DATA_REQ_ID_FACILITY_DATA + FACILITY_FETCH_WINDOW * FACILITY_FETCH_IDS_PER_SLOT,
+        DATA_REQ_ID_SPAWN         = DATA_REQ_ID_WEATHER + WEATHER_REQUEST_IDS,
+        DATA_REQ_ID_MUX_FIRST     = DATA_REQ_ID_SPAWN + SPAWN_VEHICLES_MAX
+    };
+
+    enum DATA_DEF_ID
+    {
+        DATA_DEF_ID_GROUND_VEHICLE,
+        DATA_DEF_ID_SCAN,
+        DATA_DEF_ID_FACILITY_DATA,
+        DATA_DEF_ID_MUX_FIRST
+    };
+
+    // Layouts of the data received from the sim
+#pragma pack (push, 1)
+    typedef struct DataUserObject
+    {
+        DataUserObject ()
+        {
+            dLat  = 0.0;
+            dLon  = 0.0;
+            dHead = 0.0;
+            dAlt  = 0.0;
+        }
+        
+        LatLon Position () const
+        {
+            LatLon pos = { CAngle::Degrees (dLat), CAngle::Degrees (dLon) };
+            return pos;
+        }
+
+        CHeading Heading () const
+        {
+            return CHeading::Degrees (dHead);
+        }
+
+        double dLat;
+        double dLon;
+        double dHead;
+        double dAlt;
+    }
+    DataUserObject;
+
+    typedef struct DataGroundVehicle
+    {
+        DataGroundVehicle ()
+        {
+            dRudderPos = 0.0;
+        }
+
+        double dRudderPos;
+    }
+    DataGroundVehicle;
+#pragma pack (pop)
+
+    static const TCHAR* GetExceptionStr (SIMCONNECT_EXCEPTION exception)
+    {
+        switch (exception)
+        {
+            case SIMCONNECT_EXCEPTION_NONE:                                 return _T("None");
+            case SIMCONNECT_EXCEPTION_ERROR:                                return _T("Error");
+            case SIMCONNECT_EXCEPTION_SIZE_MISMATCH:                        return _T("Size Mismatch");
+            case SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID:                      return _T("Unrecognized Id");
+            case SIMCONNECT_EXCEPTION_UNOPENED:                             return _T("Unopened");
+            case SIMCONNECT_EXCEPTION_VERSION_MISMATCH:                     return _T("Version Mismatch");
+            case SIMCONNECT_EXCEPTION_TOO_MANY_GROUPS:                      return _T("Too Many Groups");
+            case SIMCONNECT_EXCEPTION_NAME_UNRECOGNIZED:                    return _T("Name Unrecognized");
+            case SIMCONNECT_EXCEPTION_TOO_MANY_EVENT_NAMES:                 return _T("Too Many Event Names");
+            case SIMCONNECT_EXCEPTION_EVENT_ID_DUPLICATE:                   return _T("Event Id Duplicate");
+            case SIMCONNECT_EXCEPTION_TOO_MANY_MAPS:                        return _T("Too Many Maps");
+            case SIMCONNECT_EXCEPTION_TOO_MANY_OBJECTS:                     return _T("Too Many Objects");
+            case SIMCONNECT_EXCEPTION_TOO_MANY_REQUESTS:                    return _T("Too Many Requests");
+            case SIMCONNECT_EXCEPTION_WEATHER_INVALID_PORT:                 return _T("Weather Invalid Port");
+            case SIMCONNECT_EXCEPTION_WEATHER_INVALID_METAR:                return _T("Weather Invalid Metar");
+            case SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_GET_OBSERVATION:    return _T("Weather Unable to Get Observation");
+            case SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_CREATE_STATION:     return _T("Weather Unable to Create Station");
+            case SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_REMOVE_STATION:     return _T("Weather Unable to Remove Station");
+            case SIMCONNECT_EXCEPTION_INVALID_DATA_TYPE:                    return _T("Invalid Data Type");
+            case SIMCONNECT_EXCEPTION_INVALID_DATA_SIZE:                    return _T("Invalid Data Size");
+            case SIMCONNECT_EXCEPTION_DATA_ERROR:                           return _T("Data Error");
+            case SIMCONNECT_EXCEPTION_INVALID_ARRAY:                        return _T("Invalid Array");
+            case SIMCONNECT_EXCEPTION_CREATE_OBJECT_FAILED:                 return _T("Create Object Failed");
+            case SIMCONNECT_EXCEPTION_LOAD_FLIGHTPLAN_FAILED:               return _T("Load Flightplan Failed");
+            case SIMCONNECT_EXCEPTION_OPERATION_INVALID_FOR_OBJECT_TYPE:    return _T("Operation Invalid For Object Type");
+            case SIMCONNECT_EXCEPTION_ILLEGAL_OPERATION:                    return _T("Illegal Operation");
+            case SIMCONNECT_EXCEPTION_ALREADY_SUBSCRIBED:                   return _T("Already Subscribed");
+            case SIMCONNECT_EXCEPTION_INVALID_ENUM:                         return _T("Invalid Enum");
+            case SIMCONNECT_EXCEPTION_DEFINITION_ERROR:                     return _T("Definition Error");
+            case SIMCONNECT_EXCEPTION_DUPLICATE_ID:                         return _T("Duplicate Id");
+            case SIMCONNECT_EXCEPTION_DATUM_ID:                             return _T("Datum Id");
+            case SIMCONNECT_EXCEPTION_OUT_OF_BOUNDS:                        return _T("Out of Bounds");
+            case SIMCONNECT_EXCEPTION_ALREADY_CREATED:                      return _T("Already Created");
+            case SIMCONNECT_EXCEPTION_OBJECT_OUTSIDE_REALITY_BUBBLE:        return _T("Object Outside Reality Bubble");
+            case SIMCONNECT_EXCEPTION_OBJECT_CONTAINER:                     return _T("Object Container");
+            case SIMCONNECT_EXCEPTION_OBJECT_AI:                            return _T("Object AI");
+            case SIMCONNECT_EXCEPTION_OBJECT_ATC:                           return _T("Object ATC");
+            case SIMCONNECT_EXCEPTION_OBJECT_SCHEDULE:                      return _T("Object Schedule");
+            default:                                                        return _T("(Unknown)");
+        }
+    }
+
+private:
+    static const DWORD MUX_GROUPS_MAX      = 32;
+    static const DWORD DISPATCH_TIMEOUT_MS = 100;
+    static const DWORD SCAN_INTERVAL_SEC   = 5;
+    static const DWORD SCAN_TIMEOUT_MS     = 10000;
+    static const DWORD SCAN_RADIUS_METERS  = 10000;
+    static const DWORD NEARBY_COUNT        = 5;
+    static const DWORD NEARBY_AIRPORTS     = 10;   // Whose ground layouts to fetch
+    static const int   TAXI_NODE_FT        = 500;  // Farthest the vehicle can be from the taxiways to be routed
+    static const int   FOLLOW_SQUARE_FT    = 150;
+
+    enum NOTIFY_GROUP_ID
+    {
+        NOTIFY_GROUP_ID_KEYBOARD
+    };
+
+    enum INPUT_GROUP_ID
+    {
+        INPUT_GROUP_ID_KEYBOARD
+    };
+
+
+
+    void CALLBACK DispatchProc (SIMCONNECT_RECV* pData,
+                                DWORD            cbData)
+    {
+        switch (pData->dwID)
+        {
+            case SIMCONNECT_RECV_ID_OPEN:
+            {
+                // Airports and navaids can be looked up right away from the cache, while the sim's lists come in
+                if (m_facilities.Open (m_hSimConnect, "DemoRudderPos", (SIMCONNECT_RECV_OPEN*)pData))
+                {
+                    _tprintf (_T("Facilities cached: %u airports, %u waypoints, %u NDBs, %u VORs.\n"),
+                              m_facilities.Count (SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT), m_facilities.Count (SIMCONNECT_FACILITY_LIST_TYPE_WAYPOINT),
+                              m_facilities.Count (SIMCONNECT_FACILITY_LIST_TYPE_NDB), m_facilities.Count (SIMCONNECT_FACILITY_LIST_TYPE_VOR));
+                }
+
+                // Only MSFS says what goes out of range; without it there are no nearest facilities
+                m_range.Open (m_hSimConnect);
+                m_fetcher.Open (m_hSimConnect, AirportProc_, this);
+                m_weather.Open (m_hSimConnect);
+                break;
+            }
+
+            case SIMCONNECT_RECV_ID_AIRPORT_LIST:
+            case SIMCONNECT_RECV_ID_WAYPOINT_LIST:
+            case SIMCONNECT_RECV_ID_NDB_LIST:
+            case SIMCONNECT_RECV_ID_VOR_LIST:
+                if (!m_facilities.OnFacilitiesList (pData)) m_range.OnFacilitiesList (pData);
+                break;
+
+            case SIMCONNECT_RECV_ID_EVENT:
+            {
+                SIMCONNECT_RECV_EVENT* evt = (SIMCONNECT_RECV_EVENT*)pData;
+
+                if (m_scheduler.OnRecv (pData)) break;
+
+                switch (evt->uEventID)
+                {
+                    case EVENT_ID_CREATE:
+                    {
+                        if (!m_bDataUserObjectSet)
+                        {
+                            _tprintf (_T("No data from user object yet!\n"));
+                            break;
+                        }
+                        else if (m_idObjGroundVehicle)
+                        {
+                            _tprintf (_T("Ground vehicle already created!\n"));
+                        }
+                        else
+                        {
+                            // 50 feet in front of user aircraft, heading 90 degrees to the right so we can see wheels
+                            m_formation.Clear ();
+                            m_formation.Add (50.0, 0.0, 90.0);
+
+                            // Create the ground vehicle
+                            Spawn (m_formation,
+                                #ifdef SIM_MSFS2020
+                                    "ASO_Pushback_Blue",
+                                #else
+                                    "VEH_jetTruck",
+                                #endif
+                                DATA_REQ_ID_SPAWN
+                            );
+                        }
+                        break;
+                    }
+
+                    case EVENT_ID_FOLLOW:
+                    {
+                        const CObjectRegistry::SimObject* pVehicle = m_registry.Find (m_idObjGroundVehicle);
+
+                        if (!m_idObjGroundVehicle)
+                        {
+                            _tprintf (_T("Create the ground vehicle first!\n"));
+                        }
+                        else if (m_follower.IsFollowing (m_idObjGroundVehicle))
+                        {
+                            StopFollowing ();
+                        }
+                        else if (pVehicle == NULL || !pVehicle->bPosition)
+                        {
+                            _tprintf (_T("No position for the ground vehicle yet!\n"));
+                        }
+                        else if (!FollowTaxiRoute (*pVehicle))
+                        {
+                            // A square to the right, starting straight ahead, ending where the vehicle is now
+                            LatLon   corner  = { CAngle::Degrees (pVehicle->dLat), CAngle::Degrees (pVehicle->dLon) };
+                            CHeading heading = CHeading::Degrees (pVehicle->dHead);
+                            double   lats[4];
+                            double   lons[4];
+
+                            for (int i = 0; i < 4; i++)
+                            {
+                                corner  = m_frame.Translate (corner, heading + CAngle::Degrees (90.0 * i), CDistance::Feet (FOLLOW_SQUARE_FT));
+                                lats[i] = corner.lat.Deg ();
+                                lons[i] = corner.lon.Deg ();
+                            }
+
+                            _tprintf (_T("Following a %d ft square...\n"), FOLLOW_SQUARE_FT);
+                            m_follower.Follow (m_idObjGroundVehicle, lats, lons, 4);
+                        }
+                        break;
+                    }
+
+                    case EVENT_ID_NEARBY:
+                    {
+                        if (!m_bDataUserObjectSet)
+                        {
+                            _tprintf (_T("No data from user object yet!\n"));
+                            break;
+                        }
+
+                        std::vector<CSpatialGrid::Hit> hits;
+                        m_grid.KNearest (m_dataUserObject.dLat, m_dataUserObject.dLon, NEARBY_COUNT, hits);
+
+                        _tprintf (_T("%u objects known, %u nearest:\n"), m_grid.Count (), (DWORD)hits.size ());
+                        for (size_t i = 0; i < hits.size (); i++)
+                        {
+                            const CObjectRegistry::SimObject* pObject = m_registry.Find (hits[i].idObject);
+                            _tprintf (_T("  object %u (%s) at %.0f ft\n"), hits[i].idObject,
+                                      pObject && pObject->eType == SIMCONNECT_SIMOBJECT_TYPE_GROUND ? _T("ground") : _T("aircraft"),
+                                      hits[i].dDistFt);
+                        }
+
+                        std::vector<CFacilityRange::Hit> airports;
+                        double                           dNavaidFt = 0.0;
+                        const FacilityEntry*             pNavaid   = m_range.NearestNavaid (m_dataUserObject.dLat, m_dataUserObject.dLon, &dNavaidFt);
+                        TCHAR                            szIcao[9];
+
+                        m_range.KNearest (SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT, m_dataUserObject.dLat, m_dataUserObject.dLon, NEARBY_AIRPORTS, airports);
+                        if (!airports.empty ())
+                        {
+                            _tprintf (_T("  nearest airport %s at %.1f nm\n"), IcaoText (*airports[0].pFacility, szIcao), CDistance::Feet (airports[0].dDistFt).Nm ());
+                        }
+
+                        // FetchTask fetches these as airports come into range; the key asks for them right away
+                        for (size_t i = 0; i < airports.size (); i++) m_fetcher.Fetch (airports[i].pFacility->szIcao, m_scheduler.SimTime ());
+                        if (pNavaid != NULL)
+                        {
+                            _tprintf (_T("  nearest navaid %s at %.1f nm\n"), IcaoText (*pNavaid, szIcao), CDistance::Feet (dNavaidFt).Nm ());
+                        }
+
+                        WeatherSample weather;
+                        if (m_weather.Query (m_dataUserObject.dLat, m_dataUserObject.dLon, m_scheduler.SimTime (), weather))
+                        {
+                            _tprintf (_T("  wind %03.0f at %.0f kt, %.0f C, %.0f hPa\n"),
+                                      weather.WindFromDeg (), weather.WindKt (), weather.fTemperatureC, weather.fPressureHpa);
+                        }
+                        break;
+                    }
+
+                    case EVENT_ID_QUIT:
+                        _tprintf (_T("QUIT key pressed.\n"));
+                        m_bQuit = true;
+                        break;
+
+                    case EVENT_ID_RUDDER_LEFT:
+                        if (!m_idObjGroundVehicle)
+                        {
+                            _tprintf (_T("Create the ground vehicle first!\n"));
+                        }
+                        else if (m_dataGroundVehicle.dRudderPos > -1.0)
+                        {
+                            // Manual steering takes over from the path follower
+                            StopFollowing ();
+
+                            m_dataGroundVehicle.dRudderPos -= 0.1;
+                            _tprintf (_T("Setting rudder position to %f...\n"), m_dataGroundVehicle.dRudderPos);
+
+                            SimConnect_SetDataOnSimObject (
+                                m_hSimConnect,
+                                DATA_DEF_ID_GROUND_VEHICLE,
+                                m_idObjGroundVehicle,
+                                SIMCONNECT_DATA_SET_FLAG_DEFAULT,
+                                1,
+                                sizeof (m_dataGroundVehicle),
+                                &m_dataGroundVehicle
+                            );
+                        }
+                        break;
+
+                    case EVENT_ID_RUDDER_RIGHT:
+                        if (!m_idObjGroundVehicle)
+                        {
+                            _tprintf (_T("Create the ground vehicle first!\n"));
+                        }
+                        else if (m_dataGroundVehicle.dRudderPos < 1.0)
+                        {
+                            // Manual steering takes over from the path follower
+                            StopFollowing ();
+
+                            m_dataGroundVehicle.dRudderPos += 0.1;
+                            _tprintf (_T("Setting rudder position to %f...\n"), m_dataGroundVehicle.dRudderPos);
+
+                            SimConnect_SetDataOnSimObject (
+                                m_hSimConnect,
+                                DATA_DEF_ID_GROUND_VEHICLE,
+                                m_idObjGroundVehicle,
+                                SIMCONNECT_DATA_SET_FLAG_DEFAULT,
+                                1,
+                                sizeof (m_dataGroundVehicle),
+                                &m_dataGroundVehicle
+                            );
+                        }
+                        break;
+                }
+                break;
+            }
+
+            case SIMCONNECT_RECV_ID_ASSIGNED_OBJECT_ID:
+            {
+                SIMCONNECT_RECV_ASSIGNED_OBJECT_ID* pObjData = (SIMCONNECT_RECV_ASSIGNED_OBJECT_ID*)pData;
+                DWORD                               iVehicle = pObjData->dwRequestID - DATA_REQ_ID_SPAWN;
+
+                if (iVehicle < m_spawned.size ()) OnSpawned (iVehicle, pObjData->dwObjectID);
+                break;
+            }
+
+            case SIMCONNECT_RECV_ID_SIMOBJECT_DATA:
+            {
+                SIMCONNECT_RECV_SIMOBJECT_DATA* pObjData = (SIMCONNECT_RECV_SIMOBJECT_DATA*)pData;
+
+                if (m_mux.OnSimObjectData (pObjData)) break;
+
+                switch (pObjData->dwRequestID)
+                {
+                    case DATA_REQ_ID_GROUND_VEHICLE:
+                        memcpy ((void*)&m_dataGroundVehicle, &pObjData->dwData, sizeof (m_dataGroundVehicle));
+                        Publish (BUS_KIND_RUDDER, pObjData->dwObjectID, &m_dataGroundVehicle.dRudderPos, 1);
+                        if (!m_follower.IsFollowing (m_idObjGroundVehicle))
+                        {
+                            _tprintf (_T("Rudder position is now %f\n"), m_dataGroundVehicle.dRudderPos);
+                        }
+                        break;
+                }
+                break;
+            }
+
+            case SIMCONNECT_RECV_ID_SIMOBJECT_DATA_BYTYPE:
+            {
+                SIMCONNECT_RECV_SIMOBJECT_DATA_BYTYPE* pObjData = (SIMCONNECT_RECV_SIMOBJECT_DATA_BYTYPE*)pData;
+
+                switch (pObjData->dwRequestID)
+                {
+                    case DATA_REQ_ID_SCAN_AIRCRAFT:
+                        OnScanData (pObjData, SIMCONNECT_SIMOBJECT_TYPE_AIRCRAFT);
+                        break;
+
+                    case DATA_REQ_ID_SCAN_GROUND:
+                        OnScanData (pObjData, SIMCONNECT_SIMOBJECT_TYPE_GROUND);
+                        break;
+                }
+                break;
+            }
+
+            case SIMCONNECT_RECV_ID_EVENT_FRAME:
+                m_scheduler.OnRecv (pData);
+                break;
+
+            case SIMCONNECT_RECV_ID_EVENT_OBJECT_ADDREMOVE:
+            {
+                SIMCONNECT_RECV_EVENT_OBJECT_ADDREMOVE* evt = (SIMCONNECT_RECV_EVENT_OBJECT_ADDREMOVE*)pData;
+
+                if (m_registry.OnAddRemove (evt))
+                {
+                    // Requests on a removed object will never be answered again
+                    m_mux.RemoveObject (evt->dwData);
+                    m_grid.Remove (evt->dwData);
+
+                    m_follower.Stop (evt->dwData);
+                    m_reckoner.Remove (evt->dwData);
+                    m_filter.Remove (evt->dwData);
+
+                    if (evt->dwData == m_idObjGroundVehicle)
+                    {
+                        _tprintf (_T("Ground vehicle was removed by the sim.\n"));
+                        m_mux.Unsubscribe (m_idSubGroundVehicle);
+                        m_idSubGroundVehicle = 0;
+                        m_idObjGroundVehicle = 0;
+                        m_dataGroundVehicle  = DataGroundVehicle ();
+                    }
+                }
+                break;
+            }
+
+            case SIMCONNECT_RECV_ID_QUIT:
+                _tprintf (_T("Simulator quit received.\n"));
+                m_bQuit = true;
+                break;
+
+            case SIMCONNECT_RECV_ID_EXCEPTION:
+            {
+                SIMCONNECT_RECV_EXCEPTION* pEx = (SIMCONNECT_RECV_EXCEPTION*)pData;
+                _tprintf (_T("Exception! Code=%u, Message=%s\n"),
+                          pEx->dwException, GetExceptionStr ((SIMCONNECT_EXCEPTION)pEx->dwException));
+                break;
+            }
+
+            default:
+                if (!m_fetcher.OnRecv (pData)) m_weather.OnRecv (pData);
+                break;
+        }
+    }
+
+    /**
+     * Set up the events, subscriptions and data definitions of a new connection.
+     */
+    void Setup ()
+    {
+        _tprintf (
+            _T("Connected to sim! Press:\n")
+            _T("  C to create the ground vehicle\n")
+            _T("  A to move rudder left\n")
+            _T("  D to move rudder right\n")
+            _T("  F to drive the ground vehicle to a parking spot, or around a square, or stop\n")
+            _T("  N to list the objects nearest to the aircraft\n")
+            _T("  X to quit\n")
+        );
+
+        // Create private events
+        SimConnect_MapClientEventToSimEvent (m_hSimConnect, EVENT_ID_CREATE);
+        SimConnect_MapClientEventToSimEvent (m_hSimConnect, EVENT_ID_RUDDER_LEFT);
+        SimConnect_MapClientEventToSimEvent (m_hSimConnect, EVENT_ID_RUDDER_RIGHT);
+        SimConnect_MapClientEventToSimEvent (m_hSimConnect, EVENT_ID_FOLLOW);
+        SimConnect_MapClientEventToSimEvent (m_hSimConnect, EVENT_ID_NEARBY);
+        SimConnect_MapClientEventToSimEvent (m_hSimConnect, EVENT_ID_QUIT);
+
+        // Assign the private events to a notification group
+        SimConnect_AddClientEventToNotificationGroup (m_hSimConnect, NOTIFY_GROUP_ID_KEYBOARD, EVENT_ID_CREATE);
+        SimConnect_AddClientEventToNotificationGroup (m_hSimConnect, NOTIFY_GROUP_ID_KEYBOARD, EVENT_ID_RUDDER_LEFT);
+        SimConnect_AddClientEventToNotificationGroup (m_hSimConnect, NOTIFY_GROUP_ID_KEYBOARD, EVENT_ID_RUDDER_RIGHT);
+        SimConnect_AddClientEventToNotificationGroup (m_hSimConnect, NOTIFY_GROUP_ID_KEYBOARD, EVENT_ID_FOLLOW);
+        SimConnect_AddClientEventToNotificationGroup (m_hSimConnect, NOTIFY_GROUP_ID_KEYBOARD, EVENT_ID_NEARBY);
+        SimConnect_AddClientEventToNotificationGroup (m_hSimConnect, NOTIFY_GROUP_ID_KEYBOARD, EVENT_ID_QUIT);
+
+        // Link the private events to keyboard keys
+        SimConnect_MapInputEventToClientEvent (m_hSimConnect, INPUT_GROUP_ID_KEYBOARD, "C", EVENT_ID_CREATE);
+        SimConnect_MapInputEventToClientEvent (m_hSimConnect, INPUT_GROUP_ID_KEYBOARD, "A", EVENT_ID_RUDDER_LEFT);
+        SimConnect_MapInputEventToClientEvent (m_hSimConnect, INPUT_GROUP_ID_KEYBOARD, "D", EVENT_ID_RUDDER_RIGHT);
+        SimConnect_MapInputEventToClientEvent (m_hSimConnect, INPUT_GROUP_ID_KEYBOARD, "F", EVENT_ID_FOLLOW);
+        SimConnect_MapInputEventToClientEvent (m_hSimConnect, INPUT_GROUP_ID_KEYBOARD, "N", EVENT_ID_NEARBY);
+        SimConnect_MapInputEventToClientEvent (m_hSimConnect, INPUT_GROUP_ID_KEYBOARD, "X", EVENT_ID_QUIT);
+
+        // Turn on notifications for the private events
+        SimConnect_SetInputGroupState (m_hSimConnect, NOTIFY_GROUP_ID_KEYBOARD, SIMCONNECT_STATE_ON);
+
+        // Keep track of objects added and removed by the sim
+        m_registry.Subscribe (m_hSimConnect, EVENT_ID_OBJECT_ADDED, EVENT_ID_OBJECT_REMOVED);
+
+        // Subscribe to data on user object, every second, for the weather and the local frame to follow it
+        m_mux.Attach (m_hSimConnect);
+        m_mux.Subscribe (
+            SIMCONNECT_OBJECT_ID_USER,
+            SIMCONNECT_PERIOD_SECOND,
+            s_fieldsUserObject,
+            _countof (s_fieldsUserObject),
+            UserObjectProc_,
+            this
+        );
+
+        // Set up data definition for the radius scan, same layout as the user object
+        for (DWORD i = 0; i < _countof (s_fieldsUserObject); i++)
+        {
+            SimConnect_AddToDataDefinition (
+                m_hSimConnect,
+                DATA_DEF_ID_SCAN,
+                s_fieldsUserObject[i].szSimVar,
+                s_fieldsUserObject[i].szUnits,
+                SIMCONNECT_DATATYPE_FLOAT64
+            );
+        }
+
+        // Periodic work runs on sim frames: timers and steering every frame, request rates six times a second,
+        //  and a rescan of the objects around the aircraft every few seconds
+        m_scheduler.Subscribe (m_hSimConnect, EVENT_ID_FRAME, EVENT_ID_6HZ, EVENT_ID_1SEC, EVENT_ID_PAUSE);
+        m_scheduler.AddTask (CFrameScheduler::SCHEDULE_FRAME, TimerTask_, this);
+        m_scheduler.AddTask (CFrameScheduler::SCHEDULE_FRAME, SteerTask_, this);
+        m_scheduler.AddTask (CFrameScheduler::SCHEDULE_6HZ, RateTask_, this);
+        m_scheduler.AddTask (CFrameScheduler::SCHEDULE_1SEC, ScanTask_, this);
+        m_scheduler.AddTask (CFrameScheduler::SCHEDULE_1SEC, WeatherTask_, this);
+        m_scheduler.AddTask (CFrameScheduler::SCHEDULE_1SEC, FetchTask_, this);
+
+        // Set up data definition for the ground vehicle
+        SimConnect_AddToDataDefinition (
+            m_hSimConnect,
+            DATA_DEF_ID_GROUND_VEHICLE,
+            "RUDDER POSITION",
+            UnitPosition::NAME,
+            SIMCONNECT_DATATYPE_FLOAT64
+        );
+    }
+
+    /**
+     * Publish every sample received from the sim on the telemetry bus "DemoRudderPos.<dwConfigIndex>", for local
+     *  processes that want them without opening connections of their own. The demo runs without it if it cannot be
+     *  had, e.g. because another demo on the same sim has it. With SetRecord, the samples are also recorded.
+     */
+    void OpenBus (DWORD dwConfigIndex)
+    {
+        char szName[64];
+        snprintf (szName, sizeof (szName), "DemoRudderPos.%u", dwConfigIndex);
+
+        if (!m_bus.Open (szName)) _tprintf (_T("Not publishing telemetry for sim %u.\n"), dwConfigIndex);
+        if (!m_bRecord) return;
+
+        snprintf (szName, sizeof (szName), "DemoRudderPos.%u.trec", dwConfigIndex);
+        if (!m_recorder.Open (szName)) _tprintf (_T("Not recording telemetry for sim %u.\n"), dwConfigIndex);
+    }
+
+    /**
+     * A sample for the bus, and the recording if there is one.
+     */
+    void Publish (BUS_KIND      eKind,
+                  DWORD         idObject,
+                  const double* pValues,
+                  DWORD         cValues)
+    {
+        m_bus.Publish (eKind, idObject, m_scheduler.SimTime (), pValues, cValues);
+        m_recorder.Record (eKind, idObject, m_scheduler.SimTime (), pValues, cValues);
+    }
+
+    /**
+     * Request all aircraft and ground vehicles within the scan radius. Replies arrive one object per message.
+     */
+    void StartScan ()
+    {
+        m_nScan++;
+        m_cScanPending   = 2;
+        m_cSecondsToScan = SCAN_INTERVAL_SEC - 1;
+
+        // Should the sim never answer, give up and let the next scan start
+        m_timers.Cancel (m_idTimerScan);
+        m_idTimerScan = m_timers.Schedule (SCAN_TIMEOUT_MS, 0, ScanTimeoutProc_, this);
+
+        SimConnect_RequestDataOnSimObjectType (
+            m_hSimConnect,
+            DATA_REQ_ID_SCAN_AIRCRAFT,
+            DATA_DEF_ID_SCAN,
+            SCAN_RADIUS_METERS,
+            SIMCONNECT_SIMOBJECT_TYPE_AIRCRAFT
+        );
+        SimConnect_RequestDataOnSimObjectType (
+            m_hSimConnect,
+            DATA_REQ_ID_SCAN_GROUND,
+            DATA_DEF_ID_SCAN,
+            SCAN_RADIUS_METERS,
+            SIMCONNECT_SIMOBJECT_TYPE_GROUND
+        );
+    }
+
+    void OnScanData (SIMCONNECT_RECV_SIMOBJECT_DATA_BYTYPE* pObjData,
+                     SIMCONNECT_SIMOBJECT_TYPE              eType)
+    {
+        // An empty result still arrives as a single message with nothing out of nothing
+        if (pObjData->dwoutof > 0)
+        {
+            // Copied out rather than cast, which would alias the DWORD it starts at
+            DataUserObject data;
+            memcpy ((void*)&data, &pObjData->dwData, sizeof (data));
+
+            m_registry.SetPosition (pObjData->dwObjectID, eType, data.dLat, data.dLon, data.dHead, data.dAlt).nScan = m_nScan;
+            m_grid.Update (pObjData->dwObjectID, data.dLat, data.dLon);
+            Publish (BUS_KIND_SCAN, pObjData->dwObjectID, &data.dLat, 4);
+        }
+
+        // Replies to a scan that timed out may still trickle in
+        if (pObjData->dwentrynumber >= pObjData->dwoutof && m_cScanPending > 0 && --m_cScanPending == 0)
+        {
+            m_timers.Cancel (m_idTimerScan);
+
+            // Whatever was not seen in this scan has left the radius
+            CSpatialGrid& grid  = m_grid;
+            DWORD         nScan = m_nScan;
+
+            m_registry.ForEach ([&grid, nScan] (DWORD idObject, CObjectRegistry::SimObject& object)
+            {
+                if (object.nScan != nScan) grid.Remove (idObject);
+            });
+        }
+    }
+
+    /**
+     * Steer the vehicles by the filtered estimate of where they are this frame rather than by their last samples,
+     *  which are noisy and, between fixes, old.
+     */
+    void PredictVehicles ()
+    {
+        for (DWORD i = 0; i < m_follower.Count (); i++)
+        {
+            DWORD                 idObject = m_follower.ObjectAt (i);
+            CKalmanBank::Estimate estimate;
+
+            if (m_filter.EstimateAt (idObject, m_scheduler.SimTime (), estimate))
+            {
+                m_follower.SetState (idObject, estimate.dLat, estimate.dLon, estimate.dHead);
+            }
+        }
+    }
+
+    /**
+     * Request the ground vehicle's position as often as the dead reckoner needs it. This is done from a task rather
+     *  than from GroundVehicleProc, since the mux must not be changed while it calls its consumers.
+     */
+    void AdjustGroundVehicleRate ()
+    {
+        if (m_idSubGroundVehicle == 0) return;
+
+        DWORD cFrames = m_reckoner.FramesOf (m_idObjGroundVehicle);
+        if (cFrames == m_cFramesGroundVehicle) return;
+
+        DWORD idSub = m_mux.SetInterval (m_idSubGroundVehicle, cFrames - 1);
+        if (idSub == 0) return;
+
+        m_idSubGroundVehicle   = idSub;
+        m_cFramesGroundVehicle = cFrames;
+    }
+
+    /**
+     * Run the path follower for all vehicles and write the rudder positions that changed. A vehicle at the end of
+     *  its path gets its rudder straightened one last time and is no longer followed.
+     */
+    void SteerVehicles ()
+    {
+        m_follower.Update ();
+
+        // Backwards, as Stop moves the last vehicle into the place of the one stopped
+        for (DWORD i = m_follower.Count (); i-- > 0; )
+        {
+            DWORD             idObject = m_follower.ObjectAt (i);
+            DataGroundVehicle data;
+            data.dRudderPos = m_follower.RudderAt (i);
+
+            if (idObject != m_idObjGroundVehicle || fabs (data.dRudderPos - m_dataGroundVehicle.dRudderPos) >= 0.005)
+            {
+                if (idObject == m_idObjGroundVehicle) m_dataGroundVehicle = data;
+
+                SimConnect_SetDataOnSimObject (
+                    m_hSimConnect,
+                    DATA_DEF_ID_GROUND_VEHICLE,
+                    idObject,
+                    SIMCONNECT_DATA_SET_FLAG_DEFAULT,
+                    1,
+                    sizeof (data),
+                    &data
+                );
+            }
+
+            if (m_follower.IsDoneAt (i))
+            {
+                _tprintf (_T("Object %u reached the end of its path.\n"), idObject);
+                m_follower.Stop (idObject);
+            }
+        }
+    }
+
+    /**
+     * Create one object of a container title per vehicle of a formation around the user aircraft, on the ground at
+     *  its altitude, up to SPAWN_VEHICLES_MAX of them. The sim answers each with an ASSIGNED_OBJECT_ID for
+     *  idRequestFirst plus the index of the vehicle in the formation.
+     */
+    void Spawn (CFormation& formation,
+                const char* szContainerTitle,
+                DATA_REQ_ID idRequestFirst)
+    {
+        formation.Place (m_dataUserObject.dLat, m_dataUserObject.dLon, m_dataUserObject.dHead);
+        m_spawned.assign (std::min (formation.Count (), (uint32_t)SPAWN_VEHICLES_MAX), 0);
+        if (m_spawned.size () < formation.Count ())
+        {
+            _tprintf (_T("Spawning %u of %u vehicles; %u dropped.\n"),
+                      (DWORD)m_spawned.size (), formation.Count (), formation.Count () - (DWORD)m_spawned.size ());
+        }
+
+        for (uint32_t i = 0; i < m_spawned.size (); i++)
+        {
+            SIMCONNECT_DATA_INITPOSITION initPos = {};
+
+            initPos.Altitude  = m_dataUserObject.dAlt;
+            initPos.Latitude  = formation.LatAt (i);
+            initPos.Longitude = formation.LonAt (i);
+            initPos.Heading   = formation.HeadAt (i);
+            initPos.OnGround  = 1;
+
+            SimConnect_AICreateSimulatedObject (m_hSimConnect, szContainerTitle, initPos, idRequestFirst + i);
+        }
+    }
+
+    /**
+     * The sim created vehicle iVehicle of the formation spawned last. The first is the one the demo drives, with
+     *  its rudder watched and its position subscribed to.
+     */
+    void OnSpawned (DWORD iVehicle,
+                    DWORD idObject)
+    {
+        m_spawned[iVehicle] = idObject;
+        m_registry.Add (idObject, SIMCONNECT_SIMOBJECT_TYPE_GROUND);
+        if (iVehicle != 0) return;
+
+        // A vehicle created before is no longer driven
+        if (m_idSubGroundVehicle != 0) m_mux.Unsubscribe (m_idSubGroundVehicle);
+
+        m_idObjGroundVehicle = idObject;
+        _tprintf (_T("Recevied object id %u for ground vehicle.\n"), m_idObjGroundVehicle);
+
+        // Request data on ground vehicle
+        SimConnect_RequestDataOnSimObject (
+            m_hSimConnect,
+            DATA_REQ_ID_GROUND_VEHICLE,
+            DATA_DEF_ID_GROUND_VEHICLE,
+            m_idObjGroundVehicle,
+            SIMCONNECT_PERIOD_SIM_FRAME,
+            SIMCONNECT_DATA_REQUEST_FLAG_CHANGED
+        );
+
+        // Its position and heading feed the path follower, every frame until the dead reckoner knows better
+        m_cFramesGroundVehicle = 1;
+        m_idSubGroundVehicle   = m_mux.Subscribe (
+            m_idObjGroundVehicle,
+            SIMCONNECT_PERIOD_SIM_FRAME,
+            s_fieldsUserObject,
+            _countof (s_fieldsUserObject),
+            GroundVehicleProc_,
+            this
+        );
+    }
+
+    /**
+     * Send the vehicle along the taxiways to the next parking spot of the airport it is at, if its layout has been
+     *  fetched; false if not.
+     */
+    bool FollowTaxiRoute (const CObjectRegistry::SimObject& vehicle)
+    {
+        std::vector<CFacilityRange::Hit> airports;
+        const AirportModel*              pAirport;
+
+        m_range.KNearest (SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT, vehicle.dLat, vehicle.dLon, 1, airports);
+        if (airports.empty ()) return false;
+
+        pAirport = m_fetcher.Find (airports[0].pFacility->szIcao);
+        if (pAirport == NULL || pAirport->cParkings == 0) return false;
+
+        if (pAirport != m_pRouterAirport)
+        {
+            m_router.Build (*pAirport);
+            m_pRouterAirport = pAirport;
+        }
+
+        double dNodeFt = 0.0;
+        DWORD  iFrom   = m_router.NearestNode (vehicle.dLat, vehicle.dLon, &dNodeFt);
+        DWORD  iTo     = m_router.ParkingNode (m_iParking++ % pAirport->cParkings);
+        double dLengthFt;
+
+        if (iFrom == TAXI_ROUTER_NONE || dNodeFt > TAXI_NODE_FT || !m_router.Route (iFrom, iTo, m_routeLats, m_routeLons, &dLengthFt)) return false;
+
+        _tprintf (_T("Taxiing %.0f ft to a parking spot, %u waypoints...\n"), dLengthFt, (DWORD)m_routeLats.size ());
+        m_follower.Follow (m_idObjGroundVehicle, m_routeLats.data (), m_routeLons.data (), (uint32_t)m_routeLats.size ());
+        return true;
+    }
+
+    void StopFollowing ()
+    {
+        if (!m_follower.IsFollowing (m_idObjGroundVehicle)) return;
+
+        _tprintf (_T("Stopped following the path.\n"));
+        m_follower.Stop (m_idObjGroundVehicle);
+    }
+
+    void SteerTask (double dSimSeconds)
+    {
+        if (m_follower.Count () == 0) return;
+
+        PredictVehicles ();
+        SteerVehicles ();
+    }
+
+    void ScanTask (double dSimSeconds)
+    {
+        if (m_cSecondsToScan > 0)
+        {
+            m_cSecondsToScan--;
+        }
+        else if (m_cScanPending == 0)
+        {
+            StartScan ();
+        }
+    }
+
+    /**
+     * Keep the weather around the aircraft at hand for the vehicles.
+     */
+    void WeatherTask (double dSimSeconds)
+    {
+        if (m_bDataUserObjectSet) m_weather.Prefetch (m_dataUserObject.dLat, m_dataUserObject.dLon, dSimSeconds);
+    }
+
+    /**
+     * Fetch the ground layouts of the airports nearest the aircraft whenever airports have come into range or left
+     *  it, and give up on those the sim has not sent the layouts of.
+     */
+    void FetchTask (double dSimSeconds)
+    {
+        DWORD nChanges = m_range.Changes (SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT);
+
+        if (m_bDataUserObjectSet && nChanges != m_nAirportChanges)
+        {
+            std::vector<CFacilityRange::Hit> airports;
+
+            m_nAirportChanges = nChanges;
+            m_range.KNearest (SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT, m_dataUserObject.dLat, m_dataUserObject.dLon, NEARBY_AIRPORTS, airports);
+            for (size_t i = 0; i < airports.size (); i++) m_fetcher.Fetch (airports[i].pFacility->szIcao, dSimSeconds);
+        }
+        m_fetcher.Expire (dSimSeconds);
+    }
+
+    /**
+     * The timers count milliseconds of sim time.
+     */
+    void TimerTask (double dSimSeconds)
+    {
+        m_timers.AdvanceTo ((uint64_t)(m_scheduler.SimTime () * 1000.0));
+    }
+
+    void ScanTimeoutProc ()
+    {
+        _tprintf (_T("Scan %u timed out with %u replies missing.\n"), m_nScan, m_cScanPending);
+        m_cScanPending = 0;
+    }
+
+    void GroundVehicleProc (DWORD         idObject,
+                            const double* pValues,
+                            DWORD         cValues)
+    {
+        DataUserObject data;
+        memcpy ((void*)&data, pValues, sizeof (data));
+
+        Publish (BUS_KIND_GROUND_VEHICLE, idObject, pValues, cValues);
+        m_registry.SetPosition (idObject, SIMCONNECT_SIMOBJECT_TYPE_GROUND, data.dLat, data.dLon, data.dHead, data.dAlt);
+        m_follower.SetState (idObject, data.dLat, data.dLon, data.dHead);
+        m_reckoner.OnFix (idObject, m_scheduler.SimTime (), data.dLat, data.dLon, data.dHead);
+
+        uint32_t idSample = idObject;
+        double   dTime    = m_scheduler.SimTime ();
+        m_filter.Update (1, &idSample, &dTime, &data.dLat, &data.dLon, &data.dHead);
+    }
+
+    void UserObjectProc (DWORD         idObject,
+                         const double* pValues,
+                         DWORD         cValues)
+    {
+        bool bFirst = !m_bDataUserObjectSet;
+
+        memcpy ((void*)&m_dataUserObject, pValues, sizeof (m_dataUserObject));
+        m_bDataUserObjectSet = true;
+        Publish (BUS_KIND_USER_OBJECT, idObject, pValues, cValues);
+
+        // Small offsets around the aircraft are done in its local tangent plane, which moves along with it
+        if (m_frame.Track (m_dataUserObject.dLat, m_dataUserObject.dLon) && !bFirst)
+        {
+            _tprintf (_T("Local frame moved to lat=%f, lon=%f.\n"), m_frame.LatAnchor (), m_frame.LonAnchor ());
+        }
+
+        m_registry.SetPosition (idObject, SIMCONNECT_SIMOBJECT_TYPE_USER,
+                                m_dataUserObject.dLat, m_dataUserObject.dLon, m_dataUserObject.dHead, m_dataUserObject.dAlt);
+
+        if (!bFirst) return;
+
+        _tprintf (_T("Received data for user object: lat=%f, lon=%f, head=%f, alt=%f\n"),
+                  m_dataUserObject.dLat, m_dataUserObject.dLon, m_dataUserObject.dHead, m_dataUserObject.dAlt);
+    }
+
+    /**
+     * An airport fetched for the ground vehicles.
+     */
+    void AirportProc (const char*         szIcao,
+                      const AirportModel* pAirport)
+    {
+        TCHAR szText[9];
+
+        for (int i = 0; i < 9; i++) szText[i] = (TCHAR)(unsigned char)szIcao[i];
+        szText[8] = _T('\0');
+
+        if (pAirport == NULL)
+        {
+            _tprintf (_T("Airport %s: no data.\n"), szText);
+            return;
+        }
+        _tprintf (_T("Airport %s: %u runways, %u taxi points, %u parking spots, %u taxi paths.\n"),
+                  szText, pAirport->cRunways, pAirport->cTaxiPoints, pAirport->cParkings, pAirport->cTaxiPaths);
+    }
+
+    /**
+     * The ICAO code of a facility, for _tprintf.
+     */
+    static const TCHAR* IcaoText (const FacilityEntry& facility,
+                                  TCHAR              (&szIcao)[9])
+    {
+        for (int i = 0; i < 9; i++) szIcao[i] = (TCHAR)(unsigned char)facility.szIcao[i];
+        szIcao[8] = _T('\0');
+        return szIcao;
+    }
+
+    /**
+     * Static method that calls the instance, which is passed as the context.
+     */
+    static void CALLBACK DispatchProc_ (SIMCONNECT_RECV* pData,
+                                        DWORD            cbData,
+                                        void*            pContext)
+    {
+        CDemoRudderPos* pThis = (CDemoRudderPos*)pContext;
+        pThis->DispatchProc (pData, cbData);
+    }
+
+    /**
+     * Static method that calls the instance, which is passed as the context.
+     */
+    static void CALLBACK AirportProc_ (const char*         szIcao,
+                                       const AirportModel* pAirport,
+                                       void*               pContext)
+    {
+        CDemoRudderPos* pThis = (CDemoRudderPos*)pContext;
+        pThis->AirportProc (szIcao, pAirport);
+    }
+
+    /**
+     * Static method that calls the instance, which is passed as the context.
+     */
+    static void CALLBACK UserObjectProc_ (DWORD         idObject,
+                                          const double* pValues,
+                                          DWORD         cValues,
+                                          void*         pContext)
+    {
+        CDemoRudderPos* pThis = (CDemoRudderPos*)pContext;
+        pThis->UserObjectProc (idObject, pValues, cValues);
+    }
+
+    /**
+     * Static method that calls the instance, which is passed as the context.
+     */
+    static void CALLBACK GroundVehicleProc_ (DWORD         idObject,
+                                             const double* pValues,
+                                             DWORD         cValues,
+                                             void*         pContext)
+    {
+        CDemoRudderPos* pThis = (CDemoRudderPos*)pContext;
+        pThis->GroundVehicleProc (idObject, pValues, cValues);
+    }
+
+
+    /**
+     * Static method that calls the instance, which is passed as the context.
+     */
+    static void CALLBACK TimerTask_ (double dSimSeconds,
+                                     void*  pContext)
+    {
+        CDemoRudderPos* pThis = (CDemoRudderPos*)pContext;
+        pThis->TimerTask (dSimSeconds);
+    }
+
+    /**
+     * Static method that calls the instance, which is passed as the context.
+     */
+    static void CALLBACK ScanTimeoutProc_ (uint64_t idTimer,
+                                           void*    pContext)
+    {
+        CDemoRudderPos* pThis = (CDemoRudderPos*)pContext;
+        pThis->ScanTimeoutProc ();
+    }
+
+    /**
+     * Static method that calls the instance, which is passed as the context.
+     */
+    static void CALLBACK SteerTask_ (double dSimSeconds,
+                                     void*  pContext)
+    {
+        CDemoRudderPos* pThis = (CDemoRudderPos*)pContext;
+        pThis->SteerTask (dSimSeconds);
+    }
+
+    /**
+     * Static method that calls the instance, which is passed as the context.
+     */
+    static void CALLBACK RateTask_ (double dSimSeconds,
+                                    void*  pContext)
+    {
+        CDemoRudderPos* pThis = (CDemoRudderPos*)pContext;
+        pThis->AdjustGroundVehicleRate ();
+    }
+
+    /**
+     * Static method that calls the instance, which is passed as the context.
+     */
+    static void CALLBACK ScanTask_ (double dSimSeconds,
+                                    void*  pContext)
+    {
+        CDemoRudderPos* pThis = (CDemoRudderPos*)pContext;
+        pThis->ScanTask (dSimSeconds);
+    }
+
+    /**
+     * Static method that calls the instance, which is passed as the context.
+     */
+    static void CALLBACK WeatherTask_ (double dSimSeconds,
+                                       void*  pContext)
+    {
+        CDemoRudderPos* pThis = (CDemoRudderPos*)pContext;
+        pThis->WeatherTask (dSimSeconds);
+    }
+
+    /**
+     * Static method that calls the instance, which is passed as the context.
+     */
+    static void CALLBACK FetchTask_ (double dSimSeconds,
+                                     void*  pContext)
+    {
+        CDemoRudderPos* pThis = (CDemoRudderPos*)pContext;
+        pThis->FetchTask (dSimSeconds);
+    }
+
+
+    HANDLE              m_hSimConnect;
+    HANDLE              m_hEventDispatch;
+    CConnectionMux*     m_pConnections;     // Set when opened through a multiplexer
+    bool                m_bQuit;
+    bool                m_bRecord;          // Whether Open starts a recording
+    DWORD               m_idObjGroundVehicle;
+    DataUserObject      m_dataUserObject;
+    DataGroundVehicle   m_dataGroundVehicle;
+    bool                m_bDataUserObjectSet;
+    CSubscriptionMux    m_mux;
+    CObjectRegistry     m_registry;
+    CLocalFrame         m_frame;
+    CFormation          m_formation;
+    std::vector<DWORD>  m_spawned;          // Object of each vehicle of the formation spawned last, 0 until created
+    CSpatialGrid        m_grid;
+    DWORD               m_nScan;
+    DWORD               m_cScanPending;
+    DWORD               m_cSecondsToScan;
+    CPathFollower       m_follower;
+    DWORD               m_idSubGroundVehicle;
+    CDeadReckoner       m_reckoner;         // Only paces the fixes, with OnFix and FramesOf; m_filter predicts
+    CKalmanBank         m_filter;
+    CFrameScheduler     m_scheduler;
+    DWORD               m_cFramesGroundVehicle; // Frames between the fixes currently requested
+    CTimerWheel         m_timers;
+    uint64_t            m_idTimerScan;
+    CTelemetryPublisher m_bus;
+    CTelemetryRecorder  m_recorder;         // Of what goes on the bus, with -record
+    CFacilityCache      m_facilities;
+    CFacilityRange      m_range;            // Facilities near the user aircraft
+    DWORD               m_nAirportChanges;  // Of m_range, when the nearest airports were last fetched
+    CFacilityFetcher    m_fetcher;          // Ground layouts of the airports near it
+    CTaxiRouter         m_router;
+    const AirportModel* m_pRouterAirport;   // Whose taxiways m_router has
+    DWORD               m_iParking;         // Where the next route goes
+    std::vector<double> m_routeLats;
+    std::vector<double> m_routeLons;
+    CWeatherCache       m_weather;          // Around the aircraft
+
+    static const CSubscriptionMux::Field s_fieldsUserObject[4];
+};
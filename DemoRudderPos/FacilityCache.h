@@ -0,0 +1,414 @@
+#pragma once
+
+#include <Windows.h>
+#include <SimConnect.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MappedFile.h"
+
+
+#define FACILITY_CACHE_MAGIC    0x43434146      // "FACC"
+#define FACILITY_CACHE_VERSION  1
+#define FACILITY_CACHE_TYPES    4               // Airports, waypoints, NDBs and VORs, which both sims list
+
+/**
+ * A facility as kept in the cache, whatever its type; what a type does not have is zero.
+ */
+typedef struct FacilityEntry
+{
+    double  dLatitude;
+    double  dLongitude;
+    float   fAltitude;          // Meters
+    float   fMagVar;            // Degrees
+    DWORD   dwFrequency;        // Hz
+    DWORD   dwFlags;            // SIMCONNECT_VOR_FLAGS
+    char    szIcao[9];
+    BYTE    eType;              // SIMCONNECT_FACILITY_LIST_TYPE
+    BYTE    bReserved[6];
+}
+FacilityEntry;
+
+/**
+ * A cache file is this header, then the entries of each type in turn, each type's sorted by ICAO. It belongs to the
+ *  version of the sim in it; another version's facilities may differ.
+ */
+typedef struct FacilityCacheHeader
+{
+    DWORD dwMagic;
+    DWORD dwVersion;
+    DWORD cbEntry;
+    DWORD dwSimVersion[4];                      // Application version and build, major and minor
+    DWORD cEntries[FACILITY_CACHE_TYPES];
+}
+FacilityCacheHeader;
+
+
+/**
+ * An ICAO code, which has at most 8 characters, as a key.
+ */
+inline uint64_t IcaoKey (const char* szIcao)
+{
+    uint64_t nKey = 0;
+    memcpy (&nKey, szIcao, strnlen (szIcao, sizeof (nKey)));
+    return nKey;
+}
+
+/**
+ * Append the facilities of an AIRPORT_LIST, WAYPOINT_LIST, NDB_LIST or VOR_LIST message to entries; false for any
+ *  other message.
+ */
+inline bool AppendFacilities (const SIMCONNECT_RECV*      pData,
+                              std::vector<FacilityEntry>& entries)
+{
+    const SIMCONNECT_RECV_FACILITIES_LIST* pList = (const SIMCONNECT_RECV_FACILITIES_LIST*)pData;
+    SIMCONNECT_FACILITY_LIST_TYPE          eType;
+    size_t                                 cbFacility;
+
+    switch (pData->dwID)
+    {
+        case SIMCONNECT_RECV_ID_AIRPORT_LIST:
+            eType      = SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT;
+            cbFacility = sizeof (SIMCONNECT_DATA_FACILITY_AIRPORT);
+            break;
+
+        case SIMCONNECT_RECV_ID_WAYPOINT_LIST:
+            eType      = SIMCONNECT_FACILITY_LIST_TYPE_WAYPOINT;
+            cbFacility = sizeof (SIMCONNECT_DATA_FACILITY_WAYPOINT);
+            break;
+
+        case SIMCONNECT_RECV_ID_NDB_LIST:
+            eType      = SIMCONNECT_FACILITY_LIST_TYPE_NDB;
+            cbFacility = sizeof (SIMCONNECT_DATA_FACILITY_NDB);
+            break;
+
+        case SIMCONNECT_RECV_ID_VOR_LIST:
+            eType      = SIMCONNECT_FACILITY_LIST_TYPE_VOR;
+            cbFacility = sizeof (SIMCONNECT_DATA_FACILITY_VOR);
+            break;
+
+        default:
+            return false;
+    }
+
+    size_t iFirst = entries.size ();
+    entries.resize (iFirst + pList->dwArraySize);
+    if (pList->dwArraySize > 0) memset (&entries[iFirst], 0, pList->dwArraySize * sizeof (FacilityEntry));
+
+    // The facilities of every type start with an airport's fields, and those of the navaids with a waypoint's
+    const BYTE* pbFacility = (const BYTE*)((const SIMCONNECT_RECV_AIRPORT_LIST*)pData)->rgData;
+
+    for (DWORD i = 0; i < pList->dwArraySize; i++, pbFacility += cbFacility)
+    {
+        const SIMCONNECT_DATA_FACILITY_AIRPORT* pFacility = (const SIMCONNECT_DATA_FACILITY_AIRPORT*)pbFacility;
+        FacilityEntry&                          entry     = entries[iFirst + i];
+
+        memcpy (entry.szIcao, pFacility->Icao, sizeof (entry.szIcao));
+        entry.dLatitude  = pFacility->Latitude;
+        entry.dLongitude = pFacility->Longitude;
+        entry.fAltitude  = (float)pFacility->Altitude;
+        entry.eType      = (BYTE)eType;
+
+        if (eType != SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT) entry.fMagVar = ((const SIMCONNECT_DATA_FACILITY_WAYPOINT*)pFacility)->fMagVar;
+        if (eType == SIMCONNECT_FACILITY_LIST_TYPE_NDB || eType == SIMCONNECT_FACILITY_LIST_TYPE_VOR)
+        {
+            entry.dwFrequency = ((const SIMCONNECT_DATA_FACILITY_NDB*)pFacility)->fFrequency;
+        }
+        if (eType == SIMCONNECT_FACILITY_LIST_TYPE_VOR) entry.dwFlags = ((const SIMCONNECT_DATA_FACILITY_VOR*)pFacility)->Flags;
+    }
+    return true;
+}
+
+
+/**
+ * The facility lists of a sim, kept on disk between runs, so that lookups work as soon as the sim has said which
+ *  version it is rather than after it has sent lists of hundreds of thousands of entries.
+ *
+ * Open maps the file of the sim's version, if there is one, and answers lookups from it in place. It then asks the
+ *  sim for the lists anyway, one type at a time, and each type, once all its pages are in, replaces the cached one.
+ *  When all have come in and any of them differed from the file, the file is rewritten on a thread of its own.
+ */
+class CFacilityCache
+{
+public:
+    /**
+     * The cache owns the request ID, used for each list in turn. With bRefreshLoaded false, a file that loads is
+     *  taken as it is and the sim is not asked for the lists, which saves their traffic at the cost of not seeing
+     *  scenery installed since the file was written.
+     */
+    CFacilityCache (DWORD idRequest,
+                    bool  bRefreshLoaded = true) :
+        m_hSimConnect    (NULL),
+        m_idRequest      (idRequest),
+        m_bRefreshLoaded (bRefreshLoaded),
+        m_iRefresh       (FACILITY_CACHE_TYPES),
+        m_cPages         (0),
+        m_bChanged       (false)
+    {
+        memset (m_dwSimVersion, 0, sizeof (m_dwSimVersion));
+        memset (m_pEntries, 0, sizeof (m_pEntries));
+        memset (m_cEntries, 0, sizeof (m_cEntries));
+    }
+
+    ~CFacilityCache ()
+    {
+        Close ();
+    }
+
+    /**
+     * Load the cache of the sim that sent pOpen, from the file named after szPrefix and its version, and start
+     *  refreshing it, unless it loaded and the cache was made not to. Returns whether there was a cache to load.
+     */
+    bool Open (HANDLE                      hSimConnect,
+               const char*                 szPrefix,
+               const SIMCONNECT_RECV_OPEN* pOpen)
+    {
+        Close ();
+
+        m_hSimConnect     = hSimConnect;
+        m_dwSimVersion[0] = pOpen->dwApplicationVersionMajor;
+        m_dwSimVersion[1] = pOpen->dwApplicationVersionMinor;
+        m_dwSimVersion[2] = pOpen->dwApplicationBuildMajor;
+        m_dwSimVersion[3] = pOpen->dwApplicationBuildMinor;
+
+        // Only letters and digits of the application name, which can have anything in it
+        char szApp[64];
+        int  cchApp = 0;
+        for (const char* pch = pOpen->szApplicationName; *pch != '\0' && cchApp < (int)sizeof (szApp) - 1; pch++)
+        {
+            if (isalnum ((unsigned char)*pch)) szApp[cchApp++] = *pch;
+        }
+        szApp[cchApp] = '\0';
+
+        char szPath[MAX_PATH];
+        snprintf (szPath, sizeof (szPath), "%s.Facilities.%s.%u.%u.%u.%u.cache", szPrefix, szApp, m_dwSimVersion[0], m_dwSimVersion[1], m_dwSimVersion[2], m_dwSimVersion[3]);
+        m_strPath = szPath;
+
+        bool bLoaded = Load ();
+        if (bLoaded && !m_bRefreshLoaded) return true;
+
+        m_iRefresh = 0;
+        m_bChanged = !bLoaded;
+        RequestList ();
+        return bLoaded;
+    }
+
+    /**
+     * Stop refreshing, wait for the file to be written if it is being, and forget the facilities.
+     */
+    void Close ()
+    {
+        if (m_writer.joinable ()) m_writer.join ();
+
+        m_file.Close ();
+        for (DWORD i = 0; i < FACILITY_CACHE_TYPES; i++)
+        {
+            m_owned[i].clear ();
+            m_pEntries[i] = NULL;
+            m_cEntries[i] = 0;
+        }
+        m_staging.clear ();
+        m_iRefresh    = FACILITY_CACHE_TYPES;
+        m_hSimConnect = NULL;
+    }
+
+    /**
+     * Pass on AIRPORT_LIST, WAYPOINT_LIST, NDB_LIST and VOR_LIST messages; returns true if it was for the cache.
+     */
+    bool OnFacilitiesList (const SIMCONNECT_RECV* pData)
+    {
+        const SIMCONNECT_RECV_FACILITIES_LIST* pList = (const SIMCONNECT_RECV_FACILITIES_LIST*)pData;
+        if (pList->dwRequestID != m_idRequest || m_iRefresh >= FACILITY_CACHE_TYPES) return false;
+
+        if (!AppendFacilities (pData, m_staging)) return false;
+
+        // The pages of a list can come in any order; the list is complete when all of them have
+        if (++m_cPages >= pList->dwOutOf) OnListComplete ();
+        return true;
+    }
+
+    /**
+     * The facility of a type with an ICAO code, or NULL; the first of them if several share it, which the others
+     *  follow in Entries.
+     */
+    const FacilityEntry* Find (SIMCONNECT_FACILITY_LIST_TYPE eType,
+                               const char*                   szIcao) const
+    {
+        if ((DWORD)eType >= FACILITY_CACHE_TYPES) return NULL;
+
+        const FacilityEntry* pFirst = m_pEntries[eType];
+        const FacilityEntry* pLast  = pFirst + m_cEntries[eType];
+        const FacilityEntry* pFound = std::lower_bound (pFirst, pLast, szIcao, [] (const FacilityEntry& entry, const char* szKey)
+        {
+            return strncmp (entry.szIcao, szKey, sizeof (entry.szIcao)) < 0;
+        });
+
+        return pFound != pLast && strncmp (pFound->szIcao, szIcao, sizeof (pFound->szIcao)) == 0 ? pFound : NULL;
+    }
+
+    /**
+     * All the facilities of a type, sorted by ICAO code.
+     */
+    const FacilityEntry* Entries (SIMCONNECT_FACILITY_LIST_TYPE eType) const
+    {
+        return (DWORD)eType < FACILITY_CACHE_TYPES ? m_pEntries[eType] : NULL;
+    }
+
+    DWORD Count (SIMCONNECT_FACILITY_LIST_TYPE eType) const
+    {
+        return (DWORD)eType < FACILITY_CACHE_TYPES ? m_cEntries[eType] : 0;
+    }
+
+    /**
+     * Whether lists are still coming in from the sim.
+     */
+    bool IsRefreshing () const
+    {
+        return m_iRefresh < FACILITY_CACHE_TYPES;
+    }
+
+private:
+    CFacilityCache (const CFacilityCache&);
+    CFacilityCache& operator= (const CFacilityCache&);
+
+
+    /**
+     * Map the file and point the lookups into it, if it is a cache of this version of the sim.
+     */
+    bool Load ()
+    {
+        if (!m_file.Open (m_strPath.c_str ())) return false;
+
+        const FacilityCacheHeader* pHeader  = (const FacilityCacheHeader*)m_file.Data ();
+        size_t                     cEntries = 0;
+
+        if (m_file.Size () >= sizeof (FacilityCacheHeader) && pHeader->dwMagic == FACILITY_CACHE_MAGIC && pHeader->dwVersion == FACILITY_CACHE_VERSION &&
+            pHeader->cbEntry == sizeof (FacilityEntry) && memcmp (pHeader->dwSimVersion, m_dwSimVersion, sizeof (m_dwSimVersion)) == 0)
+        {
+            for (DWORD i = 0; i < FACILITY_CACHE_TYPES; i++) cEntries += pHeader->cEntries[i];
+        }
+
+        if (cEntries == 0 || m_file.Size () != sizeof (FacilityCacheHeader) + cEntries * sizeof (FacilityEntry))
+        {
+            m_file.Close ();
+            return false;
+        }
+
+        const FacilityEntry* pEntries = (const FacilityEntry*)(pHeader + 1);
+        for (DWORD i = 0; i < FACILITY_CACHE_TYPES; i++)
+        {
+            m_pEntries[i] = pEntries;
+            m_cEntries[i] = pHeader->cEntries[i];
+            pEntries     += pHeader->cEntries[i];
+        }
+        return true;
+    }
+
+    /**
+     * By ICAO code, and facilities that share one, as waypoints in different regions can, by position, so that the
+     *  same list always sorts the same.
+     */
+    static bool IsBefore (const FacilityEntry& a,
+                          const FacilityEntry& b)
+    {
+        int nCompare = strncmp (a.szIcao, b.szIcao, sizeof (a.szIcao));
+        if (nCompare != 0) return nCompare < 0;
+        if (a.dLatitude != b.dLatitude) return a.dLatitude < b.dLatitude;
+        return a.dLongitude < b.dLongitude;
+    }
+
+    void RequestList ()
+    {
+        m_staging.clear ();
+        m_cPages = 0;
+        SimConnect_RequestFacilitiesList (m_hSimConnect, (SIMCONNECT_FACILITY_LIST_TYPE)m_iRefresh, m_idRequest);
+    }
+
+    /**
+     * Swap the list just received in for the cached one, and ask for the next; after the last, save the lot if
+     *  anything changed.
+     */
+    void OnListComplete ()
+    {
+        std::sort (m_staging.begin (), m_staging.end (), IsBefore);
+
+        DWORD i = m_iRefresh;
+        if (m_staging.size () != m_cEntries[i] || (m_cEntries[i] > 0 && memcmp (m_staging.data (), m_pEntries[i], m_staging.size () * sizeof (FacilityEntry)) != 0))
+        {
+            m_bChanged = true;
+        }
+
+        m_owned[i].swap (m_staging);
+        m_pEntries[i] = m_owned[i].data ();
+        m_cEntries[i] = (DWORD)m_owned[i].size ();
+
+        if (++m_iRefresh < FACILITY_CACHE_TYPES)
+        {
+            RequestList ();
+            return;
+        }
+
+        // Nothing points into the file any more, so it can be replaced
+        m_file.Close ();
+        if (m_bChanged) m_writer = std::thread (&CFacilityCache::Save, this);
+    }
+
+    /**
+     * Write the cache to a temporary file and move it over the old one, so that a run that starts meanwhile finds
+     *  either the old cache or the new one. On the writer thread; the lists are left alone until it is done.
+     */
+    void Save ()
+    {
+        std::string strTemp = m_strPath + ".tmp";
+        FILE*       pFile   = fopen (strTemp.c_str (), "wb");
+        if (pFile == NULL) return;
+
+        FacilityCacheHeader header;
+        memset (&header, 0, sizeof (header));
+        header.dwMagic   = FACILITY_CACHE_MAGIC;
+        header.dwVersion = FACILITY_CACHE_VERSION;
+        header.cbEntry   = sizeof (FacilityEntry);
+        memcpy (header.dwSimVersion, m_dwSimVersion, sizeof (header.dwSimVersion));
+        for (DWORD i = 0; i < FACILITY_CACHE_TYPES; i++) header.cEntries[i] = m_cEntries[i];
+
+        bool bWritten = fwrite (&header, sizeof (header), 1, pFile) == 1;
+        for (DWORD i = 0; i < FACILITY_CACHE_TYPES; i++)
+        {
+            bWritten = bWritten && fwrite (m_pEntries[i], sizeof (FacilityEntry), m_cEntries[i], pFile) == m_cEntries[i];
+        }
+        bWritten = fclose (pFile) == 0 && bWritten;
+
+        #ifdef _WIN32
+            if (bWritten) bWritten = MoveFileExA (strTemp.c_str (), m_strPath.c_str (), MOVEFILE_REPLACE_EXISTING) != FALSE;
+        #else
+            if (bWritten) bWritten = rename (strTemp.c_str (), m_strPath.c_str ()) == 0;
+        #endif
+        if (!bWritten) remove (strTemp.c_str ());
+    }
+
+
+    HANDLE                      m_hSimConnect;
+    DWORD                       m_idRequest;
+    bool                        m_bRefreshLoaded;   // Ask the sim for the lists even when the file loads
+    DWORD                       m_dwSimVersion[4];
+    std::string                 m_strPath;
+
+    // Lookups go to the mapped file, or to what came from the sim once it has
+    CMappedFile                 m_file;
+    std::vector<FacilityEntry>  m_owned[FACILITY_CACHE_TYPES];
+    const FacilityEntry*        m_pEntries[FACILITY_CACHE_TYPES];
+    DWORD                       m_cEntries[FACILITY_CACHE_TYPES];
+
+    // Refresh
+    DWORD                       m_iRefresh;         // Type being received; FACILITY_CACHE_TYPES when done
+    std::vector<FacilityEntry>  m_staging;
+    DWORD                       m_cPages;
+    bool                        m_bChanged;
+    std::thread                 m_writer;
+};
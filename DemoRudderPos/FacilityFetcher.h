@@ -0,0 +1,581 @@
+#pragma once
+
+#include <Windows.h>
+#include <SimConnect.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Arena.h"
+#include "FacilityCache.h"
+
+
+#define FACILITY_FETCH_WINDOW       16      // Requests in flight at once
+#define FACILITY_FETCH_IDS_PER_SLOT 4       // Request IDs each slot of the window takes in turn
+#define FACILITY_FETCH_TIMEOUT_SEC  10.0    // Before giving up on an airport the sim has not answered
+
+// TAXI_PATH types the taxi network cares about
+#define AIRPORT_PATH_TAXI           1
+#define AIRPORT_PATH_RUNWAY         2
+#define AIRPORT_PATH_PARKING        3       // Ends at a parking spot rather than a taxi point
+
+// Layouts of the FACILITY_DATA replies to the definition of CFacilityFetcher, in the order it asks for the fields
+#pragma pack (push, 1)
+typedef struct FacilityDataAirport
+{
+    double  dLatitude;
+    double  dLongitude;
+    double  dAltitude;
+    int     nRunways;
+    int     nTaxiPoints;
+    int     nTaxiParkings;
+    int     nTaxiPaths;
+}
+FacilityDataAirport;
+
+typedef struct FacilityDataRunway
+{
+    double  dLatitude;
+    double  dLongitude;
+    double  dAltitude;
+    float   fHeading;
+    float   fLength;
+    float   fWidth;
+    int     nPrimaryNumber;
+    int     nSecondaryNumber;
+}
+FacilityDataRunway;
+
+typedef struct FacilityDataTaxiPoint
+{
+    int     nType;
+    float   fBiasX;
+    float   fBiasZ;
+}
+FacilityDataTaxiPoint;
+
+typedef struct FacilityDataTaxiParking
+{
+    int     nType;
+    int     nName;
+    int     nNumber;
+    float   fHeading;
+    float   fRadius;
+    float   fBiasX;
+    float   fBiasZ;
+}
+FacilityDataTaxiParking;
+
+typedef struct FacilityDataTaxiPath
+{
+    int     nType;
+    float   fWidth;
+    int     nStart;
+    int     nEnd;
+    int     nNameIndex;
+}
+FacilityDataTaxiPath;
+#pragma pack (pop)
+
+
+/**
+ * An airport as the ground vehicles need it. Positions on the ground are in meters east (X) and north (Z) of the
+ *  airport's reference point.
+ */
+typedef struct AirportRunway
+{
+    double  dLatitude;
+    double  dLongitude;
+    float   fAltitude;          // Meters
+    float   fHeading;           // Degrees true
+    float   fLength;            // Meters
+    float   fWidth;
+    DWORD   nPrimary;           // Runway numbers at either end
+    DWORD   nSecondary;
+}
+AirportRunway;
+
+typedef struct AirportTaxiPoint
+{
+    float   fX;
+    float   fZ;
+    DWORD   eType;
+}
+AirportTaxiPoint;
+
+typedef struct AirportParking
+{
+    float   fX;
+    float   fZ;
+    float   fHeading;
+    float   fRadius;            // Meters
+    DWORD   eType;
+    DWORD   eName;              // Gate A, ramp, ... as the sim numbers them
+    DWORD   nNumber;
+}
+AirportParking;
+
+typedef struct AirportTaxiPath
+{
+    float   fWidth;             // Meters
+    DWORD   eType;              // AIRPORT_PATH
+    DWORD   iStart;             // Taxi point
+    DWORD   iEnd;               // Taxi point, or parking for AIRPORT_PATH_PARKING
+    DWORD   iName;
+}
+AirportTaxiPath;
+
+typedef struct AirportModel
+{
+    char                    szIcao[9];
+    double                  dLatitude;
+    double                  dLongitude;
+    double                  dAltitude;      // Meters
+    DWORD                   cRunways;
+    DWORD                   cTaxiPoints;
+    DWORD                   cParkings;
+    DWORD                   cTaxiPaths;
+    const AirportRunway*    pRunways;
+    const AirportTaxiPoint* pTaxiPoints;
+    const AirportParking*   pParkings;
+    const AirportTaxiPath*  pTaxiPaths;
+}
+AirportModel;
+
+
+/**
+ * Fetches the runways, parking spots and taxi networks of airports from MSFS, many at a time, and keeps them.
+ *
+ * The sim answers a request for facility data with one FACILITY_DATA message per airport, runway, taxi point and so
+ *  on, then FACILITY_DATA_END, so fetching airports one after the other costs a round trip to the sim each. The
+ *  fetcher instead keeps up to FACILITY_FETCH_WINDOW requests in flight, each with a request ID of its own, and
+ *  tells their replies apart by it. Each airport is assembled from its replies in a slot of its own and, once it
+ *  ends, packed into an arena as one AirportModel with its arrays, which stays until Close.
+ *
+ * An airport whose request fails, or that the sim has not finished answering within FACILITY_FETCH_TIMEOUT_SEC, is
+ *  kept as one the sim does not have, so that its slot goes to the next. A slot takes its request IDs in turn, so
+ *  that replies still coming for an airport given up on are not taken for the next one.
+ *
+ * P3D has no facility data, so there Open fails with E_NOTIMPL and nothing is fetched.
+ */
+class CFacilityFetcher
+{
+public:
+    /**
+     * Receives an airport as it is fetched; NULL if the sim has none with the code.
+     */
+    typedef void (CALLBACK* AirportProc) (const char*         szIcao,
+                                          const AirportModel* pAirport,
+                                          void*               pContext);
+
+    /**
+     * The fetcher owns the definition ID and the cWindow * FACILITY_FETCH_IDS_PER_SLOT request IDs from
+     *  idRequestFirst.
+     */
+    CFacilityFetcher (DWORD idDefine,
+                      DWORD idRequestFirst,
+                      DWORD cWindow = FACILITY_FETCH_WINDOW) :
+        m_hSimConnect    (NULL),
+        m_idDefine       (idDefine),
+        m_idRequestFirst (idRequestFirst),
+        m_slots          (cWindow),
+        m_cRequests      (0),
+        m_dNowSec        (0.0),
+        m_pfnAirport     (NULL),
+        m_pContext       (NULL)
+    {
+    }
+
+    /**
+     * Define the fields to fetch. Each airport fetched goes to pfnAirport, from OnRecv.
+     */
+    HRESULT Open (HANDLE      hSimConnect,
+                  AirportProc pfnAirport,
+                  void*       pContext)
+    {
+        Close ();
+
+        m_hSimConnect = hSimConnect;
+        m_pfnAirport  = pfnAirport;
+        m_pContext    = pContext;
+
+    #ifdef SIM_MSFS2020
+        static const char* const s_rgszFields[] =
+        {
+            "OPEN AIRPORT",
+                "LATITUDE", "LONGITUDE", "ALTITUDE", "N_RUNWAYS", "N_TAXI_POINTS", "N_TAXI_PARKINGS", "N_TAXI_PATHS",
+                "OPEN RUNWAY",
+                    "LATITUDE", "LONGITUDE", "ALTITUDE", "HEADING", "LENGTH", "WIDTH", "PRIMARY_NUMBER", "SECONDARY_NUMBER",
+                "CLOSE RUNWAY",
+                "OPEN TAXI_POINT",
+                    "TYPE", "BIAS_X", "BIAS_Z",
+                "CLOSE TAXI_POINT",
+                "OPEN TAXI_PARKING",
+                    "TYPE", "NAME", "NUMBER", "HEADING", "RADIUS", "BIAS_X", "BIAS_Z",
+                "CLOSE TAXI_PARKING",
+                "OPEN TAXI_PATH",
+                    "TYPE", "WIDTH", "START", "END", "NAME_INDEX",
+                "CLOSE TAXI_PATH",
+            "CLOSE AIRPORT"
+        };
+
+        for (size_t i = 0; i < _countof (s_rgszFields); i++)
+        {
+            HRESULT hr = SimConnect_AddToFacilityDefinition (m_hSimConnect, m_idDefine, s_rgszFields[i]);
+            if (FAILED (hr)) return hr;
+        }
+        return S_OK;
+    #else
+        m_hSimConnect = NULL;
+        return E_NOTIMPL;
+    #endif
+    }
+
+    /**
+     * Forget the airports, which invalidates every AirportModel handed out.
+     */
+    void Close ()
+    {
+        for (size_t i = 0; i < m_slots.size (); i++) m_slots[i] = Slot ();
+        m_queue.clear ();
+        m_requested.clear ();
+        m_airports.clear ();
+        m_arena.Clear ();
+        m_hSimConnect = NULL;
+        m_cRequests   = 0;
+    }
+
+    /**
+     * Queue an airport to fetch, unless it has been already; nothing without Open. dNowSec is the time for Expire.
+     */
+    void Fetch (const char* szIcao,
+                double      dNowSec)
+    {
+        uint64_t nKey = IcaoKey (szIcao);
+        m_dNowSec = dNowSec;
+        if (m_hSimConnect == NULL || nKey == 0 || !m_requested.insert (nKey).second) return;
+
+        m_queue.push_back (nKey);
+        Pump ();
+    }
+
+    /**
+     * Give up on the airports the sim has not answered in time, e.g. once a second.
+     */
+    void Expire (double dNowSec)
+    {
+        m_dNowSec = dNowSec;
+
+        for (DWORD iSlot = 0; iSlot < m_slots.size (); iSlot++)
+        {
+            Slot& slot = m_slots[iSlot];
+            if (slot.nKey == 0 || m_dNowSec < slot.dSentSec + FACILITY_FETCH_TIMEOUT_SEC) continue;
+
+            slot.bAirport = false;
+            OnEnd (slot);
+        }
+        Pump ();
+    }
+
+    /**
+     * Pass on every message; returns true if it was for the fetcher.
+     */
+    bool OnRecv (const SIMCONNECT_RECV* pData)
+    {
+    #ifdef SIM_MSFS2020
+        if (pData->dwID == SIMCONNECT_RECV_ID_FACILITY_DATA)
+        {
+            const SIMCONNECT_RECV_FACILITY_DATA* pFacility = (const SIMCONNECT_RECV_FACILITY_DATA*)pData;
+            Slot*                                pSlot     = FindSlot (pFacility->UserRequestId);
+            if (pSlot == NULL) return false;
+
+            // The data in place of Data, the last member of the packed message
+            size_t ibData = sizeof (SIMCONNECT_RECV_FACILITY_DATA) - sizeof (DWORD);
+            size_t cbData = pData->dwSize > ibData ? pData->dwSize - ibData : 0;
+            OnFacilityData (*pSlot, *pFacility, (const BYTE*)pData + ibData, cbData);
+            return true;
+        }
+
+        if (pData->dwID == SIMCONNECT_RECV_ID_FACILITY_DATA_END)
+        {
+            const SIMCONNECT_RECV_FACILITY_DATA_END* pEnd  = (const SIMCONNECT_RECV_FACILITY_DATA_END*)pData;
+            Slot*                                    pSlot = FindSlot (pEnd->RequestId);
+            if (pSlot == NULL) return false;
+
+            OnEnd (*pSlot);
+            Pump ();
+            return true;
+        }
+    #endif
+        return false;
+    }
+
+    /**
+     * A fetched airport, or NULL if it has not been fetched or the sim has none with the code.
+     */
+    const AirportModel* Find (const char* szIcao) const
+    {
+        auto it = m_airports.find (IcaoKey (szIcao));
+        return it != m_airports.end () ? it->second : NULL;
+    }
+
+    /**
+     * Airports queued or in flight.
+     */
+    DWORD PendingCount () const
+    {
+        return (DWORD)m_queue.size () + m_cRequests;
+    }
+
+    /**
+     * Airports fetched, including those the sim did not have.
+     */
+    DWORD Count () const
+    {
+        return (DWORD)m_airports.size ();
+    }
+
+    /**
+     * Bytes the fetched airports take.
+     */
+    size_t ArenaSize () const
+    {
+        return m_arena.Size ();
+    }
+
+private:
+    CFacilityFetcher (const CFacilityFetcher&);
+    CFacilityFetcher& operator= (const CFacilityFetcher&);
+
+
+    /**
+     * An airport being assembled, for the request ID of its index.
+     */
+    typedef struct Slot
+    {
+        Slot () :
+            nKey      (0),
+            nTurn     (0),
+            idRequest (0),
+            dSentSec  (0.0),
+            bAirport  (false)
+        {
+            memset (&airport, 0, sizeof (airport));
+        }
+
+        uint64_t                        nKey;       // 0 when free
+        DWORD                           nTurn;      // Requests made from the slot, kept when it is freed
+        DWORD                           idRequest;
+        double                          dSentSec;
+        bool                            bAirport;   // Whether the airport itself has come
+        FacilityDataAirport             airport;
+        std::vector<AirportRunway>      runways;
+        std::vector<AirportTaxiPoint>   points;
+        std::vector<AirportParking>     parkings;
+        std::vector<AirportTaxiPath>    paths;
+    }
+    Slot;
+
+    /**
+     * Slot i takes the request IDs idRequestFirst + i + n * cWindow.
+     */
+    Slot* FindSlot (DWORD idRequest)
+    {
+        DWORD iId = idRequest - m_idRequestFirst;
+        if (iId >= m_slots.size () * FACILITY_FETCH_IDS_PER_SLOT) return NULL;
+
+        Slot& slot = m_slots[iId % m_slots.size ()];
+        return slot.nKey != 0 && slot.idRequest == idRequest ? &slot : NULL;
+    }
+
+    /**
+     * Request queued airports into the free slots. One whose request fails is done with at once, as missing.
+     */
+    void Pump ()
+    {
+        for (DWORD iSlot = 0; iSlot < m_slots.size () && !m_queue.empty (); iSlot++)
+        {
+            Slot& slot = m_slots[iSlot];
+            if (slot.nKey != 0) continue;
+
+            uint64_t nKey = m_queue.front ();
+            char     szIcao[9];
+            HRESULT  hr   = E_NOTIMPL;
+
+            m_queue.pop_front ();
+            memset (szIcao, 0, sizeof (szIcao));
+            memcpy (szIcao, &nKey, sizeof (nKey));
+
+            slot.nKey      = nKey;
+            slot.idRequest = m_idRequestFirst + iSlot + (slot.nTurn++ % FACILITY_FETCH_IDS_PER_SLOT) * (DWORD)m_slots.size ();
+            slot.dSentSec  = m_dNowSec;
+            m_cRequests++;
+
+        #ifdef SIM_MSFS2020
+            hr = SimConnect_RequestFacilityData_EX1 (m_hSimConnect, m_idDefine, slot.idRequest, szIcao, "", 'A');
+        #endif
+            if (FAILED (hr)) OnEnd (slot);
+        }
+    }
+
+#ifdef SIM_MSFS2020
+    /**
+     * Put an item of a list where the sim says it goes in the list, which it also says the length of.
+     */
+    template <typename T>
+    static T& Place (std::vector<T>&                      list,
+                     const SIMCONNECT_RECV_FACILITY_DATA& facility)
+    {
+        if (list.size () < facility.ListSize)  list.resize (facility.ListSize);
+        if (list.size () <= facility.ItemIndex) list.resize (facility.ItemIndex + 1);
+        return list[facility.ItemIndex];
+    }
+
+    void OnFacilityData (Slot&                                slot,
+                         const SIMCONNECT_RECV_FACILITY_DATA& facility,
+                         const BYTE*                          pData,
+                         size_t                               cbData)
+    {
+        switch (facility.Type)
+        {
+            case SIMCONNECT_FACILITY_DATA_AIRPORT:
+            {
+                if (cbData < sizeof (FacilityDataAirport)) break;
+
+                memcpy (&slot.airport, pData, sizeof (slot.airport));
+                slot.bAirport = true;
+                slot.runways.reserve (std::max (slot.airport.nRunways, 0));
+                slot.points.reserve (std::max (slot.airport.nTaxiPoints, 0));
+                slot.parkings.reserve (std::max (slot.airport.nTaxiParkings, 0));
+                slot.paths.reserve (std::max (slot.airport.nTaxiPaths, 0));
+                break;
+            }
+
+            case SIMCONNECT_FACILITY_DATA_RUNWAY:
+            {
+                if (cbData < sizeof (FacilityDataRunway)) break;
+
+                const FacilityDataRunway* pRunway = (const FacilityDataRunway*)pData;
+                AirportRunway&            runway  = Place (slot.runways, facility);
+                runway.dLatitude  = pRunway->dLatitude;
+                runway.dLongitude = pRunway->dLongitude;
+                runway.fAltitude  = (float)pRunway->dAltitude;
+                runway.fHeading   = pRunway->fHeading;
+                runway.fLength    = pRunway->fLength;
+                runway.fWidth     = pRunway->fWidth;
+                runway.nPrimary   = pRunway->nPrimaryNumber;
+                runway.nSecondary = pRunway->nSecondaryNumber;
+                break;
+            }
+
+            case SIMCONNECT_FACILITY_DATA_TAXI_POINT:
+            {
+                if (cbData < sizeof (FacilityDataTaxiPoint)) break;
+
+                const FacilityDataTaxiPoint* pPoint = (const FacilityDataTaxiPoint*)pData;
+                AirportTaxiPoint&            point  = Place (slot.points, facility);
+                point.fX    = pPoint->fBiasX;
+                point.fZ    = pPoint->fBiasZ;
+                point.eType = pPoint->nType;
+                break;
+            }
+
+            case SIMCONNECT_FACILITY_DATA_TAXI_PARKING:
+            {
+                if (cbData < sizeof (FacilityDataTaxiParking)) break;
+
+                const FacilityDataTaxiParking* pParking = (const FacilityDataTaxiParking*)pData;
+                AirportParking&                parking  = Place (slot.parkings, facility);
+                parking.fX       = pParking->fBiasX;
+                parking.fZ       = pParking->fBiasZ;
+                parking.fHeading = pParking->fHeading;
+                parking.fRadius  = pParking->fRadius;
+                parking.eType    = pParking->nType;
+                parking.eName    = pParking->nName;
+                parking.nNumber  = pParking->nNumber;
+                break;
+            }
+
+            case SIMCONNECT_FACILITY_DATA_TAXI_PATH:
+            {
+                if (cbData < sizeof (FacilityDataTaxiPath)) break;
+
+                const FacilityDataTaxiPath* pPath = (const FacilityDataTaxiPath*)pData;
+                AirportTaxiPath&            path  = Place (slot.paths, facility);
+                path.fWidth = pPath->fWidth;
+                path.eType  = pPath->nType;
+                path.iStart = pPath->nStart;
+                path.iEnd   = pPath->nEnd;
+                path.iName  = pPath->nNameIndex;
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+#endif
+
+    /**
+     * Pack the airport into the arena and free its slot.
+     */
+    void OnEnd (Slot& slot)
+    {
+        AirportModel* pAirport = NULL;
+        char          szIcao[9];
+
+        memset (szIcao, 0, sizeof (szIcao));
+        memcpy (szIcao, &slot.nKey, sizeof (slot.nKey));
+
+        if (slot.bAirport)
+        {
+            pAirport = m_arena.Allocate<AirportModel> (1);
+            memcpy (pAirport->szIcao, szIcao, sizeof (szIcao));
+            pAirport->dLatitude   = slot.airport.dLatitude;
+            pAirport->dLongitude  = slot.airport.dLongitude;
+            pAirport->dAltitude   = slot.airport.dAltitude;
+            pAirport->cRunways    = (DWORD)slot.runways.size ();
+            pAirport->cTaxiPoints = (DWORD)slot.points.size ();
+            pAirport->cParkings   = (DWORD)slot.parkings.size ();
+            pAirport->cTaxiPaths  = (DWORD)slot.paths.size ();
+            pAirport->pRunways    = Pack (slot.runways);
+            pAirport->pTaxiPoints = Pack (slot.points);
+            pAirport->pParkings   = Pack (slot.parkings);
+            pAirport->pTaxiPaths  = Pack (slot.paths);
+        }
+
+        DWORD nTurn = slot.nTurn;
+        m_airports[slot.nKey] = pAirport;
+        slot       = Slot ();
+        slot.nTurn = nTurn;
+        m_cRequests--;
+
+        if (m_pfnAirport != NULL) m_pfnAirport (szIcao, pAirport, m_pContext);
+    }
+
+    template <typename T>
+    const T* Pack (const std::vector<T>& items)
+    {
+        T* pItems = m_arena.Allocate<T> (items.size ());
+        if (!items.empty ()) memcpy (pItems, items.data (), items.size () * sizeof (T));
+        return pItems;
+    }
+
+
+    HANDLE                                              m_hSimConnect;
+    DWORD                                               m_idDefine;
+    DWORD                                               m_idRequestFirst;
+    std::vector<Slot>                                   m_slots;
+    DWORD                                               m_cRequests;    // Slots in use
+    double                                              m_dNowSec;      // As of the last Fetch or Expire
+    std::deque<uint64_t>                                m_queue;        // ICAO keys not yet requested
+    std::unordered_set<uint64_t>                        m_requested;    // Ever queued
+    std::unordered_map<uint64_t, const AirportModel*>   m_airports;
+    CArena                                              m_arena;
+    AirportProc                                         m_pfnAirport;
+    void*                                               m_pContext;
+};
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <Windows.h>
+#include <SimConnect.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+#include "FacilityCache.h"
+#include "SpatialGrid.h"
+
+
+// Of a few hundred airports or a few thousand waypoints in range, some 10 to a cell
+#define FACILITY_RANGE_CELL_DEG 0.25
+
+/**
+ * The facilities around the user aircraft, kept up to date as the sim brings them into range and drops them, for
+ *  nearest-airport and nearest-navaid queries.
+ *
+ * MSFS sends the facilities of a type that come into range under one request ID and those that leave it under
+ *  another (SimConnect_SubscribeToFacilities_EX1), so the set changes by what moved in and out rather than by
+ *  fetching whole lists again. Each type has a spatial grid of its own, which takes an insert or a removal without
+ *  a rebuild. P3D only has the older subscription, which says nothing about facilities leaving, so there Open fails
+ *  with E_NOTIMPL and the set stays empty.
+ */
+class CFacilityRange
+{
+public:
+    typedef struct Hit
+    {
+        const FacilityEntry* pFacility;
+        double               dDistFt;
+    }
+    Hit;
+
+    /**
+     * The set owns the 2 * FACILITY_CACHE_TYPES request IDs from idRequestFirst: of each type's facilities coming
+     *  into range, then of those leaving it.
+     */
+    explicit CFacilityRange (DWORD idRequestFirst) :
+        m_hSimConnect    (NULL),
+        m_idRequestFirst (idRequestFirst)
+    {
+    }
+
+    /**
+     * Subscribe to the facilities coming into and leaving range. Those in range already come in first.
+     */
+    HRESULT Open (HANDLE hSimConnect)
+    {
+        Close ();
+        m_hSimConnect = hSimConnect;
+
+    #ifdef SIM_MSFS2020
+        for (DWORD i = 0; i < FACILITY_CACHE_TYPES; i++)
+        {
+            HRESULT hr = SimConnect_SubscribeToFacilities_EX1 (m_hSimConnect, (SIMCONNECT_FACILITY_LIST_TYPE)i, m_idRequestFirst + 2 * i, m_idRequestFirst + 2 * i + 1);
+            if (FAILED (hr)) return hr;
+        }
+        return S_OK;
+    #else
+        return E_NOTIMPL;
+    #endif
+    }
+
+    /**
+     * Unsubscribe and forget the facilities.
+     */
+    void Close ()
+    {
+    #ifdef SIM_MSFS2020
+        if (m_hSimConnect != NULL)
+        {
+            for (DWORD i = 0; i < FACILITY_CACHE_TYPES; i++)
+            {
+                SimConnect_UnsubscribeToFacilities_EX1 (m_hSimConnect, (SIMCONNECT_FACILITY_LIST_TYPE)i, true, true);
+            }
+        }
+    #endif
+        m_hSimConnect = NULL;
+
+        for (DWORD i = 0; i < FACILITY_CACHE_TYPES; i++)
+        {
+            m_types[i].grid.Clear ();
+            m_types[i].index.clear ();
+            m_types[i].nChanges++;
+        }
+        m_facilities.clear ();
+        m_free.clear ();
+    }
+
+    /**
+     * Pass on AIRPORT_LIST, WAYPOINT_LIST, NDB_LIST and VOR_LIST messages; returns true if it was for the set.
+     */
+    bool OnFacilitiesList (const SIMCONNECT_RECV* pData)
+    {
+        const SIMCONNECT_RECV_FACILITIES_LIST* pList = (const SIMCONNECT_RECV_FACILITIES_LIST*)pData;
+        if (pList->dwRequestID < m_idRequestFirst || pList->dwRequestID >= m_idRequestFirst + 2 * FACILITY_CACHE_TYPES) return false;
+
+        m_received.clear ();
+        if (!AppendFacilities (pData, m_received)) return false;
+
+        bool bLeaving = (pList->dwRequestID - m_idRequestFirst) % 2 != 0;
+        if (!m_received.empty ()) m_types[m_received[0].eType].nChanges++;
+
+        for (size_t i = 0; i < m_received.size (); i++)
+        {
+            if (bLeaving)
+            {
+                Remove (m_received[i]);
+            }
+            else
+            {
+                Add (m_received[i]);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * The k facilities of a type nearest to a position, closest first.
+     */
+    void KNearest (SIMCONNECT_FACILITY_LIST_TYPE eType,
+                   double                        dLat,
+                   double                        dLon,
+                   DWORD                         k,
+                   std::vector<Hit>&             hits)
+    {
+        hits.clear ();
+        if ((DWORD)eType >= FACILITY_CACHE_TYPES) return;
+
+        m_types[eType].grid.KNearest (dLat, dLon, k, m_gridHits);
+        for (size_t i = 0; i < m_gridHits.size (); i++)
+        {
+            Hit hit = { &m_facilities[m_gridHits[i].idObject], m_gridHits[i].dDistFt };
+            hits.push_back (hit);
+        }
+    }
+
+    /**
+     * The nearest NDB or VOR, or NULL if there is none in range.
+     */
+    const FacilityEntry* NearestNavaid (double  dLat,
+                                        double  dLon,
+                                        double* pdDistFt = NULL)
+    {
+        std::vector<Hit> hits;
+        Hit              nearest = { NULL, 0.0 };
+
+        KNearest (SIMCONNECT_FACILITY_LIST_TYPE_VOR, dLat, dLon, 1, hits);
+        if (!hits.empty ()) nearest = hits[0];
+
+        KNearest (SIMCONNECT_FACILITY_LIST_TYPE_NDB, dLat, dLon, 1, hits);
+        if (!hits.empty () && (nearest.pFacility == NULL || hits[0].dDistFt < nearest.dDistFt)) nearest = hits[0];
+
+        if (pdDistFt != NULL) *pdDistFt = nearest.dDistFt;
+        return nearest.pFacility;
+    }
+
+    DWORD Count (SIMCONNECT_FACILITY_LIST_TYPE eType) const
+    {
+        return (DWORD)eType < FACILITY_CACHE_TYPES ? m_types[eType].grid.Count () : 0;
+    }
+
+    /**
+     * Goes up whenever facilities of a type come into range or leave it, for callers that act on changes only.
+     */
+    DWORD Changes (SIMCONNECT_FACILITY_LIST_TYPE eType) const
+    {
+        return (DWORD)eType < FACILITY_CACHE_TYPES ? m_types[eType].nChanges : 0;
+    }
+
+private:
+    CFacilityRange (const CFacilityRange&);
+    CFacilityRange& operator= (const CFacilityRange&);
+
+
+    typedef struct TypeSet
+    {
+        TypeSet () :
+            grid     (FACILITY_RANGE_CELL_DEG),
+            nChanges (0)
+        {
+        }
+
+        CSpatialGrid                                grid;       // Of the slots
+        std::unordered_multimap<uint64_t, uint32_t> index;      // ICAO code to slot
+        DWORD                                       nChanges;   // Lists received that moved facilities in or out
+    }
+    TypeSet;
+
+    /**
+     * Waypoints in different regions can share a code, so the same code and position is the same facility. A
+     *  facility the sim sends again while in range is updated in place.
+     */
+    uint32_t* FindSlot (const FacilityEntry& facility)
+    {
+        auto range = m_types[facility.eType].index.equal_range (IcaoKey (facility.szIcao));
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            const FacilityEntry& other = m_facilities[it->second];
+            if (other.dLatitude == facility.dLatitude && other.dLongitude == facility.dLongitude) return &it->second;
+        }
+        return NULL;
+    }
+
+    void Add (const FacilityEntry& facility)
+    {
+        uint32_t* piSlot = FindSlot (facility);
+        uint32_t  iSlot;
+
+        if (piSlot != NULL)
+        {
+            iSlot = *piSlot;
+        }
+        else if (!m_free.empty ())
+        {
+            iSlot = m_free.back ();
+            m_free.pop_back ();
+            m_types[facility.eType].index.insert (std::make_pair (IcaoKey (facility.szIcao), iSlot));
+        }
+        else
+        {
+            iSlot = (uint32_t)m_facilities.size ();
+            m_facilities.push_back (FacilityEntry ());
+            m_types[facility.eType].index.insert (std::make_pair (IcaoKey (facility.szIcao), iSlot));
+        }
+
+        m_facilities[iSlot] = facility;
+        m_types[facility.eType].grid.Update (iSlot, facility.dLatitude, facility.dLongitude);
+    }
+
+    void Remove (const FacilityEntry& facility)
+    {
+        TypeSet& type  = m_types[facility.eType];
+        auto     range = type.index.equal_range (IcaoKey (facility.szIcao));
+
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            const FacilityEntry& other = m_facilities[it->second];
+            if (other.dLatitude != facility.dLatitude || other.dLongitude != facility.dLongitude) continue;
+
+            uint32_t iSlot = it->second;
+            type.index.erase (it);
+            type.grid.Remove (iSlot);
+            m_free.push_back (iSlot);
+            return;
+        }
+    }
+
+
+    HANDLE                                      m_hSimConnect;
+    DWORD                                       m_idRequestFirst;
+    std::vector<FacilityEntry>                  m_facilities;   // Slots, the IDs in the grids; freed ones are reused
+    std::vector<uint32_t>                       m_free;
+    TypeSet                                     m_types[FACILITY_CACHE_TYPES];
+    std::vector<FacilityEntry>                  m_received;     // Scratch for a message's facilities
+    std::vector<CSpatialGrid::Hit>              m_gridHits;
+};
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+
+
+/**
+ * Open-addressing hash map from 32-bit IDs (sim object IDs, request IDs, ...) to values, stored in one flat array.
+ *
+ * Uses linear probing with backward-shift deletion, so there are no tombstones and lookups never degrade after many
+ *  removals. Find and Erase never allocate; Insert only allocates when the table has to grow beyond 3/4 load, which
+ *  can be avoided altogether with Reserve.
+ *
+ * The key 0xFFFFFFFF (SIMCONNECT_UNUSED) marks an empty slot and cannot be stored.
+ */
+template <typename TValue>
+class CFlatHashMap
+{
+public:
+    static const uint32_t KEY_EMPTY = 0xFFFFFFFF;
+
+    CFlatHashMap () :
+        m_pSlots    (NULL),
+        m_nMask     (0),
+        m_nShift    (32),
+        m_cEntries  (0)
+    {
+    }
+
+    ~CFlatHashMap ()
+    {
+        Free (m_pSlots, m_nMask + 1);
+    }
+
+    /**
+     * Make room for at least cEntries entries without growing.
+     */
+    void Reserve (uint32_t cEntries)
+    {
+        uint32_t cSlots = 16;
+        while (cSlots - cSlots / 4 < cEntries) cSlots *= 2;
+
+        if (m_pSlots == NULL || cSlots > m_nMask + 1) Rehash (cSlots);
+    }
+
+    TValue* Find (uint32_t idKey)
+    {
+        if (m_cEntries == 0) return NULL;
+
+        for (uint32_t i = Home (idKey); ; i = (i + 1) & m_nMask)
+        {
+            if (m_pSlots[i].idKey == idKey)     return &m_pSlots[i].value;
+            if (m_pSlots[i].idKey == KEY_EMPTY) return NULL;
+        }
+    }
+
+    const TValue* Find (uint32_t idKey) const
+    {
+        return const_cast<CFlatHashMap*> (this)->Find (idKey);
+    }
+
+    /**
+     * Returns the value for a key, inserting a default-constructed one if the key is not present yet.
+     */
+    TValue& Insert (uint32_t idKey,
+                    bool*    pbInserted = NULL)
+    {
+        if (m_pSlots == NULL || (m_cEntries + 1) > (m_nMask + 1) - (m_nMask + 1) / 4)
+        {
+            Rehash (m_pSlots == NULL ? 16 : (m_nMask + 1) * 2);
+        }
+
+        uint32_t i = Home (idKey);
+        for (; m_pSlots[i].idKey != KEY_EMPTY; i = (i + 1) & m_nMask)
+        {
+            if (m_pSlots[i].idKey == idKey)
+            {
+                if (pbInserted) *pbInserted = false;
+                return m_pSlots[i].value;
+            }
+        }
+
+        m_pSlots[i].idKey = idKey;
+        m_pSlots[i].value = TValue ();
+        m_cEntries++;
+
+        if (pbInserted) *pbInserted = true;
+        return m_pSlots[i].value;
+    }
+
+    bool Erase (uint32_t idKey)
+    {
+        if (m_cEntries == 0) return false;
+
+        uint32_t i = Home (idKey);
+        for (; m_pSlots[i].idKey != idKey; i = (i + 1) & m_nMask)
+        {
+            if (m_pSlots[i].idKey == KEY_EMPTY) return false;
+        }
+
+        // Shift following entries of the same probe run back into the hole
+        for (uint32_t j = (i + 1) & m_nMask; m_pSlots[j].idKey != KEY_EMPTY; j = (j + 1) & m_nMask)
+        {
+            uint32_t iHome = Home (m_pSlots[j].idKey);
+            if (((j - iHome) & m_nMask) >= ((j - i) & m_nMask))
+            {
+                m_pSlots[i] = m_pSlots[j];
+                i = j;
+            }
+        }
+
+        m_pSlots[i].idKey = KEY_EMPTY;
+        m_pSlots[i].value = TValue ();
+        m_cEntries--;
+        return true;
+    }
+
+    void Clear ()
+    {
+        for (uint32_t i = 0; m_pSlots != NULL && i <= m_nMask; i++)
+        {
+            m_pSlots[i].idKey = KEY_EMPTY;
+            m_pSlots[i].value = TValue ();
+        }
+        m_cEntries = 0;
+    }
+
+    uint32_t Size () const
+    {
+        return m_cEntries;
+    }
+
+    /**
+     * Slot-wise iteration: for (i = 0; i < Capacity (); i++) if (IsUsed (i)) ... KeyAt (i), ValueAt (i).
+     */
+    uint32_t Capacity () const
+    {
+        return m_pSlots == NULL ? 0 : m_nMask + 1;
+    }
+
+    bool IsUsed (uint32_t iSlot) const
+    {
+        return m_pSlots[iSlot].idKey != KEY_EMPTY;
+    }
+
+    uint32_t KeyAt (uint32_t iSlot) const
+    {
+        return m_pSlots[iSlot].idKey;
+    }
+
+    TValue& ValueAt (uint32_t iSlot)
+    {
+        return m_pSlots[iSlot].value;
+    }
+
+private:
+    typedef struct Slot
+    {
+        uint32_t idKey;
+        TValue   value;
+    }
+    Slot;
+
+    /**
+     * Fibonacci hashing; object IDs are mostly sequential, which the multiplication spreads over the table.
+     */
+    uint32_t Home (uint32_t idKey) const
+    {
+        return (uint32_t)((idKey * 2654435769u) >> m_nShift) & m_nMask;
+    }
+
+    void Rehash (uint32_t cSlots)
+    {
+        Slot*    pOld   = m_pSlots;
+        uint32_t cOld   = m_pSlots == NULL ? 0 : m_nMask + 1;
+
+        m_pSlots = (Slot*)malloc (sizeof (Slot) * cSlots);
+        if (m_pSlots == NULL) throw std::bad_alloc ();
+
+        for (uint32_t i = 0; i < cSlots; i++)
+        {
+            new (&m_pSlots[i]) Slot ();
+            m_pSlots[i].idKey = KEY_EMPTY;
+        }
+
+        m_nMask  = cSlots - 1;
+        m_nShift = 32;
+        for (uint32_t n = cSlots; n > 1; n >>= 1) m_nShift--;
+        m_cEntries = 0;
+
+        for (uint32_t i = 0; i < cOld; i++)
+        {
+            if (pOld[i].idKey != KEY_EMPTY) Insert (pOld[i].idKey) = pOld[i].value;
+        }
+        Free (pOld, cOld);
+    }
+
+    static void Free (Slot*    pSlots,
+                      uint32_t cSlots)
+    {
+        if (pSlots == NULL) return;
+
+        for (uint32_t i = 0; i < cSlots; i++) pSlots[i].~Slot ();
+        free (pSlots);
+    }
+
+    CFlatHashMap (const CFlatHashMap&);
+    CFlatHashMap& operator= (const CFlatHashMap&);
+
+
+    Slot*       m_pSlots;
+    uint32_t    m_nMask;
+    uint32_t    m_nShift;
+    uint32_t    m_cEntries;
+};
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Geodesy.h"
+#include "LocalFrame.h"
+
+
+/**
+ * Placement of vehicles in a formation around a reference position and heading, typically the user aircraft.
+ *
+ * The layout is built in the body frame of the reference (feet ahead and to the right, heading relative to its
+ *  nose) from lines, grids, rings and points along polylines, which can be combined. Place then turns the whole
+ *  layout into positions and true headings in one pass over structures of arrays: a rotation and the scale factors
+ *  of a local frame at the reference, or CGeodesy::TranslateBatch for layouts too large for a flat frame to stay
+ *  within a foot.
+ */
+class CFormation
+{
+public:
+    CFormation () :
+        m_dExtentFt (0.0)
+    {
+    }
+
+    void Clear ()
+    {
+        m_aheads.clear ();
+        m_rights.clear ();
+        m_relHeads.clear ();
+        m_dExtentFt = 0.0;
+    }
+
+    /**
+     * One vehicle dAheadFt ahead and dRightFt to the right of the reference, heading dHeadDeg relative to its nose.
+     */
+    void Add (double dAheadFt,
+              double dRightFt,
+              double dHeadDeg)
+    {
+        m_aheads.push_back (dAheadFt);
+        m_rights.push_back (dRightFt);
+        m_relHeads.push_back (dHeadDeg);
+        m_dExtentFt = fmax (m_dExtentFt, sqrt (dAheadFt * dAheadFt + dRightFt * dRightFt));
+    }
+
+    /**
+     * cVehicles in a row across the nose, dAheadFt ahead and centred on it, dSpacingFt apart.
+     */
+    void Line (uint32_t cVehicles,
+               double   dAheadFt,
+               double   dSpacingFt,
+               double   dHeadDeg)
+    {
+        Grid (1, cVehicles, dAheadFt, 0.0, dSpacingFt, dHeadDeg);
+    }
+
+    /**
+     * cRows rows of cCols vehicles, the first row dAheadFt ahead and the others further ahead by dRowSpacingFt each,
+     *  every row centred across the nose with dColSpacingFt between columns.
+     */
+    void Grid (uint32_t cRows,
+               uint32_t cCols,
+               double   dAheadFt,
+               double   dRowSpacingFt,
+               double   dColSpacingFt,
+               double   dHeadDeg)
+    {
+        for (uint32_t iRow = 0; iRow < cRows; iRow++)
+        {
+            for (uint32_t iCol = 0; iCol < cCols; iCol++)
+            {
+                Add (dAheadFt + iRow * dRowSpacingFt, (iCol - (cCols - 1) / 2.0) * dColSpacingFt, dHeadDeg);
+            }
+        }
+    }
+
+    /**
+     * cVehicles evenly around a circle of dRadiusFt about the reference, the first one straight ahead. dHeadDeg is
+     *  relative to facing outwards, so with 90 they all face clockwise around the circle.
+     */
+    void Ring (uint32_t cVehicles,
+               double   dRadiusFt,
+               double   dHeadDeg)
+    {
+        for (uint32_t i = 0; i < cVehicles; i++)
+        {
+            double dBearingDeg = 360.0 * i / cVehicles;
+            double dBearingRad = CAngle::Degrees (dBearingDeg).Rad ();
+            Add (dRadiusFt * cos (dBearingRad), dRadiusFt * sin (dBearingRad), dBearingDeg + dHeadDeg);
+        }
+    }
+
+    /**
+     * cVehicles evenly spaced along a polyline of cPoints body-frame points, from its first point to its last, each
+     *  heading along its segment plus dHeadDeg.
+     */
+    void Polyline (const double* pAheads,
+                   const double* pRights,
+                   uint32_t      cPoints,
+                   uint32_t      cVehicles,
+                   double        dHeadDeg)
+    {
+        if (cPoints < 2 || cVehicles == 0) return;
+
+        double dLengthFt = 0.0;
+        for (uint32_t i = 1; i < cPoints; i++)
+        {
+            dLengthFt += hypot (pAheads[i] - pAheads[i - 1], pRights[i] - pRights[i - 1]);
+        }
+
+        double   dSpacingFt = cVehicles > 1 ? dLengthFt / (cVehicles - 1) : 0.0;
+        double   dStartFt   = 0.0;     // Distance along the polyline to the start of segment iSeg
+        uint32_t iSeg       = 0;
+
+        for (uint32_t i = 0; i < cVehicles; i++)
+        {
+            double dAtFt  = i * dSpacingFt;
+            double dSegFt = hypot (pAheads[iSeg + 1] - pAheads[iSeg], pRights[iSeg + 1] - pRights[iSeg]);
+
+            while (dAtFt > dStartFt + dSegFt && iSeg + 2 < cPoints)
+            {
+                dStartFt += dSegFt;
+                iSeg++;
+                dSegFt = hypot (pAheads[iSeg + 1] - pAheads[iSeg], pRights[iSeg + 1] - pRights[iSeg]);
+            }
+
+            double dAhead = pAheads[iSeg + 1] - pAheads[iSeg];
+            double dRight = pRights[iSeg + 1] - pRights[iSeg];
+            double dT     = dSegFt > 0.0 ? fmin ((dAtFt - dStartFt) / dSegFt, 1.0) : 0.0;
+
+            Add (pAheads[iSeg] + dT * dAhead, pRights[iSeg] + dT * dRight,
+                 CAngle::Radians (atan2 (dRight, dAhead)).Deg () + dHeadDeg);
+        }
+    }
+
+    /**
+     * Place the layout around a reference position (degrees) and true heading (degrees). The results are valid until
+     *  the layout changes or the next Place.
+     */
+    void Place (double dLat,
+                double dLon,
+                double dHead)
+    {
+        uint32_t cVehicles = Count ();
+
+        m_lats.resize (cVehicles);
+        m_lons.resize (cVehicles);
+        m_heads.resize (cVehicles);
+
+        for (uint32_t i = 0; i < cVehicles; i++)
+        {
+            m_heads[i] = CGeodesy::Mod (dHead + m_relHeads[i], 360.0);
+        }
+
+        CLocalFrame frame;
+        frame.Anchor (dLat, dLon);
+
+        if (m_dExtentFt <= frame.RangeFt ())
+        {
+            // Rotate the body frame onto east/north and scale to degrees
+            double dSin = sin (CAngle::Degrees (dHead).Rad ());
+            double dCos = cos (CAngle::Degrees (dHead).Rad ());
+
+            for (uint32_t i = 0; i < cVehicles; i++)
+            {
+                double dEast  = m_aheads[i] * dSin + m_rights[i] * dCos;
+                double dNorth = m_aheads[i] * dCos - m_rights[i] * dSin;
+                frame.FromLocal (dEast, dNorth, m_lats[i], m_lons[i]);
+            }
+        }
+        else
+        {
+            m_bearings.resize (cVehicles);
+            m_dists.resize (cVehicles);
+
+            for (uint32_t i = 0; i < cVehicles; i++)
+            {
+                m_bearings[i] = dHead + CAngle::Radians (atan2 (m_rights[i], m_aheads[i])).Deg ();
+                m_dists[i]    = hypot (m_aheads[i], m_rights[i]);
+                m_lats[i]     = dLat;
+                m_lons[i]     = dLon;
+            }
+
+            CGeodesy::TranslateBatch (cVehicles, m_bearings.data (), m_dists.data (), m_lats.data (), m_lons.data ());
+        }
+    }
+
+    uint32_t Count () const
+    {
+        return (uint32_t)m_aheads.size ();
+    }
+
+    /**
+     * Results of the last Place, for i in [0, Count ()).
+     */
+    double LatAt  (uint32_t i) const { return m_lats[i]; }
+    double LonAt  (uint32_t i) const { return m_lons[i]; }
+    double HeadAt (uint32_t i) const { return m_heads[i]; }
+
+private:
+    // Layout in the body frame
+    std::vector<double> m_aheads;
+    std::vector<double> m_rights;
+    std::vector<double> m_relHeads;
+    double              m_dExtentFt;    // Largest distance from the reference
+
+    // Placed
+    std::vector<double> m_lats;
+    std::vector<double> m_lons;
+    std::vector<double> m_heads;
+
+    // Scratch for the spherical fallback
+    std::vector<double> m_bearings;
+    std::vector<double> m_dists;
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <Windows.h>
+#include <SimConnect.h>
+#include <vector>
+
+
+/**
+ * Runs periodic client work on the sim's own clock: every sim frame, six times a second or once a second, driven by
+ *  the "Frame", "6Hz" and "1sec" system events instead of wall-clock timers.
+ *
+ * Sim time is counted in frames, each 1 / fFrameRate seconds at fSimSpeed times real time, so it runs faster or
+ *  slower with the sim rate and stands still while the sim is paused. Tasks are not run while paused, unless they
+ *  ask to be; the sim also sends fewer messages then, so a client waiting on the SimConnect event handle idles.
+ */
+class CFrameScheduler
+{
+public:
+    enum SCHEDULE
+    {
+        SCHEDULE_FRAME,
+        SCHEDULE_6HZ,
+        SCHEDULE_1SEC
+    };
+
+    /**
+     * Runs a task. dSimSeconds is the sim time since the task last ran, or since it was added.
+     */
+    typedef void (CALLBACK* TaskProc) (double dSimSeconds,
+                                       void*  pContext);
+
+    CFrameScheduler () :
+        m_idEventFrame (SIMCONNECT_UNUSED),
+        m_idEvent6Hz   (SIMCONNECT_UNUSED),
+        m_idEvent1Sec  (SIMCONNECT_UNUSED),
+        m_idEventPause (SIMCONNECT_UNUSED),
+        m_bPaused      (false),
+        m_fSimSpeed    (1.0f),
+        m_dSimTime     (0.0)
+    {
+    }
+
+    /**
+     * Subscribe to the system events that drive the scheduler. The frame events arrive as
+     *  SIMCONNECT_RECV_ID_EVENT_FRAME, the others as SIMCONNECT_RECV_ID_EVENT.
+     */
+    void Subscribe (HANDLE hSimConnect,
+                    DWORD  idEventFrame,
+                    DWORD  idEvent6Hz,
+                    DWORD  idEvent1Sec,
+                    DWORD  idEventPause)
+    {
+        m_idEventFrame = idEventFrame;
+        m_idEvent6Hz   = idEvent6Hz;
+        m_idEvent1Sec  = idEvent1Sec;
+        m_idEventPause = idEventPause;
+
+        SimConnect_SubscribeToSystemEvent (hSimConnect, idEventFrame, "Frame");
+        SimConnect_SubscribeToSystemEvent (hSimConnect, idEvent6Hz,   "6Hz");
+        SimConnect_SubscribeToSystemEvent (hSimConnect, idEvent1Sec,  "1sec");
+        SimConnect_SubscribeToSystemEvent (hSimConnect, idEventPause, "Pause");
+    }
+
+    /**
+     * Run pfnTask on a schedule from the next tick on. Returns a task ID for RemoveTask.
+     */
+    DWORD AddTask (SCHEDULE schedule,
+                   TaskProc pfnTask,
+                   void*    pContext,
+                   bool     bWhilePaused = false)
+    {
+        Task task;
+        task.bUsed        = true;
+        task.schedule     = schedule;
+        task.pfnTask      = pfnTask;
+        task.pContext     = pContext;
+        task.bWhilePaused = bWhilePaused;
+        task.dLastRun     = m_dSimTime;
+
+        for (DWORD i = 0; i < m_tasks.size (); i++)
+        {
+            if (!m_tasks[i].bUsed)
+            {
+                m_tasks[i] = task;
+                return i + 1;
+            }
+        }
+        m_tasks.push_back (task);
+        return (DWORD)m_tasks.size ();
+    }
+
+    /**
+     * May be called from a task, including for itself.
+     */
+    void RemoveTask (DWORD idTask)
+    {
+        if (idTask == 0 || idTask > m_tasks.size ()) return;
+
+        m_tasks[idTask - 1].bUsed = false;
+    }
+
+    /**
+     * Handles the scheduler's events, running the tasks that are due. Returns false for any other message, so the
+     *  caller can handle it itself.
+     */
+    bool OnRecv (const SIMCONNECT_RECV* pData)
+    {
+        if (pData->dwID == SIMCONNECT_RECV_ID_EVENT_FRAME)
+        {
+            const SIMCONNECT_RECV_EVENT_FRAME* pFrame = (const SIMCONNECT_RECV_EVENT_FRAME*)pData;
+            if (pFrame->uEventID != m_idEventFrame) return false;
+
+            m_fSimSpeed = pFrame->fSimSpeed;
+            if (!m_bPaused && pFrame->fFrameRate > 0.0f) m_dSimTime += pFrame->fSimSpeed / pFrame->fFrameRate;
+
+            RunTasks (SCHEDULE_FRAME);
+            return true;
+        }
+
+        if (pData->dwID != SIMCONNECT_RECV_ID_EVENT) return false;
+
+        const SIMCONNECT_RECV_EVENT* pEvt = (const SIMCONNECT_RECV_EVENT*)pData;
+
+        if (pEvt->uEventID == m_idEvent6Hz)
+        {
+            RunTasks (SCHEDULE_6HZ);
+        }
+        else if (pEvt->uEventID == m_idEvent1Sec)
+        {
+            RunTasks (SCHEDULE_1SEC);
+        }
+        else if (pEvt->uEventID == m_idEventPause)
+        {
+            m_bPaused = pEvt->dwData != 0;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Seconds of sim time since the first frame.
+     */
+    double SimTime () const
+    {
+        return m_dSimTime;
+    }
+
+    /**
+     * Sim rate of the last frame, 1 for real time.
+     */
+    float SimSpeed () const
+    {
+        return m_fSimSpeed;
+    }
+
+    bool IsPaused () const
+    {
+        return m_bPaused;
+    }
+
+private:
+    typedef struct Task
+    {
+        bool     bUsed;
+        SCHEDULE schedule;
+        TaskProc pfnTask;
+        void*    pContext;
+        bool     bWhilePaused;
+        double   dLastRun;
+    }
+    Task;
+
+    void RunTasks (SCHEDULE schedule)
+    {
+        // A task may add tasks, which can grow m_tasks under the loop; those added at the end wait for the next tick
+        DWORD cTasks = (DWORD)m_tasks.size ();
+
+        for (DWORD i = 0; i < cTasks; i++)
+        {
+            Task& task = m_tasks[i];
+            if (!task.bUsed || task.schedule != schedule || (m_bPaused && !task.bWhilePaused)) continue;
+
+            double   dSimSeconds = m_dSimTime - task.dLastRun;
+            TaskProc pfnTask     = task.pfnTask;
+            void*    pContext    = task.pContext;
+
+            task.dLastRun = m_dSimTime;
+            pfnTask (dSimSeconds, pContext);
+        }
+    }
+
+
+    DWORD               m_idEventFrame;
+    DWORD               m_idEvent6Hz;
+    DWORD               m_idEvent1Sec;
+    DWORD               m_idEventPause;
+    bool                m_bPaused;
+    float               m_fSimSpeed;
+    double              m_dSimTime;
+    std::vector<Task>   m_tasks;
+};
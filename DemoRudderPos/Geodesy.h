@@ -0,0 +1,380 @@
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stddef.h>
+
+#include "Trig.h"
+#include "Units.h"
+
+
+typedef struct LatLon
+{
+    CAngle lat;
+    CAngle lon;
+}
+LatLon;
+
+
+/**
+ * Geodesy on lat/lon positions and distances. Translate takes the typed units; the kernels meant for arrays take
+ *  raw degrees and feet.
+ *
+ * Translate and DistanceFt assume a sphere, which is the fast mode. Direct and Inverse solve the same problems on the
+ *  WGS-84 ellipsoid with Vincenty's formulae, which are good to a fraction of a millimetre but iterate; over a few
+ *  nautical miles the sphere is off by metres. The batch entry points take structures of arrays for placing or
+ *  measuring thousands of points in one call.
+ */
+class CGeodesy
+{
+public:
+    /**
+     * Arc length on the sphere Translate works on, where a minute of arc is a nautical mile, and the reverse.
+     */
+    static constexpr CDistance ArcLength (CAngle arc)
+    {
+        return CDistance::Nm (arc.Deg () * 60.0);
+    }
+
+    static constexpr CAngle ArcAngle (CDistance length)
+    {
+        return CAngle::Degrees (length.Nm () / 60.0);
+    }
+
+    // ArcLength of one degree, for kernels on raw degrees
+    static constexpr double FT_PER_DEG = UnitConvert<UnitNauticalMiles, UnitFeet> (60.0);
+
+    /**
+     * Move (translate) a specified distance at a specified true heading.
+     */
+    static LatLon Translate (const LatLon& from,
+                             CHeading      heading,
+                             CDistance     distance)
+    {
+        if (distance == CDistance ()) return from; // Nothing to do
+
+        double dLatRad;
+        double dLonRad;
+        TranslateRad<CLibmTrig> (from.lat.Rad (), from.lon.Rad (), heading.Rad (), ArcAngle (distance).Rad (), dLatRad, dLonRad);
+
+        LatLon to = { CAngle::Radians (dLatRad), CAngle::Radians (dLonRad) };
+        return to;
+    }
+
+    /**
+     * Modulus (i.e. remainder) of a division. Unlike C-library fmod where the numerator sign is preserved, here the
+     *  denominator sign is preserved.
+     */
+    static double Mod (double dNumer,
+                       double dDenom)
+    {
+        return dNumer - dDenom * floor (dNumer / dDenom);
+    }
+
+    /**
+     * Great-circle distance in feet between two positions in degrees (haversine).
+     */
+    static double DistanceFt (double dLat0,
+                              double dLon0,
+                              double dLat1,
+                              double dLon1)
+    {
+        double dSinLat = sin (CAngle::Degrees (dLat1 - dLat0).Rad () / 2.0);
+        double dSinLon = sin (CAngle::Degrees (dLon1 - dLon0).Rad () / 2.0);
+        double dA      = dSinLat * dSinLat +
+                         cos (CAngle::Degrees (dLat0).Rad ()) * cos (CAngle::Degrees (dLat1).Rad ()) * dSinLon * dSinLon;
+
+        return ArcLength (CAngle::Radians (2.0 * asin (sqrt (dA)))).Ft ();
+    }
+
+    /**
+     * Spherical Translate over arrays of positions; entry i moves pDistances[i] feet at true heading pHeadings[i].
+     *
+     * TRIG_MODE_POLY moves the results by at most 0.0001 ft against TRIG_MODE_LIBM up to 20 nm, except for arcs
+     *  passing within a mile or so of a pole: there the longitude comes from an asin of nearly +-1, which magnifies
+     *  any error, and the difference grows to 0.01 ft. (The formula only holds for longitude changes under 90
+     *  degrees anyway, so arcs around a pole are off in either mode.)
+     */
+    static void TranslateBatch (size_t        cPoints,
+                                const double* pHeadings,
+                                const double* pDistances,
+                                double*       pLats,
+                                double*       pLons,
+                                TRIG_MODE     mode = TRIG_MODE_LIBM)
+    {
+        if (mode == TRIG_MODE_POLY)
+        {
+            TranslateBatchWith<CPolyTrig> (cPoints, pHeadings, pDistances, pLats, pLons);
+        }
+        else
+        {
+            TranslateBatchWith<CLibmTrig> (cPoints, pHeadings, pDistances, pLats, pLons);
+        }
+    }
+
+    /**
+     * Direct geodesic problem on the WGS-84 ellipsoid: the position dDistance feet from (dLat, dLon) along the
+     *  geodesic leaving at true heading dHeading. pdHeadingEnd, if given, receives the true heading of the geodesic
+     *  on arrival. Returns false if the iteration did not converge, which does not happen short of antipodal
+     *  distances.
+     */
+    static bool Direct (double  dLat,
+                        double  dLon,
+                        double  dHeading,
+                        double  dDistance,
+                        double& dLatEnd,
+                        double& dLonEnd,
+                        double* pdHeadingEnd = NULL)
+    {
+        const double dB = WGS84_A_FT * (1.0 - WGS84_F);
+
+        double dSinAlpha1  = sin (CAngle::Degrees (dHeading).Rad ());
+        double dCosAlpha1  = cos (CAngle::Degrees (dHeading).Rad ());
+        double dTanU1      = (1.0 - WGS84_F) * tan (CAngle::Degrees (dLat).Rad ());
+        double dCosU1      = 1.0 / sqrt (1.0 + dTanU1 * dTanU1);
+        double dSinU1      = dTanU1 * dCosU1;
+        double dSigma1     = atan2 (dTanU1, dCosAlpha1);
+        double dSinAlpha   = dCosU1 * dSinAlpha1;
+        double dCos2Alpha  = 1.0 - dSinAlpha * dSinAlpha;
+        double dU2         = dCos2Alpha * (WGS84_A_FT * WGS84_A_FT - dB * dB) / (dB * dB);
+        double dA          = 1.0 + dU2 / 16384.0 * (4096.0 + dU2 * (-768.0 + dU2 * (320.0 - 175.0 * dU2)));
+        double dBigB       = dU2 / 1024.0 * (256.0 + dU2 * (-128.0 + dU2 * (74.0 - 47.0 * dU2)));
+        double dSigma      = dDistance / (dB * dA);
+        double dSigmaPrev  = 0.0;
+        double dSinSigma   = 0.0;
+        double dCosSigma   = 1.0;
+        double dCos2SigmaM = 1.0;
+        int    iIter       = 0;
+
+        do
+        {
+            dCos2SigmaM = cos (2.0 * dSigma1 + dSigma);
+            dSinSigma   = sin (dSigma);
+            dCosSigma   = cos (dSigma);
+
+            double dDeltaSigma = dBigB * dSinSigma * (dCos2SigmaM + dBigB / 4.0 *
+                (dCosSigma * (-1.0 + 2.0 * dCos2SigmaM * dCos2SigmaM) -
+                 dBigB / 6.0 * dCos2SigmaM * (-3.0 + 4.0 * dSinSigma * dSinSigma) * (-3.0 + 4.0 * dCos2SigmaM * dCos2SigmaM)));
+
+            dSigmaPrev = dSigma;
+            dSigma     = dDistance / (dB * dA) + dDeltaSigma;
+        }
+        while (fabs (dSigma - dSigmaPrev) > 1e-12 && ++iIter < 100);
+
+        double dX      = dSinU1 * dSinSigma - dCosU1 * dCosSigma * dCosAlpha1;
+        double dLatRad = atan2 (dSinU1 * dCosSigma + dCosU1 * dSinSigma * dCosAlpha1,
+                                (1.0 - WGS84_F) * sqrt (dSinAlpha * dSinAlpha + dX * dX));
+        double dLambda = atan2 (dSinSigma * dSinAlpha1, dCosU1 * dCosSigma - dSinU1 * dSinSigma * dCosAlpha1);
+        double dC      = WGS84_F / 16.0 * dCos2Alpha * (4.0 + WGS84_F * (4.0 - 3.0 * dCos2Alpha));
+        double dL      = dLambda - (1.0 - dC) * WGS84_F * dSinAlpha *
+                         (dSigma + dC * dSinSigma * (dCos2SigmaM + dC * dCosSigma * (-1.0 + 2.0 * dCos2SigmaM * dCos2SigmaM)));
+
+        dLatEnd = CAngle::Radians (dLatRad).Deg ();
+        dLonEnd = Mod (dLon + CAngle::Radians (dL).Deg () + 180.0, 360.0) - 180.0;
+        if (pdHeadingEnd != NULL) *pdHeadingEnd = Mod (CAngle::Radians (atan2 (dSinAlpha, -dX)).Deg (), 360.0);
+
+        return iIter < 100;
+    }
+
+    /**
+     * Inverse geodesic problem on the WGS-84 ellipsoid: the distance in feet between two positions and the true
+     *  heading of the geodesic leaving the first one. Returns false if the iteration did not converge, which only
+     *  happens for nearly antipodal positions; the results are then the spherical ones.
+     */
+    static bool Inverse (double  dLat0,
+                         double  dLon0,
+                         double  dLat1,
+                         double  dLon1,
+                         double& dDistance,
+                         double* pdHeading = NULL)
+    {
+        const double dB = WGS84_A_FT * (1.0 - WGS84_F);
+
+        double dL          = CAngle::Degrees (dLon1 - dLon0).Rad ();
+        double dTanU1      = (1.0 - WGS84_F) * tan (CAngle::Degrees (dLat0).Rad ());
+        double dTanU2      = (1.0 - WGS84_F) * tan (CAngle::Degrees (dLat1).Rad ());
+        double dCosU1      = 1.0 / sqrt (1.0 + dTanU1 * dTanU1);
+        double dCosU2      = 1.0 / sqrt (1.0 + dTanU2 * dTanU2);
+        double dSinU1      = dTanU1 * dCosU1;
+        double dSinU2      = dTanU2 * dCosU2;
+        double dLambda     = dL;
+        double dLambdaPrev = 0.0;
+        double dSinLambda  = 0.0;
+        double dCosLambda  = 1.0;
+        double dSinSigma   = 0.0;
+        double dCosSigma   = 1.0;
+        double dSigma      = 0.0;
+        double dCos2Alpha  = 1.0;
+        double dCos2SigmaM = 1.0;
+        int    iIter       = 0;
+
+        do
+        {
+            dSinLambda = sin (dLambda);
+            dCosLambda = cos (dLambda);
+
+            double dCross = dCosU1 * dSinU2 - dSinU1 * dCosU2 * dCosLambda;
+            dSinSigma = sqrt ((dCosU2 * dSinLambda) * (dCosU2 * dSinLambda) + dCross * dCross);
+            if (dSinSigma == 0.0)
+            {
+                // Same position
+                dDistance = 0.0;
+                if (pdHeading != NULL) *pdHeading = 0.0;
+                return true;
+            }
+
+            dCosSigma   = dSinU1 * dSinU2 + dCosU1 * dCosU2 * dCosLambda;
+            dSigma      = atan2 (dSinSigma, dCosSigma);
+
+            double dSinAlpha = dCosU1 * dCosU2 * dSinLambda / dSinSigma;
+            dCos2Alpha  = 1.0 - dSinAlpha * dSinAlpha;
+            dCos2SigmaM = dCos2Alpha != 0.0 ? dCosSigma - 2.0 * dSinU1 * dSinU2 / dCos2Alpha : 0.0; // 0 along the equator
+
+            double dC = WGS84_F / 16.0 * dCos2Alpha * (4.0 + WGS84_F * (4.0 - 3.0 * dCos2Alpha));
+            dLambdaPrev = dLambda;
+            dLambda     = dL + (1.0 - dC) * WGS84_F * dSinAlpha *
+                          (dSigma + dC * dSinSigma * (dCos2SigmaM + dC * dCosSigma * (-1.0 + 2.0 * dCos2SigmaM * dCos2SigmaM)));
+        }
+        while (fabs (dLambda - dLambdaPrev) > 1e-12 && ++iIter < 100);
+
+        if (iIter >= 100)
+        {
+            dDistance = DistanceFt (dLat0, dLon0, dLat1, dLon1);
+            if (pdHeading != NULL) *pdHeading = Heading (dLat0, dLon0, dLat1, dLon1);
+            return false;
+        }
+
+        double dU2         = dCos2Alpha * (WGS84_A_FT * WGS84_A_FT - dB * dB) / (dB * dB);
+        double dA          = 1.0 + dU2 / 16384.0 * (4096.0 + dU2 * (-768.0 + dU2 * (320.0 - 175.0 * dU2)));
+        double dBigB       = dU2 / 1024.0 * (256.0 + dU2 * (-128.0 + dU2 * (74.0 - 47.0 * dU2)));
+        double dDeltaSigma = dBigB * dSinSigma * (dCos2SigmaM + dBigB / 4.0 *
+            (dCosSigma * (-1.0 + 2.0 * dCos2SigmaM * dCos2SigmaM) -
+             dBigB / 6.0 * dCos2SigmaM * (-3.0 + 4.0 * dSinSigma * dSinSigma) * (-3.0 + 4.0 * dCos2SigmaM * dCos2SigmaM)));
+
+        dDistance = dB * dA * (dSigma - dDeltaSigma);
+        if (pdHeading != NULL)
+        {
+            *pdHeading = Mod (CAngle::Radians (atan2 (dCosU2 * dSinLambda, dCosU1 * dSinU2 - dSinU1 * dCosU2 * dCosLambda)).Deg (), 360.0);
+        }
+        return true;
+    }
+
+    /**
+     * Direct over arrays of positions. Returns the number of points that did not converge.
+     */
+    static size_t DirectBatch (size_t        cPoints,
+                               const double* pLats,
+                               const double* pLons,
+                               const double* pHeadings,
+                               const double* pDistances,
+                               double*       pLatsEnd,
+                               double*       pLonsEnd)
+    {
+        size_t cFailed = 0;
+
+        for (size_t i = 0; i < cPoints; i++)
+        {
+            if (!Direct (pLats[i], pLons[i], pHeadings[i], pDistances[i], pLatsEnd[i], pLonsEnd[i])) cFailed++;
+        }
+        return cFailed;
+    }
+
+    /**
+     * Inverse over arrays of position pairs; pHeadings may be NULL. Returns the number of points that did not
+     *  converge.
+     */
+    static size_t InverseBatch (size_t        cPoints,
+                                const double* pLats0,
+                                const double* pLons0,
+                                const double* pLats1,
+                                const double* pLons1,
+                                double*       pDistances,
+                                double*       pHeadings)
+    {
+        size_t cFailed = 0;
+
+        for (size_t i = 0; i < cPoints; i++)
+        {
+            if (!Inverse (pLats0[i], pLons0[i], pLats1[i], pLons1[i], pDistances[i],
+                          pHeadings != NULL ? &pHeadings[i] : NULL)) cFailed++;
+        }
+        return cFailed;
+    }
+
+    /**
+     * Initial great-circle true heading in degrees from one position to another.
+     */
+    static double Heading (double dLat0,
+                           double dLon0,
+                           double dLat1,
+                           double dLon1)
+    {
+        double dLat0Rad = CAngle::Degrees (dLat0).Rad ();
+        double dLat1Rad = CAngle::Degrees (dLat1).Rad ();
+        double dLonRad  = CAngle::Degrees (dLon1 - dLon0).Rad ();
+
+        double dRad     = atan2 (sin (dLonRad) * cos (dLat1Rad),
+                                 cos (dLat0Rad) * sin (dLat1Rad) - sin (dLat0Rad) * cos (dLat1Rad) * cos (dLonRad));
+
+        return Mod (CAngle::Radians (dRad).Deg (), 360.0);
+    }
+
+private:
+    // WGS-84 ellipsoid: semi-major axis in feet and flattening
+    static constexpr double WGS84_A_FT = UnitConvert<UnitMeters, UnitFeet> (6378137.0);
+    static constexpr double WGS84_F    = 1.0 / 298.257223563;
+
+    template <typename TTrig>
+    static void TranslateBatchWith (size_t        cPoints,
+                                    const double* pHeadings,
+                                    const double* pDistances,
+                                    double*       pLats,
+                                    double*       pLons)
+    {
+        for (size_t i = 0; i < cPoints; i++)
+        {
+            if (pDistances[i] == 0.0) continue;
+
+            double dLatRad;
+            double dLonRad;
+            TranslateRad<TTrig> (CAngle::Degrees (pLats[i]).Rad (), CAngle::Degrees (pLons[i]).Rad (),
+                                 CAngle::Degrees (pHeadings[i]).Rad (), ArcAngle (CDistance::Feet (pDistances[i])).Rad (),
+                                 dLatRad, dLonRad);
+
+            pLats[i] = CAngle::Radians (dLatRad).Deg ();
+            pLons[i] = CAngle::Radians (dLonRad).Deg ();
+        }
+    }
+
+    /**
+     * The spherical Translate kernel, all in radians and without touching its inputs.
+     */
+    template <typename TTrig>
+    static void TranslateRad (double  dLat,
+                              double  dLon,
+                              double  dHeading,
+                              double  dArc,
+                              double& dLatEnd,
+                              double& dLonEnd)
+    {
+        double dSinLat;
+        double dCosLat;
+        double dSinArc;
+        double dCosArc;
+        double dSinHeading;
+        double dCosHeading;
+        TTrig::SinCos (dLat,     dSinLat,     dCosLat);
+        TTrig::SinCos (dArc,     dSinArc,     dCosArc);
+        TTrig::SinCos (dHeading, dSinHeading, dCosHeading);
+
+        dLatEnd = TTrig::Asin (dSinLat * dCosArc + dCosLat * dSinArc * dCosHeading);
+        dLonEnd = dLon;
+
+        double dCosLatEnd = TTrig::Cos (dLatEnd);
+        if (dCosLatEnd != 0.0)
+        {
+            // Negated, since this formula assumes positive for west, but FSX is the opposite
+            dLonEnd = -(Mod (-dLon - TTrig::Asin (dSinHeading * dSinArc / dCosLatEnd) + M_PI, M_PI * 2.0) - M_PI);
+        }
+    }
+};
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "FlatHashMap.h"
+#include "Geodesy.h"
+
+
+/**
+ * A bank of Kalman filters that smooth the position and heading samples of many objects, and estimate position,
+ *  velocity, heading and turn rate at any time from them.
+ *
+ * Each object has a constant-velocity filter for its position, in feet east and north of an anchor near it, and a
+ *  constant-turn-rate filter for its heading. Both model the unknown accelerations as white noise, so samples may
+ *  come at any interval. The east and north filters see the same noise at the same times, so they share one
+ *  covariance, and a sample costs two 2x2 covariance updates. All of the state is kept as structures of arrays.
+ *
+ * Update takes a batch of samples, resolves the objects first and then runs all the filters in one loop; EstimateAll
+ *  does the same for the estimates of every object at one time.
+ */
+class CKalmanBank
+{
+public:
+    typedef struct Estimate
+    {
+        double dLat;        // Degrees
+        double dLon;        // Degrees
+        double dHead;       // Degrees true
+        double dSpeedFt;    // Feet per second over the ground
+        double dCourse;     // Degrees true
+        double dTurn;       // Degrees per second, positive to the right
+    }
+    Estimate;
+
+    /**
+     * dPosNoiseFt, dHeadNoiseDeg: standard deviations of the sample noise.
+     * dAccelFt, dTurnAccelDeg: standard deviations of the unmodelled accelerations, per second squared. Larger values
+     *  follow manoeuvres more closely and smooth less.
+     */
+    CKalmanBank (double dPosNoiseFt   = 1.0,
+                 double dAccelFt      = 2.0,
+                 double dHeadNoiseDeg = 0.5,
+                 double dTurnAccelDeg = 4.0) :
+        m_dPosR  (dPosNoiseFt * dPosNoiseFt),
+        m_dPosQ  (dAccelFt * dAccelFt),
+        m_dHeadR (dHeadNoiseDeg * dHeadNoiseDeg),
+        m_dHeadQ (dTurnAccelDeg * dTurnAccelDeg)
+    {
+    }
+
+    void Reserve (uint32_t cObjects)
+    {
+        m_index.Reserve (cObjects);
+    }
+
+    /**
+     * cSamples samples, each an object ID, a time in seconds, a position in degrees and a true heading in degrees.
+     *  The first sample of an object starts its filters. A sample older than the object's last one is taken as if it
+     *  were of that time.
+     */
+    void Update (uint32_t        cSamples,
+                 const uint32_t* pIds,
+                 const double*   pTimes,
+                 const double*   pLats,
+                 const double*   pLons,
+                 const double*   pHeads)
+    {
+        m_slots.resize (cSamples);
+
+        for (uint32_t j = 0; j < cSamples; j++)
+        {
+            bool      bInserted = false;
+            uint32_t& iSlot     = m_index.Insert (pIds[j], &bInserted);
+
+            if (bInserted)
+            {
+                iSlot = (uint32_t)m_ids.size ();
+                Append (pIds[j], pTimes[j], pLats[j], pLons[j], pHeads[j]);
+            }
+            m_slots[j] = iSlot;
+        }
+
+        for (uint32_t j = 0; j < cSamples; j++)
+        {
+            uint32_t i   = m_slots[j];
+            double   dDt = fmax (pTimes[j] - m_times[i], 0.0);
+
+            m_times[i] += dDt;
+
+            // Position: predict both axes, then correct them with the same gains
+            double dDt2    = dDt * dDt;
+            double dP00    = m_posP00[i] + 2.0 * dDt * m_posP01[i] + dDt2 * m_posP11[i] + m_dPosQ * dDt2 * dDt2 / 4.0;
+            double dP01    = m_posP01[i] + dDt * m_posP11[i] + m_dPosQ * dDt2 * dDt / 2.0;
+            double dP11    = m_posP11[i] + m_dPosQ * dDt2;
+            double dK0     = dP00 / (dP00 + m_dPosR);
+            double dK1     = dP01 / (dP00 + m_dPosR);
+            double dEast   = m_easts[i] + m_vEasts[i] * dDt;
+            double dNorth  = m_norths[i] + m_vNorths[i] * dDt;
+            double dYEast  = WrapDeg (pLons[j] - m_anchorLons[i]) * m_ftPerDegLons[i] - dEast;
+            double dYNorth = (pLats[j] - m_anchorLats[i]) * CGeodesy::FT_PER_DEG - dNorth;
+
+            m_easts[i]   = dEast + dK0 * dYEast;
+            m_norths[i]  = dNorth + dK0 * dYNorth;
+            m_vEasts[i]  += dK1 * dYEast;
+            m_vNorths[i] += dK1 * dYNorth;
+            m_posP00[i]  = (1.0 - dK0) * dP00;
+            m_posP01[i]  = (1.0 - dK0) * dP01;
+            m_posP11[i]  = dP11 - dK1 * dP01;
+
+            // Heading
+            dP00 = m_headP00[i] + 2.0 * dDt * m_headP01[i] + dDt2 * m_headP11[i] + m_dHeadQ * dDt2 * dDt2 / 4.0;
+            dP01 = m_headP01[i] + dDt * m_headP11[i] + m_dHeadQ * dDt2 * dDt / 2.0;
+            dP11 = m_headP11[i] + m_dHeadQ * dDt2;
+            dK0  = dP00 / (dP00 + m_dHeadR);
+            dK1  = dP01 / (dP00 + m_dHeadR);
+
+            double dHead  = m_heads[i] + m_turns[i] * dDt;
+            double dYHead = WrapDeg (pHeads[j] - dHead);
+
+            m_heads[i]   = CGeodesy::Mod (dHead + dK0 * dYHead, 360.0);
+            m_turns[i]   += dK1 * dYHead;
+            m_headP00[i] = (1.0 - dK0) * dP00;
+            m_headP01[i] = (1.0 - dK0) * dP01;
+            m_headP11[i] = dP11 - dK1 * dP01;
+
+            // Keep the flat east/north plane small around the object
+            if (m_easts[i] * m_easts[i] + m_norths[i] * m_norths[i] > REANCHOR_FT * REANCHOR_FT) Reanchor (i);
+        }
+    }
+
+    /**
+     * The estimate for one object at dTime seconds. Returns false if the object has no samples.
+     */
+    bool EstimateAt (uint32_t  idObject,
+                     double    dTime,
+                     Estimate& estimate) const
+    {
+        const uint32_t* piSlot = m_index.Find (idObject);
+        if (piSlot == NULL) return false;
+
+        uint32_t i   = *piSlot;
+        double   dDt = dTime - m_times[i];
+
+        estimate.dLat     = m_anchorLats[i] + (m_norths[i] + m_vNorths[i] * dDt) / CGeodesy::FT_PER_DEG;
+        estimate.dLon     = m_anchorLons[i] + (m_easts[i] + m_vEasts[i] * dDt) / m_ftPerDegLons[i];
+        estimate.dHead    = CGeodesy::Mod (m_heads[i] + m_turns[i] * dDt, 360.0);
+        estimate.dSpeedFt = sqrt (m_vEasts[i] * m_vEasts[i] + m_vNorths[i] * m_vNorths[i]);
+        estimate.dCourse  = CGeodesy::Mod (CAngle::Radians (atan2 (m_vEasts[i], m_vNorths[i])).Deg (), 360.0);
+        estimate.dTurn    = m_turns[i];
+        return true;
+    }
+
+    /**
+     * Positions and headings of all objects at dTime seconds, read with ObjectAt, LatAt, LonAt and HeadAt. They are
+     *  valid until the next Update, Remove or EstimateAll.
+     */
+    void EstimateAll (double dTime)
+    {
+        uint32_t cObjects = Count ();
+
+        m_estLats.resize (cObjects);
+        m_estLons.resize (cObjects);
+        m_estHeads.resize (cObjects);
+
+        for (uint32_t i = 0; i < cObjects; i++)
+        {
+            double dDt = dTime - m_times[i];
+
+            m_estLats[i]  = m_anchorLats[i] + (m_norths[i] + m_vNorths[i] * dDt) / CGeodesy::FT_PER_DEG;
+            m_estLons[i]  = m_anchorLons[i] + (m_easts[i] + m_vEasts[i] * dDt) / m_ftPerDegLons[i];
+            m_estHeads[i] = CGeodesy::Mod (m_heads[i] + m_turns[i] * dDt, 360.0);
+        }
+    }
+
+    void Remove (uint32_t idObject)
+    {
+        const uint32_t* piSlot = m_index.Find (idObject);
+        if (piSlot == NULL) return;
+
+        // Move the last object into the hole so the arrays stay dense
+        uint32_t i     = *piSlot;
+        uint32_t iLast = (uint32_t)m_ids.size () - 1;
+        m_index.Erase (idObject);
+        if (i != iLast) *m_index.Find (m_ids[iLast]) = i;
+
+        m_ids[i]          = m_ids[iLast];
+        m_times[i]        = m_times[iLast];
+        m_anchorLats[i]   = m_anchorLats[iLast];
+        m_anchorLons[i]   = m_anchorLons[iLast];
+        m_ftPerDegLons[i] = m_ftPerDegLons[iLast];
+        m_easts[i]        = m_easts[iLast];
+        m_norths[i]       = m_norths[iLast];
+        m_vEasts[i]       = m_vEasts[iLast];
+        m_vNorths[i]      = m_vNorths[iLast];
+        m_posP00[i]       = m_posP00[iLast];
+        m_posP01[i]       = m_posP01[iLast];
+        m_posP11[i]       = m_posP11[iLast];
+        m_heads[i]        = m_heads[iLast];
+        m_turns[i]        = m_turns[iLast];
+        m_headP00[i]      = m_headP00[iLast];
+        m_headP01[i]      = m_headP01[iLast];
+        m_headP11[i]      = m_headP11[iLast];
+
+        m_ids.pop_back ();
+        m_times.pop_back ();
+        m_anchorLats.pop_back ();
+        m_anchorLons.pop_back ();
+        m_ftPerDegLons.pop_back ();
+        m_easts.pop_back ();
+        m_norths.pop_back ();
+        m_vEasts.pop_back ();
+        m_vNorths.pop_back ();
+        m_posP00.pop_back ();
+        m_posP01.pop_back ();
+        m_posP11.pop_back ();
+        m_heads.pop_back ();
+        m_turns.pop_back ();
+        m_headP00.pop_back ();
+        m_headP01.pop_back ();
+        m_headP11.pop_back ();
+    }
+
+    uint32_t Count () const
+    {
+        return (uint32_t)m_ids.size ();
+    }
+
+    /**
+     * For i in [0, Count ()); LatAt, LonAt and HeadAt are the results of the last EstimateAll.
+     */
+    uint32_t ObjectAt (uint32_t i) const { return m_ids[i]; }
+    double   LatAt    (uint32_t i) const { return m_estLats[i]; }
+    double   LonAt    (uint32_t i) const { return m_estLons[i]; }
+    double   HeadAt   (uint32_t i) const { return m_estHeads[i]; }
+
+private:
+    // Distance from its anchor at which an object gets a new one
+    static constexpr double REANCHOR_FT = 6076.0;
+
+    // Variance of the first velocity and turn rate, before a second sample says anything about them
+    static constexpr double SPEED_VAR   = 50.0 * 50.0;
+    static constexpr double TURN_VAR    = 30.0 * 30.0;
+
+    // Variance of the first position and heading; the first sample replaces them
+    static constexpr double UNKNOWN_VAR = 1e12;
+
+    void Append (uint32_t idObject,
+                 double   dTime,
+                 double   dLat,
+                 double   dLon,
+                 double   dHead)
+    {
+        m_ids.push_back (idObject);
+        m_times.push_back (dTime);
+        m_anchorLats.push_back (dLat);
+        m_anchorLons.push_back (dLon);
+        m_ftPerDegLons.push_back (FtPerDegLon (dLat));
+        m_easts.push_back (0.0);
+        m_norths.push_back (0.0);
+        m_vEasts.push_back (0.0);
+        m_vNorths.push_back (0.0);
+        m_posP00.push_back ((double)UNKNOWN_VAR);
+        m_posP01.push_back (0.0);
+        m_posP11.push_back ((double)SPEED_VAR);
+        m_heads.push_back (dHead);
+        m_turns.push_back (0.0);
+        m_headP00.push_back ((double)UNKNOWN_VAR);
+        m_headP01.push_back (0.0);
+        m_headP11.push_back ((double)TURN_VAR);
+    }
+
+    void Reanchor (uint32_t i)
+    {
+        m_anchorLats[i]  += m_norths[i] / CGeodesy::FT_PER_DEG;
+        m_anchorLons[i]  += m_easts[i] / m_ftPerDegLons[i];
+        m_ftPerDegLons[i] = FtPerDegLon (m_anchorLats[i]);
+        m_easts[i]        = 0.0;
+        m_norths[i]       = 0.0;
+    }
+
+    static double FtPerDegLon (double dLat)
+    {
+        return fmax (CGeodesy::FT_PER_DEG * cos (CAngle::Degrees (dLat).Rad ()), 1.0);
+    }
+
+    /**
+     * An angle difference in degrees brought into [-180, 180).
+     */
+    static double WrapDeg (double dDeg)
+    {
+        return CGeodesy::Mod (dDeg + 180.0, 360.0) - 180.0;
+    }
+
+
+    double                  m_dPosR;
+    double                  m_dPosQ;
+    double                  m_dHeadR;
+    double                  m_dHeadQ;
+
+    CFlatHashMap<uint32_t>  m_index;        // Object ID to index in the arrays below
+    std::vector<uint32_t>   m_ids;
+    std::vector<double>     m_times;
+
+    // Position in feet east and north of the anchor, in feet per second, and the covariance shared by both axes
+    std::vector<double>     m_anchorLats;
+    std::vector<double>     m_anchorLons;
+    std::vector<double>     m_ftPerDegLons;
+    std::vector<double>     m_easts;
+    std::vector<double>     m_norths;
+    std::vector<double>     m_vEasts;
+    std::vector<double>     m_vNorths;
+    std::vector<double>     m_posP00;
+    std::vector<double>     m_posP01;
+    std::vector<double>     m_posP11;
+
+    // Heading in degrees true, turn rate in degrees per second, and their covariance
+    std::vector<double>     m_heads;
+    std::vector<double>     m_turns;
+    std::vector<double>     m_headP00;
+    std::vector<double>     m_headP01;
+    std::vector<double>     m_headP11;
+
+    // Scratch for Update, and the results of EstimateAll
+    std::vector<uint32_t>   m_slots;
+    std::vector<double>     m_estLats;
+    std::vector<double>     m_estLons;
+    std::vector<double>     m_estHeads;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Geodesy.h"
+
+
+/**
+ * Local east-north-up tangent plane anchored at a reference position, typically the user aircraft.
+ *
+ * Converting between lat/lon degrees and east/north offsets in feet takes a couple of multiplies, instead of the
+ *  asin/sin/cos/Mod of a full CGeodesy::Translate. The price is a flattening error that grows with the distance
+ *  from the anchor; the frame derives the range within which that error stays below a tolerance, and Track
+ *  re-anchors it when the reference position drifts out of that range.
+ */
+class CLocalFrame
+{
+public:
+    /**
+     * dToleranceFt: largest position error accepted anywhere within the range of the frame.
+     */
+    explicit CLocalFrame (double dToleranceFt = 1.0) :
+        m_dToleranceFt (dToleranceFt),
+        m_bAnchored    (false)
+    {
+        // Usable right away, but the first Track anchors it for real
+        Anchor (0.0, 0.0);
+        m_bAnchored = false;
+    }
+
+    void Anchor (double dLat,
+                 double dLon)
+    {
+        double dCosLat = cos (CAngle::Degrees (dLat).Rad ());
+
+        m_dLat        = dLat;
+        m_dLon        = dLon;
+        m_dFtPerLat   = CGeodesy::FT_PER_DEG;
+        m_dFtPerLon   = CGeodesy::FT_PER_DEG * dCosLat;
+        m_dLatPerFt   = 1.0 / m_dFtPerLat;
+        m_dLonPerFt   = dCosLat > 1e-9 ? 1.0 / m_dFtPerLon : 0.0;
+        m_dRangeFt    = RangeFt (dLat, m_dToleranceFt);
+        m_dRangeFt2   = m_dRangeFt * m_dRangeFt;
+        m_bAnchored   = true;
+    }
+
+    /**
+     * Keep the frame usable around a moving reference position. Returns true if the frame was re-anchored, in which
+     *  case local coordinates computed before are no longer valid.
+     */
+    bool Track (double dLat,
+                double dLon)
+    {
+        if (m_bAnchored && Contains (dLat, dLon)) return false;
+
+        Anchor (dLat, dLon);
+        return true;
+    }
+
+    /**
+     * Whether a position is close enough to the anchor for the flattening error to stay within tolerance.
+     */
+    bool Contains (double dLat,
+                   double dLon) const
+    {
+        double dEast;
+        double dNorth;
+        ToLocal (dLat, dLon, dEast, dNorth);
+        return dEast * dEast + dNorth * dNorth <= m_dRangeFt2;
+    }
+
+    void ToLocal (double  dLat,
+                  double  dLon,
+                  double& dEast,
+                  double& dNorth) const
+    {
+        double dLonDeg = dLon - m_dLon;
+        if (dLonDeg >  180.0) dLonDeg -= 360.0;
+        if (dLonDeg < -180.0) dLonDeg += 360.0;
+
+        dEast  = dLonDeg * m_dFtPerLon;
+        dNorth = (dLat - m_dLat) * m_dFtPerLat;
+    }
+
+    void FromLocal (double  dEast,
+                    double  dNorth,
+                    double& dLat,
+                    double& dLon) const
+    {
+        dLat = m_dLat + dNorth * m_dLatPerFt;
+        dLon = m_dLon + dEast * m_dLonPerFt;
+        if (dLon >  180.0) dLon -= 360.0;
+        if (dLon < -180.0) dLon += 360.0;
+    }
+
+    /**
+     * Same contract as CGeodesy::Translate, for positions within range of the frame.
+     */
+    LatLon Translate (const LatLon& from,
+                      CHeading      heading,
+                      CDistance     distance) const
+    {
+        LatLon to = { from.lat + CAngle::Degrees (distance.Ft () * cos (heading.Rad ()) * m_dLatPerFt),
+                      from.lon + CAngle::Degrees (distance.Ft () * sin (heading.Rad ()) * m_dLonPerFt) };
+        return to;
+    }
+
+    double LatAnchor () const { return m_dLat; }
+    double LonAnchor () const { return m_dLon; }
+    double RangeFt   () const { return m_dRangeFt; }
+
+    /**
+     * Distance from the anchor within which the flattening error stays below dToleranceFt. Moving north by n, the
+     *  longitude scale is off by about n * tan (lat) / R, so also moving east by e is off by e * n * tan (lat) / R.
+     *  Over all headings at a distance d that peaks at about d^2 * tan (lat) / (sqrt (3) * R). Near the equator the
+     *  curvature term, below d^3 / 6R^2, takes over.
+     */
+    static double RangeFt (double dLat,
+                           double dToleranceFt)
+    {
+        const double dRadiusFt = CGeodesy::ArcLength (CAngle::Radians (1.0)).Ft ();
+
+        double dTan     = fabs (tan (CAngle::Degrees (dLat).Rad ()));
+        double dRangeFt = cbrt (6.0 * dRadiusFt * dRadiusFt * dToleranceFt);
+
+        if (dTan > 0.0) dRangeFt = fmin (dRangeFt, sqrt (sqrt (3.0) * dRadiusFt * dToleranceFt / dTan));
+        return dRangeFt;
+    }
+
+private:
+    double  m_dToleranceFt;
+    bool    m_bAnchored;
+    double  m_dLat;
+    double  m_dLon;
+    double  m_dFtPerLat;
+    double  m_dFtPerLon;
+    double  m_dLatPerFt;
+    double  m_dLonPerFt;
+    double  m_dRangeFt;
+    double  m_dRangeFt2;
+};
@@ -0,0 +1,32 @@
+#include <Windows.h>
+#include <tchar.h>
+#include <vector>
+
+#include "DemoRudderPos.h"
+
+#pragma comment (lib, "SimConnect.lib")
+
+
+/**
+ * Without arguments, runs the demo on the local sim. Given ConfigIndex values from SimConnect.cfg, runs one demo per
+ *  sim they name, all from this process. With -record first, each demo also records its telemetry to a file.
+ */
+int __cdecl _tmain (int argc, _TCHAR* argv[])
+{
+    bool bRecord = argc > 1 && _tcscmp (argv[1], _T("-record")) == 0;
+    int  iFirst  = bRecord ? 2 : 1;
+
+    if (argc > iFirst)
+    {
+        std::vector<DWORD> configs;
+        for (int i = iFirst; i < argc; i++) configs.push_back ((DWORD)_ttoi (argv[i]));
+
+        CDemoRudderPos::RunAll (configs.data (), (DWORD)configs.size (), bRecord);
+        return 0;
+    }
+
+    CDemoRudderPos demo;
+    demo.SetRecord (bRecord);
+    demo.Run ();
+    return 0;
+}
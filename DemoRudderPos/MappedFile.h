@@ -0,0 +1,113 @@
+#pragma once
+
+#include <Windows.h>
+#include <stddef.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * A whole file mapped read-only, so that only the pages actually touched are read from disk.
+ */
+class CMappedFile
+{
+public:
+    CMappedFile () :
+        #ifdef _WIN32
+            m_hFile    (INVALID_HANDLE_VALUE),
+            m_hMapping (NULL),
+        #endif
+        m_pView    (NULL),
+        m_cbView   (0)
+    {
+    }
+
+    ~CMappedFile ()
+    {
+        Close ();
+    }
+
+    /**
+     * Fails for a file that cannot be opened, and for an empty one.
+     */
+    bool Open (const char* szPath)
+    {
+        Close ();
+
+        #ifdef _WIN32
+            m_hFile = CreateFileA (szPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+            if (m_hFile == INVALID_HANDLE_VALUE) return false;
+
+            LARGE_INTEGER cb;
+            if (GetFileSizeEx (m_hFile, &cb) && cb.QuadPart > 0)
+            {
+                m_hMapping = CreateFileMappingA (m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+                if (m_hMapping != NULL) m_pView = MapViewOfFile (m_hMapping, FILE_MAP_READ, 0, 0, 0);
+                m_cbView = (size_t)cb.QuadPart;
+            }
+        #else
+            int fd = open (szPath, O_RDONLY);
+            if (fd < 0) return false;
+
+            struct stat st;
+            if (fstat (fd, &st) == 0 && st.st_size > 0)
+            {
+                m_pView = mmap (NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (m_pView == MAP_FAILED) m_pView = NULL;
+                if (m_pView != NULL) madvise (m_pView, (size_t)st.st_size, MADV_SEQUENTIAL);
+                m_cbView = (size_t)st.st_size;
+            }
+            close (fd);
+        #endif
+
+        if (m_pView == NULL)
+        {
+            Close ();
+            return false;
+        }
+        return true;
+    }
+
+    void Close ()
+    {
+        #ifdef _WIN32
+            if (m_pView != NULL) UnmapViewOfFile (m_pView);
+            if (m_hMapping != NULL) CloseHandle (m_hMapping);
+            if (m_hFile != INVALID_HANDLE_VALUE) CloseHandle (m_hFile);
+            m_hMapping = NULL;
+            m_hFile    = INVALID_HANDLE_VALUE;
+        #else
+            if (m_pView != NULL) munmap (m_pView, m_cbView);
+        #endif
+
+        m_pView  = NULL;
+        m_cbView = 0;
+    }
+
+    const BYTE* Data () const
+    {
+        return (const BYTE*)m_pView;
+    }
+
+    size_t Size () const
+    {
+        return m_cbView;
+    }
+
+private:
+    CMappedFile (const CMappedFile&);
+    CMappedFile& operator= (const CMappedFile&);
+
+
+    #ifdef _WIN32
+        HANDLE  m_hFile;
+        HANDLE  m_hMapping;
+    #endif
+    void*       m_pView;
+    size_t      m_cbView;
+};
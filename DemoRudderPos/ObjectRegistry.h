@@ -0,0 +1,132 @@
+#pragma once
+
+#include <Windows.h>
+#include <SimConnect.h>
+
+#include "FlatHashMap.h"
+
+
+/**
+ * Live registry of the sim objects the client knows about, kept current from the "ObjectAdded" and "ObjectRemoved"
+ *  system events. Lookups by object ID go through a flat hash map and never allocate, so they are safe to do from
+ *  the dispatch loop with thousands of objects around a busy airport.
+ */
+class CObjectRegistry
+{
+public:
+    typedef struct SimObject
+    {
+        SimObject ()
+        {
+            eType     = SIMCONNECT_SIMOBJECT_TYPE_USER;
+            nScan     = 0;
+            bPosition = false;
+            dLat      = 0.0;
+            dLon      = 0.0;
+            dHead     = 0.0;
+            dAlt      = 0.0;
+        }
+
+        SIMCONNECT_SIMOBJECT_TYPE eType;
+        DWORD                     nScan;        // Last radius scan the object was seen in
+        bool                      bPosition;    // Whether dLat/dLon/dHead/dAlt have been set yet
+        double                    dLat;
+        double                    dLon;
+        double                    dHead;
+        double                    dAlt;
+    }
+    SimObject;
+
+    CObjectRegistry ()
+    {
+        m_objects.Reserve (4096);
+    }
+
+    /**
+     * Subscribe to the add/remove system events. Both arrive as SIMCONNECT_RECV_ID_EVENT_OBJECT_ADDREMOVE.
+     */
+    void Subscribe (HANDLE hSimConnect,
+                    DWORD  idEventAdded,
+                    DWORD  idEventRemoved)
+    {
+        m_idEventAdded   = idEventAdded;
+        m_idEventRemoved = idEventRemoved;
+
+        SimConnect_SubscribeToSystemEvent (hSimConnect, idEventAdded,   "ObjectAdded");
+        SimConnect_SubscribeToSystemEvent (hSimConnect, idEventRemoved, "ObjectRemoved");
+    }
+
+    /**
+     * Apply an add/remove event to the registry. Returns true if the event removed a known object, in which case
+     *  the caller should drop anything it still has pending for that object.
+     */
+    bool OnAddRemove (const SIMCONNECT_RECV_EVENT_OBJECT_ADDREMOVE* pEvt)
+    {
+        if (pEvt->uEventID == m_idEventAdded)
+        {
+            Add (pEvt->dwData, pEvt->eObjType);
+        }
+        else if (pEvt->uEventID == m_idEventRemoved)
+        {
+            return m_objects.Erase (pEvt->dwData);
+        }
+        return false;
+    }
+
+    SimObject& Add (DWORD                     idObject,
+                    SIMCONNECT_SIMOBJECT_TYPE eType)
+    {
+        SimObject& object = m_objects.Insert (idObject);
+        object.eType = eType;
+        return object;
+    }
+
+    SimObject* Find (DWORD idObject)
+    {
+        return m_objects.Find (idObject);
+    }
+
+    /**
+     * Record the last known position of an object; objects that were never announced are added as they are seen.
+     */
+    SimObject& SetPosition (DWORD                     idObject,
+                            SIMCONNECT_SIMOBJECT_TYPE eType,
+                            double                    dLat,
+                            double                    dLon,
+                            double                    dHead,
+                            double                    dAlt)
+    {
+        bool       bInserted = false;
+        SimObject& object    = m_objects.Insert (idObject, &bInserted);
+
+        if (bInserted) object.eType = eType;
+        object.bPosition = true;
+        object.dLat      = dLat;
+        object.dLon      = dLon;
+        object.dHead     = dHead;
+        object.dAlt      = dAlt;
+        return object;
+    }
+
+    /**
+     * Call proc (idObject, object) for every object in the registry. The registry must not be modified meanwhile.
+     */
+    template <typename TProc>
+    void ForEach (TProc proc)
+    {
+        for (DWORD i = 0; i < m_objects.Capacity (); i++)
+        {
+            if (m_objects.IsUsed (i)) proc (m_objects.KeyAt (i), m_objects.ValueAt (i));
+        }
+    }
+
+    DWORD Count () const
+    {
+        return m_objects.Size ();
+    }
+
+private:
+    CFlatHashMap<SimObject> m_objects;
+    DWORD                   m_idEventAdded;
+    DWORD                   m_idEventRemoved;
+};
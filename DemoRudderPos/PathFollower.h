@@ -0,0 +1,266 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "FlatHashMap.h"
+#include "Geodesy.h"
+
+
+/**
+ * Pure-pursuit path follower for ground vehicles. Each vehicle steers towards the point of its path one lookahead
+ *  distance ahead, with a rudder command proportional to the curvature of the arc that reaches it.
+ *
+ * The per-frame state is kept as a structure of arrays so the steering kernel in Update is a straight loop over
+ *  doubles without branches; only the waypoint bookkeeping runs per vehicle.
+ */
+class CPathFollower
+{
+public:
+    /**
+     * dLookaheadFt: distance of the pursuit point ahead of the vehicle.
+     * dWheelbaseFt: distance between the axles, which converts curvature to a steering angle.
+     * dSteerMaxDeg: steering angle at full rudder deflection.
+     */
+    CPathFollower (double dLookaheadFt = 40.0,
+                   double dWheelbaseFt = 12.0,
+                   double dSteerMaxDeg = 35.0) :
+        m_dLookaheadFt (dLookaheadFt),
+        m_dWheelbaseFt (dWheelbaseFt),
+        m_dTanSteerMax (tan (CAngle::Degrees (dSteerMaxDeg).Rad ()))
+    {
+    }
+
+    /**
+     * Start following a path of waypoints in degrees, replacing any path the vehicle already had.
+     */
+    void Follow (uint32_t      idObject,
+                 const double* pLats,
+                 const double* pLons,
+                 uint32_t      cWaypoints)
+    {
+        bool      bInserted = false;
+        uint32_t& iSlot     = m_index.Insert (idObject, &bInserted);
+
+        if (bInserted)
+        {
+            iSlot = (uint32_t)m_ids.size ();
+            m_ids.push_back (idObject);
+            m_paths.push_back (Path ());
+            m_lats.push_back (0.0);
+            m_lons.push_back (0.0);
+            m_heads.push_back (0.0);
+            m_targetLats.push_back (0.0);
+            m_targetLons.push_back (0.0);
+            m_rudders.push_back (0.0);
+        }
+
+        Path& path = m_paths[iSlot];
+        path.lats.assign (pLats, pLats + cWaypoints);
+        path.lons.assign (pLons, pLons + cWaypoints);
+        path.iNext  = 0;
+        path.bState = false;
+    }
+
+    void Stop (uint32_t idObject)
+    {
+        uint32_t i = Find (idObject);
+        if (i == NONE) return;
+
+        // Move the last vehicle into the hole so the arrays stay dense
+        uint32_t iLast = (uint32_t)m_ids.size () - 1;
+        m_index.Erase (idObject);
+        if (i != iLast) *m_index.Find (m_ids[iLast]) = i;
+
+        m_ids[i]        = m_ids[iLast];
+        m_paths[i]      = m_paths[iLast];
+        m_lats[i]       = m_lats[iLast];
+        m_lons[i]       = m_lons[iLast];
+        m_heads[i]      = m_heads[iLast];
+        m_targetLats[i] = m_targetLats[iLast];
+        m_targetLons[i] = m_targetLons[iLast];
+        m_rudders[i]    = m_rudders[iLast];
+
+        m_ids.pop_back ();
+        m_paths.pop_back ();
+        m_lats.pop_back ();
+        m_lons.pop_back ();
+        m_heads.pop_back ();
+        m_targetLats.pop_back ();
+        m_targetLons.pop_back ();
+        m_rudders.pop_back ();
+    }
+
+    bool IsFollowing (uint32_t idObject) const
+    {
+        return Find (idObject) != NONE;
+    }
+
+    /**
+     * Latest position (degrees) and true heading (degrees) of a vehicle, as received from the sim.
+     */
+    void SetState (uint32_t idObject,
+                   double   dLat,
+                   double   dLon,
+                   double   dHead)
+    {
+        uint32_t i = Find (idObject);
+        if (i == NONE) return;
+
+        m_lats[i]         = dLat;
+        m_lons[i]         = dLon;
+        m_heads[i]        = dHead;
+        m_paths[i].bState = true;
+    }
+
+    /**
+     * Compute the rudder command of every vehicle for this frame.
+     */
+    void Update ()
+    {
+        uint32_t cVehicles = (uint32_t)m_ids.size ();
+
+        // Advance along the paths and pick the pursuit points
+        for (uint32_t i = 0; i < cVehicles; i++)
+        {
+            Path& path = m_paths[i];
+
+            while (path.iNext < path.lats.size () &&
+                   DistanceFt (m_lats[i], m_lons[i], path.lats[path.iNext], path.lons[path.iNext]) < m_dLookaheadFt)
+            {
+                path.iNext++;
+            }
+
+            if (!path.bState || path.iNext >= path.lats.size ())
+            {
+                // Done (or no state yet): pursue our own position, which steers straight
+                m_targetLats[i] = m_lats[i];
+                m_targetLons[i] = m_lons[i];
+            }
+            else
+            {
+                m_targetLats[i] = path.lats[path.iNext];
+                m_targetLons[i] = path.lons[path.iNext];
+            }
+        }
+
+        Steer (cVehicles,
+               m_lats.data (), m_lons.data (), m_heads.data (),
+               m_targetLats.data (), m_targetLons.data (),
+               m_dWheelbaseFt / m_dTanSteerMax,
+               m_rudders.data ());
+    }
+
+    /**
+     * Number of vehicles; for i in [0, Count ()), ObjectAt (i) is steered with RudderAt (i).
+     */
+    uint32_t Count () const
+    {
+        return (uint32_t)m_ids.size ();
+    }
+
+    uint32_t ObjectAt (uint32_t i) const
+    {
+        return m_ids[i];
+    }
+
+    double RudderAt (uint32_t i) const
+    {
+        return m_rudders[i];
+    }
+
+    bool IsDoneAt (uint32_t i) const
+    {
+        return m_paths[i].iNext >= m_paths[i].lats.size ();
+    }
+
+    /**
+     * The steering kernel: pure pursuit on a local flat-earth approximation. dGain is wheelbase over the tangent of
+     *  the full-deflection steering angle, so the rudder is the tangent of the required steering angle relative to
+     *  the full deflection one, clamped to [-1, 1]. Positive is to the right, like the A/D keys.
+     */
+    static void Steer (uint32_t      cVehicles,
+                       const double* pLats,
+                       const double* pLons,
+                       const double* pHeads,
+                       const double* pTargetLats,
+                       const double* pTargetLons,
+                       double        dGain,
+                       double*       pRudders)
+    {
+        const double dFtPerDeg = CGeodesy::FT_PER_DEG;
+        const double dDegToRad = UnitConvert<UnitDegrees, UnitRadians> (1.0);
+
+        for (uint32_t i = 0; i < cVehicles; i++)
+        {
+            double dNorth = (pTargetLats[i] - pLats[i]) * dFtPerDeg;
+            double dEast  = WrapDeg (pTargetLons[i] - pLons[i]) * dFtPerDeg * cos (pLats[i] * dDegToRad);
+            double dSin   = sin (pHeads[i] * dDegToRad);
+            double dCos   = cos (pHeads[i] * dDegToRad);
+
+            // Pursuit point in the vehicle frame
+            double dAhead = dNorth * dCos + dEast * dSin;
+            double dRight = dEast * dCos - dNorth * dSin;
+            double dDist2 = dAhead * dAhead + dRight * dRight + 1e-9;
+
+            // Curvature of the arc through the pursuit point is 2 * right / distance^2
+            double dRudder = dGain * 2.0 * dRight / dDist2;
+            dRudder = dRudder >  1.0 ?  1.0 : dRudder;
+            dRudder = dRudder < -1.0 ? -1.0 : dRudder;
+            pRudders[i] = dRudder;
+        }
+    }
+
+private:
+    static const uint32_t NONE = 0xFFFFFFFF;
+
+    typedef struct Path
+    {
+        std::vector<double> lats;
+        std::vector<double> lons;
+        size_t              iNext;
+        bool                bState;     // Whether a position has been received yet
+    }
+    Path;
+
+    uint32_t Find (uint32_t idObject) const
+    {
+        const uint32_t* piSlot = m_index.Find (idObject);
+        return piSlot == NULL ? NONE : *piSlot;
+    }
+
+    /**
+     * A longitude difference in degrees brought into [-180, 180), so that paths across the antimeridian stay short.
+     */
+    static double WrapDeg (double dDeg)
+    {
+        return CGeodesy::Mod (dDeg + 180.0, 360.0) - 180.0;
+    }
+
+    static double DistanceFt (double dLat0,
+                              double dLon0,
+                              double dLat1,
+                              double dLon1)
+    {
+        double dNorth = (dLat1 - dLat0) * CGeodesy::FT_PER_DEG;
+        double dEast  = WrapDeg (dLon1 - dLon0) * CGeodesy::FT_PER_DEG * cos (CAngle::Degrees (dLat0).Rad ());
+        return sqrt (dNorth * dNorth + dEast * dEast);
+    }
+
+
+    double                  m_dLookaheadFt;
+    double                  m_dWheelbaseFt;
+    double                  m_dTanSteerMax;
+
+    CFlatHashMap<uint32_t>  m_index;    // Object ID to index in the arrays below
+    std::vector<uint32_t>   m_ids;
+    std::vector<Path>       m_paths;
+
+    // Per-frame state, one entry per vehicle
+    std::vector<double>     m_lats;
+    std::vector<double>     m_lons;
+    std::vector<double>     m_heads;
+    std::vector<double>     m_targetLats;
+    std::vector<double>     m_targetLons;
+    std::vector<double>     m_rudders;
+};
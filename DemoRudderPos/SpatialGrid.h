@@ -0,0 +1,355 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "FlatHashMap.h"
+#include "Geodesy.h"
+
+
+/**
+ * Uniform lat/lon grid index over point objects, for k-nearest and within-radius queries around the user aircraft.
+ *
+ * Objects are kept in per-cell intrusive lists, so moving an object only relinks it when it crosses a cell border
+ *  and updates between scans never allocate once the index has grown to its working size. Distances are computed
+ *  on a local flat-earth approximation, which is accurate to well below a foot over the few nautical miles a scan
+ *  covers.
+ */
+class CSpatialGrid
+{
+public:
+    typedef struct Hit
+    {
+        uint32_t idObject;
+        double   dDistFt;
+    }
+    Hit;
+
+    /**
+     * dCellDeg is the cell size in degrees of latitude (and longitude); it must be at least 0.005 so cell keys fit
+     *  in 32 bits. Around 10-20 objects per cell is a good target.
+     */
+    explicit CSpatialGrid (double dCellDeg = 0.02) :
+        m_dCellDeg  (dCellDeg),
+        m_nLatCells ((uint32_t)ceil (180.0 / dCellDeg) + 1),
+        m_nLonCells ((uint32_t)ceil (360.0 / dCellDeg))
+    {
+    }
+
+    void Reserve (uint32_t cObjects)
+    {
+        m_entries.reserve (cObjects);
+        m_index.Reserve (cObjects);
+        m_cells.Reserve (cObjects);
+    }
+
+    /**
+     * Insert an object or move it to a new position.
+     */
+    void Update (uint32_t idObject,
+                 double   dLat,
+                 double   dLon)
+    {
+        uint32_t  idCell    = CellKey (dLat, dLon);
+        bool      bInserted = false;
+        uint32_t& iEntry    = m_index.Insert (idObject, &bInserted);
+
+        if (bInserted)
+        {
+            iEntry = (uint32_t)m_entries.size ();
+            m_entries.push_back (Entry ());
+            m_entries[iEntry].idObject = idObject;
+            Link (iEntry, idCell);
+        }
+        else if (m_entries[iEntry].idCell != idCell)
+        {
+            Unlink (iEntry);
+            Link (iEntry, idCell);
+        }
+
+        m_entries[iEntry].dLat = dLat;
+        m_entries[iEntry].dLon = dLon;
+    }
+
+    void Remove (uint32_t idObject)
+    {
+        uint32_t* piEntry = m_index.Find (idObject);
+        if (piEntry == NULL) return;
+
+        uint32_t iEntry = *piEntry;
+        uint32_t iLast  = (uint32_t)m_entries.size () - 1;
+
+        Unlink (iEntry);
+        m_index.Erase (idObject);
+
+        // Move the last entry into the hole so the entries stay dense
+        if (iEntry != iLast)
+        {
+            uint32_t idCell = m_entries[iLast].idCell;
+
+            Unlink (iLast);
+            m_entries[iEntry] = m_entries[iLast];
+            Link (iEntry, idCell);
+            *m_index.Find (m_entries[iEntry].idObject) = iEntry;
+        }
+        m_entries.pop_back ();
+    }
+
+    /**
+     * Remove every object, keeping the memory for the next ones.
+     */
+    void Clear ()
+    {
+        m_entries.clear ();
+        m_index.Clear ();
+        m_cells.Clear ();
+    }
+
+    uint32_t Count () const
+    {
+        return (uint32_t)m_entries.size ();
+    }
+
+    /**
+     * All objects within dRadiusFt of a position, in no particular order.
+     */
+    void WithinRadius (double            dLat,
+                       double            dLon,
+                       double            dRadiusFt,
+                       std::vector<Hit>& hits)
+    {
+        hits.clear ();
+
+        double  dCosLat = CosLat (dLat);
+        int32_t nLat    = (int32_t)ceil (dRadiusFt / CGeodesy::FT_PER_DEG / m_dCellDeg);
+        int32_t nLon    = (int32_t)ceil (dRadiusFt / (CGeodesy::FT_PER_DEG * dCosLat) / m_dCellDeg);
+
+        // With more cells to visit than objects, a plain scan is cheaper
+        if ((double)(2 * nLat + 1) * (2 * nLon + 1) > m_entries.size ())
+        {
+            for (uint32_t i = 0; i < m_entries.size (); i++)
+            {
+                double dDistFt = Distance (dLat, dLon, dCosLat, m_entries[i]);
+                if (dDistFt <= dRadiusFt)
+                {
+                    Hit hit = { m_entries[i].idObject, dDistFt };
+                    hits.push_back (hit);
+                }
+            }
+            return;
+        }
+
+        int32_t iLat0 = LatIndex (dLat);
+        int32_t iLon0 = LonIndex (dLon);
+
+        for (int32_t iLat = iLat0 - nLat; iLat <= iLat0 + nLat; iLat++)
+        {
+            if (iLat < 0 || iLat >= (int32_t)m_nLatCells) continue;
+
+            for (int32_t iLon = iLon0 - nLon; iLon <= iLon0 + nLon; iLon++)
+            {
+                const uint32_t* piHead = m_cells.Find (CellKey (iLat, iLon));
+                if (piHead == NULL) continue;
+
+                for (uint32_t i = *piHead; i != NONE; i = m_entries[i].iNext)
+                {
+                    double dDistFt = Distance (dLat, dLon, dCosLat, m_entries[i]);
+                    if (dDistFt <= dRadiusFt)
+                    {
+                        Hit hit = { m_entries[i].idObject, dDistFt };
+                        hits.push_back (hit);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * The k objects nearest to a position, closest first. Searches rings of cells outwards from the cell of the
+     *  position until no unvisited cell can hold anything closer than the k-th hit found so far.
+     */
+    void KNearest (double            dLat,
+                   double            dLon,
+                   uint32_t          k,
+                   std::vector<Hit>& hits)
+    {
+        hits.clear ();
+        if (k == 0 || m_entries.empty ()) return;
+
+        double  dCosLat    = CosLat (dLat);
+        double  dCellMinFt = m_dCellDeg * CGeodesy::FT_PER_DEG * dCosLat;
+        int32_t iLat0      = LatIndex (dLat);
+        int32_t iLon0      = LonIndex (dLon);
+        int32_t nRingMax   = (int32_t)std::max (m_nLatCells, m_nLonCells);
+
+        for (int32_t nRing = 0; nRing <= nRingMax; nRing++)
+        {
+            // Everything in this ring is at least (nRing - 1) cells away
+            if (hits.size () == k && hits.front ().dDistFt <= (nRing - 1) * dCellMinFt) break;
+
+            // Once a ring has more cells than there are objects, finish with a plain scan
+            if (8.0 * nRing > m_entries.size ())
+            {
+                hits.clear ();
+                for (uint32_t i = 0; i < m_entries.size (); i++)
+                {
+                    Offer (Distance (dLat, dLon, dCosLat, m_entries[i]), i, k, hits);
+                }
+                break;
+            }
+
+            for (int32_t iLat = iLat0 - nRing; iLat <= iLat0 + nRing; iLat++)
+            {
+                if (iLat < 0 || iLat >= (int32_t)m_nLatCells) continue;
+
+                bool    bEdge = (iLat == iLat0 - nRing || iLat == iLat0 + nRing);
+                int32_t nStep = bEdge ? 1 : 2 * nRing;
+
+                for (int32_t iLon = iLon0 - nRing; iLon <= iLon0 + nRing; iLon += nStep)
+                {
+                    const uint32_t* piHead = m_cells.Find (CellKey (iLat, iLon));
+                    if (piHead == NULL) continue;
+
+                    for (uint32_t i = *piHead; i != NONE; i = m_entries[i].iNext)
+                    {
+                        Offer (Distance (dLat, dLon, dCosLat, m_entries[i]), i, k, hits);
+                    }
+                }
+            }
+        }
+
+        std::sort_heap (hits.begin (), hits.end (), FartherFirst);
+    }
+
+private:
+    static const uint32_t NONE = 0xFFFFFFFF;
+
+    typedef struct Entry
+    {
+        uint32_t idObject;
+        uint32_t idCell;
+        uint32_t iPrev;
+        uint32_t iNext;
+        double   dLat;
+        double   dLon;
+    }
+    Entry;
+
+    static bool FartherFirst (const Hit& a,
+                              const Hit& b)
+    {
+        return a.dDistFt < b.dDistFt;
+    }
+
+    /**
+     * Keep the k closest hits in a max-heap on distance.
+     */
+    void Offer (double            dDistFt,
+                uint32_t          iEntry,
+                uint32_t          k,
+                std::vector<Hit>& hits) const
+    {
+        Hit hit = { m_entries[iEntry].idObject, dDistFt };
+
+        if (hits.size () < k)
+        {
+            hits.push_back (hit);
+            std::push_heap (hits.begin (), hits.end (), FartherFirst);
+        }
+        else if (dDistFt < hits.front ().dDistFt)
+        {
+            std::pop_heap (hits.begin (), hits.end (), FartherFirst);
+            hits.back () = hit;
+            std::push_heap (hits.begin (), hits.end (), FartherFirst);
+        }
+    }
+
+    static double CosLat (double dLat)
+    {
+        // Keep the longitude scale sane right at the poles
+        return std::max (cos (CAngle::Degrees (dLat).Rad ()), 1e-6);
+    }
+
+    static double Distance (double       dLat,
+                            double       dLon,
+                            double       dCosLat,
+                            const Entry& entry)
+    {
+        double dLonDeg = entry.dLon - dLon;
+        if (dLonDeg >  180.0) dLonDeg -= 360.0;
+        if (dLonDeg < -180.0) dLonDeg += 360.0;
+
+        double dNorthFt = (entry.dLat - dLat) * CGeodesy::FT_PER_DEG;
+        double dEastFt  = dLonDeg * CGeodesy::FT_PER_DEG * dCosLat;
+        return sqrt (dNorthFt * dNorthFt + dEastFt * dEastFt);
+    }
+
+    int32_t LatIndex (double dLat) const
+    {
+        return (int32_t)floor ((dLat + 90.0) / m_dCellDeg);
+    }
+
+    int32_t LonIndex (double dLon) const
+    {
+        return (int32_t)floor ((dLon + 180.0) / m_dCellDeg);
+    }
+
+    uint32_t CellKey (int32_t iLat,
+                      int32_t iLon) const
+    {
+        // Longitude wraps around the antimeridian
+        iLon %= (int32_t)m_nLonCells;
+        if (iLon < 0) iLon += m_nLonCells;
+
+        return (uint32_t)iLat * m_nLonCells + (uint32_t)iLon;
+    }
+
+    uint32_t CellKey (double dLat,
+                      double dLon) const
+    {
+        return CellKey (LatIndex (dLat), LonIndex (dLon));
+    }
+
+    void Link (uint32_t iEntry,
+               uint32_t idCell)
+    {
+        bool      bInserted = false;
+        uint32_t& iHead     = m_cells.Insert (idCell, &bInserted);
+
+        m_entries[iEntry].idCell = idCell;
+        m_entries[iEntry].iPrev  = NONE;
+        m_entries[iEntry].iNext  = bInserted ? NONE : iHead;
+
+        if (!bInserted) m_entries[iHead].iPrev = iEntry;
+        iHead = iEntry;
+    }
+
+    void Unlink (uint32_t iEntry)
+    {
+        Entry& entry = m_entries[iEntry];
+
+        if (entry.iNext != NONE) m_entries[entry.iNext].iPrev = entry.iPrev;
+
+        if (entry.iPrev != NONE)
+        {
+            m_entries[entry.iPrev].iNext = entry.iNext;
+        }
+        else if (entry.iNext != NONE)
+        {
+            *m_cells.Find (entry.idCell) = entry.iNext;
+        }
+        else
+        {
+            m_cells.Erase (entry.idCell);
+        }
+    }
+
+
+    double                  m_dCellDeg;
+    uint32_t                m_nLatCells;
+    uint32_t                m_nLonCells;
+    std::vector<Entry>      m_entries;
+    CFlatHashMap<uint32_t>  m_index;    // Object ID to index in m_entries
+    CFlatHashMap<uint32_t>  m_cells;    // Cell key to index of the first entry in the cell
+};
@@ -0,0 +1,465 @@
+#pragma once
+
+#include <Windows.h>
+#include <SimConnect.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define SUBSCRIPTION_MUX_IDS_PER_GROUP 4    // Request IDs each group takes in turn, one per layout
+
+
+/**
+ * Shares SimVar subscriptions between several internal consumers (controller, logger, exporter, ...).
+ *
+ * Every (object, SimVar, unit, period, interval) tuple is refcounted. Tuples with the same object, period and interval
+ *  are merged into one data definition and one SimConnect_RequestDataOnSimObject, and each received SIMOBJECT_DATA is fanned out to
+ *  all consumers of that group. The merged definitions are maintained incrementally: a field that is already part
+ *  of a group costs no IPC at all, a new field is appended to the existing definition, and fields that are no
+ *  longer referenced are only compacted away once they make up the majority of the definition. Each new layout
+ *  of a group is requested under the next of its request IDs, so replies still in flight in the old one are dropped.
+ *
+ * All fields are requested as SIMCONNECT_DATATYPE_FLOAT64.
+ */
+class CSubscriptionMux
+{
+public:
+    typedef struct Field
+    {
+        const char* szSimVar;
+        const char* szUnits;
+    }
+    Field;
+
+    /**
+     * Receives the values of a subscription, in the same order as the fields passed to Subscribe.
+     */
+    typedef void (CALLBACK* ConsumerProc) (DWORD         idObject,
+                                           const double* pValues,
+                                           DWORD         cValues,
+                                           void*         pContext);
+
+    /**
+     * The mux owns the data definition IDs [idDefFirst, idDefFirst + cGroupsMax) and the request IDs
+     *  [idReqFirst, idReqFirst + cGroupsMax * SUBSCRIPTION_MUX_IDS_PER_GROUP).
+     */
+    CSubscriptionMux (DWORD idDefFirst,
+                      DWORD idReqFirst,
+                      DWORD cGroupsMax) :
+        m_hSimConnect (NULL),
+        m_idDefFirst  (idDefFirst),
+        m_idReqFirst  (idReqFirst),
+        m_groups      (cGroupsMax)
+    {
+    }
+
+    void Attach (HANDLE hSimConnect)
+    {
+        m_hSimConnect = hSimConnect;
+    }
+
+    /**
+     * Subscribe to a set of SimVars on an object, skipping dwInterval periods between sends. Returns a subscription
+     *  ID, or 0 if all groups are in use.
+     */
+    DWORD Subscribe (DWORD             idObject,
+                     SIMCONNECT_PERIOD period,
+                     const Field*      pFields,
+                     DWORD             cFields,
+                     ConsumerProc      pfnConsumer,
+                     void*             pContext,
+                     DWORD             dwInterval = 0)
+    {
+        DWORD iGroup = FindGroup (idObject, period, dwInterval);
+        if (iGroup == NONE)
+        {
+            iGroup = AllocGroup (idObject, period, dwInterval);
+            if (iGroup == NONE) return 0;
+        }
+
+        Group& group     = m_groups[iGroup];
+        bool   bAppended = false;
+
+        Consumer consumer;
+        consumer.bUsed       = true;
+        consumer.iGroup      = iGroup;
+        consumer.pfnConsumer = pfnConsumer;
+        consumer.pContext    = pContext;
+
+        for (DWORD iField = 0; iField < cFields; iField++)
+        {
+            DWORD iSlot = FindSlot (group, pFields[iField]);
+            if (iSlot == NONE)
+            {
+                Slot slot;
+                slot.strSimVar = pFields[iField].szSimVar;
+                slot.strUnits  = pFields[iField].szUnits;
+                slot.cRefs     = 0;
+
+                iSlot = (DWORD)group.slots.size ();
+                group.slots.push_back (slot);
+
+                SimConnect_AddToDataDefinition (
+                    m_hSimConnect,
+                    m_idDefFirst + iGroup,
+                    slot.strSimVar.c_str (),
+                    slot.strUnits.c_str (),
+                    SIMCONNECT_DATATYPE_FLOAT64
+                );
+                bAppended = true;
+            }
+
+            if (group.slots[iSlot].cRefs++ == 0) group.cLive++;
+            consumer.slots.push_back (iSlot);
+        }
+
+        if (consumer.slots.size () > m_values.size ()) m_values.resize (consumer.slots.size ());
+
+        DWORD iConsumer = AllocConsumer ();
+        m_consumers[iConsumer] = consumer;
+        group.cConsumers++;
+
+        // A one-shot request has to be repeated for the newcomer; a periodic one only when the layout grew
+        if (bAppended || period == SIMCONNECT_PERIOD_ONCE)
+        {
+            Request (iGroup, bAppended);
+        }
+
+        return iConsumer + 1;
+    }
+
+    void Unsubscribe (DWORD idSub)
+    {
+        if (idSub == 0 || idSub > m_consumers.size () || !m_consumers[idSub - 1].bUsed) return;
+
+        Consumer& consumer = m_consumers[idSub - 1];
+
+        // Detached when the object was removed; the group is already gone
+        if (consumer.iGroup != NONE)
+        {
+            Group& group = m_groups[consumer.iGroup];
+
+            for (size_t i = 0; i < consumer.slots.size (); i++)
+            {
+                if (--group.slots[consumer.slots[i]].cRefs == 0) group.cLive--;
+            }
+            group.cConsumers--;
+
+            if (group.cConsumers == 0)
+            {
+                SimConnect_RequestDataOnSimObject (
+                    m_hSimConnect,
+                    group.idRequest,
+                    m_idDefFirst + consumer.iGroup,
+                    group.idObject,
+                    SIMCONNECT_PERIOD_NEVER
+                );
+                SimConnect_ClearDataDefinition (m_hSimConnect, m_idDefFirst + consumer.iGroup);
+                FreeGroup (consumer.iGroup);
+            }
+            else if (group.slots.size () - group.cLive > group.cLive)
+            {
+                Compact (consumer.iGroup);
+            }
+        }
+
+        consumer.bUsed = false;
+        consumer.slots.clear ();
+    }
+
+    /**
+     * Change the interval of a subscription. A consumer alone in its group keeps its subscription ID and costs one
+     *  request; otherwise it moves to the group for the new interval and gets a new ID. Returns the ID to use from
+     *  now on, or 0 if there was no group left to move to, in which case the old subscription stays as it was.
+     *
+     * Must not be called from inside a ConsumerProc.
+     */
+    DWORD SetInterval (DWORD idSub,
+                       DWORD dwInterval)
+    {
+        if (idSub == 0 || idSub > m_consumers.size () || !m_consumers[idSub - 1].bUsed) return 0;
+
+        const Consumer& consumer = m_consumers[idSub - 1];
+        if (consumer.iGroup == NONE) return idSub;
+
+        Group& group = m_groups[consumer.iGroup];
+        if (group.dwInterval == dwInterval) return idSub;
+
+        if (group.cConsumers == 1 && FindGroup (group.idObject, group.period, dwInterval) == NONE)
+        {
+            group.dwInterval = dwInterval;
+            Request (consumer.iGroup, false);
+            return idSub;
+        }
+
+        // The old group is left alone until the new subscription exists, so its strings can be passed straight on
+        std::vector<Field> fields (consumer.slots.size ());
+        for (size_t i = 0; i < fields.size (); i++)
+        {
+            fields[i].szSimVar = group.slots[consumer.slots[i]].strSimVar.c_str ();
+            fields[i].szUnits  = group.slots[consumer.slots[i]].strUnits.c_str ();
+        }
+
+        DWORD idNew = Subscribe (group.idObject, group.period, fields.data (), (DWORD)fields.size (),
+                                 consumer.pfnConsumer, consumer.pContext, dwInterval);
+        if (idNew == 0) return 0;
+
+        Unsubscribe (idSub);
+        return idNew;
+    }
+
+    /**
+     * Drop all groups on an object the sim has removed. The sim has already ended their requests, so only the
+     *  definitions are cleared; the consumers stay subscribed but detached until they unsubscribe.
+     */
+    void RemoveObject (DWORD idObject)
+    {
+        for (DWORD iGroup = 0; iGroup < m_groups.size (); iGroup++)
+        {
+            if (!m_groups[iGroup].bUsed || m_groups[iGroup].idObject != idObject) continue;
+
+            for (size_t iConsumer = 0; iConsumer < m_consumers.size (); iConsumer++)
+            {
+                if (m_consumers[iConsumer].bUsed && m_consumers[iConsumer].iGroup == iGroup)
+                {
+                    m_consumers[iConsumer].iGroup = NONE;
+                }
+            }
+
+            SimConnect_ClearDataDefinition (m_hSimConnect, m_idDefFirst + iGroup);
+            FreeGroup (iGroup);
+        }
+    }
+
+    /**
+     * Fans a SIMOBJECT_DATA message out to the consumers of its group. Returns false if the message does not belong
+     *  to the mux, so the caller can handle it itself.
+     */
+    bool OnSimObjectData (const SIMCONNECT_RECV_SIMOBJECT_DATA* pObjData)
+    {
+        DWORD iId = pObjData->dwRequestID - m_idReqFirst;
+        if (iId >= m_groups.size () * SUBSCRIPTION_MUX_IDS_PER_GROUP) return false;
+
+        DWORD  iGroup = iId % (DWORD)m_groups.size ();
+        Group& group  = m_groups[iGroup];
+
+        // Messages still in flight from before the last append or compaction came under an older request ID
+        if (!group.bUsed || pObjData->dwRequestID != group.idRequest) return true;
+
+        const BYTE* pbData = (const BYTE*)&pObjData->dwData;
+
+        for (size_t iConsumer = 0; iConsumer < m_consumers.size (); iConsumer++)
+        {
+            const Consumer& consumer = m_consumers[iConsumer];
+            if (!consumer.bUsed || consumer.iGroup != iGroup) continue;
+
+            for (size_t i = 0; i < consumer.slots.size (); i++)
+            {
+                memcpy (&m_values[i], pbData + consumer.slots[i] * sizeof (double), sizeof (double));
+            }
+            consumer.pfnConsumer (pObjData->dwObjectID, m_values.data (), (DWORD)consumer.slots.size (), consumer.pContext);
+        }
+        return true;
+    }
+
+private:
+    static const DWORD NONE = (DWORD)-1;
+
+    typedef struct Slot
+    {
+        std::string strSimVar;
+        std::string strUnits;
+        DWORD       cRefs;
+    }
+    Slot;
+
+    typedef struct Group
+    {
+        Group () :
+            bUsed      (false),
+            idObject   (0),
+            period     (SIMCONNECT_PERIOD_NEVER),
+            dwInterval (0),
+            cLive      (0),
+            cConsumers (0),
+            idRequest  (NONE),
+            nTurn      (0)
+        {
+        }
+
+        bool              bUsed;
+        DWORD             idObject;
+        SIMCONNECT_PERIOD period;
+        DWORD             dwInterval;
+        std::vector<Slot> slots;
+        DWORD             cLive;
+        DWORD             cConsumers;
+        DWORD             idRequest;    // Of the current layout, NONE until the first request
+        DWORD             nTurn;        // Layouts requested from the group, kept when it is freed
+    }
+    Group;
+
+    typedef struct Consumer
+    {
+        Consumer () :
+            bUsed       (false),
+            iGroup      (NONE),
+            pfnConsumer (NULL),
+            pContext    (NULL)
+        {
+        }
+
+        bool               bUsed;
+        DWORD              iGroup;
+        std::vector<DWORD> slots;
+        ConsumerProc       pfnConsumer;
+        void*              pContext;
+    }
+    Consumer;
+
+    DWORD FindGroup (DWORD             idObject,
+                     SIMCONNECT_PERIOD period,
+                     DWORD             dwInterval) const
+    {
+        for (DWORD i = 0; i < m_groups.size (); i++)
+        {
+            const Group& group = m_groups[i];
+            if (group.bUsed && group.idObject == idObject && group.period == period && group.dwInterval == dwInterval)
+            {
+                return i;
+            }
+        }
+        return NONE;
+    }
+
+    DWORD AllocGroup (DWORD             idObject,
+                      SIMCONNECT_PERIOD period,
+                      DWORD             dwInterval)
+    {
+        for (DWORD i = 0; i < m_groups.size (); i++)
+        {
+            if (!m_groups[i].bUsed)
+            {
+                m_groups[i].bUsed      = true;
+                m_groups[i].idObject   = idObject;
+                m_groups[i].period     = period;
+                m_groups[i].dwInterval = dwInterval;
+                return i;
+            }
+        }
+        return NONE;
+    }
+
+    void FreeGroup (DWORD iGroup)
+    {
+        DWORD nTurn = m_groups[iGroup].nTurn;
+        m_groups[iGroup]       = Group ();
+        m_groups[iGroup].nTurn = nTurn;
+    }
+
+    static DWORD FindSlot (const Group& group,
+                           const Field& field)
+    {
+        for (DWORD i = 0; i < group.slots.size (); i++)
+        {
+            if (group.slots[i].strSimVar == field.szSimVar && group.slots[i].strUnits == field.szUnits) return i;
+        }
+        return NONE;
+    }
+
+    DWORD AllocConsumer ()
+    {
+        for (DWORD i = 0; i < m_consumers.size (); i++)
+        {
+            if (!m_consumers[i].bUsed) return i;
+        }
+        m_consumers.push_back (Consumer ());
+        return (DWORD)m_consumers.size () - 1;
+    }
+
+    /**
+     * (Re)issue the request of a group. For a new layout the old request is ended and the group moves on to its next
+     *  request ID: group i takes the request IDs idReqFirst + i + n * cGroupsMax.
+     */
+    void Request (DWORD iGroup,
+                  bool  bNewLayout)
+    {
+        Group& group = m_groups[iGroup];
+
+        if (bNewLayout || group.idRequest == NONE)
+        {
+            if (group.idRequest != NONE)
+            {
+                SimConnect_RequestDataOnSimObject (
+                    m_hSimConnect,
+                    group.idRequest,
+                    m_idDefFirst + iGroup,
+                    group.idObject,
+                    SIMCONNECT_PERIOD_NEVER
+                );
+            }
+            group.idRequest = m_idReqFirst + iGroup + (group.nTurn++ % SUBSCRIPTION_MUX_IDS_PER_GROUP) * (DWORD)m_groups.size ();
+        }
+
+        SimConnect_RequestDataOnSimObject (
+            m_hSimConnect,
+            group.idRequest,
+            m_idDefFirst + iGroup,
+            group.idObject,
+            group.period,
+            SIMCONNECT_DATA_REQUEST_FLAG_DEFAULT,
+            0,
+            group.dwInterval
+        );
+    }
+
+    /**
+     * Rebuild the definition of a group from its live slots only, and remap the consumers to the new layout.
+     */
+    void Compact (DWORD iGroup)
+    {
+        Group&             group = m_groups[iGroup];
+        std::vector<Slot>  slots;
+        std::vector<DWORD> remap (group.slots.size (), (DWORD)NONE);
+
+        SimConnect_ClearDataDefinition (m_hSimConnect, m_idDefFirst + iGroup);
+
+        for (DWORD i = 0; i < group.slots.size (); i++)
+        {
+            if (group.slots[i].cRefs == 0) continue;
+
+            remap[i] = (DWORD)slots.size ();
+            slots.push_back (group.slots[i]);
+
+            SimConnect_AddToDataDefinition (
+                m_hSimConnect,
+                m_idDefFirst + iGroup,
+                group.slots[i].strSimVar.c_str (),
+                group.slots[i].strUnits.c_str (),
+                SIMCONNECT_DATATYPE_FLOAT64
+            );
+        }
+        group.slots.swap (slots);
+
+        for (size_t iConsumer = 0; iConsumer < m_consumers.size (); iConsumer++)
+        {
+            Consumer& consumer = m_consumers[iConsumer];
+            if (!consumer.bUsed || consumer.iGroup != iGroup) continue;
+
+            for (size_t i = 0; i < consumer.slots.size (); i++)
+            {
+                consumer.slots[i] = remap[consumer.slots[i]];
+            }
+        }
+
+        Request (iGroup, true);
+    }
+
+
+    HANDLE                  m_hSimConnect;
+    DWORD                   m_idDefFirst;
+    DWORD                   m_idReqFirst;
+    std::vector<Group>      m_groups;
+    std::vector<Consumer>   m_consumers;
+    std::vector<double>     m_values;
+};
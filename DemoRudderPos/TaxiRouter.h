@@ -0,0 +1,472 @@
+#pragma once
+
+#include <Windows.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "FacilityFetcher.h"
+#include "LocalFrame.h"
+#include "SpatialGrid.h"
+
+
+#define TAXI_ROUTER_LANDMARKS       8
+#define TAXI_ROUTER_RUNWAY_FACTOR   4.0f    // Driving along a runway costs this many times its length
+#define TAXI_ROUTER_NONE            0xFFFFFFFF
+
+enum TAXI_ROUTE_MODE
+{
+    TAXI_ROUTE_MODE_DIJKSTRA,               // No heuristic
+    TAXI_ROUTE_MODE_EUCLIDEAN,              // A* on straight-line distance
+    TAXI_ROUTE_MODE_LANDMARKS               // A* on straight-line distance and the landmarks, whichever is larger (ALT)
+};
+
+/**
+ * Routes for ground vehicles over the taxiways of an airport, as waypoints in degrees for CPathFollower.
+ *
+ * The taxi points and parking spots of the airport are the nodes, its taxi, runway and parking paths the edges,
+ *  both ways, in arrays indexed by node. Routes are the shortest by A*. Straight-line distance alone says little
+ *  where taxiways wind or end, so Build also takes the distances from a few landmarks at the edges of the network
+ *  to every node, one Dijkstra each; by the triangle inequality, the difference of a landmark's distances to a node
+ *  and to the goal bounds the rest of the route from below, and the search settles far fewer nodes off the route.
+ *
+ * The nodes of a route are found without clearing anything per query: each node's state carries the number of the
+ *  query that last touched it.
+ */
+class CTaxiRouter
+{
+public:
+    explicit CTaxiRouter (DWORD cLandmarks = TAXI_ROUTER_LANDMARKS) :
+        m_cLandmarks (cLandmarks),
+        m_cPoints    (0),
+        m_grid       (0.005),
+        m_eMode      (TAXI_ROUTE_MODE_LANDMARKS),
+        m_nQuery     (0),
+        m_cSettled   (0)
+    {
+    }
+
+    /**
+     * Take the network of an airport, replacing any before. The airport need not outlive the router.
+     */
+    void Build (const AirportModel& airport)
+    {
+        Clear ();
+        m_frame.Anchor (airport.dLatitude, airport.dLongitude);
+        m_cPoints = airport.cTaxiPoints;
+
+        for (DWORD i = 0; i < airport.cTaxiPoints; i++) AddNode (airport.pTaxiPoints[i].fX, airport.pTaxiPoints[i].fZ);
+        for (DWORD i = 0; i < airport.cParkings; i++)   AddNode (airport.pParkings[i].fX, airport.pParkings[i].fZ);
+
+        // Count the edges of each node, then place them
+        std::vector<Link> links;
+        for (DWORD i = 0; i < airport.cTaxiPaths; i++)
+        {
+            const AirportTaxiPath& path  = airport.pTaxiPaths[i];
+            DWORD                  iEnd  = path.eType == AIRPORT_PATH_PARKING ? m_cPoints + path.iEnd : path.iEnd;
+            float                  fCost;
+
+            if (path.eType != AIRPORT_PATH_TAXI && path.eType != AIRPORT_PATH_RUNWAY && path.eType != AIRPORT_PATH_PARKING) continue;
+            if (path.iStart >= m_cPoints || iEnd >= NodeCount () || path.iStart == iEnd) continue;
+
+            fCost = (float)Distance (path.iStart, iEnd);
+            if (path.eType == AIRPORT_PATH_RUNWAY) fCost *= TAXI_ROUTER_RUNWAY_FACTOR;
+
+            Link link = { path.iStart, iEnd, fCost };
+            links.push_back (link);
+        }
+
+        m_iFirstEdge.assign (NodeCount () + 1, 0);
+        for (size_t i = 0; i < links.size (); i++)
+        {
+            m_iFirstEdge[links[i].iFrom + 1]++;
+            m_iFirstEdge[links[i].iTo + 1]++;
+        }
+        for (DWORD i = 0; i < NodeCount (); i++) m_iFirstEdge[i + 1] += m_iFirstEdge[i];
+
+        std::vector<DWORD> iNext (m_iFirstEdge.begin (), m_iFirstEdge.end () - 1);
+        m_edges.resize (links.size () * 2);
+        for (size_t i = 0; i < links.size (); i++)
+        {
+            Edge forward  = { links[i].iTo, links[i].fCost };
+            Edge backward = { links[i].iFrom, links[i].fCost };
+            m_edges[iNext[links[i].iFrom]++] = forward;
+            m_edges[iNext[links[i].iTo]++]   = backward;
+        }
+
+        m_states.assign (NodeCount (), State ());
+        BuildComponents ();
+        BuildLandmarks ();
+    }
+
+    /**
+     * Forget the network.
+     */
+    void Clear ()
+    {
+        m_nodes.clear ();
+        m_iFirstEdge.clear ();
+        m_edges.clear ();
+        m_components.clear ();
+        m_landmarks.clear ();
+        m_landmarkDists.clear ();
+        m_states.clear ();
+        m_grid.Clear ();
+        m_cPoints = 0;
+    }
+
+    /**
+     * Heuristic of the searches from now on; the routes are the same, only the work to find them differs.
+     */
+    void SetMode (TAXI_ROUTE_MODE eMode)
+    {
+        m_eMode = eMode;
+    }
+
+    /**
+     * Taxi points come first, then parking spots.
+     */
+    DWORD NodeCount () const
+    {
+        return (DWORD)m_nodes.size ();
+    }
+
+    DWORD ParkingNode (DWORD iParking) const
+    {
+        return m_cPoints + iParking;
+    }
+
+    DWORD EdgeCount () const
+    {
+        return (DWORD)m_edges.size () / 2;
+    }
+
+    void NodePosition (DWORD   iNode,
+                       double& dLat,
+                       double& dLon) const
+    {
+        m_frame.FromLocal (m_nodes[iNode].dEastFt, m_nodes[iNode].dNorthFt, dLat, dLon);
+    }
+
+    /**
+     * The node nearest a position, or TAXI_ROUTER_NONE without a network.
+     */
+    DWORD NearestNode (double  dLat,
+                       double  dLon,
+                       double* pdDistFt = NULL)
+    {
+        m_grid.KNearest (dLat, dLon, 1, m_hits);
+        if (m_hits.empty ()) return TAXI_ROUTER_NONE;
+
+        if (pdDistFt != NULL) *pdDistFt = m_hits[0].dDistFt;
+        return m_hits[0].idObject;
+    }
+
+    /**
+     * The shortest route between two nodes as waypoints, both nodes included; false if there is none.
+     */
+    bool Route (DWORD                iFrom,
+                DWORD                iTo,
+                std::vector<double>& lats,
+                std::vector<double>& lons,
+                double*              pdLengthFt = NULL)
+    {
+        lats.clear ();
+        lons.clear ();
+        m_cSettled = 0;
+        if (iFrom >= NodeCount () || iTo >= NodeCount () || m_components[iFrom] != m_components[iTo]) return false;
+
+        Search (iFrom, iTo);
+
+        if (pdLengthFt != NULL) *pdLengthFt = m_states[iTo].fCost;
+        for (DWORD iNode = iTo; ; iNode = m_states[iNode].iParent)
+        {
+            double dLat;
+            double dLon;
+            NodePosition (iNode, dLat, dLon);
+            lats.push_back (dLat);
+            lons.push_back (dLon);
+            if (iNode == iFrom) break;
+        }
+        std::reverse (lats.begin (), lats.end ());
+        std::reverse (lons.begin (), lons.end ());
+        return true;
+    }
+
+    /**
+     * Nodes the last route settled, to compare heuristics by.
+     */
+    DWORD Settled () const
+    {
+        return m_cSettled;
+    }
+
+private:
+    CTaxiRouter (const CTaxiRouter&);
+    CTaxiRouter& operator= (const CTaxiRouter&);
+
+
+    typedef struct Node
+    {
+        double  dEastFt;
+        double  dNorthFt;
+    }
+    Node;
+
+    typedef struct Link
+    {
+        DWORD   iFrom;
+        DWORD   iTo;
+        float   fCost;
+    }
+    Link;
+
+    typedef struct Edge
+    {
+        DWORD   iTo;
+        float   fCost;          // Feet, more along runways
+    }
+    Edge;
+
+    typedef struct State
+    {
+        State () :
+            nQuery  (0),
+            bClosed (false),
+            fCost   (0.0f),
+            iParent (TAXI_ROUTER_NONE)
+        {
+        }
+
+        uint32_t    nQuery;     // Of the search that last reached the node; the rest is stale otherwise
+        bool        bClosed;
+        float       fCost;      // From the start
+        DWORD       iParent;
+    }
+    State;
+
+    typedef struct Open
+    {
+        float   fEstimate;      // Cost from the start and heuristic to the goal
+        DWORD   iNode;
+    }
+    Open;
+
+    static bool LaterFirst (const Open& a,
+                            const Open& b)
+    {
+        return a.fEstimate > b.fEstimate;
+    }
+
+    void AddNode (float fX,
+                  float fZ)
+    {
+        Node   node = { CDistance::Meters (fX).Ft (), CDistance::Meters (fZ).Ft () };
+        double dLat;
+        double dLon;
+
+        m_nodes.push_back (node);
+        m_frame.FromLocal (node.dEastFt, node.dNorthFt, dLat, dLon);
+        m_grid.Update ((uint32_t)m_nodes.size () - 1, dLat, dLon);
+    }
+
+    double Distance (DWORD iFrom,
+                     DWORD iTo) const
+    {
+        double dEast  = m_nodes[iTo].dEastFt - m_nodes[iFrom].dEastFt;
+        double dNorth = m_nodes[iTo].dNorthFt - m_nodes[iFrom].dNorthFt;
+        return sqrt (dEast * dEast + dNorth * dNorth);
+    }
+
+    /**
+     * A lower bound of the cost from a node to the goal. Every edge costs at least its length, so straight-line
+     *  distance is one; so is, on an undirected network, the difference of a landmark's distances to the two.
+     */
+    float Heuristic (DWORD iNode,
+                     DWORD iTo) const
+    {
+        if (m_eMode == TAXI_ROUTE_MODE_DIJKSTRA) return 0.0f;
+
+        float fBound = (float)Distance (iNode, iTo);
+        if (m_eMode == TAXI_ROUTE_MODE_EUCLIDEAN) return fBound;
+
+        const float* pDists = m_landmarkDists.data ();
+        for (size_t i = 0; i < m_landmarks.size (); i++, pDists += NodeCount ())
+        {
+            fBound = std::max (fBound, fabsf (pDists[iTo] - pDists[iNode]));
+        }
+        return fBound;
+    }
+
+    /**
+     * A* from iFrom until iTo is settled, or with iTo of TAXI_ROUTER_NONE and no heuristic, Dijkstra over all that
+     *  can be reached.
+     */
+    void Search (DWORD iFrom,
+                 DWORD iTo)
+    {
+        // Wrapping around would make ancient states look current
+        if (++m_nQuery == 0)
+        {
+            m_states.assign (NodeCount (), State ());
+            m_nQuery = 1;
+        }
+
+        State& start = m_states[iFrom];
+        start.nQuery  = m_nQuery;
+        start.bClosed = false;
+        start.fCost   = 0.0f;
+        start.iParent = iFrom;
+
+        Open open = { iTo != TAXI_ROUTER_NONE ? Heuristic (iFrom, iTo) : 0.0f, iFrom };
+        m_open.clear ();
+        m_open.push_back (open);
+
+        while (!m_open.empty ())
+        {
+            std::pop_heap (m_open.begin (), m_open.end (), LaterFirst);
+            DWORD  iNode = m_open.back ().iNode;
+            State& state = m_states[iNode];
+            m_open.pop_back ();
+
+            // The heuristics are consistent, so a node is done the first time it comes off the heap
+            if (state.bClosed) continue;
+            state.bClosed = true;
+            m_cSettled++;
+            if (iNode == iTo) return;
+
+            for (DWORD iEdge = m_iFirstEdge[iNode]; iEdge < m_iFirstEdge[iNode + 1]; iEdge++)
+            {
+                const Edge& edge  = m_edges[iEdge];
+                State&      next  = m_states[edge.iTo];
+                float       fCost = state.fCost + edge.fCost;
+
+                if (next.nQuery != m_nQuery)
+                {
+                    next.nQuery  = m_nQuery;
+                    next.bClosed = false;
+                }
+                else if (next.bClosed || fCost >= next.fCost)
+                {
+                    continue;
+                }
+
+                next.fCost   = fCost;
+                next.iParent = iNode;
+
+                Open reached = { fCost + (iTo != TAXI_ROUTER_NONE ? Heuristic (edge.iTo, iTo) : 0.0f), edge.iTo };
+                m_open.push_back (reached);
+                std::push_heap (m_open.begin (), m_open.end (), LaterFirst);
+            }
+        }
+    }
+
+    /**
+     * Number the connected parts of the network, so that routes between them fail without a search.
+     */
+    void BuildComponents ()
+    {
+        std::vector<DWORD> stack;
+
+        m_components.assign (NodeCount (), TAXI_ROUTER_NONE);
+        for (DWORD iSeed = 0, nComponent = 0; iSeed < NodeCount (); iSeed++)
+        {
+            if (m_components[iSeed] != TAXI_ROUTER_NONE) continue;
+
+            m_components[iSeed] = nComponent;
+            stack.push_back (iSeed);
+            while (!stack.empty ())
+            {
+                DWORD iNode = stack.back ();
+                stack.pop_back ();
+                for (DWORD iEdge = m_iFirstEdge[iNode]; iEdge < m_iFirstEdge[iNode + 1]; iEdge++)
+                {
+                    DWORD iTo = m_edges[iEdge].iTo;
+                    if (m_components[iTo] != TAXI_ROUTER_NONE) continue;
+
+                    m_components[iTo] = nComponent;
+                    stack.push_back (iTo);
+                }
+            }
+            nComponent++;
+        }
+    }
+
+    /**
+     * Pick landmarks far apart, each the node farthest from those picked so far, starting from the node farthest
+     *  from an arbitrary one; the distances from each come from the search that picks the next. Nodes out of reach
+     *  of a landmark, in other parts of the network, get a distance of 0 from it, which bounds nothing.
+     */
+    void BuildLandmarks ()
+    {
+        if (NodeCount () == 0 || m_cLandmarks == 0) return;
+
+        std::vector<float> nearest (NodeCount (), FLT_MAX);
+        DWORD              iLandmark = FarthestFrom (0, NULL);
+
+        m_landmarkDists.reserve ((size_t)m_cLandmarks * NodeCount ());
+        while (m_landmarks.size () < m_cLandmarks)
+        {
+            m_landmarks.push_back (iLandmark);
+            iLandmark = FarthestFrom (iLandmark, &nearest);
+        }
+    }
+
+    /**
+     * Dijkstra from a node; with pNearest, record the distances as a landmark's and return the node farthest from
+     *  every landmark, otherwise the node farthest from this one.
+     */
+    DWORD FarthestFrom (DWORD               iFrom,
+                        std::vector<float>* pNearest)
+    {
+        TAXI_ROUTE_MODE eMode = m_eMode;
+        DWORD           iFarthest = iFrom;
+        float           fFarthest = 0.0f;
+
+        m_eMode = TAXI_ROUTE_MODE_DIJKSTRA;
+        Search (iFrom, TAXI_ROUTER_NONE);
+        m_eMode = eMode;
+
+        if (pNearest != NULL) m_landmarkDists.resize (m_landmarkDists.size () + NodeCount (), 0.0f);
+        for (DWORD i = 0; i < NodeCount (); i++)
+        {
+            bool  bReached = m_states[i].nQuery == m_nQuery;
+            float fDist    = bReached ? m_states[i].fCost : 0.0f;
+
+            if (pNearest != NULL)
+            {
+                m_landmarkDists[m_landmarkDists.size () - NodeCount () + i] = fDist;
+                if (bReached) (*pNearest)[i] = std::min ((*pNearest)[i], fDist);
+                fDist = (*pNearest)[i] != FLT_MAX ? (*pNearest)[i] : 0.0f;
+            }
+            if (fDist > fFarthest)
+            {
+                fFarthest = fDist;
+                iFarthest = i;
+            }
+        }
+        return iFarthest;
+    }
+
+
+    DWORD                           m_cLandmarks;
+    DWORD                           m_cPoints;      // Taxi points, the first nodes
+    CLocalFrame                     m_frame;        // At the airport's reference point
+    std::vector<Node>               m_nodes;
+    std::vector<DWORD>              m_iFirstEdge;   // Per node, and one past the last
+    std::vector<Edge>               m_edges;
+    std::vector<DWORD>              m_components;   // Per node
+    std::vector<DWORD>              m_landmarks;
+    std::vector<float>              m_landmarkDists;// Per landmark, per node
+    CSpatialGrid                    m_grid;         // Of the nodes
+    std::vector<CSpatialGrid::Hit>  m_hits;
+    TAXI_ROUTE_MODE                 m_eMode;
+
+    // Of the searches
+    std::vector<State>              m_states;
+    std::vector<Open>               m_open;
+    uint32_t                        m_nQuery;
+    DWORD                           m_cSettled;
+};
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <Windows.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ARCHIVE_SSE2
+#endif
+
+#include "MappedFile.h"
+#include "TelemetryRecorder.h"
+
+
+/**
+ * The indices of the values above, or below, a threshold, in order; returns how many there are. piMatches has room
+ *  for cValues. With SSE2, eight values are compared per step, and a step without a match, by far the most common
+ *  in a selective query, costs one test of the combined mask.
+ */
+inline DWORD FilterAbove (const double* pValues,
+                          DWORD         cValues,
+                          double        dThreshold,
+                          DWORD*        piMatches)
+{
+    DWORD cMatches = 0;
+    DWORD i        = 0;
+
+#ifdef ARCHIVE_SSE2
+    __m128d threshold = _mm_set1_pd (dThreshold);
+
+    for (; i + 8 <= cValues; i += 8)
+    {
+        int nMask0 = _mm_movemask_pd (_mm_cmpgt_pd (_mm_loadu_pd (pValues + i),     threshold));
+        int nMask1 = _mm_movemask_pd (_mm_cmpgt_pd (_mm_loadu_pd (pValues + i + 2), threshold));
+        int nMask2 = _mm_movemask_pd (_mm_cmpgt_pd (_mm_loadu_pd (pValues + i + 4), threshold));
+        int nMask3 = _mm_movemask_pd (_mm_cmpgt_pd (_mm_loadu_pd (pValues + i + 6), threshold));
+        int nMask  = nMask0 | (nMask1 << 2) | (nMask2 << 4) | (nMask3 << 6);
+
+        for (DWORD iBit = 0; nMask != 0; iBit++, nMask >>= 1)
+        {
+            if (nMask & 1) piMatches[cMatches++] = i + iBit;
+        }
+    }
+#endif
+
+    for (; i < cValues; i++)
+    {
+        if (pValues[i] > dThreshold) piMatches[cMatches++] = i;
+    }
+    return cMatches;
+}
+
+inline DWORD FilterBelow (const double* pValues,
+                          DWORD         cValues,
+                          double        dThreshold,
+                          DWORD*        piMatches)
+{
+    DWORD cMatches = 0;
+    DWORD i        = 0;
+
+#ifdef ARCHIVE_SSE2
+    __m128d threshold = _mm_set1_pd (dThreshold);
+
+    for (; i + 8 <= cValues; i += 8)
+    {
+        int nMask0 = _mm_movemask_pd (_mm_cmplt_pd (_mm_loadu_pd (pValues + i),     threshold));
+        int nMask1 = _mm_movemask_pd (_mm_cmplt_pd (_mm_loadu_pd (pValues + i + 2), threshold));
+        int nMask2 = _mm_movemask_pd (_mm_cmplt_pd (_mm_loadu_pd (pValues + i + 4), threshold));
+        int nMask3 = _mm_movemask_pd (_mm_cmplt_pd (_mm_loadu_pd (pValues + i + 6), threshold));
+        int nMask  = nMask0 | (nMask1 << 2) | (nMask2 << 4) | (nMask3 << 6);
+
+        for (DWORD iBit = 0; nMask != 0; iBit++, nMask >>= 1)
+        {
+            if (nMask & 1) piMatches[cMatches++] = i + iBit;
+        }
+    }
+#endif
+
+    for (; i < cValues; i++)
+    {
+        if (pValues[i] < dThreshold) piMatches[cMatches++] = i;
+    }
+    return cMatches;
+}
+
+
+enum ARCHIVE_OP
+{
+    ARCHIVE_OP_ABOVE,
+    ARCHIVE_OP_BELOW
+};
+
+#define ARCHIVE_ANY_OBJECT  0xFFFFFFFF
+#define ARCHIVE_ANY_KIND    0
+
+/**
+ * Which samples to find: those of one object, or any, and one kind, or any, with a field above or below a threshold,
+ *  within a span of sim time.
+ */
+typedef struct ArchiveQuery
+{
+    ArchiveQuery () :
+        idObject   (ARCHIVE_ANY_OBJECT),
+        eKind      (ARCHIVE_ANY_KIND),
+        iField     (0),
+        eOp        (ARCHIVE_OP_ABOVE),
+        dThreshold (0.0),
+        nTimeFrom  (INT64_MIN),
+        nTimeTo    (INT64_MAX)
+    {
+    }
+
+    DWORD       idObject;
+    DWORD       eKind;          // BUS_KIND
+    DWORD       iField;
+    ARCHIVE_OP  eOp;
+    double      dThreshold;
+    int64_t     nTimeFrom;      // Microseconds, both inclusive
+    int64_t     nTimeTo;
+}
+ArchiveQuery;
+
+typedef struct ArchiveStats
+{
+    DWORD       cBlocks;        // Of the object, kind and span
+    DWORD       cBlocksSkipped; // Of those, by their zone map
+    ULONGLONG   cSamples;       // Decoded and compared
+    ULONGLONG   cbColumns;      // Compressed bytes decoded
+    ULONGLONG   cMatches;
+    DWORD       cBlocksBad;     // Of those, not whole in the file, so not decoded
+}
+ArchiveStats;
+
+/**
+ * Answers queries over a recording of CTelemetryRecorder, mapped rather than read, however large it is.
+ *
+ * The blocks of the object and kind asked for are picked from the index at the end of the recording; a block whose
+ *  zone map rules out a match is skipped without touching its pages. The rest have just the one field decoded and
+ *  filtered (see FilterAbove), and their times only when something matched.
+ */
+class CTelemetryArchive
+{
+public:
+    /**
+     * Receives a matching sample, and the block it is in, in the order of the recording.
+     */
+    typedef void (CALLBACK* MatchProc) (const RecIndexEntry* pBlock,
+                                        DWORD                iSample,
+                                        int64_t              nTime,
+                                        double               dValue,
+                                        void*                pContext);
+
+    CTelemetryArchive () :
+        m_pIndex  (NULL),
+        m_cBlocks (0)
+    {
+    }
+
+    /**
+     * Fails for a file that is not a recording. One cut short, without an index, is indexed here.
+     */
+    bool Open (const char* szPath)
+    {
+        Close ();
+        if (!m_file.Open (szPath)) return false;
+
+        const BYTE*          pData   = m_file.Data ();
+        size_t               cbData  = m_file.Size ();
+        const RecFileHeader* pHeader = (const RecFileHeader*)pData;
+
+        if (cbData < sizeof (RecFileHeader) || pHeader->dwMagic != TELEMETRY_REC_MAGIC || pHeader->dwVersion != TELEMETRY_REC_VERSION || pHeader->cFields != TELEMETRY_REC_FIELDS)
+        {
+            Close ();
+            return false;
+        }
+
+        const RecTrailer* pTrailer = (const RecTrailer*)(pData + cbData - sizeof (RecTrailer));
+        if (cbData >= sizeof (RecFileHeader) + sizeof (RecTrailer) && pTrailer->dwMagic == TELEMETRY_REC_INDEX_MAGIC &&
+            pTrailer->ibIndex + (uint64_t)pTrailer->cBlocks * sizeof (RecIndexEntry) + sizeof (RecTrailer) == cbData)
+        {
+            m_pIndex  = (const RecIndexEntry*)(pData + pTrailer->ibIndex);
+            m_cBlocks = pTrailer->cBlocks;
+            return true;
+        }
+
+        // Stop at the first block that is not whole
+        for (size_t ib = sizeof (RecFileHeader); ib + sizeof (RecBlockHeader) <= cbData; )
+        {
+            const RecBlockHeader* pBlock = (const RecBlockHeader*)(pData + ib);
+            if (!IsRecBlockWhole (pBlock, cbData - ib)) break;
+
+            m_built.push_back (RecIndexEntry ());
+            IndexRecBlock (pBlock, ib, m_built.back ());
+            ib += pBlock->cbBlock;
+        }
+        m_pIndex  = m_built.data ();
+        m_cBlocks = (DWORD)m_built.size ();
+        return true;
+    }
+
+    void Close ()
+    {
+        m_file.Close ();
+        m_built.clear ();
+        m_pIndex  = NULL;
+        m_cBlocks = 0;
+    }
+
+    DWORD BlockCount () const
+    {
+        return m_cBlocks;
+    }
+
+    const RecIndexEntry& IndexEntry (DWORD iBlock) const
+    {
+        return m_pIndex[iBlock];
+    }
+
+    const RecBlockHeader* Block (const RecIndexEntry& entry) const
+    {
+        return (const RecBlockHeader*)(m_file.Data () + entry.ibBlock);
+    }
+
+    /**
+     * Size of the mapped recording.
+     */
+    size_t Size () const
+    {
+        return m_file.Size ();
+    }
+
+    /**
+     * Pass each matching sample to pfnMatch, which may be NULL to just count them.
+     */
+    ArchiveStats Query (const ArchiveQuery& query,
+                        MatchProc           pfnMatch,
+                        void*               pContext)
+    {
+        ArchiveStats stats;
+        memset (&stats, 0, sizeof (stats));
+        if (query.iField >= TELEMETRY_REC_FIELDS) return stats;
+
+        for (DWORD iBlock = 0; iBlock < m_cBlocks; iBlock++)
+        {
+            const RecIndexEntry& entry = m_pIndex[iBlock];
+
+            if (query.idObject != ARCHIVE_ANY_OBJECT && entry.idObject != query.idObject) continue;
+            if (query.eKind != ARCHIVE_ANY_KIND && entry.eKind != query.eKind) continue;
+            if (entry.nTimeLast < query.nTimeFrom || entry.nTimeFirst > query.nTimeTo) continue;
+
+            stats.cBlocks++;
+            if (query.eOp == ARCHIVE_OP_ABOVE ? !(entry.dMax[query.iField] > query.dThreshold) : !(entry.dMin[query.iField] < query.dThreshold))
+            {
+                stats.cBlocksSkipped++;
+                continue;
+            }
+
+            // The index of a corrupt recording may point anywhere
+            if (entry.ibBlock > m_file.Size () || !IsRecBlockWhole (Block (entry), m_file.Size () - entry.ibBlock))
+            {
+                stats.cBlocksBad++;
+                continue;
+            }
+
+            const RecBlockHeader* pBlock = Block (entry);
+            DWORD                 cMatches;
+
+            DecodeRecField (pBlock, query.iField, m_values);
+            stats.cSamples  += pBlock->cSamples;
+            stats.cbColumns += pBlock->cbColumns[1 + query.iField];
+
+            if (query.eOp == ARCHIVE_OP_ABOVE)
+            {
+                cMatches = FilterAbove (m_values, pBlock->cSamples, query.dThreshold, m_iMatches);
+            }
+            else
+            {
+                cMatches = FilterBelow (m_values, pBlock->cSamples, query.dThreshold, m_iMatches);
+            }
+            if (cMatches == 0) continue;
+
+            DecodeRecTimes (pBlock, m_times);
+            stats.cbColumns += pBlock->cbColumns[0];
+
+            for (DWORD i = 0; i < cMatches; i++)
+            {
+                DWORD iSample = m_iMatches[i];
+                if (m_times[iSample] < query.nTimeFrom || m_times[iSample] > query.nTimeTo) continue;
+
+                stats.cMatches++;
+                if (pfnMatch != NULL) pfnMatch (&entry, iSample, m_times[iSample], m_values[iSample], pContext);
+            }
+        }
+        return stats;
+    }
+
+private:
+    CTelemetryArchive (const CTelemetryArchive&);
+    CTelemetryArchive& operator= (const CTelemetryArchive&);
+
+
+    CMappedFile                 m_file;
+    std::vector<RecIndexEntry>  m_built;        // For a recording without an index
+    const RecIndexEntry*        m_pIndex;
+    DWORD                       m_cBlocks;
+
+    // Of the block being scanned
+    double                      m_values[TELEMETRY_REC_BLOCK_SAMPLES];
+    int64_t                     m_times[TELEMETRY_REC_BLOCK_SAMPLES];
+    DWORD                       m_iMatches[TELEMETRY_REC_BLOCK_SAMPLES];
+};
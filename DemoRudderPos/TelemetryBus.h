@@ -0,0 +1,473 @@
+#pragma once
+
+#include <Windows.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+enum BUS_KIND
+{
+    BUS_KIND_USER_OBJECT = 1,
+    BUS_KIND_GROUND_VEHICLE,
+    BUS_KIND_SCAN,
+    BUS_KIND_RUDDER
+};
+
+/**
+ * One sample on the telemetry bus: where an object is, in the layout of DataUserObject, or a rudder position.
+ */
+typedef struct BusSample
+{
+    DWORD  eKind;           // BUS_KIND
+    DWORD  idObject;
+    double dSimTime;        // Seconds, as CFrameScheduler::SimTime
+    double dValues[4];      // Latitude, longitude, heading, altitude; just the rudder position for BUS_KIND_RUDDER
+}
+BusSample;
+
+
+/**
+ * A named block of memory shared between processes, created read-write by one of them and opened read-only by the
+ *  others. The name is local to the machine, and to the session on Windows.
+ */
+class CSharedMemory
+{
+public:
+    CSharedMemory () :
+        #ifdef _WIN32
+            m_hMapping (NULL),
+        #else
+            m_bOwner   (false),
+        #endif
+        m_pView    (NULL),
+        m_cbView   (0)
+    {
+    }
+
+    ~CSharedMemory ()
+    {
+        Close ();
+    }
+
+    /**
+     * Fails if there is a block of that name already. On Windows it goes with the last process that has it mapped;
+     *  on POSIX systems it outlives a process that crashed, until it is Unlinked.
+     */
+    bool Create (const char* szName,
+                 size_t      cb)
+    {
+        Close ();
+
+        #ifdef _WIN32
+            char szPath[MAX_PATH];
+            snprintf (szPath, sizeof (szPath), "Local\\%s", szName);
+
+            m_hMapping = CreateFileMappingA (INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)cb >> 32), (DWORD)cb, szPath);
+            if (m_hMapping == NULL) return false;
+            if (GetLastError () == ERROR_ALREADY_EXISTS)
+            {
+                Close ();
+                return false;
+            }
+
+            m_pView = MapViewOfFile (m_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, cb);
+        #else
+            snprintf (m_szPath, sizeof (m_szPath), "/%s", szName);
+
+            int fd = shm_open (m_szPath, O_CREAT | O_EXCL | O_RDWR, 0644);
+            if (fd < 0) return false;
+            m_bOwner = true;
+
+            if (ftruncate (fd, (off_t)cb) == 0)
+            {
+                m_pView = mmap (NULL, cb, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                if (m_pView == MAP_FAILED) m_pView = NULL;
+            }
+            close (fd);
+        #endif
+
+        if (m_pView == NULL)
+        {
+            Close ();
+            return false;
+        }
+        m_cbView = cb;
+        return true;
+    }
+
+    bool Open (const char* szName)
+    {
+        Close ();
+
+        #ifdef _WIN32
+            char szPath[MAX_PATH];
+            snprintf (szPath, sizeof (szPath), "Local\\%s", szName);
+
+            m_hMapping = OpenFileMappingA (FILE_MAP_READ, FALSE, szPath);
+            if (m_hMapping == NULL) return false;
+
+            MEMORY_BASIC_INFORMATION info;
+            m_pView = MapViewOfFile (m_hMapping, FILE_MAP_READ, 0, 0, 0);
+            if (m_pView != NULL && VirtualQuery (m_pView, &info, sizeof (info)) != 0) m_cbView = info.RegionSize;
+        #else
+            snprintf (m_szPath, sizeof (m_szPath), "/%s", szName);
+
+            int fd = shm_open (m_szPath, O_RDONLY, 0);
+            if (fd < 0) return false;
+
+            struct stat st;
+            if (fstat (fd, &st) == 0 && st.st_size > 0)
+            {
+                m_pView = mmap (NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                if (m_pView == MAP_FAILED) m_pView = NULL;
+                m_cbView = (size_t)st.st_size;
+            }
+            close (fd);
+        #endif
+
+        if (m_pView == NULL)
+        {
+            Close ();
+            return false;
+        }
+        return true;
+    }
+
+    void Close ()
+    {
+        #ifdef _WIN32
+            if (m_pView != NULL) UnmapViewOfFile (m_pView);
+            if (m_hMapping != NULL) CloseHandle (m_hMapping);
+            m_hMapping = NULL;
+        #else
+            if (m_pView != NULL) munmap (m_pView, m_cbView);
+            if (m_bOwner) shm_unlink (m_szPath);
+            m_bOwner = false;
+        #endif
+
+        m_pView  = NULL;
+        m_cbView = 0;
+    }
+
+    /**
+     * Remove the name of a block left behind, so that it can be created again. The block itself goes once the last
+     *  process that has it open closes it. Nothing to do on Windows.
+     */
+    static bool Unlink (const char* szName)
+    {
+        #ifdef _WIN32
+            return false;
+        #else
+            char szPath[256];
+            snprintf (szPath, sizeof (szPath), "/%s", szName);
+            return shm_unlink (szPath) == 0;
+        #endif
+    }
+
+    void* View () const
+    {
+        return m_pView;
+    }
+
+    size_t Size () const
+    {
+        return m_cbView;
+    }
+
+private:
+    CSharedMemory (const CSharedMemory&);
+    CSharedMemory& operator= (const CSharedMemory&);
+
+
+    #ifdef _WIN32
+        HANDLE  m_hMapping;
+    #else
+        char    m_szPath[256];
+        bool    m_bOwner;       // Unlinks the block on Close
+    #endif
+    void*       m_pView;
+    size_t      m_cbView;
+};
+
+
+/**
+ * The layout of the bus in shared memory: a BusHeader, then a ring of BusSlots.
+ *
+ * Sample n goes into slot n % cSlots. Each slot carries a sequence word, odd while the publisher is writing it and
+ *  2n + 2 once sample n is in it, and the header the sequence number of the next sample. A reader copies a slot
+ *  between two loads of its sequence word, and keeps the copy only if both were 2n + 2: anything else means the
+ *  sample is not written yet, or has been overwritten by one cSlots later because the reader fell that far behind.
+ *  The publisher never waits for readers, and readers never write to the bus.
+ */
+#define TELEMETRY_BUS_MAGIC         0x53554254      // "TBUS"
+#define TELEMETRY_BUS_VERSION       1
+
+typedef struct BusSlot
+{
+    std::atomic<uint64_t> nSeq;
+    BusSample             sample;
+    BYTE                  pad[8];       // To 64 bytes, a cache line
+}
+BusSlot;
+
+typedef struct BusHeader
+{
+    DWORD                 dwMagic;
+    DWORD                 dwVersion;
+    DWORD                 cSlots;       // A power of two
+    DWORD                 cbSlot;
+    DWORD                 dwOwner;      // Process ID of the publisher
+    alignas (64)
+    std::atomic<uint64_t> nHead;        // Sequence number of the next sample
+    alignas (64)
+    BusSlot               slots[1];
+}
+BusHeader;
+
+inline size_t BusSize (DWORD cSlots)
+{
+    return offsetof (BusHeader, slots) + cSlots * sizeof (BusSlot);
+}
+
+
+/**
+ * Publishes samples to the readers of a telemetry bus, in other processes or this one.
+ */
+class CTelemetryPublisher
+{
+public:
+    CTelemetryPublisher () :
+        m_pHeader (NULL),
+        m_nHead   (0)
+    {
+    }
+
+    /**
+     * Create the bus; cSlots is rounded up to a power of two. Returns false if the name is taken by a live publisher
+     *  or the memory could not be had. A bus left behind by a publisher that is gone is replaced.
+     */
+    bool Open (const char* szName,
+               DWORD       cSlots = 4096)
+    {
+        Close ();
+
+        DWORD cSlotsPow2 = 1;
+        while (cSlotsPow2 < cSlots) cSlotsPow2 <<= 1;
+
+        if (!m_memory.Create (szName, BusSize (cSlotsPow2)))
+        {
+            if (!IsStale (szName) || !CSharedMemory::Unlink (szName)) return false;
+            if (!m_memory.Create (szName, BusSize (cSlotsPow2))) return false;
+        }
+
+        // A new mapping reads as zeros, which is every slot empty
+        m_pHeader = (BusHeader*)m_memory.View ();
+        m_pHeader->cSlots    = cSlotsPow2;
+        m_pHeader->cbSlot    = sizeof (BusSlot);
+        m_pHeader->dwVersion = TELEMETRY_BUS_VERSION;
+        #ifdef _WIN32
+            m_pHeader->dwOwner = GetCurrentProcessId ();
+        #else
+            m_pHeader->dwOwner = (DWORD)getpid ();
+        #endif
+
+        // Last, so that a reader that sees the magic sees the rest
+        std::atomic_thread_fence (std::memory_order_release);
+        m_pHeader->dwMagic = TELEMETRY_BUS_MAGIC;
+
+        m_nHead = 0;
+        return true;
+    }
+
+    void Close ()
+    {
+        m_memory.Close ();
+        m_pHeader = NULL;
+    }
+
+    bool IsOpen () const
+    {
+        return m_pHeader != NULL;
+    }
+
+    /**
+     * Up to four values; those not given are zero. Does nothing while the bus is not open.
+     */
+    void Publish (BUS_KIND      eKind,
+                  DWORD         idObject,
+                  double        dSimTime,
+                  const double* pValues,
+                  DWORD         cValues)
+    {
+        if (m_pHeader == NULL) return;
+
+        BusSlot& slot = m_pHeader->slots[m_nHead & (m_pHeader->cSlots - 1)];
+
+        slot.nSeq.store (2 * m_nHead + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+
+        slot.sample.eKind    = eKind;
+        slot.sample.idObject = idObject;
+        slot.sample.dSimTime = dSimTime;
+        for (DWORD i = 0; i < 4; i++) slot.sample.dValues[i] = i < cValues ? pValues[i] : 0.0;
+
+        slot.nSeq.store (2 * m_nHead + 2, std::memory_order_release);
+        m_pHeader->nHead.store (++m_nHead, std::memory_order_release);
+    }
+
+    /**
+     * Samples published since the bus was opened.
+     */
+    uint64_t Count () const
+    {
+        return m_nHead;
+    }
+
+private:
+    /**
+     * Whether the bus of that name was left behind by a publisher that is no longer running. Only on POSIX systems,
+     *  and only once the bus is whole: one still being created by another process is not.
+     */
+    static bool IsStale (const char* szName)
+    {
+        #ifdef _WIN32
+            return false;
+        #else
+            CSharedMemory memory;
+            if (!memory.Open (szName)) return false;
+
+            const BusHeader* pHeader = (const BusHeader*)memory.View ();
+            if (memory.Size () < BusSize (1) || pHeader->dwMagic != TELEMETRY_BUS_MAGIC) return false;
+            std::atomic_thread_fence (std::memory_order_acquire);
+
+            return pHeader->dwOwner == 0 || (kill ((pid_t)pHeader->dwOwner, 0) != 0 && errno == ESRCH);
+        #endif
+    }
+
+
+    CSharedMemory   m_memory;
+    BusHeader*      m_pHeader;
+    uint64_t        m_nHead;        // Own copy; the publisher is the only writer
+};
+
+
+/**
+ * Reads a telemetry bus from the newest sample on, whatever the publisher is doing. A reader that falls more than the
+ *  ring behind loses the oldest samples, and is told how many.
+ */
+class CTelemetryReader
+{
+public:
+    enum READ
+    {
+        READ_OK,
+        READ_EMPTY,     // Nothing new yet
+        READ_LAGGED     // Samples were lost; the next read goes on from the oldest still there
+    };
+
+    CTelemetryReader () :
+        m_pHeader  (NULL),
+        m_nNext    (0),
+        m_cDropped (0)
+    {
+    }
+
+    /**
+     * Returns false if there is no such bus, e.g. while the publisher has not started.
+     */
+    bool Open (const char* szName)
+    {
+        Close ();
+        if (!m_memory.Open (szName)) return false;
+
+        const BusHeader* pHeader = (const BusHeader*)m_memory.View ();
+        if (m_memory.Size () < BusSize (1)
+            || pHeader->dwMagic != TELEMETRY_BUS_MAGIC
+            || pHeader->dwVersion != TELEMETRY_BUS_VERSION
+            || pHeader->cbSlot != sizeof (BusSlot)
+            || m_memory.Size () < BusSize (pHeader->cSlots))
+        {
+            m_memory.Close ();
+            return false;
+        }
+        std::atomic_thread_fence (std::memory_order_acquire);
+
+        m_pHeader  = pHeader;
+        m_nNext    = pHeader->nHead.load (std::memory_order_acquire);
+        m_cDropped = 0;
+        return true;
+    }
+
+    void Close ()
+    {
+        m_memory.Close ();
+        m_pHeader = NULL;
+    }
+
+    /**
+     * The next sample, if there is one.
+     */
+    READ Read (BusSample& sample)
+    {
+        if (m_pHeader == NULL) return READ_EMPTY;
+
+        const BusSlot& slot = m_pHeader->slots[m_nNext & (m_pHeader->cSlots - 1)];
+        uint64_t                  nSeq = 2 * m_nNext + 2;
+
+        uint64_t nBefore = slot.nSeq.load (std::memory_order_acquire);
+        if (nBefore < nSeq) return READ_EMPTY;
+
+        if (nBefore == nSeq)
+        {
+            memcpy (&sample, (const void*)&slot.sample, sizeof (sample));
+            std::atomic_thread_fence (std::memory_order_acquire);
+            if (slot.nSeq.load (std::memory_order_relaxed) == nSeq)
+            {
+                m_nNext++;
+                return READ_OK;
+            }
+        }
+
+        // Overwritten: skip to half a ring behind the publisher, leaving room to catch up before it laps again
+        uint64_t nHead = m_pHeader->nHead.load (std::memory_order_acquire);
+        uint64_t nNext = nHead - m_pHeader->cSlots / 2;
+
+        m_cDropped += nNext - m_nNext;
+        m_nNext     = nNext;
+        return READ_LAGGED;
+    }
+
+    /**
+     * Samples published that this reader has not read yet.
+     */
+    uint64_t Lag () const
+    {
+        return m_pHeader != NULL ? m_pHeader->nHead.load (std::memory_order_acquire) - m_nNext : 0;
+    }
+
+    /**
+     * Samples lost to falling behind, since Open.
+     */
+    uint64_t Dropped () const
+    {
+        return m_cDropped;
+    }
+
+private:
+    CSharedMemory       m_memory;
+    const BusHeader*    m_pHeader;
+    uint64_t            m_nNext;
+    uint64_t            m_cDropped;
+};
@@ -0,0 +1,778 @@
+#pragma once
+
+#include <Windows.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FlatHashMap.h"
+#include "TelemetryBus.h"
+
+
+/**
+ * Bits written most significant first, packed into bytes.
+ */
+class CBitWriter
+{
+public:
+    CBitWriter () :
+        m_nAcc  (0),
+        m_cUsed (0)
+    {
+    }
+
+    void Clear ()
+    {
+        m_bytes.clear ();
+        m_nAcc  = 0;
+        m_cUsed = 0;
+    }
+
+    /**
+     * The low cBits of nValue, 1 to 64 of them.
+     */
+    void Write (uint64_t nValue,
+                DWORD    cBits)
+    {
+        if (cBits < 64) nValue &= ((uint64_t)1 << cBits) - 1;
+
+        DWORD cFree = 64 - m_cUsed;
+        if (cBits < cFree)
+        {
+            m_nAcc  |= nValue << (cFree - cBits);
+            m_cUsed += cBits;
+            return;
+        }
+
+        // Fill the accumulator, spill it, and start the next one with what did not fit
+        DWORD cRest = cBits - cFree;
+        m_nAcc |= nValue >> cRest;
+        Spill (m_nAcc, 64);
+
+        m_nAcc  = cRest > 0 ? nValue << (64 - cRest) : 0;
+        m_cUsed = cRest;
+    }
+
+    /**
+     * Pad the last byte with zeros; Bytes is complete after this, and Write is not to be called again until Clear.
+     */
+    void Finish ()
+    {
+        Spill (m_nAcc, m_cUsed);
+        m_nAcc  = 0;
+        m_cUsed = 0;
+    }
+
+    const std::vector<BYTE>& Bytes () const
+    {
+        return m_bytes;
+    }
+
+    size_t BitCount () const
+    {
+        return m_bytes.size () * 8 + m_cUsed;
+    }
+
+private:
+    void Spill (uint64_t nAcc,
+                DWORD    cBits)
+    {
+        for (DWORD i = 0; i < cBits; i += 8) m_bytes.push_back ((BYTE)(nAcc >> (56 - i)));
+    }
+
+
+    std::vector<BYTE>   m_bytes;
+    uint64_t            m_nAcc;     // Bits not yet in m_bytes, from the top
+    DWORD               m_cUsed;
+};
+
+/**
+ * Reads what CBitWriter wrote. Reading past the end gives zeros.
+ */
+class CBitReader
+{
+public:
+    CBitReader (const BYTE* pData,
+                size_t      cbData) :
+        m_pData  (pData),
+        m_cbData (cbData),
+        m_iBit   (0)
+    {
+    }
+
+    /**
+     * The next cBits, 1 to 64 of them.
+     */
+    uint64_t Read (DWORD cBits)
+    {
+        if (cBits > 56)
+        {
+            uint64_t nHigh = Read (cBits - 32);
+            return (nHigh << 32) | Read (32);
+        }
+
+        // The 8 bytes from the one holding the next bit cover it and the 56 after it
+        size_t   ib    = m_iBit >> 3;
+        uint64_t nWord = 0;
+
+        if (ib + 8 <= m_cbData)
+        {
+            memcpy (&nWord, m_pData + ib, sizeof (nWord));
+#ifdef _MSC_VER
+            nWord = _byteswap_uint64 (nWord);
+#else
+            nWord = __builtin_bswap64 (nWord);
+#endif
+        }
+        else
+        {
+            for (size_t i = 0; i < 8; i++) nWord = (nWord << 8) | (ib + i < m_cbData ? m_pData[ib + i] : 0);
+        }
+
+        uint64_t nValue = (nWord << (m_iBit & 7)) >> (64 - cBits);
+        m_iBit += cBits;
+        return nValue;
+    }
+
+    bool ReadBit ()
+    {
+        return Read (1) != 0;
+    }
+
+private:
+    const BYTE* m_pData;
+    size_t      m_cbData;
+    size_t      m_iBit;
+};
+
+
+/**
+ * Gorilla-style compression of a series: timestamps as deltas of deltas in variable-length buckets, and each value
+ *  as the XOR with the one before it, stored as a single 0 bit when unchanged and otherwise as just its meaningful
+ *  bits, reusing the previous window of leading and trailing zeros when they fit in it. Slowly moving telemetry,
+ *  sampled at a steady frame rate, comes down to a few bits per field.
+ */
+namespace Gorilla
+{
+    // Of a non-zero n
+    inline DWORD LeadingZeros (uint64_t n)
+    {
+#ifdef _MSC_VER
+        unsigned long iBit;
+        _BitScanReverse64 (&iBit, n);
+        return 63 - iBit;
+#else
+        return (DWORD)__builtin_clzll (n);
+#endif
+    }
+
+    inline DWORD TrailingZeros (uint64_t n)
+    {
+#ifdef _MSC_VER
+        unsigned long iBit;
+        _BitScanForward64 (&iBit, n);
+        return iBit;
+#else
+        return (DWORD)__builtin_ctzll (n);
+#endif
+    }
+
+    inline uint64_t Bits (double d)
+    {
+        uint64_t n;
+        memcpy (&n, &d, sizeof (n));
+        return n;
+    }
+
+    inline double Double (uint64_t n)
+    {
+        double d;
+        memcpy (&d, &n, sizeof (d));
+        return d;
+    }
+
+    inline int64_t SignExtend (uint64_t n,
+                               DWORD    cBits)
+    {
+        return (int64_t)(n << (64 - cBits)) >> (64 - cBits);
+    }
+
+    /**
+     * '0' for no change in the delta, then '10', '110', '1110' and '11110' for one that fits in 7, 9, 12 and 32
+     *  bits, and '11111' for anything else, in 64.
+     */
+    inline void WriteDeltaOfDelta (CBitWriter& writer,
+                                   int64_t     nDod)
+    {
+        if (nDod == 0)
+        {
+            writer.Write (0, 1);
+        }
+        else if (nDod >= -64 && nDod < 64)
+        {
+            writer.Write (0x2, 2);
+            writer.Write ((uint64_t)nDod, 7);
+        }
+        else if (nDod >= -256 && nDod < 256)
+        {
+            writer.Write (0x6, 3);
+            writer.Write ((uint64_t)nDod, 9);
+        }
+        else if (nDod >= -2048 && nDod < 2048)
+        {
+            writer.Write (0xE, 4);
+            writer.Write ((uint64_t)nDod, 12);
+        }
+        else if (nDod >= INT32_MIN && nDod <= INT32_MAX)
+        {
+            writer.Write (0x1E, 5);
+            writer.Write ((uint64_t)nDod, 32);
+        }
+        else
+        {
+            writer.Write (0x1F, 5);
+            writer.Write ((uint64_t)nDod, 64);
+        }
+    }
+
+    inline int64_t ReadDeltaOfDelta (CBitReader& reader)
+    {
+        static const DWORD s_cBits[] = { 7, 9, 12, 32, 64 };
+
+        DWORD cOnes = 0;
+        while (cOnes < 5 && reader.ReadBit ()) cOnes++;
+
+        if (cOnes == 0) return 0;
+        return SignExtend (reader.Read (s_cBits[cOnes - 1]), s_cBits[cOnes - 1]);
+    }
+
+    typedef struct XorState
+    {
+        uint64_t nPrev;
+        DWORD    cLeading;      // Of the current window; 64 before there is one
+        DWORD    cTrailing;
+    }
+    XorState;
+
+    inline void InitXor (XorState& state)
+    {
+        state.nPrev     = 0;
+        state.cLeading  = 64;
+        state.cTrailing = 0;
+    }
+
+    /**
+     * '0' for the same value; '10' and the bits of the window; '11', 5 bits of leading zeros, 6 bits of length less
+     *  one and the meaningful bits, which become the window.
+     */
+    inline void WriteXor (CBitWriter& writer,
+                          XorState&   state,
+                          uint64_t    nValue)
+    {
+        uint64_t nXor = nValue ^ state.nPrev;
+        state.nPrev = nValue;
+
+        if (nXor == 0)
+        {
+            writer.Write (0, 1);
+            return;
+        }
+
+        DWORD cLeading  = std::min (LeadingZeros (nXor), (DWORD)31);
+        DWORD cTrailing = TrailingZeros (nXor);
+
+        if (state.cLeading != 64 && cLeading >= state.cLeading && cTrailing >= state.cTrailing)
+        {
+            writer.Write (0x2, 2);
+            writer.Write (nXor >> state.cTrailing, 64 - state.cLeading - state.cTrailing);
+            return;
+        }
+
+        DWORD cMeaningful = 64 - cLeading - cTrailing;
+        writer.Write (0x3, 2);
+        writer.Write (cLeading, 5);
+        writer.Write (cMeaningful - 1, 6);
+        writer.Write (nXor >> cTrailing, cMeaningful);
+
+        state.cLeading  = cLeading;
+        state.cTrailing = cTrailing;
+    }
+
+    inline uint64_t ReadXor (CBitReader& reader,
+                             XorState&   state)
+    {
+        if (!reader.ReadBit ()) return state.nPrev;
+
+        if (reader.ReadBit ())
+        {
+            state.cLeading  = (DWORD)reader.Read (5);
+            state.cTrailing = 64 - state.cLeading - ((DWORD)reader.Read (6) + 1);
+        }
+
+        state.nPrev ^= reader.Read (64 - state.cLeading - state.cTrailing) << state.cTrailing;
+        return state.nPrev;
+    }
+}
+
+
+#define TELEMETRY_REC_MAGIC         0x43455254      // "TREC"
+#define TELEMETRY_REC_BLOCK_MAGIC   0x4B4C4254      // "TBLK"
+#define TELEMETRY_REC_INDEX_MAGIC   0x58444954      // "TIDX"
+#define TELEMETRY_REC_VERSION       1
+#define TELEMETRY_REC_FIELDS        4               // As in BusSample
+#define TELEMETRY_REC_BLOCK_SAMPLES 1024
+
+/**
+ * A recording is a RecFileHeader followed by blocks, each a RecBlockHeader and its columns back to back: the times,
+ *  in microseconds of sim time, then each field. Every block holds up to TELEMETRY_REC_BLOCK_SAMPLES samples of one
+ *  object and kind, and decodes on its own. The header keeps the range of each field in the block, its zone map.
+ *  Blocks are padded to 8 bytes, so that a mapped recording can be read in place.
+ */
+typedef struct RecFileHeader
+{
+    DWORD dwMagic;
+    DWORD dwVersion;
+    DWORD cFields;
+    DWORD cBlockSamples;
+}
+RecFileHeader;
+
+typedef struct RecBlockHeader
+{
+    DWORD   dwMagic;
+    DWORD   cbBlock;                            // Header and columns, padded to 8 bytes
+    DWORD   idObject;
+    DWORD   eKind;                              // BUS_KIND
+    DWORD   cSamples;
+    DWORD   cbColumns[1 + TELEMETRY_REC_FIELDS];
+    int64_t nTimeFirst;
+    int64_t nTimeLast;
+    double  dMin[TELEMETRY_REC_FIELDS];         // For skipping blocks without decoding them
+    double  dMax[TELEMETRY_REC_FIELDS];
+}
+RecBlockHeader;
+
+/**
+ * A recording closed properly ends in an index of its blocks, with their zone maps, and a RecTrailer saying where the
+ *  index is, so that a reader can pick the blocks it needs without visiting every block header. One cut short has
+ *  neither, and its blocks are found by walking the headers.
+ */
+typedef struct RecIndexEntry
+{
+    uint64_t ibBlock;
+    DWORD    idObject;
+    DWORD    eKind;
+    DWORD    cSamples;
+    DWORD    dwReserved;
+    int64_t  nTimeFirst;
+    int64_t  nTimeLast;
+    double   dMin[TELEMETRY_REC_FIELDS];
+    double   dMax[TELEMETRY_REC_FIELDS];
+}
+RecIndexEntry;
+
+typedef struct RecTrailer
+{
+    uint64_t ibIndex;
+    DWORD    cBlocks;
+    DWORD    dwMagic;       // TELEMETRY_REC_INDEX_MAGIC, last in the file
+}
+RecTrailer;
+
+inline void IndexRecBlock (const RecBlockHeader* pHeader,
+                           uint64_t              ibBlock,
+                           RecIndexEntry&        entry)
+{
+    entry.ibBlock    = ibBlock;
+    entry.idObject   = pHeader->idObject;
+    entry.eKind      = pHeader->eKind;
+    entry.cSamples   = pHeader->cSamples;
+    entry.dwReserved = 0;
+    entry.nTimeFirst = pHeader->nTimeFirst;
+    entry.nTimeLast  = pHeader->nTimeLast;
+    memcpy (entry.dMin, pHeader->dMin, sizeof (entry.dMin));
+    memcpy (entry.dMax, pHeader->dMax, sizeof (entry.dMax));
+}
+
+/**
+ * Whether the block is whole within the cbAvailable bytes from its start: its header, and the columns its header says
+ *  it has, within its cbBlock. One cut short or corrupt is not decoded, as that would read past its end.
+ */
+inline bool IsRecBlockWhole (const RecBlockHeader* pHeader,
+                             uint64_t              cbAvailable)
+{
+    if (cbAvailable < sizeof (RecBlockHeader)) return false;
+    if (pHeader->dwMagic != TELEMETRY_REC_BLOCK_MAGIC || pHeader->cSamples > TELEMETRY_REC_BLOCK_SAMPLES) return false;
+    if (pHeader->cbBlock < sizeof (RecBlockHeader) || pHeader->cbBlock > cbAvailable) return false;
+
+    uint64_t cbColumns = 0;
+    for (DWORD i = 0; i < 1 + TELEMETRY_REC_FIELDS; i++) cbColumns += pHeader->cbColumns[i];
+    return sizeof (RecBlockHeader) + cbColumns <= pHeader->cbBlock;
+}
+
+/**
+ * Decode the time column of a block, cSamples times in microseconds.
+ */
+inline void DecodeRecTimes (const RecBlockHeader* pHeader,
+                            int64_t*              pTimes)
+{
+    CBitReader times ((const BYTE*)(pHeader + 1), pHeader->cbColumns[0]);
+    int64_t    nTime  = 0;
+    int64_t    nDelta = 0;
+
+    for (DWORD i = 0; i < pHeader->cSamples; i++)
+    {
+        if (i == 0)
+        {
+            nTime = (int64_t)times.Read (64);
+        }
+        else
+        {
+            nDelta += Gorilla::ReadDeltaOfDelta (times);
+            nTime  += nDelta;
+        }
+        pTimes[i] = nTime;
+    }
+}
+
+/**
+ * Decode the column of one field of a block, cSamples values, without touching the others.
+ */
+inline void DecodeRecField (const RecBlockHeader* pHeader,
+                            DWORD                 iField,
+                            double*               pValues)
+{
+    const BYTE* pColumn = (const BYTE*)(pHeader + 1);
+    for (DWORD i = 0; i <= iField; i++) pColumn += pHeader->cbColumns[i];
+
+    CBitReader        values (pColumn, pHeader->cbColumns[1 + iField]);
+    Gorilla::XorState state;
+    Gorilla::InitXor (state);
+
+    for (DWORD i = 0; i < pHeader->cSamples; i++) pValues[i] = Gorilla::Double (Gorilla::ReadXor (values, state));
+}
+
+/**
+ * Decode all the columns of a block.
+ */
+inline void DecodeRecBlock (const RecBlockHeader* pHeader,
+                            int64_t*              pTimes,
+                            double*               pFields[TELEMETRY_REC_FIELDS])
+{
+    DecodeRecTimes (pHeader, pTimes);
+    for (DWORD iField = 0; iField < TELEMETRY_REC_FIELDS; iField++) DecodeRecField (pHeader, iField, pFields[iField]);
+}
+
+/**
+ * Records telemetry to a file in compressed columns, e.g. every sample the demo publishes, for hours on end.
+ *
+ * Each object and kind of sample is a series of its own, encoded as it comes in (see Gorilla) into a block of
+ *  columns. A full block is handed to a background thread, which writes it out, so the caller never waits on the
+ *  disk; the next block starts afresh, so that any block can be decoded without the ones before it.
+ */
+class CTelemetryRecorder
+{
+public:
+    CTelemetryRecorder () :
+        m_pFile     (NULL),
+        m_cSamples  (0),
+        m_bStop     (false),
+        m_cbWritten (0)
+    {
+        m_objects.Reserve (256);
+    }
+
+    ~CTelemetryRecorder ()
+    {
+        Close ();
+    }
+
+    /**
+     * Start a new recording at szPath. Returns false if the file could not be created.
+     */
+    bool Open (const char* szPath)
+    {
+        Close ();
+
+        m_pFile = fopen (szPath, "wb");
+        if (m_pFile == NULL) return false;
+
+        RecFileHeader header;
+        header.dwMagic       = TELEMETRY_REC_MAGIC;
+        header.dwVersion     = TELEMETRY_REC_VERSION;
+        header.cFields       = TELEMETRY_REC_FIELDS;
+        header.cBlockSamples = TELEMETRY_REC_BLOCK_SAMPLES;
+        fwrite (&header, sizeof (header), 1, m_pFile);
+
+        m_cSamples  = 0;
+        m_cbWritten = sizeof (header);
+        m_bStop     = false;
+        m_thread    = std::thread (&CTelemetryRecorder::WriteProc, this);
+        return true;
+    }
+
+    /**
+     * Write out what has been recorded, the partly filled blocks included, and the index, and close the file.
+     */
+    void Close ()
+    {
+        if (m_pFile == NULL) return;
+
+        for (uint32_t iSlot = 0; iSlot < m_objects.Capacity (); iSlot++)
+        {
+            if (!m_objects.IsUsed (iSlot)) continue;
+
+            for (Series* pSeries : m_objects.ValueAt (iSlot).pSeries)
+            {
+                if (pSeries != NULL && pSeries->cSamples > 0) Seal (*pSeries);
+                delete pSeries;
+            }
+        }
+        m_objects.Clear ();
+
+        {
+            std::lock_guard<std::mutex> lock (m_mutex);
+            m_bStop = true;
+        }
+        m_wake.notify_one ();
+        m_thread.join ();
+
+        fclose (m_pFile);
+        m_pFile = NULL;
+    }
+
+    bool IsOpen () const
+    {
+        return m_pFile != NULL;
+    }
+
+    /**
+     * Up to TELEMETRY_REC_FIELDS values; those not given are zero. Does nothing while no recording is open.
+     */
+    void Record (BUS_KIND      eKind,
+                 DWORD         idObject,
+                 double        dSimTime,
+                 const double* pValues,
+                 DWORD         cValues)
+    {
+        if (m_pFile == NULL) return;
+
+        Series& series = FindSeries (eKind, idObject);
+        int64_t nTime  = (int64_t)floor (dSimTime * 1e6 + 0.5);
+
+        if (series.cSamples == 0)
+        {
+            series.columns[0].Write ((uint64_t)nTime, 64);
+            series.nTimeFirst = nTime;
+            series.nDelta     = 0;
+        }
+        else
+        {
+            int64_t nDelta = nTime - series.nTimeLast;
+            Gorilla::WriteDeltaOfDelta (series.columns[0], nDelta - series.nDelta);
+            series.nDelta = nDelta;
+        }
+        series.nTimeLast = nTime;
+
+        for (DWORD i = 0; i < TELEMETRY_REC_FIELDS; i++)
+        {
+            double dValue = i < cValues ? pValues[i] : 0.0;
+
+            Gorilla::WriteXor (series.columns[1 + i], series.xors[i], Gorilla::Bits (dValue));
+            series.dMin[i] = std::min (series.dMin[i], dValue);
+            series.dMax[i] = std::max (series.dMax[i], dValue);
+        }
+
+        m_cSamples++;
+        if (++series.cSamples == TELEMETRY_REC_BLOCK_SAMPLES) Seal (series);
+    }
+
+    void Record (const BusSample& sample)
+    {
+        Record ((BUS_KIND)sample.eKind, sample.idObject, sample.dSimTime, sample.dValues, TELEMETRY_REC_FIELDS);
+    }
+
+    /**
+     * Samples recorded, and bytes written to the file so far; the blocks not yet full are not in the file yet.
+     */
+    uint64_t SampleCount () const
+    {
+        return m_cSamples;
+    }
+
+    uint64_t BytesWritten () const
+    {
+        return m_cbWritten;
+    }
+
+private:
+    typedef struct Series
+    {
+        DWORD               idObject;
+        BUS_KIND            eKind;
+        DWORD               cSamples;
+        int64_t             nTimeFirst;
+        int64_t             nTimeLast;
+        int64_t             nDelta;
+        CBitWriter          columns[1 + TELEMETRY_REC_FIELDS];
+        Gorilla::XorState   xors[TELEMETRY_REC_FIELDS];
+        double              dMin[TELEMETRY_REC_FIELDS];
+        double              dMax[TELEMETRY_REC_FIELDS];
+    }
+    Series;
+
+    // The series of an object, by kind
+    typedef struct ObjectSeries
+    {
+        Series* pSeries[BUS_KIND_RUDDER + 1];
+    }
+    ObjectSeries;
+
+
+    Series& FindSeries (BUS_KIND eKind,
+                        DWORD    idObject)
+    {
+        bool          bInserted;
+        ObjectSeries& object  = m_objects.Insert (idObject, &bInserted);
+        Series*&      pSeries = object.pSeries[(DWORD)eKind <= BUS_KIND_RUDDER ? eKind : 0];
+
+        if (bInserted) memset (&object, 0, sizeof (object));
+        if (pSeries == NULL)
+        {
+            pSeries = new Series ();
+            pSeries->idObject = idObject;
+            pSeries->eKind    = eKind;
+            StartBlock (*pSeries);
+        }
+        return *pSeries;
+    }
+
+    void StartBlock (Series& series)
+    {
+        series.cSamples = 0;
+        for (DWORD i = 0; i < 1 + TELEMETRY_REC_FIELDS; i++) series.columns[i].Clear ();
+        for (DWORD i = 0; i < TELEMETRY_REC_FIELDS; i++)
+        {
+            Gorilla::InitXor (series.xors[i]);
+            series.dMin[i] = HUGE_VAL;
+            series.dMax[i] = -HUGE_VAL;
+        }
+    }
+
+    /**
+     * Hand the block of a series to the writer thread and start the next one.
+     */
+    void Seal (Series& series)
+    {
+        RecBlockHeader header;
+        memset (&header, 0, sizeof (header));
+        header.dwMagic    = TELEMETRY_REC_BLOCK_MAGIC;
+        header.cbBlock    = sizeof (header);
+        header.idObject   = series.idObject;
+        header.eKind      = series.eKind;
+        header.cSamples   = series.cSamples;
+        header.nTimeFirst = series.nTimeFirst;
+        header.nTimeLast  = series.nTimeLast;
+
+        for (DWORD i = 0; i < 1 + TELEMETRY_REC_FIELDS; i++)
+        {
+            series.columns[i].Finish ();
+            header.cbColumns[i] = (DWORD)series.columns[i].Bytes ().size ();
+            header.cbBlock     += header.cbColumns[i];
+        }
+        header.cbBlock = (header.cbBlock + 7) & ~7;
+        for (DWORD i = 0; i < TELEMETRY_REC_FIELDS; i++)
+        {
+            header.dMin[i] = series.dMin[i];
+            header.dMax[i] = series.dMax[i];
+        }
+
+        std::vector<BYTE> block;
+        {
+            std::lock_guard<std::mutex> lock (m_mutex);
+            if (!m_free.empty ())
+            {
+                block.swap (m_free.back ());
+                m_free.pop_back ();
+            }
+        }
+
+        block.assign ((const BYTE*)&header, (const BYTE*)&header + sizeof (header));
+        for (DWORD i = 0; i < 1 + TELEMETRY_REC_FIELDS; i++)
+        {
+            block.insert (block.end (), series.columns[i].Bytes ().begin (), series.columns[i].Bytes ().end ());
+        }
+        block.resize (header.cbBlock);
+
+        {
+            std::lock_guard<std::mutex> lock (m_mutex);
+            m_full.push_back (std::vector<BYTE> ());
+            m_full.back ().swap (block);
+        }
+        m_wake.notify_one ();
+
+        StartBlock (series);
+    }
+
+    /**
+     * The background thread: writes full blocks as they come, until told to stop and there are none left.
+     */
+    void WriteProc ()
+    {
+        std::unique_lock<std::mutex> lock (m_mutex);
+
+        for (;;)
+        {
+            m_wake.wait (lock, [this] () { return m_bStop || !m_full.empty (); });
+            if (m_full.empty ()) break;
+
+            std::vector<BYTE> block;
+            block.swap (m_full.front ());
+            m_full.pop_front ();
+
+            lock.unlock ();
+            m_index.push_back (RecIndexEntry ());
+            IndexRecBlock ((const RecBlockHeader*)block.data (), m_cbWritten, m_index.back ());
+
+            fwrite (block.data (), 1, block.size (), m_pFile);
+            m_cbWritten += block.size ();
+            lock.lock ();
+
+            // Keep a few buffers for the blocks to come
+            if (m_free.size () < 8) m_free.push_back (std::vector<BYTE> ());
+            if (m_free.size () <= 8) m_free.back ().swap (block);
+        }
+
+        RecTrailer trailer;
+        trailer.ibIndex = m_cbWritten;
+        trailer.cBlocks = (DWORD)m_index.size ();
+        trailer.dwMagic = TELEMETRY_REC_INDEX_MAGIC;
+
+        fwrite (m_index.data (), sizeof (RecIndexEntry), m_index.size (), m_pFile);
+        fwrite (&trailer, sizeof (trailer), 1, m_pFile);
+        m_cbWritten += m_index.size () * sizeof (RecIndexEntry) + sizeof (trailer);
+        m_index.clear ();
+        fflush (m_pFile);
+    }
+
+    FILE*                           m_pFile;
+    CFlatHashMap<ObjectSeries>      m_objects;
+    uint64_t                        m_cSamples;
+
+    std::thread                     m_thread;
+    std::mutex                      m_mutex;            // Guards the rest
+    std::condition_variable         m_wake;
+    std::deque<std::vector<BYTE>>   m_full;
+    std::vector<std::vector<BYTE>>  m_free;
+    bool                            m_bStop;
+    std::atomic<uint64_t>           m_cbWritten;        // Only by the thread
+    std::vector<RecIndexEntry>      m_index;            // Of the blocks written, for the thread
+};
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <Windows.h>
+#include <stdint.h>
+#include <vector>
+
+
+/**
+ * Hierarchical timer wheel for one-shot and periodic timers, in integer ticks of whatever unit the owner advances
+ *  it by.
+ *
+ * Four wheels of 256 slots each cover 2^8, 2^16, 2^24 and 2^32 ticks ahead. A timer goes into the slot of the
+ *  finest wheel that reaches its expiry, and every 256 ticks the next slot of the wheel above is emptied into the
+ *  finer ones, so each timer is touched at most once per wheel on its way down. Scheduling and cancelling only link
+ *  or unlink a node, and each tick fires its whole slot as one batch.
+ *
+ * Nodes live in one array and link to each other by index, with the slot heads as sentinel nodes at the start of
+ *  it, so a node can be unlinked without knowing which slot it is in. Freed nodes are reused; the timer ID carries
+ *  a generation, so cancelling a timer that has already fired is harmless.
+ */
+class CTimerWheel
+{
+public:
+    /**
+     * Called when a timer fires. A periodic timer has already been rescheduled, and can be cancelled from here.
+     */
+    typedef void (CALLBACK* TimerProc) (uint64_t idTimer,
+                                        void*    pContext);
+
+    CTimerWheel () :
+        m_nNow    (0),
+        m_cTimers (0),
+        m_iFree   (NONE)
+    {
+        m_nodes.resize (HEAD_FIRING + 1);
+        for (uint32_t i = 0; i <= HEAD_FIRING; i++)
+        {
+            m_nodes[i].iPrev = i;
+            m_nodes[i].iNext = i;
+        }
+    }
+
+    void Reserve (uint32_t cTimers)
+    {
+        m_nodes.reserve (HEAD_FIRING + 1 + cTimers);
+    }
+
+    /**
+     * Fire pfnTimer nDelay ticks from now (at the next tick for 0), then every nPeriod ticks if that is not 0.
+     *  Returns the timer ID.
+     */
+    uint64_t Schedule (uint64_t  nDelay,
+                       uint32_t  nPeriod,
+                       TimerProc pfnTimer,
+                       void*     pContext)
+    {
+        uint32_t i    = AllocNode ();
+        Node&    node = m_nodes[i];
+
+        node.nExpiry  = m_nNow + (nDelay > 0 ? nDelay : 1);
+        node.nPeriod  = nPeriod;
+        node.pfnTimer = pfnTimer;
+        node.pContext = pContext;
+        node.bLive    = true;
+        m_cTimers++;
+
+        Link (i);
+        return ((uint64_t)node.nGeneration << 32) | i;
+    }
+
+    /**
+     * Returns false if the timer has already fired (and was not periodic) or been cancelled.
+     */
+    bool Cancel (uint64_t idTimer)
+    {
+        uint32_t i = (uint32_t)idTimer;
+        if (i <= HEAD_FIRING || i >= m_nodes.size ()) return false;
+
+        Node& node = m_nodes[i];
+        if (!node.bLive || node.nGeneration != (uint32_t)(idTimer >> 32)) return false;
+
+        Unlink (i);
+        FreeNode (i);
+        m_cTimers--;
+        return true;
+    }
+
+    /**
+     * Move time forward to nTick, firing every timer that expires on the way, in order of expiry.
+     */
+    void AdvanceTo (uint64_t nTick)
+    {
+        while (m_nNow < nTick)
+        {
+            // Nothing to fire or cascade on the way
+            if (m_cTimers == 0)
+            {
+                m_nNow = nTick;
+                break;
+            }
+
+            m_nNow++;
+
+            // Every 256 ticks, bring the timers of the next slot of each coarser wheel down
+            for (uint32_t iWheel = 1; iWheel < WHEELS; iWheel++)
+            {
+                if ((m_nNow & ((1ull << (SLOT_BITS * iWheel)) - 1)) != 0) break;
+                Cascade (iWheel, (uint32_t)(m_nNow >> (SLOT_BITS * iWheel)) & SLOT_MASK);
+            }
+
+            Fire ((uint32_t)m_nNow & SLOT_MASK);
+        }
+    }
+
+    uint64_t Now () const
+    {
+        return m_nNow;
+    }
+
+    /**
+     * Timers scheduled and not yet fired or cancelled; periodic timers count until cancelled.
+     */
+    uint32_t Count () const
+    {
+        return m_cTimers;
+    }
+
+private:
+    static const uint32_t WHEELS      = 4;
+    static const uint32_t SLOT_BITS   = 8;
+    static const uint32_t SLOTS       = 1 << SLOT_BITS;
+    static const uint32_t SLOT_MASK   = SLOTS - 1;
+    static const uint32_t HEAD_FIRING = WHEELS * SLOTS;     // Sentinel of the batch being fired
+    static const uint32_t NONE        = (uint32_t)-1;
+
+    typedef struct Node
+    {
+        Node () :
+            iPrev       (0),
+            iNext       (0),
+            nExpiry     (0),
+            nPeriod     (0),
+            nGeneration (0),
+            bLive       (false),
+            pfnTimer    (NULL),
+            pContext    (NULL)
+        {
+        }
+
+        uint32_t  iPrev;
+        uint32_t  iNext;        // Also the next free node
+        uint64_t  nExpiry;
+        uint32_t  nPeriod;
+        uint32_t  nGeneration;
+        bool      bLive;
+        TimerProc pfnTimer;
+        void*     pContext;
+    }
+    Node;
+
+    uint32_t AllocNode ()
+    {
+        if (m_iFree == NONE)
+        {
+            m_nodes.push_back (Node ());
+            return (uint32_t)m_nodes.size () - 1;
+        }
+
+        uint32_t i = m_iFree;
+        m_iFree = m_nodes[i].iNext;
+        return i;
+    }
+
+    void FreeNode (uint32_t i)
+    {
+        m_nodes[i].bLive = false;
+        m_nodes[i].nGeneration++;
+        m_nodes[i].iNext = m_iFree;
+        m_iFree          = i;
+    }
+
+    /**
+     * Link a node into the slot of the finest wheel that reaches its expiry.
+     */
+    void Link (uint32_t i)
+    {
+        uint64_t nDelta = m_nodes[i].nExpiry - m_nNow;
+        uint32_t iWheel = 0;
+
+        while (iWheel < WHEELS - 1 && nDelta >= (1ull << (SLOT_BITS * (iWheel + 1)))) iWheel++;
+
+        // Beyond the coarsest wheel, park in its furthest slot and go round again from there
+        uint64_t nAt = m_nodes[i].nExpiry;
+        if (nDelta >= (1ull << (SLOT_BITS * WHEELS))) nAt = m_nNow + ((uint64_t)SLOT_MASK << (SLOT_BITS * (WHEELS - 1)));
+
+        Append (iWheel * SLOTS + ((uint32_t)(nAt >> (SLOT_BITS * iWheel)) & SLOT_MASK), i);
+    }
+
+    void Append (uint32_t iHead,
+                 uint32_t i)
+    {
+        uint32_t iTail = m_nodes[iHead].iPrev;
+
+        m_nodes[i].iPrev     = iTail;
+        m_nodes[i].iNext     = iHead;
+        m_nodes[iTail].iNext = i;
+        m_nodes[iHead].iPrev = i;
+    }
+
+    void Unlink (uint32_t i)
+    {
+        m_nodes[m_nodes[i].iPrev].iNext = m_nodes[i].iNext;
+        m_nodes[m_nodes[i].iNext].iPrev = m_nodes[i].iPrev;
+    }
+
+    /**
+     * Move the whole list of a slot onto the sentinel iTo, which must be empty.
+     */
+    void Splice (uint32_t iFrom,
+                 uint32_t iTo)
+    {
+        if (m_nodes[iFrom].iNext == iFrom) return;
+
+        m_nodes[iTo].iNext                = m_nodes[iFrom].iNext;
+        m_nodes[iTo].iPrev                = m_nodes[iFrom].iPrev;
+        m_nodes[m_nodes[iTo].iNext].iPrev = iTo;
+        m_nodes[m_nodes[iTo].iPrev].iNext = iTo;
+        m_nodes[iFrom].iNext              = iFrom;
+        m_nodes[iFrom].iPrev              = iFrom;
+    }
+
+    void Cascade (uint32_t iWheel,
+                  uint32_t iSlot)
+    {
+        // Detach the slot first, since a timer can land in the same slot again a full turn later
+        Splice (iWheel * SLOTS + iSlot, HEAD_FIRING);
+
+        while (m_nodes[HEAD_FIRING].iNext != HEAD_FIRING)
+        {
+            uint32_t i = m_nodes[HEAD_FIRING].iNext;
+            Unlink (i);
+            Link (i);
+        }
+    }
+
+    void Fire (uint32_t iSlot)
+    {
+        // The batch is detached so that timers scheduled by the callbacks go to the wheels, and timers cancelled by
+        //  them simply leave the batch
+        Splice (iSlot, HEAD_FIRING);
+
+        while (m_nodes[HEAD_FIRING].iNext != HEAD_FIRING)
+        {
+            uint32_t  i        = m_nodes[HEAD_FIRING].iNext;
+            Node&     node     = m_nodes[i];
+            TimerProc pfnTimer = node.pfnTimer;
+            void*     pContext = node.pContext;
+            uint64_t  idTimer  = ((uint64_t)node.nGeneration << 32) | i;
+
+            Unlink (i);
+
+            if (node.nPeriod > 0)
+            {
+                node.nExpiry = m_nNow + node.nPeriod;
+                Link (i);
+            }
+            else
+            {
+                FreeNode (i);
+                m_cTimers--;
+            }
+
+            // May schedule timers, which can move m_nodes
+            pfnTimer (idTimer, pContext);
+        }
+    }
+
+
+    uint64_t            m_nNow;
+    uint32_t            m_cTimers;
+    uint32_t            m_iFree;
+    std::vector<Node>   m_nodes;    // Slot heads, the firing head, then the timers
+};
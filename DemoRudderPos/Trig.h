@@ -0,0 +1,148 @@
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+
+/**
+ * Trig for CGeodesy::TranslateBatch, which takes a TRIG_MODE to pick the implementation at runtime and is templated
+ *  on one of the classes below inside. The steering kernel of CPathFollower has a single sin/cos pair per vehicle
+ *  and gains nothing measurable from it, so it always calls the C library.
+ *
+ * TRIG_MODE_LIBM calls the C library, and is the default. TRIG_MODE_POLY evaluates minimax polynomials (fitted with
+ *  the Remez algorithm) instead: no calls and no tables, only multiply-adds and a sqrt.
+ *  Maximum errors, as angles in radians:
+ *
+ *      Sin, Cos  6e-12 for |x| up to a few turns; the reduction to [-pi/4, pi/4] adds less than 1e-16 per turn
+ *      Asin      8e-13 on [-0.5, 0.5], 2e-12 outside it; arguments just outside [-1, 1] from rounding are clamped
+ *
+ *  An angle of 6e-12 rad is 0.00013 ft on the ground. How much of that a kernel passes on depends on the kernel;
+ *  each one documents its error in feet, and DemoRudderPosBench has the tables by latitude.
+ */
+enum TRIG_MODE
+{
+    TRIG_MODE_LIBM,
+    TRIG_MODE_POLY
+};
+
+
+class CLibmTrig
+{
+public:
+    static double Sin (double dRad)
+    {
+        return sin (dRad);
+    }
+
+    static double Cos (double dRad)
+    {
+        return cos (dRad);
+    }
+
+    static void SinCos (double  dRad,
+                        double& dSin,
+                        double& dCos)
+    {
+        dSin = sin (dRad);
+        dCos = cos (dRad);
+    }
+
+    static double Asin (double dValue)
+    {
+        return asin (dValue);
+    }
+};
+
+
+class CPolyTrig
+{
+public:
+    static double Sin (double dRad)
+    {
+        double dSin;
+        double dCos;
+        SinCos (dRad, dSin, dCos);
+        return dSin;
+    }
+
+    static double Cos (double dRad)
+    {
+        double dSin;
+        double dCos;
+        SinCos (dRad, dSin, dCos);
+        return dCos;
+    }
+
+    /**
+     * Both from one argument reduction: dRad = k * pi/2 + r with |r| <= pi/4, then the quadrant k mod 4 swaps and
+     *  negates the polynomials for sin r and cos r. The quadrant is applied by multiplying with 0 or 1 rather than
+     *  by branching, since headings land in all four at random.
+     */
+    static void SinCos (double  dRad,
+                        double& dSin,
+                        double& dCos)
+    {
+        double dK   = (dRad * M_2_PI + ROUND) - ROUND;
+        double dR   = (dRad - dK * PIO2_HI) - dK * PIO2_LO;
+        double dT   = dR * dR;
+        double dT2  = dT * dT;
+        double dS   = dR + dR * dT * ((S1 + dT * S2) + dT2 * (S3 + dT * S4));
+        double dC   = 1.0 - 0.5 * dT + dT2 * ((C2 + dT * C3) + dT2 * (C4 + dT * C5));
+        int    iK   = (int)dK;
+        double dOdd = (double)(iK & 1);         // Quadrants 1 and 3: sin and cos swap
+        double dNeg = (double)((iK >> 1) & 1);  // Quadrants 2 and 3: sin is negative
+
+        dSin = (dS * (1.0 - dOdd) + dC * dOdd) * (1.0 - 2.0 * dNeg);
+        dCos = (dC * (1.0 - dOdd) + dS * dOdd) * (1.0 - 2.0 * (dOdd + dNeg - 2.0 * dOdd * dNeg));
+    }
+
+    /**
+     * Polynomial on [0, 0.5]; above that asin x = pi/2 - 2 asin sqrt ((1 - x) / 2), which maps (0.5, 1] back onto
+     *  [0, 0.5). Unlike the quadrants above, which half an argument falls in is predictable in the kernels (it
+     *  follows the latitude), so this one branches.
+     */
+    static double Asin (double dValue)
+    {
+        double dAbs   = fabs (dValue) < 1.0 ? fabs (dValue) : 1.0;
+        bool   bUpper = dAbs > 0.5;
+        double dT     = bUpper ? 0.5 * (1.0 - dAbs) : dAbs * dAbs;
+        double dX     = bUpper ? sqrt (dT) : dAbs;
+        double dT2    = dT * dT;
+        double dT4    = dT2 * dT2;
+        double dPoly  = (A1 + dT * A2) + dT2 * (A3 + dT * A4) + dT4 * ((A5 + dT * A6) + dT2 * (A7 + dT * A8));
+        double dP     = dX + dX * dT * dPoly;
+        double dAsin  = bUpper ? M_PI_2 - 2.0 * dP : dP;
+
+        return copysign (dAsin, dValue);
+    }
+
+private:
+    // Adding and subtracting 1.5 * 2^52 rounds to the nearest integer
+    static constexpr double ROUND   = 6755399441055744.0;
+
+    // pi/2 split so that k * PIO2_HI is exact for |k| < 2^20 (Cody-Waite)
+    static constexpr double PIO2_HI = 1.57079632673412561417e+00;
+    static constexpr double PIO2_LO = 6.07710050650619224932e-11;
+
+    // sin r = r + r^3 (S1 + S2 r^2 + ...)
+    static constexpr double S1 = -1.66666666442498557e-01;
+    static constexpr double S2 =  8.33332933219939863e-03;
+    static constexpr double S3 = -1.98392624521010136e-04;
+    static constexpr double S4 =  2.71735724455219003e-06;
+
+    // cos r = 1 - r^2 / 2 + r^4 (C2 + C3 r^2 + ...)
+    static constexpr double C2 =  4.16666666479216657e-02;
+    static constexpr double C3 = -1.38888855464225553e-03;
+    static constexpr double C4 =  2.47999114140637549e-05;
+    static constexpr double C5 = -2.72371483475361272e-07;
+
+    // asin x = x + x^3 (A1 + A2 x^2 + ...)
+    static constexpr double A1 =  1.66666666455693641e-01;
+    static constexpr double A2 =  7.50000361687038763e-02;
+    static constexpr double A3 =  4.46410407226909139e-02;
+    static constexpr double A4 =  3.04229476557010929e-02;
+    static constexpr double A5 =  2.18832156147809008e-02;
+    static constexpr double A6 =  2.06188624189225685e-02;
+    static constexpr double A7 =  1.92574982313567034e-03;
+    static constexpr double A8 =  3.30729655373550521e-02;
+};
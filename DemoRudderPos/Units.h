@@ -0,0 +1,211 @@
+#pragma once
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+
+/**
+ * Compile-time units for angles, distances and control positions.
+ *
+ * A unit is a tag type with the unit string SimConnect knows it by and its factor to the base unit of its dimension
+ *  (radians, feet, position). Quantities hold the base unit in a double, and every conversion is a constexpr
+ *  multiply that folds into the surrounding arithmetic, so typed code costs the same as the raw macros did.
+ *  Converting between units of different dimensions does not compile.
+ */
+
+typedef struct DimAngle    {} DimAngle;
+typedef struct DimDistance {} DimDistance;
+typedef struct DimPosition {} DimPosition;
+
+typedef struct UnitRadians
+{
+    typedef DimAngle Dimension;
+    static constexpr const char* NAME    = "radians";
+    static constexpr double      TO_BASE = 1.0;
+}
+UnitRadians;
+
+typedef struct UnitDegrees
+{
+    typedef DimAngle Dimension;
+    static constexpr const char* NAME    = "degrees";
+    static constexpr double      TO_BASE = M_PI / 180.0;
+}
+UnitDegrees;
+
+typedef struct UnitFeet
+{
+    typedef DimDistance Dimension;
+    static constexpr const char* NAME    = "feet";
+    static constexpr double      TO_BASE = 1.0;
+}
+UnitFeet;
+
+typedef struct UnitMeters
+{
+    typedef DimDistance Dimension;
+    static constexpr const char* NAME    = "meters";
+    static constexpr double      TO_BASE = 1.0 / 0.3048;
+}
+UnitMeters;
+
+typedef struct UnitNauticalMiles
+{
+    typedef DimDistance Dimension;
+    static constexpr const char* NAME    = "nautical miles";
+    static constexpr double      TO_BASE = 2315000.0 / 381.0;
+}
+UnitNauticalMiles;
+
+/**
+ * Control surface or axis position, -1 to 1.
+ */
+typedef struct UnitPosition
+{
+    typedef DimPosition Dimension;
+    static constexpr const char* NAME    = "position";
+    static constexpr double      TO_BASE = 1.0;
+}
+UnitPosition;
+
+
+template <typename TFrom, typename TTo>
+struct UnitsMatch
+{
+    static constexpr bool VALUE = false;
+};
+
+template <typename TDimension>
+struct UnitsMatch<TDimension, TDimension>
+{
+    static constexpr bool VALUE = true;
+};
+
+/**
+ * Convert a raw value between two units of the same dimension, for kernels that work on arrays of doubles.
+ */
+template <typename TFrom, typename TTo>
+constexpr double UnitConvert (double dValue)
+{
+    static_assert (UnitsMatch<typename TFrom::Dimension, typename TTo::Dimension>::VALUE, "Units of different dimensions");
+    return dValue * (TFrom::TO_BASE / TTo::TO_BASE);
+}
+
+
+/**
+ * A value of some dimension, held in its base unit. The derived class is the quantity itself so arithmetic keeps
+ *  its type.
+ */
+template <typename TQuantity, typename TDimension>
+class CQuantity
+{
+public:
+    template <typename TUnit>
+    static constexpr TQuantity From (double dValue)
+    {
+        static_assert (UnitsMatch<typename TUnit::Dimension, TDimension>::VALUE, "Unit of a different dimension");
+        return TQuantity (dValue * TUnit::TO_BASE);
+    }
+
+    template <typename TUnit>
+    constexpr double In () const
+    {
+        static_assert (UnitsMatch<typename TUnit::Dimension, TDimension>::VALUE, "Unit of a different dimension");
+        return m_dBase / TUnit::TO_BASE;
+    }
+
+    constexpr TQuantity operator - () const                   { return TQuantity (-m_dBase); }
+    constexpr TQuantity operator + (TQuantity other) const    { return TQuantity (m_dBase + other.m_dBase); }
+    constexpr TQuantity operator - (TQuantity other) const    { return TQuantity (m_dBase - other.m_dBase); }
+    constexpr TQuantity operator * (double dScale) const      { return TQuantity (m_dBase * dScale); }
+    constexpr TQuantity operator / (double dScale) const      { return TQuantity (m_dBase / dScale); }
+    constexpr double    operator / (TQuantity other) const    { return m_dBase / other.m_dBase; }
+
+    constexpr bool operator <  (TQuantity other) const { return m_dBase <  other.m_dBase; }
+    constexpr bool operator >  (TQuantity other) const { return m_dBase >  other.m_dBase; }
+    constexpr bool operator <= (TQuantity other) const { return m_dBase <= other.m_dBase; }
+    constexpr bool operator >= (TQuantity other) const { return m_dBase >= other.m_dBase; }
+    constexpr bool operator == (TQuantity other) const { return m_dBase == other.m_dBase; }
+    constexpr bool operator != (TQuantity other) const { return m_dBase != other.m_dBase; }
+
+protected:
+    explicit constexpr CQuantity (double dBase) :
+        m_dBase (dBase)
+    {
+    }
+
+    double m_dBase;
+};
+
+
+class CAngle : public CQuantity<CAngle, DimAngle>
+{
+public:
+    constexpr CAngle () : CQuantity (0.0) {}
+
+    static constexpr CAngle Radians (double dRad) { return From<UnitRadians> (dRad); }
+    static constexpr CAngle Degrees (double dDeg) { return From<UnitDegrees> (dDeg); }
+
+    constexpr double Rad () const { return In<UnitRadians> (); }
+    constexpr double Deg () const { return In<UnitDegrees> (); }
+
+private:
+    friend class CQuantity<CAngle, DimAngle>;
+
+    explicit constexpr CAngle (double dRad) : CQuantity (dRad) {}
+};
+
+
+class CDistance : public CQuantity<CDistance, DimDistance>
+{
+public:
+    constexpr CDistance () : CQuantity (0.0) {}
+
+    static constexpr CDistance Feet   (double dFt) { return From<UnitFeet> (dFt); }
+    static constexpr CDistance Meters (double dM)  { return From<UnitMeters> (dM); }
+    static constexpr CDistance Nm     (double dNm) { return From<UnitNauticalMiles> (dNm); }
+
+    constexpr double Ft () const { return In<UnitFeet> (); }
+    constexpr double M  () const { return In<UnitMeters> (); }
+    constexpr double Nm () const { return In<UnitNauticalMiles> (); }
+
+private:
+    friend class CQuantity<CDistance, DimDistance>;
+
+    explicit constexpr CDistance (double dFt) : CQuantity (dFt) {}
+};
+
+
+/**
+ * A true heading. Unlike an angle it is a direction, so headings only add angles (turns) and their difference is
+ *  the turn between them.
+ */
+class CHeading
+{
+public:
+    constexpr CHeading () : m_angle () {}
+
+    static constexpr CHeading Radians (double dRad) { return CHeading (CAngle::Radians (dRad)); }
+    static constexpr CHeading Degrees (double dDeg) { return CHeading (CAngle::Degrees (dDeg)); }
+
+    constexpr double Rad () const { return m_angle.Rad (); }
+    constexpr double Deg () const { return m_angle.Deg (); }
+
+    constexpr CHeading operator + (CAngle turn) const    { return CHeading (m_angle + turn); }
+    constexpr CHeading operator - (CAngle turn) const    { return CHeading (m_angle - turn); }
+    constexpr CAngle   operator - (CHeading other) const { return m_angle - other.m_angle; }
+
+    /**
+     * The same heading in [0, 360) degrees.
+     */
+    CHeading Normalized () const
+    {
+        double dDeg = fmod (Deg (), 360.0);
+        return Degrees (dDeg < 0.0 ? dDeg + 360.0 : dDeg);
+    }
+
+private:
+    explicit constexpr CHeading (CAngle angle) : m_angle (angle) {}
+
+    CAngle m_angle;
+};
@@ -0,0 +1,436 @@
+#pragma once
+
+#include <Windows.h>
+#include <SimConnect.h>
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "Units.h"
+
+
+#define WEATHER_CELL_DEG            0.25    // Between the points of the grid, some 15 nm
+#define WEATHER_PREFETCH_CELLS      2       // Grid points each way around the position prefetched
+#define WEATHER_TTL_SEC             300.0
+#define WEATHER_REFRESH_SEC         60.0    // Before expiry, when a point is asked for again
+#define WEATHER_REQUEST_WINDOW      8       // Requests in flight at once
+#define WEATHER_REQUEST_IDS         (4 * WEATHER_REQUEST_WINDOW)    // Taken in turn by the slots of the window
+#define WEATHER_REQUEST_TIMEOUT_SEC 10.0    // The sim answers a failed request with an exception only
+#define WEATHER_CELLS_MAX           1024    // Beyond which expired points are dropped
+
+/**
+ * The weather at a point, as far as ground vehicles care. Wind is the velocity of the air, which interpolates where
+ *  a direction would not.
+ */
+typedef struct WeatherSample
+{
+    float   fWindNorthKt;
+    float   fWindEastKt;
+    float   fTemperatureC;
+    float   fPressureHpa;
+
+    /**
+     * Direction the wind blows from, in degrees true, as a METAR has it.
+     */
+    double WindFromDeg () const
+    {
+        double dDeg = CAngle::Radians (atan2 (-fWindEastKt, -fWindNorthKt)).Deg ();
+        return dDeg < 0.0 ? dDeg + 360.0 : dDeg;
+    }
+
+    double WindKt () const
+    {
+        return sqrt ((double)fWindNorthKt * fWindNorthKt + (double)fWindEastKt * fWindEastKt);
+    }
+}
+WeatherSample;
+
+/**
+ * The wind, temperature and pressure of a METAR, including the extended ones of the sim, whose groups carry layers
+ *  after an '&'; false without a wind group. Only the first wind group, that of the surface, is taken. A variable
+ *  wind has no mean direction and counts as calm; missing temperature and pressure are those of the ISA.
+ */
+inline bool ParseMetar (const char*    szMetar,
+                        WeatherSample& sample)
+{
+    bool bWind = false;
+
+    sample.fWindNorthKt  = 0.0f;
+    sample.fWindEastKt   = 0.0f;
+    sample.fTemperatureC = 15.0f;
+    sample.fPressureHpa  = 1013.25f;
+
+    for (const char* pToken = szMetar; *pToken != '\0'; )
+    {
+        size_t cchToken = strcspn (pToken, " ");
+        size_t cchGroup = strcspn (pToken, " &");
+        char   szGroup[32];
+
+        if (cchGroup > 0 && cchGroup < sizeof (szGroup))
+        {
+            size_t cchNumber;
+
+            memcpy (szGroup, pToken, cchGroup);
+            szGroup[cchGroup] = '\0';
+            cchNumber         = strspn (szGroup, "0123456789");
+
+            // dddss[Ggg]KT, MPS or KMH, or VRBss...
+            const char* pUnit = szGroup + strcspn (szGroup, "KM");
+            if (!bWind && cchGroup >= 7 && (cchNumber >= 5 || (strncmp (szGroup, "VRB", 3) == 0 && strspn (szGroup + 3, "0123456789") >= 2)) &&
+                (strcmp (pUnit, "KT") == 0 || strcmp (pUnit, "MPS") == 0 || strcmp (pUnit, "KMH") == 0))
+            {
+                double dSpeed = atoi (szGroup + 3);
+                double dFromRad;
+
+                if (strcmp (pUnit, "MPS") == 0) dSpeed *= 1.943844;
+                if (strcmp (pUnit, "KMH") == 0) dSpeed *= 0.539957;
+
+                if (szGroup[0] != 'V')
+                {
+                    szGroup[3]           = '\0';
+                    dFromRad             = CAngle::Degrees (atoi (szGroup)).Rad ();
+                    sample.fWindNorthKt  = (float)(-dSpeed * cos (dFromRad));
+                    sample.fWindEastKt   = (float)(-dSpeed * sin (dFromRad));
+                }
+                bWind = true;
+            }
+            // [M]tt/[M]dd
+            else if (strchr (szGroup, '/') != NULL && strspn (szGroup, "M0123456789/") == cchGroup &&
+                     (isdigit ((unsigned char)szGroup[0]) || (szGroup[0] == 'M' && isdigit ((unsigned char)szGroup[1]))))
+            {
+                double dTemperature = atoi (szGroup + (szGroup[0] == 'M'));
+                sample.fTemperatureC = (float)(szGroup[0] == 'M' ? -dTemperature : dTemperature);
+            }
+            // Qpppp in hPa or Apppp in hundredths of inHg
+            else if ((szGroup[0] == 'Q' || szGroup[0] == 'A') && cchGroup == 5 && strspn (szGroup + 1, "0123456789") == 4)
+            {
+                double dPressure = atoi (szGroup + 1);
+                sample.fPressureHpa = (float)(szGroup[0] == 'Q' ? dPressure : dPressure * 0.338639);
+            }
+        }
+
+        pToken += cchToken;
+        while (*pToken == ' ') pToken++;
+    }
+    return bWind;
+}
+
+
+/**
+ * The weather around the user aircraft, for any number of vehicles asking for it without each costing a request to
+ *  the sim.
+ *
+ * The sim answers SimConnect_WeatherRequestInterpolatedObservation with a METAR for a position, one round trip per
+ *  request. The cache asks only for the points of a fixed grid, WEATHER_CELL_DEG apart, and keeps each for
+ *  WEATHER_TTL_SEC; Prefetch asks for those around a position ahead of need, and a query interpolates between the
+ *  four points around it. A point is asked for once however many want it before the answer, and no more than
+ *  WEATHER_REQUEST_WINDOW requests are in flight at a time.
+ *
+ * Each slot of the window takes its request IDs in turn, so an observation that comes after its request was given
+ *  up on is not taken for the point requested next in the slot.
+ */
+class CWeatherCache
+{
+public:
+    /**
+     * The cache owns the WEATHER_REQUEST_IDS request IDs from idRequestFirst.
+     */
+    explicit CWeatherCache (DWORD idRequestFirst) :
+        m_hSimConnect    (NULL),
+        m_idRequestFirst (idRequestFirst),
+        m_fAltFt         (0.0f),
+        m_dNowSec        (0.0),
+        m_cRequests      (0),
+        m_cRequestsSent  (0)
+    {
+        memset (m_rgnSlotKeys, 0, sizeof (m_rgnSlotKeys));
+        memset (m_rgdSlotSent, 0, sizeof (m_rgdSlotSent));
+        memset (m_rgidSlotRequests, 0, sizeof (m_rgidSlotRequests));
+        memset (m_rgnSlotTurns, 0, sizeof (m_rgnSlotTurns));
+    }
+
+    /**
+     * Observations are asked for at fAltFt, the ground for ground vehicles.
+     */
+    void Open (HANDLE hSimConnect,
+               float  fAltFt = 0.0f)
+    {
+        Close ();
+        m_hSimConnect = hSimConnect;
+        m_fAltFt      = fAltFt;
+    }
+
+    void Close ()
+    {
+        m_hSimConnect = NULL;
+        m_cells.clear ();
+        m_queue.clear ();
+        memset (m_rgnSlotKeys, 0, sizeof (m_rgnSlotKeys));
+        m_cRequests = 0;
+    }
+
+    /**
+     * Ask for the grid points around a position that are missing or due to expire.
+     */
+    void Prefetch (double dLat,
+                   double dLon,
+                   double dNowSec)
+    {
+        int32_t iLat = LatIndex (dLat);
+        int32_t iLon = LonIndex (dLon);
+
+        m_dNowSec = dNowSec;
+        if (m_cells.size () > WEATHER_CELLS_MAX) Evict ();
+
+        for (int32_t iLatOff = -WEATHER_PREFETCH_CELLS; iLatOff <= WEATHER_PREFETCH_CELLS + 1; iLatOff++)
+        {
+            for (int32_t iLonOff = -WEATHER_PREFETCH_CELLS; iLonOff <= WEATHER_PREFETCH_CELLS + 1; iLonOff++)
+            {
+                Want (iLat + iLatOff, iLon + iLonOff);
+            }
+        }
+        Pump ();
+    }
+
+    /**
+     * The weather at a position, from the grid points around it that have not expired; false if none has. Points
+     *  missing or due to expire are asked for, so a query that fails now succeeds a round trip later.
+     */
+    bool Query (double         dLat,
+                double         dLon,
+                double         dNowSec,
+                WeatherSample& sample)
+    {
+        double  dLatCell = (dLat + 90.0) / WEATHER_CELL_DEG;
+        double  dLonCell = (dLon + 180.0) / WEATHER_CELL_DEG;
+        int32_t iLat     = (int32_t)floor (dLatCell);
+        int32_t iLon     = (int32_t)floor (dLonCell);
+        double  dNorth   = dLatCell - iLat;
+        double  dEast    = dLonCell - iLon;
+        double  dWeight  = 0.0;
+        double  rgdSum[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+        m_dNowSec = dNowSec;
+        for (int i = 0; i < 4; i++)
+        {
+            double      dCorner = (i & 1 ? dEast : 1.0 - dEast) * (i & 2 ? dNorth : 1.0 - dNorth);
+            const Cell* pCell   = Want (iLat + (i >> 1), iLon + (i & 1));
+
+            if (pCell == NULL || !pCell->bValid || m_dNowSec >= pCell->dExpiresSec || dCorner <= 0.0) continue;
+
+            dWeight   += dCorner;
+            rgdSum[0] += dCorner * pCell->sample.fWindNorthKt;
+            rgdSum[1] += dCorner * pCell->sample.fWindEastKt;
+            rgdSum[2] += dCorner * pCell->sample.fTemperatureC;
+            rgdSum[3] += dCorner * pCell->sample.fPressureHpa;
+        }
+        Pump ();
+        if (dWeight <= 0.0) return false;
+
+        sample.fWindNorthKt  = (float)(rgdSum[0] / dWeight);
+        sample.fWindEastKt   = (float)(rgdSum[1] / dWeight);
+        sample.fTemperatureC = (float)(rgdSum[2] / dWeight);
+        sample.fPressureHpa  = (float)(rgdSum[3] / dWeight);
+        return true;
+    }
+
+    /**
+     * Pass on every message; returns true if it was for the cache.
+     */
+    bool OnRecv (const SIMCONNECT_RECV* pData)
+    {
+        if (pData->dwID != SIMCONNECT_RECV_ID_WEATHER_OBSERVATION) return false;
+
+        const SIMCONNECT_RECV_WEATHER_OBSERVATION* pObservation = (const SIMCONNECT_RECV_WEATHER_OBSERVATION*)pData;
+        DWORD                                      iId          = pObservation->dwRequestID - m_idRequestFirst;
+        DWORD                                      iSlot        = iId % WEATHER_REQUEST_WINDOW;
+        if (iId >= WEATHER_REQUEST_IDS) return false;
+
+        // One given up on is still the cache's, but there is nothing to do with it
+        if (m_rgnSlotKeys[iSlot] == 0 || m_rgidSlotRequests[iSlot] != pObservation->dwRequestID) return true;
+
+        // The METAR, in place of szMetar at the end of the packed message, may fill it without a terminator
+        size_t ibMetar  = sizeof (SIMCONNECT_RECV_WEATHER_OBSERVATION) - sizeof (pObservation->szMetar);
+        size_t cchMetar = pData->dwSize > ibMetar ? strnlen (pObservation->szMetar, pData->dwSize - ibMetar) : 0;
+        auto   it       = m_cells.find (m_rgnSlotKeys[iSlot]);
+
+        m_metar.assign (pObservation->szMetar, pObservation->szMetar + cchMetar);
+        m_metar.push_back ('\0');
+
+        if (it != m_cells.end ())
+        {
+            Cell& cell = it->second;
+            cell.bPending    = false;
+            cell.dExpiresSec = m_dNowSec + WEATHER_TTL_SEC;
+            if (ParseMetar (m_metar.data (), cell.sample))
+            {
+                cell.bValid = true;
+            }
+        }
+
+        m_rgnSlotKeys[iSlot] = 0;
+        m_cRequests--;
+        Pump ();
+        return true;
+    }
+
+    /**
+     * Grid points kept, with an observation or waiting for one.
+     */
+    DWORD Count () const
+    {
+        return (DWORD)m_cells.size ();
+    }
+
+    /**
+     * Grid points queued or in flight.
+     */
+    DWORD PendingCount () const
+    {
+        return (DWORD)m_queue.size () + m_cRequests;
+    }
+
+    /**
+     * Requests sent to the sim since Open.
+     */
+    DWORD RequestCount () const
+    {
+        return m_cRequestsSent;
+    }
+
+private:
+    CWeatherCache (const CWeatherCache&);
+    CWeatherCache& operator= (const CWeatherCache&);
+
+
+    typedef struct Cell
+    {
+        Cell () :
+            bValid      (false),
+            bPending    (false),
+            dExpiresSec (0.0)
+        {
+            memset (&sample, 0, sizeof (sample));
+        }
+
+        bool            bValid;         // Whether there ever was an observation
+        bool            bPending;       // Queued or in flight
+        double          dExpiresSec;    // Also when a point whose METAR made no sense may be asked for again
+        WeatherSample   sample;
+    }
+    Cell;
+
+    static int32_t LatIndex (double dLat)
+    {
+        return (int32_t)floor ((dLat + 90.0) / WEATHER_CELL_DEG);
+    }
+
+    static int32_t LonIndex (double dLon)
+    {
+        return (int32_t)floor ((dLon + 180.0) / WEATHER_CELL_DEG);
+    }
+
+    /**
+     * Grid points past the poles are clamped and those past the antimeridian wrapped; never 0, which marks a free
+     *  slot.
+     */
+    static uint64_t CellKey (int32_t iLat,
+                             int32_t iLon)
+    {
+        const int32_t nLatCells = (int32_t)(180.0 / WEATHER_CELL_DEG) + 1;
+        const int32_t nLonCells = (int32_t)(360.0 / WEATHER_CELL_DEG);
+
+        iLat = iLat < 0 ? 0 : iLat >= nLatCells ? nLatCells - 1 : iLat;
+        iLon = ((iLon % nLonCells) + nLonCells) % nLonCells;
+        return ((uint64_t)(iLat + 1) << 32) | (uint32_t)iLon;
+    }
+
+    /**
+     * The grid point, asked for unless it is fresh or already pending.
+     */
+    const Cell* Want (int32_t iLat,
+                      int32_t iLon)
+    {
+        uint64_t nKey = CellKey (iLat, iLon);
+        Cell&    cell = m_cells[nKey];
+
+        if (!cell.bPending && m_dNowSec >= cell.dExpiresSec - WEATHER_REFRESH_SEC && m_hSimConnect != NULL)
+        {
+            cell.bPending = true;
+            m_queue.push_back (nKey);
+        }
+        return &cell;
+    }
+
+    /**
+     * Give up on requests the sim has not answered, then request queued points into the free slots.
+     */
+    void Pump ()
+    {
+        for (DWORD iSlot = 0; iSlot < WEATHER_REQUEST_WINDOW; iSlot++)
+        {
+            if (m_rgnSlotKeys[iSlot] == 0 || m_dNowSec < m_rgdSlotSent[iSlot] + WEATHER_REQUEST_TIMEOUT_SEC) continue;
+
+            auto it = m_cells.find (m_rgnSlotKeys[iSlot]);
+            if (it != m_cells.end ()) it->second.bPending = false;
+            m_rgnSlotKeys[iSlot] = 0;
+            m_cRequests--;
+        }
+
+        for (DWORD iSlot = 0; iSlot < WEATHER_REQUEST_WINDOW && !m_queue.empty (); iSlot++)
+        {
+            if (m_rgnSlotKeys[iSlot] != 0) continue;
+
+            uint64_t nKey = m_queue.front ();
+            double   dLat = (double)((nKey >> 32) - 1) * WEATHER_CELL_DEG - 90.0;
+            double   dLon = (double)(uint32_t)nKey * WEATHER_CELL_DEG - 180.0;
+
+            m_queue.pop_front ();
+            m_rgnSlotKeys[iSlot]      = nKey;
+            m_rgdSlotSent[iSlot]      = m_dNowSec;
+            m_rgidSlotRequests[iSlot] = m_idRequestFirst + iSlot + (m_rgnSlotTurns[iSlot]++ % (WEATHER_REQUEST_IDS / WEATHER_REQUEST_WINDOW)) * WEATHER_REQUEST_WINDOW;
+            m_cRequests++;
+            m_cRequestsSent++;
+            SimConnect_WeatherRequestInterpolatedObservation (m_hSimConnect, m_rgidSlotRequests[iSlot], (float)dLat, (float)dLon, m_fAltFt);
+        }
+    }
+
+    /**
+     * Drop the points that have expired and are not pending, those left behind by the aircraft.
+     */
+    void Evict ()
+    {
+        for (auto it = m_cells.begin (); it != m_cells.end (); )
+        {
+            if (!it->second.bPending && m_dNowSec >= it->second.dExpiresSec)
+            {
+                it = m_cells.erase (it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+
+    HANDLE                              m_hSimConnect;
+    DWORD                               m_idRequestFirst;
+    float                               m_fAltFt;
+    double                              m_dNowSec;      // Sim time of the last call that passed it
+    std::unordered_map<uint64_t, Cell>  m_cells;
+    std::deque<uint64_t>                m_queue;        // Grid points not yet requested
+    uint64_t                            m_rgnSlotKeys[WEATHER_REQUEST_WINDOW];  // Grid point in flight, 0 if free
+    double                              m_rgdSlotSent[WEATHER_REQUEST_WINDOW];
+    DWORD                               m_rgidSlotRequests[WEATHER_REQUEST_WINDOW];
+    DWORD                               m_rgnSlotTurns[WEATHER_REQUEST_WINDOW];   // Requests made from the slot
+    DWORD                               m_cRequests;    // Slots in use
+    DWORD                               m_cRequestsSent;
+    std::vector<char>                   m_metar;
+};
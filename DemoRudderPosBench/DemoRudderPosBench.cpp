@@ -0,0 +1,2896 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "ClientDataChannel.h"
+#include "ConnectionMux.h"
+#include "DeadReckoning.h"
+#include "DemoRudderPos.h"
+#include "FacilityCache.h"
+#include "FacilityFetcher.h"
+#include "Formation.h"
+#include "Geodesy.h"
+#include "KalmanBank.h"
+#include "LocalFrame.h"
+#include "PathFollower.h"
+#include "SimConnectStandIn.h"
+#include "SimConnectStandInServer.h"
+#include "SpatialGrid.h"
+#include "SubscriptionMux.h"
+#include "TaxiRouter.h"
+#include "TelemetryArchive.h"
+#include "TelemetryBus.h"
+#include "TelemetryRecorder.h"
+#include "TimerWheel.h"
+#include "Trig.h"
+#include "WeatherCache.h"
+
+
+// Somewhere busy: the middle of a large airport
+#define BENCH_LAT           47.45
+#define BENCH_LON           -122.31
+
+
+/**
+ * Calls fn (i) for i in [0, cCalls) a few times over and returns the best mean time per call in nanoseconds.
+ */
+template <typename TFn>
+static double MeasureNs (uint32_t cCalls,
+                         TFn      fn)
+{
+    double dBestNs = 1e300;
+
+    for (int iRun = 0; iRun < 5; iRun++)
+    {
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+        for (uint32_t i = 0; i < cCalls; i++) fn (i);
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now ();
+
+        dBestNs = std::min (dBestNs, std::chrono::duration<double, std::nano> (t1 - t0).count () / cCalls);
+    }
+    return dBestNs;
+}
+
+typedef struct Result
+{
+    std::string strName;
+    double      dValue;
+    std::string strUnit;
+}
+Result;
+
+static std::vector<Result>  s_results;
+static volatile double      s_dSink;        // Keeps results the compiler would otherwise discard
+
+/**
+ * Record a result; they are all printed at the end, as a table or as JSON.
+ */
+static void Record (const char* szName,
+                    double      dValue,
+                    const char* szUnit)
+{
+    Result result;
+    result.strName = szName;
+    result.dValue  = dValue;
+    result.strUnit = szUnit;
+    s_results.push_back (result);
+}
+
+static void Report (const char* szName,
+                    double      dNs,
+                    const char* szUnit = "op")
+{
+    Record (szName, dNs, (std::string ("ns/") + szUnit).c_str ());
+}
+
+static void PrintTable ()
+{
+    for (size_t i = 0; i < s_results.size (); i++)
+    {
+        const Result& result = s_results[i];
+        printf (result.strUnit.compare (0, 3, "ns/") == 0 ? "%-60s %12.1f %s\n" : "%-60s %12.6g %s\n",
+                result.strName.c_str (), result.dValue, result.strUnit.c_str ());
+    }
+}
+
+/**
+ * One result per line in a fixed order, so runs of different commits can be diffed or compared by a script. Names
+ *  and units are plain ASCII without quotes or backslashes.
+ */
+static void PrintJson ()
+{
+    printf ("{\n");
+    printf ("  \"schema\": 1,\n");
+    #ifdef SIM_MSFS2020
+        printf ("  \"sim\": \"MSFS2020\",\n");
+    #else
+        printf ("  \"sim\": \"P3Dv4\",\n");
+    #endif
+    printf ("  \"results\": [\n");
+    for (size_t i = 0; i < s_results.size (); i++)
+    {
+        const Result& result = s_results[i];
+        printf ("    { \"name\": \"%s\", \"value\": %.6g, \"unit\": \"%s\" }%s\n",
+                result.strName.c_str (), result.dValue, result.strUnit.c_str (), i + 1 < s_results.size () ? "," : "");
+    }
+    printf ("  ]\n");
+    printf ("}\n");
+}
+
+
+/**
+ * Sends stdout to the null device while in scope, so the console output of the demo neither ends up in the report
+ *  nor waits on a terminal during the timings.
+ */
+class CQuietStdout
+{
+public:
+    CQuietStdout ()
+    {
+        fflush (stdout);
+        #ifdef _WIN32
+            m_fdSaved = _dup (_fileno (stdout));
+            int fdNull = _open ("NUL", _O_WRONLY);
+            _dup2 (fdNull, _fileno (stdout));
+            _close (fdNull);
+        #else
+            m_fdSaved = dup (fileno (stdout));
+            int fdNull = open ("/dev/null", O_WRONLY);
+            dup2 (fdNull, fileno (stdout));
+            close (fdNull);
+        #endif
+    }
+
+    ~CQuietStdout ()
+    {
+        fflush (stdout);
+        #ifdef _WIN32
+            _dup2 (m_fdSaved, _fileno (stdout));
+            _close (m_fdSaved);
+        #else
+            dup2 (m_fdSaved, fileno (stdout));
+            close (m_fdSaved);
+        #endif
+    }
+
+private:
+    int m_fdSaved;
+};
+
+
+/**
+ * Spatial grid queries with objects spread over a 0.2 x 0.2 degree area (roughly 12 x 8 nm) around the airport, with
+ *  the cell size picked for about 16 objects per cell.
+ */
+static void BenchSpatialGrid ()
+{
+    static const uint32_t s_counts[] = { 1000, 10000, 100000 };
+
+    for (size_t iCount = 0; iCount < sizeof (s_counts) / sizeof (s_counts[0]); iCount++)
+    {
+        uint32_t                            cObjects = s_counts[iCount];
+        double                              dCellDeg = std::max (0.005, 0.2 / sqrt (cObjects / 16.0));
+        std::mt19937                        rng (42);
+        std::uniform_real_distribution<>    offset (-0.1, 0.1);
+        std::vector<double>                 lats (cObjects);
+        std::vector<double>                 lons (cObjects);
+        CSpatialGrid                        grid (dCellDeg);
+        std::vector<CSpatialGrid::Hit>      hits;
+        char                                szName[128];
+
+        grid.Reserve (cObjects);
+        for (uint32_t i = 0; i < cObjects; i++)
+        {
+            lats[i] = BENCH_LAT + offset (rng);
+            lons[i] = BENCH_LON + offset (rng);
+            grid.Update (i, lats[i], lons[i]);
+        }
+
+        snprintf (szName, sizeof (szName), "SpatialGrid/KNearest/k=8/n=%u", cObjects);
+        Report (szName, MeasureNs (10000, [&] (uint32_t i)
+        {
+            grid.KNearest (lats[i % cObjects], lons[i % cObjects], 8, hits);
+        }), "query");
+
+        snprintf (szName, sizeof (szName), "SpatialGrid/WithinRadius/r=2000ft/n=%u", cObjects);
+        Report (szName, MeasureNs (10000, [&] (uint32_t i)
+        {
+            grid.WithinRadius (lats[i % cObjects], lons[i % cObjects], 2000.0, hits);
+        }), "query");
+
+        // Small moves between scans mostly stay within their cell
+        snprintf (szName, sizeof (szName), "SpatialGrid/Update/n=%u", cObjects);
+        Report (szName, MeasureNs (cObjects, [&] (uint32_t i)
+        {
+            lats[i] += 1e-5;
+            grid.Update (i, lats[i], lons[i]);
+        }), "object");
+    }
+}
+
+
+/**
+ * One frame of the path follower, with every vehicle on its own 20-waypoint path, and a vehicle steering across the
+ *  antimeridian.
+ */
+static void BenchPathFollower ()
+{
+    static const uint32_t s_counts[] = { 100, 500, 2000 };
+
+    for (size_t iCount = 0; iCount < sizeof (s_counts) / sizeof (s_counts[0]); iCount++)
+    {
+        uint32_t                            cVehicles = s_counts[iCount];
+        std::mt19937                        rng (42);
+        std::uniform_real_distribution<>    offset (-0.01, 0.01);
+        CPathFollower                       follower;
+        char                                szName[128];
+
+        for (uint32_t i = 0; i < cVehicles; i++)
+        {
+            double lats[20];
+            double lons[20];
+            for (int j = 0; j < 20; j++)
+            {
+                lats[j] = BENCH_LAT + offset (rng);
+                lons[j] = BENCH_LON + offset (rng);
+            }
+            follower.Follow (i, lats, lons, 20);
+            follower.SetState (i, BENCH_LAT + offset (rng), BENCH_LON + offset (rng), i % 360);
+        }
+
+        snprintf (szName, sizeof (szName), "PathFollower/Update/n=%u", cVehicles);
+        Report (szName, MeasureNs (1000, [&] (uint32_t i)
+        {
+            follower.Update ();
+        }) / cVehicles, "vehicle");
+    }
+
+    // Heading east across the antimeridian to a point straight ahead, which needs no rudder
+    CPathFollower follower;
+    double        lat = 0.0;
+    double        lon = -179.999;
+
+    follower.Follow (1, &lat, &lon, 1);
+    follower.SetState (1, 0.0, 179.999, 90.0);
+    follower.Update ();
+    Record ("PathFollower/Antimeridian/Rudder", fabs (follower.RudderAt (0)), "position");
+}
+
+
+// Distances from an anchor the accuracy of the approximations is reported at
+static const double s_distsFt[]   = { 50.0, 500.0, 5000.0,
+                                      CDistance::Nm (1.0).Ft (), CDistance::Nm (5.0).Ft (), CDistance::Nm (20.0).Ft () };
+static const char*  s_distNames[] = { "50ft", "500ft", "5000ft", "1nm", "5nm", "20nm" };
+
+
+/**
+ * Largest error in feet of CLocalFrame::Translate against CGeodesy::Translate, over all headings (5 degree steps),
+ *  for a given distance from the anchor, followed by the throughput of both.
+ */
+static void BenchLocalFrame ()
+{
+    static const double s_lats[] = { 0.0, 30.0, 45.0, 60.0, 70.0, 80.0, 85.0, 89.0 };
+    char                szName[128];
+
+    for (size_t iLat = 0; iLat < sizeof (s_lats) / sizeof (s_lats[0]); iLat++)
+    {
+        CLocalFrame frame;
+        frame.Anchor (s_lats[iLat], BENCH_LON);
+
+        snprintf (szName, sizeof (szName), "LocalFrame/RangeFt/tol=1ft/lat=%.0f", s_lats[iLat]);
+        Record (szName, frame.RangeFt (), "ft");
+
+        for (size_t iDist = 0; iDist < sizeof (s_distsFt) / sizeof (s_distsFt[0]); iDist++)
+        {
+            double dErrFt = 0.0;
+            for (int iHead = 0; iHead < 360; iHead += 5)
+            {
+                LatLon    from     = { CAngle::Degrees (s_lats[iLat]), CAngle::Degrees (BENCH_LON) };
+                CHeading  heading  = CHeading::Degrees (iHead);
+                CDistance distance = CDistance::Feet (s_distsFt[iDist]);
+                LatLon    exact    = CGeodesy::Translate (from, heading, distance);
+                LatLon    local    = frame.Translate (from, heading, distance);
+
+                dErrFt = std::max (dErrFt, CGeodesy::DistanceFt (exact.lat.Deg (), exact.lon.Deg (),
+                                                                 local.lat.Deg (), local.lon.Deg ()));
+            }
+
+            snprintf (szName, sizeof (szName), "LocalFrame/ErrorFt/lat=%.0f/d=%s", s_lats[iLat], s_distNames[iDist]);
+            Record (szName, dErrFt, "ft");
+        }
+    }
+
+    LatLon              start     = { CAngle::Degrees (BENCH_LAT), CAngle::Degrees (BENCH_LON) };
+    std::vector<LatLon> positions (4096, start);
+    std::vector<double> lats (4096, BENCH_LAT);
+    std::vector<double> lons (4096, BENCH_LON);
+    CLocalFrame         frame;
+    double              dEast  = 0.0;
+    double              dNorth = 0.0;
+
+    frame.Anchor (BENCH_LAT, BENCH_LON);
+
+    Report ("Geodesy/Translate/50ft", MeasureNs (1000000, [&] (uint32_t i)
+    {
+        positions[i % 4096] = CGeodesy::Translate (positions[i % 4096], CHeading::Degrees (i % 360), CDistance::Feet (50.0));
+    }), "point");
+
+    Report ("LocalFrame/Translate/50ft", MeasureNs (1000000, [&] (uint32_t i)
+    {
+        positions[i % 4096] = frame.Translate (positions[i % 4096], CHeading::Degrees (i % 360), CDistance::Feet (50.0));
+    }), "point");
+
+    Report ("LocalFrame/ToLocal+FromLocal", MeasureNs (1000000, [&] (uint32_t i)
+    {
+        frame.ToLocal (lats[i % 4096], lons[i % 4096], dEast, dNorth);
+        frame.FromLocal (dEast + 50.0, dNorth, lats[i % 4096], lons[i % 4096]);
+    }), "point");
+}
+
+
+/**
+ * Spherical Translate against the WGS-84 Direct solution: the largest gap in feet over all headings (5 degree steps)
+ *  for a given distance, then the cost per point of the batched entry points.
+ */
+static void BenchGeodesy ()
+{
+    static const double s_lats[] = { 0.0, 30.0, 45.0, 60.0, 85.0 };
+    char                szName[128];
+
+    for (size_t iLat = 0; iLat < sizeof (s_lats) / sizeof (s_lats[0]); iLat++)
+    {
+        for (size_t iDist = 0; iDist < sizeof (s_distsFt) / sizeof (s_distsFt[0]); iDist++)
+        {
+            double dGapFt = 0.0;
+            for (int iHead = 0; iHead < 360; iHead += 5)
+            {
+                LatLon from      = { CAngle::Degrees (s_lats[iLat]), CAngle::Degrees (BENCH_LON) };
+                LatLon sphere    = CGeodesy::Translate (from, CHeading::Degrees (iHead), CDistance::Feet (s_distsFt[iDist]));
+                double dLatWgs84 = 0.0;
+                double dLonWgs84 = 0.0;
+                double dGap      = 0.0;
+
+                CGeodesy::Direct (s_lats[iLat], BENCH_LON, iHead, s_distsFt[iDist], dLatWgs84, dLonWgs84);
+                CGeodesy::Inverse (dLatWgs84, dLonWgs84, sphere.lat.Deg (), sphere.lon.Deg (), dGap);
+                dGapFt = std::max (dGapFt, dGap);
+            }
+
+            snprintf (szName, sizeof (szName), "Geodesy/SphereGapFt/lat=%.0f/d=%s", s_lats[iLat], s_distNames[iDist]);
+            Record (szName, dGapFt, "ft");
+        }
+    }
+
+    const uint32_t                      cPoints = 4096;
+    std::mt19937                        rng (42);
+    std::uniform_real_distribution<>    offset (-0.1, 0.1);
+    std::uniform_real_distribution<>    heading (0.0, 360.0);
+    std::uniform_real_distribution<>    distance (50.0, CDistance::Nm (5.0).Ft ());
+    std::vector<double>                 lats (cPoints);
+    std::vector<double>                 lons (cPoints);
+    std::vector<double>                 heads (cPoints);
+    std::vector<double>                 dists (cPoints);
+    std::vector<double>                 latsEnd (cPoints);
+    std::vector<double>                 lonsEnd (cPoints);
+
+    for (uint32_t i = 0; i < cPoints; i++)
+    {
+        lats[i]  = BENCH_LAT + offset (rng);
+        lons[i]  = BENCH_LON + offset (rng);
+        heads[i] = heading (rng);
+        dists[i] = distance (rng);
+    }
+
+    Report ("Geodesy/Mod", MeasureNs (1000000, [&] (uint32_t i)
+    {
+        s_dSink = s_dSink + CGeodesy::Mod (i * 0.37 - 5000.0, 360.0);
+    }));
+
+    Report ("Geodesy/TranslateBatch", MeasureNs (100, [&] (uint32_t i)
+    {
+        latsEnd = lats;
+        lonsEnd = lons;
+        CGeodesy::TranslateBatch (cPoints, heads.data (), dists.data (), latsEnd.data (), lonsEnd.data ());
+    }) / cPoints, "point");
+
+    Report ("Geodesy/TranslateBatch/poly", MeasureNs (100, [&] (uint32_t i)
+    {
+        latsEnd = lats;
+        lonsEnd = lons;
+        CGeodesy::TranslateBatch (cPoints, heads.data (), dists.data (), latsEnd.data (), lonsEnd.data (), TRIG_MODE_POLY);
+    }) / cPoints, "point");
+
+    Report ("Geodesy/DirectBatch", MeasureNs (100, [&] (uint32_t i)
+    {
+        CGeodesy::DirectBatch (cPoints, lats.data (), lons.data (), heads.data (), dists.data (),
+                               latsEnd.data (), lonsEnd.data ());
+    }) / cPoints, "point");
+
+    Report ("Geodesy/DistanceFt", MeasureNs (100, [&] (uint32_t i)
+    {
+        for (uint32_t j = 0; j < cPoints; j++) dists[j] = CGeodesy::DistanceFt (lats[j], lons[j], latsEnd[j], lonsEnd[j]);
+    }) / cPoints, "point");
+
+    Report ("Geodesy/InverseBatch", MeasureNs (100, [&] (uint32_t i)
+    {
+        CGeodesy::InverseBatch (cPoints, lats.data (), lons.data (), latsEnd.data (), lonsEnd.data (),
+                                dists.data (), heads.data ());
+    }) / cPoints, "point");
+}
+
+
+/**
+ * The polynomial trig against the C library: the largest error of each function over its range, then that of
+ *  TranslateBatch in feet over all headings (1 degree steps), by latitude up to a few hundred feet from the pole.
+ */
+static void BenchTrig ()
+{
+    static const double s_lats[] = { 0.0, 30.0, 45.0, 60.0, 80.0, 89.0, 89.9, 89.99, 89.999 };
+    char                szName[128];
+    double              dSinErr  = 0.0;
+    double              dCosErr  = 0.0;
+    double              dAsinErr = 0.0;
+
+    for (int i = -1000000; i <= 1000000; i++)
+    {
+        double dRad = i * (4.0 * M_PI / 1000000);
+        double dSin;
+        double dCos;
+        CPolyTrig::SinCos (dRad, dSin, dCos);
+
+        dSinErr  = std::max (dSinErr,  fabs (dSin - sin (dRad)));
+        dCosErr  = std::max (dCosErr,  fabs (dCos - cos (dRad)));
+        dAsinErr = std::max (dAsinErr, fabs (CPolyTrig::Asin (i / 1000000.0) - asin (i / 1000000.0)));
+    }
+    Record ("Trig/Sin/ErrorRad", dSinErr, "rad");
+    Record ("Trig/Cos/ErrorRad", dCosErr, "rad");
+    Record ("Trig/Asin/ErrorRad", dAsinErr, "rad");
+
+    for (size_t iLat = 0; iLat < sizeof (s_lats) / sizeof (s_lats[0]); iLat++)
+    {
+        for (size_t iDist = 0; iDist < sizeof (s_distsFt) / sizeof (s_distsFt[0]); iDist++)
+        {
+            std::vector<double> heads (360);
+            std::vector<double> dists (360, s_distsFt[iDist]);
+            std::vector<double> latsLibm (360, s_lats[iLat]);
+            std::vector<double> lonsLibm (360, BENCH_LON);
+            std::vector<double> latsPoly (360, s_lats[iLat]);
+            std::vector<double> lonsPoly (360, BENCH_LON);
+            double              dErrFt = 0.0;
+
+            for (int iHead = 0; iHead < 360; iHead++) heads[iHead] = iHead;
+
+            CGeodesy::TranslateBatch (360, heads.data (), dists.data (), latsLibm.data (), lonsLibm.data (), TRIG_MODE_LIBM);
+            CGeodesy::TranslateBatch (360, heads.data (), dists.data (), latsPoly.data (), lonsPoly.data (), TRIG_MODE_POLY);
+
+            for (int iHead = 0; iHead < 360; iHead++)
+            {
+                dErrFt = std::max (dErrFt, CGeodesy::DistanceFt (latsLibm[iHead], lonsLibm[iHead],
+                                                                 latsPoly[iHead], lonsPoly[iHead]));
+            }
+
+            snprintf (szName, sizeof (szName), "Trig/TranslateErrorFt/lat=%g/d=%s", s_lats[iLat], s_distNames[iDist]);
+            Record (szName, dErrFt, "ft");
+        }
+    }
+}
+
+
+/**
+ * Placing a 500-vehicle ramp (a 20 by 25 grid) in one CFormation::Place, against a CGeodesy::Translate per vehicle,
+ *  and the largest difference between the two. The ring is large enough to need the spherical fallback.
+ */
+static void BenchFormation ()
+{
+    CFormation          ramp;
+    CFormation          ring;
+    std::vector<double> bearings;
+    std::vector<double> dists;
+    std::vector<LatLon> positions (500);
+    double              dErrFt = 0.0;
+
+    ramp.Grid (20, 25, 200.0, 60.0, 40.0, 180.0);
+    ring.Ring (500, CDistance::Nm (20.0).Ft (), 90.0);
+
+    ramp.Place (BENCH_LAT, BENCH_LON, 123.4);
+    for (uint32_t i = 0; i < ramp.Count (); i++)
+    {
+        double dAhead = 200.0 + (i / 25) * 60.0;
+        double dRight = (i % 25 - 12.0) * 40.0;
+        LatLon from   = { CAngle::Degrees (BENCH_LAT), CAngle::Degrees (BENCH_LON) };
+        LatLon to     = CGeodesy::Translate (from, CHeading::Degrees (123.4 + CAngle::Radians (atan2 (dRight, dAhead)).Deg ()),
+                                             CDistance::Feet (hypot (dAhead, dRight)));
+
+        dErrFt = std::max (dErrFt, CGeodesy::DistanceFt (to.lat.Deg (), to.lon.Deg (), ramp.LatAt (i), ramp.LonAt (i)));
+        bearings.push_back (123.4 + CAngle::Radians (atan2 (dRight, dAhead)).Deg ());
+        dists.push_back (hypot (dAhead, dRight));
+    }
+    Record ("Formation/ErrorFt/Grid/n=500", dErrFt, "ft");
+
+    Report ("Formation/Place/Grid/n=500", MeasureNs (1000, [&] (uint32_t i)
+    {
+        ramp.Place (BENCH_LAT, BENCH_LON, i * 0.1);
+    }) / 500, "vehicle");
+
+    Report ("Formation/Translate/Grid/n=500", MeasureNs (1000, [&] (uint32_t i)
+    {
+        LatLon from = { CAngle::Degrees (BENCH_LAT), CAngle::Degrees (BENCH_LON) };
+        for (uint32_t j = 0; j < 500; j++)
+        {
+            positions[j] = CGeodesy::Translate (from, CHeading::Degrees (bearings[j] + i * 0.1), CDistance::Feet (dists[j]));
+        }
+    }) / 500, "vehicle");
+
+    Report ("Formation/Place/Ring/r=20nm/n=500", MeasureNs (1000, [&] (uint32_t i)
+    {
+        ring.Place (BENCH_LAT, BENCH_LON, i * 0.1);
+    }) / 500, "vehicle");
+}
+
+
+/**
+ * A taxi session replayed at 60 frames per second: stops, straights and turns of different rates, with speed
+ *  changing at 3 ft/s^2 and turn rates that switch on and off between frames. There is no recording of a real
+ *  session to replay, so this one is synthesized.
+ */
+typedef struct TaxiLeg
+{
+    double dSeconds;
+    double dSpeedKt;
+    double dTurnDegPerSec;
+}
+TaxiLeg;
+
+static const TaxiLeg s_taxiLegs[] =
+{
+    { 20.0,  0.0,   0.0  },
+    { 30.0, 15.0,   0.0  },
+    { 12.0, 10.0,   7.5  },
+    { 40.0, 20.0,   0.0  },
+    {  8.0,  8.0, -11.25 },
+    { 20.0, 15.0,   0.0  },
+    { 15.0,  0.0,   0.0  },
+    { 25.0, 12.0,   3.0  },
+    { 10.0,  5.0,  18.0  },
+    { 30.0, 18.0,   0.0  },
+    { 10.0,  0.0,   0.0  },
+};
+
+static const double s_dFrameSec = 1.0 / 60.0;
+
+/**
+ * The true position and heading of the taxi session in every frame.
+ */
+static void SynthesizeTaxi (std::vector<double>& lats,
+                            std::vector<double>& lons,
+                            std::vector<double>& heads)
+{
+    const double        dFrameSec = s_dFrameSec;
+    double              dNorthFt  = 0.0;
+    double              dEastFt   = 0.0;
+    double              dHead     = 0.0;
+    double              dSpeedFt  = 0.0;
+    double              dFtPerLon = CGeodesy::FT_PER_DEG * cos (CAngle::Degrees (BENCH_LAT).Rad ());
+
+    for (size_t iLeg = 0; iLeg < _countof (s_taxiLegs); iLeg++)
+    {
+        const TaxiLeg& leg     = s_taxiLegs[iLeg];
+        double         dTarget = CDistance::Nm (leg.dSpeedKt).Ft () / 3600.0;
+
+        for (uint32_t iFrame = 0; iFrame < (uint32_t)(leg.dSeconds / dFrameSec); iFrame++)
+        {
+            dSpeedFt += std::max (-3.0 * dFrameSec, std::min (3.0 * dFrameSec, dTarget - dSpeedFt));
+            dHead     = CGeodesy::Mod (dHead + (dSpeedFt > 0.0 ? leg.dTurnDegPerSec * dFrameSec : 0.0), 360.0);
+            dNorthFt += dSpeedFt * dFrameSec * cos (CAngle::Degrees (dHead).Rad ());
+            dEastFt  += dSpeedFt * dFrameSec * sin (CAngle::Degrees (dHead).Rad ());
+
+            lats.push_back (BENCH_LAT + dNorthFt / CGeodesy::FT_PER_DEG);
+            lons.push_back (BENCH_LON + dEastFt / dFtPerLon);
+            heads.push_back (dHead);
+        }
+    }
+}
+
+static void BenchDeadReckoning ()
+{
+    const double        dFrameSec = s_dFrameSec;
+    std::vector<double> lats;
+    std::vector<double> lons;
+    std::vector<double> heads;
+
+    SynthesizeTaxi (lats, lons, heads);
+
+    const double   tolerancesFt[] = { 0.25, 1.0, 4.0, 1.0, 4.0 };
+    const uint32_t framesMax[]    = { 32,   32,  32,  128, 128 };
+    uint32_t       cFrames        = (uint32_t)lats.size ();
+
+    for (size_t iRun = 0; iRun < _countof (tolerancesFt); iRun++)
+    {
+        CDeadReckoner reckoner (tolerancesFt[iRun], framesMax[iRun]);
+        uint32_t      cFixes    = 0;
+        uint32_t      iNextFix  = 0;
+        double        dMaxErrFt = 0.0;
+        double        dSumSqFt  = 0.0;
+
+        for (uint32_t i = 0; i < cFrames; i++)
+        {
+            if (i == iNextFix)
+            {
+                // What the consumer sees is the fix itself
+                iNextFix = i + reckoner.OnFix (1, i * dFrameSec, lats[i], lons[i], heads[i]);
+                cFixes++;
+                continue;
+            }
+
+            double dLat;
+            double dLon;
+            double dHeadPredicted;
+            reckoner.Predict (1, i * dFrameSec, dLat, dLon, dHeadPredicted);
+
+            double dErrFt = CGeodesy::DistanceFt (lats[i], lons[i], dLat, dLon);
+            dMaxErrFt  = std::max (dMaxErrFt, dErrFt);
+            dSumSqFt  += dErrFt * dErrFt;
+        }
+
+        char szName[96];
+        snprintf (szName, sizeof (szName), "DeadReckoning/MessageReduction/tol=%gft/max=%u", tolerancesFt[iRun], framesMax[iRun]);
+        Record (szName, (double)cFrames / cFixes, "x");
+        snprintf (szName, sizeof (szName), "DeadReckoning/MaxErrorFt/tol=%gft/max=%u", tolerancesFt[iRun], framesMax[iRun]);
+        Record (szName, dMaxErrFt, "ft");
+        snprintf (szName, sizeof (szName), "DeadReckoning/RmsErrorFt/tol=%gft/max=%u", tolerancesFt[iRun], framesMax[iRun]);
+        Record (szName, sqrt (dSumSqFt / cFrames), "ft");
+    }
+
+    CDeadReckoner reckoner;
+    for (uint32_t idObject = 1; idObject <= 256; idObject++)
+    {
+        reckoner.OnFix (idObject, 0.0, lats[0], lons[0], heads[0]);
+        reckoner.OnFix (idObject, 0.5, lats[idObject * 30], lons[idObject * 30], heads[idObject * 30]);
+    }
+
+    Report ("DeadReckoning/Predict/n=256", MeasureNs (1000, [&] (uint32_t i)
+    {
+        double dLat;
+        double dLon;
+        double dHeadPredicted;
+        for (uint32_t idObject = 1; idObject <= 256; idObject++)
+        {
+            reckoner.Predict (idObject, 0.5 + (i % 32) * dFrameSec, dLat, dLon, dHeadPredicted);
+            s_dSink += dLat;
+        }
+    }) / 256, "object");
+
+    // MeasureNs repeats the same i, but every fix has to be newer than the last
+    uint32_t cFixes = 0;
+    Report ("DeadReckoning/OnFix/n=256", MeasureNs (100, [&] (uint32_t i)
+    {
+        cFixes++;
+        for (uint32_t idObject = 1; idObject <= 256; idObject++)
+        {
+            uint32_t iFrame = (idObject * 30 + cFixes) % cFrames;
+            reckoner.OnFix (idObject, 0.5 + cFixes * dFrameSec, lats[iFrame], lons[iFrame], heads[iFrame]);
+        }
+    }) / 256, "object");
+}
+
+static void BenchKalman ()
+{
+    std::vector<double> lats;
+    std::vector<double> lons;
+    std::vector<double> heads;
+
+    SynthesizeTaxi (lats, lons, heads);
+
+    // Samples 1 to 4 frames apart, with 1 ft of noise on each axis and 0.5 degrees on the heading
+    std::mt19937                     rng (7);
+    std::uniform_int_distribution<>  skip (1, 4);
+    std::normal_distribution<double> noiseFt (0.0, 1.0);
+    std::normal_distribution<double> noiseDeg (0.0, 0.5);
+    CKalmanBank                      filter;
+    uint32_t                         cFrames    = (uint32_t)lats.size ();
+    uint32_t                         iNext      = 0;
+    uint32_t                         cSamples   = 0;
+    double                           dFtPerLon  = CGeodesy::FT_PER_DEG * cos (CAngle::Degrees (BENCH_LAT).Rad ());
+    double                           dRawSqFt   = 0.0;
+    double                           dRawSqDeg  = 0.0;
+    double                           dSumSqFt   = 0.0;
+    double                           dSumSqDeg  = 0.0;
+    double                           dSumSqTurn = 0.0;
+
+    for (uint32_t i = 0; i < cFrames; i++)
+    {
+        if (i == iNext)
+        {
+            uint32_t idObject = 1;
+            double   dTime    = i * s_dFrameSec;
+            double   dLat     = lats[i] + noiseFt (rng) / CGeodesy::FT_PER_DEG;
+            double   dLon     = lons[i] + noiseFt (rng) / dFtPerLon;
+            double   dHead    = CGeodesy::Mod (heads[i] + noiseDeg (rng), 360.0);
+
+            filter.Update (1, &idObject, &dTime, &dLat, &dLon, &dHead);
+
+            double dErrDeg = fabs (CGeodesy::Mod (dHead - heads[i] + 180.0, 360.0) - 180.0);
+            dRawSqFt  += pow (CGeodesy::DistanceFt (lats[i], lons[i], dLat, dLon), 2.0);
+            dRawSqDeg += dErrDeg * dErrDeg;
+            iNext     += skip (rng);
+            cSamples++;
+        }
+
+        CKalmanBank::Estimate estimate;
+        filter.EstimateAt (1, i * s_dFrameSec, estimate);
+
+        // The session turns at a constant rate within each frame, so the difference to the next one is exact
+        double dErrDeg   = fabs (CGeodesy::Mod (estimate.dHead - heads[i] + 180.0, 360.0) - 180.0);
+        double dTrueTurn = i + 1 < cFrames ? (CGeodesy::Mod (heads[i + 1] - heads[i] + 180.0, 360.0) - 180.0) / s_dFrameSec
+                                           : 0.0;
+
+        dSumSqFt   += pow (CGeodesy::DistanceFt (lats[i], lons[i], estimate.dLat, estimate.dLon), 2.0);
+        dSumSqDeg  += dErrDeg * dErrDeg;
+        dSumSqTurn += pow (estimate.dTurn - dTrueTurn, 2.0);
+    }
+
+    Record ("Kalman/RmsErrorFt/Samples", sqrt (dRawSqFt / cSamples), "ft");
+    Record ("Kalman/RmsErrorFt/Filtered", sqrt (dSumSqFt / cFrames), "ft");
+    Record ("Kalman/RmsErrorDeg/Samples", sqrt (dRawSqDeg / cSamples), "deg");
+    Record ("Kalman/RmsErrorDeg/Filtered", sqrt (dSumSqDeg / cFrames), "deg");
+    Record ("Kalman/RmsTurnErrorDegPerSec/Filtered", sqrt (dSumSqTurn / cFrames), "deg/s");
+
+    // Thousands of objects, each with a sample every frame
+    const uint32_t        cObjects = 4096;
+    CKalmanBank           bank;
+    std::vector<uint32_t> ids (cObjects);
+    std::vector<double>   times (cObjects);
+    std::vector<double>   sampleLats (cObjects);
+    std::vector<double>   sampleLons (cObjects);
+    std::vector<double>   sampleHeads (cObjects);
+    uint32_t              cUpdates = 0;
+
+    bank.Reserve (cObjects);
+    for (uint32_t i = 0; i < cObjects; i++)
+    {
+        ids[i] = 1000 + i * 7;
+    }
+
+    // MeasureNs repeats the same i, but every sample has to be newer than the last
+    Report ("Kalman/Update/n=4096", MeasureNs (100, [&] (uint32_t i)
+    {
+        cUpdates++;
+        for (uint32_t j = 0; j < cObjects; j++)
+        {
+            uint32_t iFrame = (j * 13 + cUpdates) % cFrames;
+            times[j]       = cUpdates * s_dFrameSec;
+            sampleLats[j]  = lats[iFrame];
+            sampleLons[j]  = lons[iFrame];
+            sampleHeads[j] = heads[iFrame];
+        }
+        bank.Update (cObjects, ids.data (), times.data (), sampleLats.data (), sampleLons.data (), sampleHeads.data ());
+    }) / cObjects, "sample");
+
+    Report ("Kalman/EstimateAll/n=4096", MeasureNs (100, [&] (uint32_t i)
+    {
+        bank.EstimateAll ((cUpdates + 0.5) * s_dFrameSec);
+        s_dSink += bank.LatAt (i % cObjects);
+    }) / cObjects, "object");
+}
+
+
+// Timers outstanding, one in ten periodic; ticks are milliseconds, as in the demo
+static const uint32_t           TIMER_COUNT = 100000;
+static std::vector<uint32_t>    s_timerDelays;
+static uint32_t                 s_iTimerDelay;
+static uint32_t                 s_cTimersFired;
+
+typedef struct BenchTimer
+{
+    CTimerWheel* pWheel;
+    uint64_t     idTimer;
+    uint32_t     nPeriod;
+}
+BenchTimer;
+
+static uint32_t NextTimerDelay ()
+{
+    return s_timerDelays[s_iTimerDelay++ % s_timerDelays.size ()];
+}
+
+static void CALLBACK BenchTimerProc (uint64_t idTimer,
+                                     void*    pContext)
+{
+    BenchTimer* pTimer = (BenchTimer*)pContext;
+    s_cTimersFired++;
+
+    // One-shot timers are replaced, so the number outstanding stays the same
+    if (pTimer->nPeriod == 0) pTimer->idTimer = pTimer->pWheel->Schedule (NextTimerDelay (), 0, BenchTimerProc, pTimer);
+}
+
+/**
+ * 100k outstanding timers with delays up to a minute, against a sorted map of expiries.
+ */
+static void BenchTimerWheel ()
+{
+    std::mt19937                            rng (42);
+    std::uniform_int_distribution<uint32_t> delay (1, 60000);
+    std::uniform_int_distribution<uint32_t> period (100, 10000);
+    std::vector<uint32_t>                   periods (TIMER_COUNT);
+
+    s_timerDelays.resize (65536);
+    for (size_t i = 0; i < s_timerDelays.size (); i++) s_timerDelays[i] = delay (rng);
+    for (uint32_t i = 0; i < TIMER_COUNT; i++) periods[i] = i % 10 == 0 ? period (rng) : 0;
+
+    CTimerWheel             wheel;
+    std::vector<BenchTimer> timers (TIMER_COUNT);
+
+    s_iTimerDelay = 0;
+    wheel.Reserve (TIMER_COUNT);
+    for (uint32_t i = 0; i < TIMER_COUNT; i++)
+    {
+        BenchTimer& timer = timers[i];
+        timer.pWheel  = &wheel;
+        timer.nPeriod = periods[i];
+        timer.idTimer = wheel.Schedule (timer.nPeriod > 0 ? timer.nPeriod : NextTimerDelay (), timer.nPeriod,
+                                        BenchTimerProc, &timer);
+    }
+
+    // Pushing a timeout back: cancel it and schedule it again
+    Report ("TimerWheel/Reschedule/n=100000", MeasureNs (TIMER_COUNT, [&] (uint32_t i)
+    {
+        BenchTimer& timer = timers[(i * 7919) % TIMER_COUNT];
+        wheel.Cancel (timer.idTimer);
+        timer.idTimer = wheel.Schedule (timer.nPeriod > 0 ? timer.nPeriod : NextTimerDelay (), timer.nPeriod,
+                                        BenchTimerProc, &timer);
+    }), "timer");
+
+    uint32_t cTicks = 0;
+    s_cTimersFired = 0;
+    Report ("TimerWheel/Advance/n=100000", MeasureNs (60000, [&] (uint32_t i)
+    {
+        wheel.AdvanceTo (wheel.Now () + 1);
+        cTicks++;
+    }), "tick");
+    Record ("TimerWheel/FiredPerTick/n=100000", (double)s_cTimersFired / cTicks, "timers");
+    s_dSink += wheel.Count ();
+
+    // The same timers in a multimap from expiry to timer
+    typedef std::multimap<uint64_t, uint32_t> TimerMap;
+
+    TimerMap                        queue;
+    std::vector<TimerMap::iterator> its (TIMER_COUNT);
+    uint64_t                        nNow = 0;
+
+    s_iTimerDelay = 0;
+    for (uint32_t i = 0; i < TIMER_COUNT; i++)
+    {
+        its[i] = queue.insert (std::make_pair (nNow + (periods[i] > 0 ? periods[i] : NextTimerDelay ()), i));
+    }
+
+    Report ("TimerMap/Reschedule/n=100000", MeasureNs (TIMER_COUNT, [&] (uint32_t i)
+    {
+        uint32_t iTimer = (i * 7919) % TIMER_COUNT;
+        queue.erase (its[iTimer]);
+        its[iTimer] = queue.insert (std::make_pair (nNow + (periods[iTimer] > 0 ? periods[iTimer] : NextTimerDelay ()), iTimer));
+    }), "timer");
+
+    Report ("TimerMap/Advance/n=100000", MeasureNs (60000, [&] (uint32_t i)
+    {
+        nNow++;
+        while (!queue.empty () && queue.begin ()->first <= nNow)
+        {
+            uint32_t iTimer = queue.begin ()->second;
+            queue.erase (queue.begin ());
+            its[iTimer] = queue.insert (std::make_pair (nNow + (periods[iTimer] > 0 ? periods[iTimer] : NextTimerDelay ()), iTimer));
+        }
+    }), "tick");
+    s_dSink += (double)queue.size ();
+}
+
+template <typename TRecv>
+static void InitRecv (TRecv&             recv,
+                      SIMCONNECT_RECV_ID eId)
+{
+    memset (&recv, 0, sizeof (recv));
+    recv.dwSize    = sizeof (recv);
+    recv.dwVersion = 4;
+    recv.dwID      = eId;
+}
+
+static void PostEvent (DWORD idEvent,
+                       DWORD dwData = 0)
+{
+    SIMCONNECT_RECV_EVENT evt;
+    InitRecv (evt, SIMCONNECT_RECV_ID_EVENT);
+    evt.uGroupID = SIMCONNECT_UNUSED;
+    evt.uEventID = idEvent;
+    evt.dwData   = dwData;
+    CSimConnectStandIn::Post (&evt);
+}
+
+/**
+ * To hSimConnect, or without it to the connection opened last, as for all of these.
+ */
+static void PostFrame (DWORD  idEvent,
+                       HANDLE hSimConnect = NULL)
+{
+    SIMCONNECT_RECV_EVENT_FRAME evt;
+    InitRecv (evt, SIMCONNECT_RECV_ID_EVENT_FRAME);
+    evt.uGroupID   = SIMCONNECT_UNUSED;
+    evt.uEventID   = idEvent;
+    evt.fFrameRate = 60.0f;
+    evt.fSimSpeed  = 1.0f;
+
+    if (hSimConnect != NULL)
+    {
+        CSimConnectStandIn::Post (hSimConnect, &evt);
+    }
+    else
+    {
+        CSimConnectStandIn::Post (&evt);
+    }
+}
+
+static void PostAddRemove (DWORD                     idEvent,
+                           DWORD                     idObject,
+                           SIMCONNECT_SIMOBJECT_TYPE eType)
+{
+    SIMCONNECT_RECV_EVENT_OBJECT_ADDREMOVE evt;
+    InitRecv (evt, SIMCONNECT_RECV_ID_EVENT_OBJECT_ADDREMOVE);
+    evt.uGroupID = SIMCONNECT_UNUSED;
+    evt.uEventID = idEvent;
+    evt.dwData   = idObject;
+    evt.eObjType = eType;
+    CSimConnectStandIn::Post (&evt);
+}
+
+static void PostAssignedObjectId (DWORD idRequest,
+                                  DWORD idObject)
+{
+    SIMCONNECT_RECV_ASSIGNED_OBJECT_ID assigned;
+    InitRecv (assigned, SIMCONNECT_RECV_ID_ASSIGNED_OBJECT_ID);
+    assigned.dwRequestID = idRequest;
+    assigned.dwObjectID  = idObject;
+    CSimConnectStandIn::Post (&assigned);
+}
+
+static void PostException (SIMCONNECT_EXCEPTION eException)
+{
+    SIMCONNECT_RECV_EXCEPTION ex;
+    InitRecv (ex, SIMCONNECT_RECV_ID_EXCEPTION);
+    ex.dwException = eException;
+    CSimConnectStandIn::Post (&ex);
+}
+
+static void PostRecv (SIMCONNECT_RECV_ID eId,
+                      HANDLE             hSimConnect = NULL)
+{
+    SIMCONNECT_RECV recv;
+    InitRecv (recv, eId);
+
+    if (hSimConnect != NULL)
+    {
+        CSimConnectStandIn::Post (hSimConnect, &recv);
+    }
+    else
+    {
+        CSimConnectStandIn::Post (&recv);
+    }
+}
+
+/**
+ * A SIMOBJECT_DATA or SIMOBJECT_DATA_BYTYPE message (same layout) carrying FLOAT64 values. iEntry and cEntries only
+ *  matter for the latter, where they count from 1.
+ */
+static void PostObjectData (SIMCONNECT_RECV_ID eId,
+                            DWORD              idRequest,
+                            DWORD              idDefine,
+                            DWORD              idObject,
+                            const double*      pValues,
+                            DWORD              cValues,
+                            DWORD              iEntry   = 0,
+                            DWORD              cEntries = 0)
+{
+    BYTE                            buffer[sizeof (SIMCONNECT_RECV_SIMOBJECT_DATA) + 16 * sizeof (double)];
+    SIMCONNECT_RECV_SIMOBJECT_DATA* pObjData = (SIMCONNECT_RECV_SIMOBJECT_DATA*)buffer;
+
+    InitRecv (*pObjData, eId);
+    pObjData->dwSize        = (DWORD)(sizeof (SIMCONNECT_RECV_SIMOBJECT_DATA) - sizeof (DWORD) + cValues * sizeof (double));
+    pObjData->dwRequestID   = idRequest;
+    pObjData->dwObjectID    = idObject;
+    pObjData->dwDefineID    = idDefine;
+    pObjData->dwentrynumber = iEntry;
+    pObjData->dwoutof       = cEntries;
+    pObjData->dwDefineCount = cValues;
+    memcpy (&pObjData->dwData, pValues, cValues * sizeof (double));
+
+    CSimConnectStandIn::Post (pObjData);
+}
+
+/**
+ * Replay the messages posted to the stand-in through the demo, and report the mean time per message.
+ */
+static void ReportDispatch (const char*     szName,
+                            CDemoRudderPos& demo,
+                            DWORD           cMessages)
+{
+    CSimConnectStandIn::SetRepeat (true);
+    double dNs = MeasureNs (100, [&] (uint32_t i)
+    {
+        demo.Dispatch ();
+    });
+    CSimConnectStandIn::SetRepeat (false);
+    CSimConnectStandIn::Clear ();
+
+    Report (szName, dNs / cMessages, "msg");
+}
+
+/**
+ * The demo's DispatchProc for each kind of message it handles, against the stand-in backend. The demo is driven
+ *  through the states where each path does its real work: the user aircraft known, objects scanned around it, a
+ *  ground vehicle created and following a path.
+ */
+static void BenchDispatch ()
+{
+    CQuietStdout                        quiet;
+    CDemoRudderPos                      demo;
+    std::mt19937                        rng (42);
+    std::uniform_real_distribution<>    offset (-0.05, 0.05);
+    const CSimConnectStandIn::Request*  pRequest;
+
+    if (!demo.Open ()) return;
+
+    // Nothing the demo handles, which leaves the cost of the stand-in itself
+    for (DWORD i = 0; i < 1000; i++) PostRecv (SIMCONNECT_RECV_ID_NULL);
+    ReportDispatch ("Dispatch/Null", demo, 1000);
+
+    // Answer the request for the user aircraft, which repeats every second
+    double user[4] = { BENCH_LAT, BENCH_LON, 90.0, 400.0 };
+    pRequest = CSimConnectStandIn::FindRequest (SIMCONNECT_OBJECT_ID_USER, SIMCONNECT_PERIOD_SECOND);
+    PostObjectData (SIMCONNECT_RECV_ID_SIMOBJECT_DATA, pRequest->idRequest, pRequest->idDefine, SIMCONNECT_OBJECT_ID_USER, user, 4);
+    demo.Dispatch ();
+
+    // The aircraft flying north at 300 kt, a second apart, which moves the local frame every few samples; then back
+    for (DWORD i = 1; i <= 1000; i++)
+    {
+        double flying[4] = { BENCH_LAT + i * CDistance::Nm (300.0 / 3600.0).Ft () / CGeodesy::FT_PER_DEG, BENCH_LON, 0.0, 10000.0 };
+        PostObjectData (SIMCONNECT_RECV_ID_SIMOBJECT_DATA, pRequest->idRequest, pRequest->idDefine, SIMCONNECT_OBJECT_ID_USER, flying, 4);
+    }
+    ReportDispatch ("Dispatch/SimObjectData/UserObject", demo, 1000);
+    PostObjectData (SIMCONNECT_RECV_ID_SIMOBJECT_DATA, pRequest->idRequest, pRequest->idDefine, SIMCONNECT_OBJECT_ID_USER, user, 4);
+    demo.Dispatch ();
+
+    // A full scan cycle of five seconds: the second that starts it, 500 aircraft and 500 ground vehicles, then the
+    //  idle seconds
+    PostEvent (CDemoRudderPos::EVENT_ID_1SEC);
+    for (DWORD i = 0; i < 1000; i++)
+    {
+        double position[4] = { BENCH_LAT + offset (rng), BENCH_LON + offset (rng), (double)(i % 360), 0.0 };
+        bool   bAircraft   = i < 500;
+
+        PostObjectData (SIMCONNECT_RECV_ID_SIMOBJECT_DATA_BYTYPE,
+                        bAircraft ? CDemoRudderPos::DATA_REQ_ID_SCAN_AIRCRAFT : CDemoRudderPos::DATA_REQ_ID_SCAN_GROUND,
+                        CDemoRudderPos::DATA_DEF_ID_SCAN, 100 + i, position, 4, i % 500 + 1, 500);
+    }
+    for (DWORD i = 1; i < 5; i++) PostEvent (CDemoRudderPos::EVENT_ID_1SEC);
+    ReportDispatch ("Dispatch/ScanCycle/n=1000", demo, 1005);
+
+    for (DWORD i = 0; i < 100; i++) PostEvent (CDemoRudderPos::EVENT_ID_NEARBY);
+    ReportDispatch ("Dispatch/Event/Nearby/n=1000", demo, 100);
+
+    // Create the ground vehicle, then feed its position through the mux
+    PostEvent (CDemoRudderPos::EVENT_ID_CREATE);
+    PostAssignedObjectId (CDemoRudderPos::DATA_REQ_ID_SPAWN, 5000);
+    demo.Dispatch ();
+
+    pRequest = CSimConnectStandIn::FindRequest (5000, SIMCONNECT_PERIOD_SIM_FRAME, CDemoRudderPos::DATA_REQ_ID_MUX_FIRST);
+    for (DWORD i = 0; i < 1000; i++)
+    {
+        double vehicle[4] = { BENCH_LAT + i * 1e-6, BENCH_LON, 0.0, 400.0 };
+        PostObjectData (SIMCONNECT_RECV_ID_SIMOBJECT_DATA, pRequest->idRequest, pRequest->idDefine, 5000, vehicle,
+                        CSimConnectStandIn::DefinitionSize (pRequest->idDefine));
+    }
+    ReportDispatch ("Dispatch/SimObjectData/Mux", demo, 1000);
+
+    PostEvent (CDemoRudderPos::EVENT_ID_FOLLOW);
+    demo.Dispatch ();
+
+    for (DWORD i = 0; i < 1000; i++) PostFrame (CDemoRudderPos::EVENT_ID_FRAME);
+    ReportDispatch ("Dispatch/EventFrame/Follow", demo, 1000);
+
+    // While paused the frame tasks are skipped
+    PostEvent (CDemoRudderPos::EVENT_ID_PAUSE, 1);
+    demo.Dispatch ();
+
+    for (DWORD i = 0; i < 1000; i++) PostFrame (CDemoRudderPos::EVENT_ID_FRAME);
+    ReportDispatch ("Dispatch/EventFrame/Paused", demo, 1000);
+
+    PostEvent (CDemoRudderPos::EVENT_ID_PAUSE, 0);
+    demo.Dispatch ();
+
+    for (DWORD i = 0; i < 1000; i++)
+    {
+        double rudder = 0.5;
+        PostObjectData (SIMCONNECT_RECV_ID_SIMOBJECT_DATA, CDemoRudderPos::DATA_REQ_ID_GROUND_VEHICLE,
+                        CDemoRudderPos::DATA_DEF_ID_GROUND_VEHICLE, 5000, &rudder, 1);
+    }
+    ReportDispatch ("Dispatch/SimObjectData/Rudder", demo, 1000);
+
+    // Manual steering, which also ends the path following
+    for (DWORD i = 0; i < 500; i++)
+    {
+        PostEvent (CDemoRudderPos::EVENT_ID_RUDDER_LEFT);
+        PostEvent (CDemoRudderPos::EVENT_ID_RUDDER_RIGHT);
+    }
+    ReportDispatch ("Dispatch/Event/RudderLeftRight", demo, 1000);
+
+    for (DWORD i = 0; i < 500; i++)
+    {
+        PostAddRemove (CDemoRudderPos::EVENT_ID_OBJECT_ADDED,   10000 + i, SIMCONNECT_SIMOBJECT_TYPE_AIRCRAFT);
+        PostAddRemove (CDemoRudderPos::EVENT_ID_OBJECT_REMOVED, 10000 + i, SIMCONNECT_SIMOBJECT_TYPE_AIRCRAFT);
+    }
+    ReportDispatch ("Dispatch/ObjectAddRemove", demo, 1000);
+
+    // A vehicle assigned and removed again, which subscribes and unsubscribes it
+    for (DWORD i = 0; i < 500; i++)
+    {
+        PostAssignedObjectId (CDemoRudderPos::DATA_REQ_ID_SPAWN, 20000 + i);
+        PostAddRemove (CDemoRudderPos::EVENT_ID_OBJECT_REMOVED, 20000 + i, SIMCONNECT_SIMOBJECT_TYPE_GROUND);
+    }
+    ReportDispatch ("Dispatch/AssignedObjectId+Removed", demo, 1000);
+
+    for (DWORD i = 0; i < 1000; i++) PostException ((SIMCONNECT_EXCEPTION)(i % 40));
+    ReportDispatch ("Dispatch/Exception", demo, 1000);
+
+    for (DWORD i = 0; i < 1000; i++) PostRecv (SIMCONNECT_RECV_ID_QUIT);
+    ReportDispatch ("Dispatch/Quit", demo, 1000);
+
+    demo.Close ();
+}
+
+
+static void CALLBACK CountConsumerProc (DWORD         idObject,
+                                        const double* pValues,
+                                        DWORD         cValues,
+                                        void*         pContext)
+{
+    (*(DWORD*)pContext)++;
+}
+
+/**
+ * A reply still in flight from before a compaction and an append, with as many values as the current layout: only
+ *  its request ID tells it apart, so it must reach no consumer, while one under the current ID reaches both.
+ */
+static void BenchSubscriptionMux ()
+{
+    static const CSubscriptionMux::Field s_fieldsAB[2] = { { "A", "feet" }, { "B", "feet" } };
+    static const CSubscriptionMux::Field s_fieldC[1]   = { { "C", "feet" } };
+    static const CSubscriptionMux::Field s_fieldsDE[2] = { { "D", "feet" }, { "E", "feet" } };
+    const DWORD                          idReqFirst    = 100;
+    const DWORD                          cGroups       = 4;
+    CSubscriptionMux                     mux (0, idReqFirst, cGroups);
+    DWORD                                cDelivered    = 0;
+    double                               values[3]     = { 1.0, 2.0, 3.0 };
+    BYTE                                 buffer[sizeof (SIMCONNECT_RECV_SIMOBJECT_DATA) + sizeof (values)];
+    SIMCONNECT_RECV_SIMOBJECT_DATA*      pObjData      = (SIMCONNECT_RECV_SIMOBJECT_DATA*)buffer;
+
+    // Layout A B, then A B C, then C once A B are gone, then C D E: the request IDs of turns 0 to 3 of group 0
+    DWORD idAB = mux.Subscribe (5000, SIMCONNECT_PERIOD_SIM_FRAME, s_fieldsAB, 2, CountConsumerProc, &cDelivered);
+    mux.Subscribe (5000, SIMCONNECT_PERIOD_SIM_FRAME, s_fieldC, 1, CountConsumerProc, &cDelivered);
+    mux.Unsubscribe (idAB);
+    mux.Subscribe (5000, SIMCONNECT_PERIOD_SIM_FRAME, s_fieldsDE, 2, CountConsumerProc, &cDelivered);
+
+    InitRecv (*pObjData, SIMCONNECT_RECV_ID_SIMOBJECT_DATA);
+    pObjData->dwSize        = sizeof (buffer) - sizeof (DWORD);
+    pObjData->dwObjectID    = 5000;
+    pObjData->dwDefineCount = 3;
+    memcpy (&pObjData->dwData, values, sizeof (values));
+
+    pObjData->dwRequestID = idReqFirst + 1 * cGroups;
+    mux.OnSimObjectData (pObjData);
+    Record ("SubscriptionMux/StaleLayout/Delivered", cDelivered, "consumer");
+
+    pObjData->dwRequestID = idReqFirst + 3 * cGroups;
+    mux.OnSimObjectData (pObjData);
+    Record ("SubscriptionMux/CurrentLayout/Delivered", cDelivered, "consumer");
+}
+
+
+static void CALLBACK CountDispatchProc (SIMCONNECT_RECV* pData,
+                                        DWORD            cbData,
+                                        void*            pContext)
+{
+    (*(DWORD*)pContext)++;
+}
+
+/**
+ * Eight connections to stand-in sims, serviced from one loop. The messages are posted in the timed loop, as the sims
+ *  would send them while the client waits.
+ */
+static void BenchConnectionMux ()
+{
+    const DWORD    cConnections = 8;
+    CQuietStdout   quiet;
+    CConnectionMux connections;
+    HANDLE         handles[cConnections];
+    DWORD          counts[cConnections];
+
+    for (DWORD i = 0; i < cConnections; i++)
+    {
+        counts[i] = 0;
+        connections.Open ("Bench", i, CountDispatchProc, &counts[i], &handles[i]);
+    }
+
+    // Every sim has sent something
+    Report ("ConnectionMux/AllActive/n=8", MeasureNs (10000, [&] (uint32_t i)
+    {
+        for (DWORD j = 0; j < cConnections; j++) PostRecv (SIMCONNECT_RECV_ID_NULL, handles[j]);
+        connections.Dispatch (0);
+    }) / cConnections, "msg");
+
+    // One at a time has
+    Report ("ConnectionMux/OneActive/n=8", MeasureNs (10000, [&] (uint32_t i)
+    {
+        PostRecv (SIMCONNECT_RECV_ID_NULL, handles[i % cConnections]);
+        connections.Dispatch (0);
+    }), "msg");
+
+    // Without the events every connection is dispatched to find it, which with a real sim is a call into the
+    //  SimConnect library per connection, not the few nanoseconds of the stand-in
+    Report ("ConnectionMux/OneActive/n=8/poll", MeasureNs (10000, [&] (uint32_t i)
+    {
+        PostRecv (SIMCONNECT_RECV_ID_NULL, handles[i % cConnections]);
+        for (DWORD j = 0; j < cConnections; j++) SimConnect_CallDispatch (handles[j], CountDispatchProc, &counts[j]);
+    }), "msg");
+
+    for (DWORD i = 0; i < cConnections; i++)
+    {
+        s_dSink += counts[i];
+        connections.Close (handles[i]);
+    }
+
+    // A demo on each, all getting a frame
+    std::vector<CDemoRudderPos*> demos;
+    for (DWORD i = 0; i < cConnections; i++)
+    {
+        demos.push_back (new CDemoRudderPos ());
+        demos.back ()->Open (connections, i);
+    }
+
+    Report ("ConnectionMux/EventFrame/Demo/n=8", MeasureNs (1000, [&] (uint32_t i)
+    {
+        for (DWORD j = 0; j < cConnections; j++) PostFrame (CDemoRudderPos::EVENT_ID_FRAME, demos[j]->SimConnect ());
+        connections.Dispatch (0);
+    }) / cConnections, "msg");
+
+    for (DWORD i = 0; i < cConnections; i++)
+    {
+        demos[i]->Close ();
+        delete demos[i];
+    }
+}
+
+
+static void CALLBACK ChannelDispatchProc (SIMCONNECT_RECV* pData,
+                                          DWORD            cbData,
+                                          void*            pContext)
+{
+    if (pData->dwID == SIMCONNECT_RECV_ID_CLIENT_DATA)
+    {
+        ((CClientDataChannel*)pContext)->OnClientData ((SIMCONNECT_RECV_CLIENT_DATA*)pData);
+    }
+}
+
+static void CALLBACK CountBlockProc (const BYTE* pBlock,
+                                     DWORD       cbBlock,
+                                     DWORD       nBlock,
+                                     void*       pContext)
+{
+    (*(DWORD*)pContext)++;
+}
+
+/**
+ * Blocks of a few sizes through a client data channel between two connections to the stand-in: written, pumped in
+ *  chunks of 16 and dispatched to the reader until the whole block is in.
+ */
+static void BenchClientData ()
+{
+    const DWORD sizes[]     = { 64 << 10, 1 << 20, 16 << 20 };
+    const char* sizeNames[] = { "64KB", "1MB", "16MB" };
+
+    HANDLE hWriter = NULL;
+    HANDLE hReader = NULL;
+    if (FAILED (SimConnect_Open (&hWriter, "BenchWriter", NULL, 0, NULL, 0))) return;
+    if (FAILED (SimConnect_Open (&hReader, "BenchReader", NULL, 0, NULL, 0))) return;
+
+    CClientDataChannel writer (1, 1, 1);
+    CClientDataChannel reader (1, 1, 1);
+    DWORD              cBlocks = 0;
+
+    writer.OpenWriter (hWriter, "DemoRudderPosBench.Paths");
+    reader.OpenReader (hReader, "DemoRudderPosBench.Paths", CountBlockProc, &cBlocks);
+
+    for (size_t iSize = 0; iSize < _countof (sizes); iSize++)
+    {
+        std::vector<BYTE> block (sizes[iSize]);
+        DWORD             cMismatched = 0;
+        char              szName[64];
+
+        for (size_t i = 0; i < block.size (); i++) block[i] = (BYTE)(i * 31 + iSize);
+
+        double dNs = MeasureNs (std::max (1u, (64u << 20) / sizes[iSize] / 4), [&] (uint32_t i)
+        {
+            block[0] = (BYTE)i;
+            writer.Write (block.data (), (DWORD)block.size ());
+            while (writer.Pump (16) > 0) SimConnect_CallDispatch (hReader, ChannelDispatchProc, &reader);
+
+            if (reader.Block () != block) cMismatched++;
+        });
+
+        snprintf (szName, sizeof (szName), "ClientData/Block/%s", sizeNames[iSize]);
+        Record (szName, sizes[iSize] / dNs * 1e9 / (1 << 20), "MB/s");
+        snprintf (szName, sizeof (szName), "ClientData/Block/%s/Mismatched", sizeNames[iSize]);
+        Record (szName, cMismatched, "blocks");
+    }
+
+    s_dSink += cBlocks + reader.AbandonedCount ();
+    SimConnect_Close (hReader);
+    SimConnect_Close (hWriter);
+}
+
+
+/**
+ * What a connection to CStandInServer has received so far.
+ */
+typedef struct NetCounts
+{
+    DWORD     cOpen;
+    DWORD     cData;
+    DWORD     cException;
+    ULONGLONG cbData;
+}
+NetCounts;
+
+static void CALLBACK NetDispatchProc (SIMCONNECT_RECV* pData,
+                                      DWORD            cbData,
+                                      void*            pContext)
+{
+    NetCounts* pCounts = (NetCounts*)pContext;
+
+    switch (pData->dwID)
+    {
+        case SIMCONNECT_RECV_ID_OPEN:
+            pCounts->cOpen++;
+            break;
+
+        case SIMCONNECT_RECV_ID_SIMOBJECT_DATA:
+            pCounts->cData++;
+            pCounts->cbData += cbData;
+            break;
+
+        case SIMCONNECT_RECV_ID_EXCEPTION:
+            pCounts->cException++;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static double NowSec ()
+{
+    return std::chrono::duration<double> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+/**
+ * Dispatch until fn () is true or a few seconds have gone by; returns whether it became true.
+ */
+template <typename TFn>
+static bool DispatchUntil (HANDLE     hSimConnect,
+                           NetCounts& counts,
+                           TFn        fn)
+{
+    double dGiveUp = NowSec () + 5.0;
+
+    while (!fn ())
+    {
+        if (NowSec () > dGiveUp) return false;
+        SimConnect_CallDispatch (hSimConnect, NetDispatchProc, &counts);
+    }
+    return true;
+}
+
+/**
+ * Dispatch a CConnectionMux until fn () is true or a few seconds have gone by; returns whether it became true. Unlike
+ *  DispatchUntil, a connection is dispatched only when its event is set.
+ */
+template <typename TFn>
+static bool MuxUntil (CConnectionMux& mux,
+                      TFn             fn)
+{
+    double dGiveUp = NowSec () + 5.0;
+
+    while (!fn ())
+    {
+        if (NowSec () > dGiveUp) return false;
+        mux.Dispatch (100);
+    }
+    return true;
+}
+
+/**
+ * A stand-in connection in network mode against CStandInServer over loopback, behind links modelled on the
+ *  loopback itself, a LAN and a WAN: the time to open, the round trip of a one-shot request, how many writes go
+ *  out per second, and what a thousand objects requested every frame come to.
+ */
+static void BenchNetwork ()
+{
+    typedef struct Link
+    {
+        const char* szName;
+        double      dLatencyMs;
+        double      dBytesPerSec;
+    }
+    Link;
+
+    static const Link links[] =
+    {
+        { "loopback", 0.0,  0.0    },
+        { "lan",      0.25, 12.5e6 },
+        { "wan",      20.0, 1.25e6 }
+    };
+
+    const DWORD DEFINE_ID  = 1;
+    const DWORD REQUEST_ID = 1;
+    const DWORD cObjects   = 1000;
+    const DWORD cWrites    = 1000;
+    const DWORD cTrips     = 20;
+
+    for (size_t iLink = 0; iLink < sizeof (links) / sizeof (links[0]); iLink++)
+    {
+        const Link&            link = links[iLink];
+        CStandInServer         server;
+        CStandInServer::Config config;
+        char                   szName[128];
+
+        config.dLatencyMs   = link.dLatencyMs;
+        config.dBytesPerSec = link.dBytesPerSec;
+        if (!server.Start (config)) continue;
+
+        CSimConnectStandIn::SetServer (1, "127.0.0.1", server.Port ());
+
+        NetCounts counts;
+        HANDLE    hSimConnect = NULL;
+        memset (&counts, 0, sizeof (counts));
+
+        double dStart = NowSec ();
+        if (FAILED (SimConnect_Open (&hSimConnect, "Bench", NULL, 0, NULL, 1))
+            || !DispatchUntil (hSimConnect, counts, [&] () { return counts.cOpen > 0; }))
+        {
+            if (hSimConnect != NULL) SimConnect_Close (hSimConnect);
+            continue;
+        }
+        snprintf (szName, sizeof (szName), "Network/%s/Open", link.szName);
+        Record (szName, (NowSec () - dStart) * 1000.0, "ms");
+
+        // The four FLOAT64 fields of DataUserObject
+        CDemoRudderPos::DataUserObject data;
+        SimConnect_AddToDataDefinition (hSimConnect, DEFINE_ID, "PLANE LATITUDE", "degrees");
+        SimConnect_AddToDataDefinition (hSimConnect, DEFINE_ID, "PLANE LONGITUDE", "degrees");
+        SimConnect_AddToDataDefinition (hSimConnect, DEFINE_ID, "PLANE HEADING DEGREES TRUE", "degrees");
+        SimConnect_AddToDataDefinition (hSimConnect, DEFINE_ID, "PLANE ALTITUDE", "feet");
+
+        dStart = NowSec ();
+        for (DWORD i = 0; i < cTrips; i++)
+        {
+            DWORD cData = counts.cData;
+            SimConnect_RequestDataOnSimObject (hSimConnect, REQUEST_ID, DEFINE_ID, SIMCONNECT_OBJECT_ID_USER, SIMCONNECT_PERIOD_ONCE);
+            DispatchUntil (hSimConnect, counts, [&] () { return counts.cData > cData; });
+        }
+        snprintf (szName, sizeof (szName), "Network/%s/RoundTrip", link.szName);
+        Record (szName, (NowSec () - dStart) * 1000.0 / cTrips, "ms");
+
+        // The same through CConnectionMux, woken by the event the stand-in sets when the server sends something
+        {
+            CConnectionMux mux;
+            NetCounts      muxCounts;
+            HANDLE         hMuxed  = NULL;
+            DWORD          cMissed = cTrips;
+            memset (&muxCounts, 0, sizeof (muxCounts));
+
+            if (SUCCEEDED (mux.Open ("Bench", 1, NetDispatchProc, &muxCounts, &hMuxed)) && MuxUntil (mux, [&] () { return muxCounts.cOpen > 0; }))
+            {
+                SimConnect_AddToDataDefinition (hMuxed, DEFINE_ID, "PLANE LATITUDE", "degrees");
+
+                dStart = NowSec ();
+                for (DWORD i = 0; i < cTrips; i++)
+                {
+                    DWORD cData = muxCounts.cData;
+                    SimConnect_RequestDataOnSimObject (hMuxed, REQUEST_ID, DEFINE_ID, SIMCONNECT_OBJECT_ID_USER, SIMCONNECT_PERIOD_ONCE);
+                    if (MuxUntil (mux, [&] () { return muxCounts.cData > cData; })) cMissed--;
+                }
+                snprintf (szName, sizeof (szName), "Network/%s/Mux/RoundTrip", link.szName);
+                Record (szName, (NowSec () - dStart) * 1000.0 / cTrips, "ms");
+            }
+            snprintf (szName, sizeof (szName), "Network/%s/Mux/Missed", link.szName);
+            Record (szName, cMissed, "trips");
+        }
+
+        // The writes are done once a one-shot request sent after them is answered
+        dStart = NowSec ();
+        for (DWORD i = 0; i < cWrites; i++)
+        {
+            data.dHead = i % 360;
+            SimConnect_SetDataOnSimObject (hSimConnect, DEFINE_ID, SIMCONNECT_OBJECT_ID_USER, 0, 0, sizeof (data), &data);
+        }
+        DWORD cDataBefore = counts.cData;
+        SimConnect_RequestDataOnSimObject (hSimConnect, REQUEST_ID, DEFINE_ID, SIMCONNECT_OBJECT_ID_USER, SIMCONNECT_PERIOD_ONCE);
+        DispatchUntil (hSimConnect, counts, [&] () { return counts.cData > cDataBefore; });
+        snprintf (szName, sizeof (szName), "Network/%s/SetData", link.szName);
+        Record (szName, cWrites / (NowSec () - dStart), "writes/s");
+
+        // Every object every frame, counted over a second after the first of them have arrived
+        for (DWORD i = 0; i < cObjects; i++)
+        {
+            SimConnect_RequestDataOnSimObject (hSimConnect, REQUEST_ID + 1 + i, DEFINE_ID, 0x10000 + i, SIMCONNECT_PERIOD_SIM_FRAME);
+        }
+        cDataBefore = counts.cData;
+        DispatchUntil (hSimConnect, counts, [&] () { return counts.cData > cDataBefore; });
+
+        DWORD     cDataStart  = counts.cData;
+        ULONGLONG cbDataStart = counts.cbData;
+        dStart = NowSec ();
+        DispatchUntil (hSimConnect, counts, [&] () { return NowSec () - dStart >= 1.0; });
+        double dSec = NowSec () - dStart;
+
+        snprintf (szName, sizeof (szName), "Network/%s/Frame/n=%u", link.szName, (unsigned)cObjects);
+        Record (szName, (counts.cData - cDataStart) / dSec, "msg/s");
+        snprintf (szName, sizeof (szName), "Network/%s/Frame/n=%u/bytes", link.szName, (unsigned)cObjects);
+        Record (szName, (counts.cbData - cbDataStart) / dSec / 1e6, "MB/s");
+
+        s_dSink += counts.cException;
+        SimConnect_Close (hSimConnect);
+        server.Stop ();
+    }
+
+    CSimConnectStandIn::SetServer (1, NULL, 0);
+}
+
+
+/**
+ * Publishing to the telemetry bus and reading from it, a reader that has fallen behind, and how long a sample takes
+ *  to reach a reader spinning on another thread. A second publisher of a bus is turned away, and on POSIX systems
+ *  one left behind by a publisher that died is replaced.
+ */
+static void BenchTelemetryBus ()
+{
+    const DWORD         cSlots   = 4096;
+    const DWORD         cSamples = 100000;
+    CTelemetryPublisher publisher;
+    CTelemetryReader    reader;
+    BusSample           sample;
+    double              values[4] = { BENCH_LAT, BENCH_LON, 90.0, 400.0 };
+
+    if (!publisher.Open ("DemoRudderPosBench", cSlots) || !reader.Open ("DemoRudderPosBench")) return;
+
+    CTelemetryPublisher second;
+    Record ("TelemetryBus/Open/Taken", second.Open ("DemoRudderPosBench", cSlots) ? 1.0 : 0.0, "publishers");
+
+#ifndef _WIN32
+    // The child exits without closing its bus, as if it had crashed
+    pid_t pid = fork ();
+    if (pid == 0)
+    {
+        CTelemetryPublisher crashed;
+        _exit (crashed.Open ("DemoRudderPosBench.Stale", cSlots) ? 0 : 1);
+    }
+
+    int nStatus = 1;
+    if (pid > 0) waitpid (pid, &nStatus, 0);
+    if (WIFEXITED (nStatus) && WEXITSTATUS (nStatus) == 0)
+    {
+        Record ("TelemetryBus/Open/Stale", second.Open ("DemoRudderPosBench.Stale", cSlots) ? 1.0 : 0.0, "replaced");
+        second.Close ();
+    }
+#endif
+
+    Report ("TelemetryBus/Publish", MeasureNs (cSamples, [&] (uint32_t i)
+    {
+        publisher.Publish (BUS_KIND_USER_OBJECT, i, i / 60.0, values, 4);
+    }), "sample");
+
+    // The reader was left behind by all of that
+    s_dSink += reader.Read (sample) == CTelemetryReader::READ_LAGGED ? 1.0 : 0.0;
+    Record ("TelemetryBus/Lagged/Dropped", (double)reader.Dropped (), "samples");
+    while (reader.Read (sample) != CTelemetryReader::READ_EMPTY) s_dSink += sample.dSimTime;
+
+    Report ("TelemetryBus/PublishRead", MeasureNs (cSamples, [&] (uint32_t i)
+    {
+        publisher.Publish (BUS_KIND_USER_OBJECT, i, i / 60.0, values, 4);
+        reader.Read (sample);
+        s_dSink += sample.dValues[0];
+    }), "sample");
+
+    // Samples published a few microseconds apart, each stamped with when it was, and the time the reader got it
+    const DWORD           cTimed = 20000;
+    std::vector<double>   published (cTimed);
+    std::vector<double>   latencies;
+    std::atomic<bool>     bStop (false);
+    latencies.reserve (cTimed);
+
+    std::thread thread ([&] ()
+    {
+        CTelemetryReader spinner;
+        BusSample        got;
+        if (!spinner.Open ("DemoRudderPosBench")) return;
+
+        while (!bStop || spinner.Lag () > 0)
+        {
+            if (spinner.Read (got) != CTelemetryReader::READ_OK)
+            {
+                std::this_thread::yield ();
+                continue;
+            }
+
+            double dNow = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+            if (got.idObject < cTimed) latencies.push_back (dNow - published[got.idObject]);
+        }
+    });
+
+    // Give the reader time to open the bus before the first sample
+    std::this_thread::sleep_for (std::chrono::milliseconds (10));
+
+    for (DWORD i = 0; i < cTimed; i++)
+    {
+        double dNow = std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+        double dNext = dNow + 5000.0;
+
+        published[i] = dNow;
+        publisher.Publish (BUS_KIND_USER_OBJECT, i, 0.0, values, 4);
+
+        while (std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now ().time_since_epoch ()).count () < dNext)
+        {
+            std::this_thread::yield ();
+        }
+    }
+    bStop = true;
+    thread.join ();
+
+    if (!latencies.empty ())
+    {
+        std::sort (latencies.begin (), latencies.end ());
+        Record ("TelemetryBus/Latency/p50", latencies[latencies.size () / 2], "ns");
+        Record ("TelemetryBus/Latency/p99", latencies[latencies.size () * 99 / 100], "ns");
+        Record ("TelemetryBus/Latency/Received", 100.0 * latencies.size () / cTimed, "%");
+    }
+}
+
+/**
+ * A session as the demo would record it, in the order the samples would arrive in: the user aircraft on the taxi
+ *  session and ground vehicles driving the same route, some way behind it, each with its rudder, all at the frame
+ *  rate. The rudder follows the rate of turn, full at 12 degrees a second.
+ */
+static void SynthesizeSession (DWORD                   cVehicles,
+                               std::vector<BusSample>& session)
+{
+    std::vector<double> lats;
+    std::vector<double> lons;
+    std::vector<double> heads;
+
+    SynthesizeTaxi (lats, lons, heads);
+
+    const size_t cFrames = lats.size ();
+    session.resize (cFrames * (1 + cVehicles) * 2);
+
+    BusSample* pSample = session.data ();
+    for (size_t iFrame = 0; iFrame < cFrames; iFrame++)
+    {
+        for (DWORD iObject = 0; iObject <= cVehicles; iObject++)
+        {
+            size_t iBehind  = (iFrame + cFrames - iObject * 600 % cFrames) % cFrames;
+            size_t iBefore  = (iBehind + cFrames - 1) % cFrames;
+            double dTurn    = CGeodesy::Mod (heads[iBehind] - heads[iBefore] + 180.0, 360.0) - 180.0;
+            DWORD  idObject = iObject == 0 ? 0 : 100 + iObject;
+
+            *pSample++ = { (DWORD)(iObject == 0 ? BUS_KIND_USER_OBJECT : BUS_KIND_GROUND_VEHICLE), idObject, iFrame * s_dFrameSec,
+                           { lats[iBehind], lons[iBehind], heads[iBehind], 433.0 } };
+            *pSample++ = { BUS_KIND_RUDDER, idObject, iFrame * s_dFrameSec, { std::max (-1.0, std::min (1.0, dTurn / s_dFrameSec / 12.0)), 0.0, 0.0, 0.0 } };
+        }
+    }
+}
+
+static void BenchRecorder ()
+{
+    const char*            szPath = "DemoRudderPosBench.trec";
+    std::vector<BusSample> session;
+
+    SynthesizeSession (8, session);
+
+    const size_t cSamples = session.size ();
+
+    double dBestNs = 1e300;
+    for (int iRun = 0; iRun < 5; iRun++)
+    {
+        CTelemetryRecorder recorder;
+        if (!recorder.Open (szPath)) return;
+
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+        for (size_t i = 0; i < cSamples; i++) recorder.Record (session[i]);
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now ();
+
+        dBestNs = std::min (dBestNs, std::chrono::duration<double, std::nano> (t1 - t0).count () / cSamples);
+    }
+    Report ("Recorder/Record", dBestNs, "sample");
+
+    // Read the last recording back, block by block
+    FILE* pFile = fopen (szPath, "rb");
+    if (pFile == NULL) return;
+
+    std::vector<BYTE> file;
+    BYTE              buffer[65536];
+    size_t            cbRead;
+    while ((cbRead = fread (buffer, 1, sizeof (buffer), pFile)) > 0) file.insert (file.end (), buffer, buffer + cbRead);
+    fclose (pFile);
+    remove (szPath);
+
+    std::vector<int64_t>        times (TELEMETRY_REC_BLOCK_SAMPLES);
+    std::vector<double>         fields (TELEMETRY_REC_FIELDS * TELEMETRY_REC_BLOCK_SAMPLES);
+    double*                     pFields[TELEMETRY_REC_FIELDS];
+    std::map<uint64_t, size_t>  decoded;    // By object and kind, how many so far
+    std::map<uint64_t, std::vector<const BusSample*>> expected;
+    size_t                      cDecoded    = 0;
+    size_t                      cMismatched = 0;
+    double                      dDecodeNs   = 0.0;
+
+    for (DWORD i = 0; i < TELEMETRY_REC_FIELDS; i++) pFields[i] = &fields[i * TELEMETRY_REC_BLOCK_SAMPLES];
+    for (const BusSample& sample : session) expected[((uint64_t)sample.idObject << 32) | sample.eKind].push_back (&sample);
+
+    for (size_t ib = sizeof (RecFileHeader); ib + sizeof (RecBlockHeader) <= file.size (); )
+    {
+        const RecBlockHeader* pHeader = (const RecBlockHeader*)&file[ib];
+        if (!IsRecBlockWhole (pHeader, file.size () - ib)) break;
+
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+        DecodeRecBlock (pHeader, times.data (), pFields);
+        dDecodeNs += std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - t0).count ();
+
+        uint64_t                             nKey    = ((uint64_t)pHeader->idObject << 32) | pHeader->eKind;
+        const std::vector<const BusSample*>& samples = expected[nKey];
+        size_t&                              iSample = decoded[nKey];
+
+        for (DWORD i = 0; i < pHeader->cSamples; i++, iSample++)
+        {
+            if (iSample >= samples.size ())
+            {
+                cMismatched++;
+                continue;
+            }
+
+            const BusSample& sample = *samples[iSample];
+            bool             bSame  = times[i] == (int64_t)floor (sample.dSimTime * 1e6 + 0.5);
+            for (DWORD iField = 0; iField < TELEMETRY_REC_FIELDS; iField++) bSame = bSame && pFields[iField][i] == sample.dValues[iField];
+            if (!bSame) cMismatched++;
+        }
+        cDecoded += pHeader->cSamples;
+        ib       += pHeader->cbBlock;
+    }
+
+    Report ("Recorder/Decode", cDecoded > 0 ? dDecodeNs / cDecoded : 0.0, "sample");
+    Record ("Recorder/Ratio", (double)cSamples * (sizeof (int64_t) + TELEMETRY_REC_FIELDS * sizeof (double)) / file.size (), "x");
+    Record ("Recorder/BitsPerSample", 8.0 * file.size () / cSamples, "bits");
+    Record ("Recorder/Mismatched", (double)(cSamples - cDecoded + cMismatched), "samples");
+}
+
+/**
+ * Drop a file from the page cache, so that the next read of it comes from the disk, as far as the OS lets us.
+ */
+static void EvictFromCache (const char* szPath)
+{
+#ifdef _WIN32
+    // Opening a file unbuffered drops its cached pages
+    HANDLE hFile = CreateFileA (szPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL);
+    if (hFile != INVALID_HANDLE_VALUE) CloseHandle (hFile);
+#else
+    int fd = open (szPath, O_RDONLY);
+    if (fd < 0) return;
+
+    fdatasync (fd);
+    posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+    close (fd);
+#endif
+}
+
+static void CALLBACK CountMatchProc (const RecIndexEntry* pBlock,
+                                     DWORD                iSample,
+                                     int64_t              nTime,
+                                     double               dValue,
+                                     void*                pContext)
+{
+    (*(ULONGLONG*)pContext)++;
+}
+
+/**
+ * Queries over a recording of many vehicles: one vehicle's rudder past 0.8, which the zone maps narrow down to a few
+ *  blocks, and a scan of every block, from a cold page cache and a warm one. Scans are in GB/s of the recording, and
+ *  of the compressed columns actually decoded.
+ */
+static void BenchArchive ()
+{
+    const char*            szPath = "DemoRudderPosBench.trec";
+    std::vector<BusSample> session;
+
+    SynthesizeSession (96, session);
+    {
+        CTelemetryRecorder recorder;
+        if (!recorder.Open (szPath)) return;
+        for (const BusSample& sample : session) recorder.Record (sample);
+    }
+
+    // Matches found by the query against those in the session
+    ArchiveQuery rudder;
+    ULONGLONG    cExpected = 0;
+    ULONGLONG    cFound    = 0;
+
+    rudder.idObject   = 142;
+    rudder.eKind      = BUS_KIND_RUDDER;
+    rudder.iField     = 0;
+    rudder.eOp        = ARCHIVE_OP_ABOVE;
+    rudder.dThreshold = 0.8;
+
+    for (const BusSample& sample : session)
+    {
+        if (sample.idObject == rudder.idObject && sample.eKind == rudder.eKind && sample.dValues[0] > rudder.dThreshold) cExpected++;
+    }
+
+    // Every value is above this, so no block can be skipped, and every sample is a match
+    ArchiveQuery scan;
+    scan.eOp        = ARCHIVE_OP_ABOVE;
+    scan.dThreshold = -HUGE_VAL;
+
+    for (int iCold = 1; iCold >= 0; iCold--)
+    {
+        const char*  szCache = iCold ? "Cold" : "Warm";
+        char         szName[64];
+        double       dBestNs = 1e300;
+        ArchiveStats stats;
+
+        for (int iRun = 0; iRun < 5; iRun++)
+        {
+            if (iCold) EvictFromCache (szPath);
+
+            CTelemetryArchive                     archive;
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+
+            if (!archive.Open (szPath)) break;
+            cFound = 0;
+            stats  = archive.Query (rudder, CountMatchProc, &cFound);
+            dBestNs = std::min (dBestNs, std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - t0).count ());
+        }
+        snprintf (szName, sizeof (szName), "Archive/Rudder/%s", szCache);
+        Record (szName, dBestNs / 1e6, "ms");
+        if (iCold) Record ("Archive/Rudder/Skipped", 100.0 * stats.cBlocksSkipped / std::max ((DWORD)1, stats.cBlocks), "%");
+
+        dBestNs = 1e300;
+        size_t cbFile = 0;
+        for (int iRun = 0; iRun < 3; iRun++)
+        {
+            if (iCold) EvictFromCache (szPath);
+
+            CTelemetryArchive                     archive;
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+
+            if (!archive.Open (szPath)) break;
+            stats   = archive.Query (scan, NULL, NULL);
+            dBestNs = std::min (dBestNs, std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - t0).count ());
+            cbFile  = archive.Size ();
+        }
+        snprintf (szName, sizeof (szName), "Archive/Scan/%s/File", szCache);
+        Record (szName, cbFile / dBestNs, "GB/s");
+        snprintf (szName, sizeof (szName), "Archive/Scan/%s/Columns", szCache);
+        Record (szName, stats.cbColumns / dBestNs, "GB/s");
+    }
+    Record ("Archive/Size", (double)session.size () * sizeof (BusSample) / 1e6, "MB raw");
+    Record ("Archive/Rudder/Missed", (double)(cExpected > cFound ? cExpected - cFound : cFound - cExpected), "samples");
+
+    // A recording cut short halfway, mid block and without its index, and one whose first block claims columns larger
+    //  than itself; both are queried without reading past the end, the bad blocks left out
+    std::vector<BYTE> file;
+    if (FILE* pFile = fopen (szPath, "rb"))
+    {
+        BYTE   buffer[65536];
+        size_t cb;
+        while ((cb = fread (buffer, 1, sizeof (buffer), pFile)) > 0) file.insert (file.end (), buffer, buffer + cb);
+        fclose (pFile);
+    }
+    for (int iCorrupt = 0; iCorrupt < 2 && file.size () > sizeof (RecFileHeader) + sizeof (RecBlockHeader); iCorrupt++)
+    {
+        const char*       szCorrupt = "DemoRudderPosBench.Corrupt.trec";
+        std::vector<BYTE> corrupt   = file;
+
+        if (iCorrupt == 0)
+        {
+            corrupt.resize (corrupt.size () / 2 + 3);
+        }
+        else
+        {
+            ((RecBlockHeader*)&corrupt[sizeof (RecFileHeader)])->cbColumns[1] = 0x7FFFFFFF;
+        }
+
+        FILE* pFile = fopen (szCorrupt, "wb");
+        if (pFile == NULL) break;
+        fwrite (corrupt.data (), 1, corrupt.size (), pFile);
+        fclose (pFile);
+
+        CTelemetryArchive archive;
+        ArchiveStats      stats;
+        memset (&stats, 0, sizeof (stats));
+        if (archive.Open (szCorrupt)) stats = archive.Query (scan, NULL, NULL);
+
+        Record (iCorrupt == 0 ? "Archive/Truncated/Blocks" : "Archive/Corrupt/Blocks", archive.BlockCount (), "blocks");
+        Record (iCorrupt == 0 ? "Archive/Truncated/Matches" : "Archive/Corrupt/Bad", iCorrupt == 0 ? (double)stats.cMatches : stats.cBlocksBad, iCorrupt == 0 ? "samples" : "blocks");
+        archive.Close ();
+        remove (szCorrupt);
+    }
+    remove (szPath);
+
+    // The filter on its own, over decoded values of which none match, against the plain loop
+    std::vector<double> values (TELEMETRY_REC_BLOCK_SAMPLES);
+    std::vector<DWORD>  matches (TELEMETRY_REC_BLOCK_SAMPLES);
+    for (size_t i = 0; i < values.size (); i++) values[i] = sin (i * 0.01) * 0.5;
+
+    double dFilterNs = MeasureNs (20000, [&] (uint32_t i)
+    {
+        s_dSink += FilterAbove (values.data (), (DWORD)values.size (), 0.8, matches.data ());
+    });
+    double dLoopNs = MeasureNs (20000, [&] (uint32_t i)
+    {
+        DWORD cMatches = 0;
+        for (DWORD j = 0; j < (DWORD)values.size (); j++)
+        {
+            if (values[j] > 0.8) matches[cMatches++] = j;
+        }
+        s_dSink += cMatches;
+    });
+    Record ("Archive/FilterAbove", values.size () * sizeof (double) / dFilterNs, "GB/s");
+    Record ("Archive/FilterAbove/Scalar", values.size () * sizeof (double) / dLoopNs, "GB/s");
+}
+
+
+/**
+ * An ICAO code of cch letters made of n, scattered by an odd multiplier prime to 13 so that the codes of consecutive
+ *  facilities are far apart, as they are in the sim's lists.
+ */
+static void SynthesizeIcao (DWORD n,
+                            DWORD cch,
+                            char* szIcao)
+{
+    DWORD cCodes = 1;
+    for (DWORD i = 0; i < cch; i++) cCodes *= 26;
+
+    n = (DWORD)((n * 40503ULL + 7) % cCodes);
+    memset (szIcao, 0, 9);
+    for (DWORD i = cch; i-- > 0; n /= 26) szIcao[i] = (char)('A' + n % 26);
+}
+
+/**
+ * Facilities spread evenly over the box of latitudes and longitudes given, by default the world but the poles.
+ */
+template <typename TFacility>
+static void SynthesizeFacilities (DWORD                   cFacilities,
+                                  DWORD                   cchIcao,
+                                  std::vector<TFacility>& facilities,
+                                  double                  dLatMin = -80.0,
+                                  double                  dLatMax = 80.0,
+                                  double                  dLonMin = -180.0,
+                                  double                  dLonMax = 180.0)
+{
+    std::mt19937 rng (cFacilities);
+
+    facilities.assign (cFacilities, TFacility ());
+    for (DWORD i = 0; i < cFacilities; i++)
+    {
+        TFacility& facility = facilities[i];
+        memset (&facility, 0, sizeof (facility));
+        SynthesizeIcao (i, cchIcao, facility.Icao);
+        facility.Latitude  = std::uniform_real_distribution<double> (dLatMin, dLatMax) (rng);
+        facility.Longitude = std::uniform_real_distribution<double> (dLonMin, dLonMax) (rng);
+        facility.Altitude  = std::uniform_real_distribution<double> (0.0, 3000.0) (rng);
+    }
+}
+
+static void CALLBACK FacilitiesDispatchProc (SIMCONNECT_RECV* pData,
+                                             DWORD            cbData,
+                                             void*            pContext)
+{
+    ((CFacilityCache*)pContext)->OnFacilitiesList (pData);
+}
+
+/**
+ * Facility lists the size of a sim's through the stand-in: the time from opening to having all of them, without a
+ *  cache and with one that is up to date, and from opening with the cache, cold, to the first answer. The refresh
+ *  with the cache still takes as long, but nothing waits for it.
+ */
+static void BenchFacilityCache ()
+{
+    const char* szPath = "DemoRudderPosBench.Facilities.StandIn.1.0.0.0.cache";
+
+    std::vector<SIMCONNECT_DATA_FACILITY_AIRPORT>  airports;
+    std::vector<SIMCONNECT_DATA_FACILITY_WAYPOINT> waypoints;
+    std::vector<SIMCONNECT_DATA_FACILITY_NDB>      ndbs;
+    std::vector<SIMCONNECT_DATA_FACILITY_VOR>      vors;
+
+    SynthesizeFacilities (40000,  4, airports);
+    SynthesizeFacilities (200000, 5, waypoints);
+    SynthesizeFacilities (5000,   3, ndbs);
+    SynthesizeFacilities (5000,   3, vors);
+
+    CSimConnectStandIn::SetFacilities (SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT,  airports.data (),  (DWORD)airports.size ());
+    CSimConnectStandIn::SetFacilities (SIMCONNECT_FACILITY_LIST_TYPE_WAYPOINT, waypoints.data (), (DWORD)waypoints.size ());
+    CSimConnectStandIn::SetFacilities (SIMCONNECT_FACILITY_LIST_TYPE_NDB,      ndbs.data (),      (DWORD)ndbs.size ());
+    CSimConnectStandIn::SetFacilities (SIMCONNECT_FACILITY_LIST_TYPE_VOR,      vors.data (),      (DWORD)vors.size ());
+
+    // The stand-in does not send OPEN itself
+    SIMCONNECT_RECV_OPEN open;
+    memset (&open, 0, sizeof (open));
+    strcpy (open.szApplicationName, "StandIn");
+    open.dwApplicationVersionMajor = 1;
+
+    HANDLE hSimConnect = NULL;
+    if (FAILED (SimConnect_Open (&hSimConnect, "BenchFacilities", NULL, 0, NULL, 0))) return;
+    remove (szPath);
+
+    const char* szAirport = airports[airports.size () / 2].Icao;
+    DWORD       cMissing  = 0;
+
+    for (int iCached = 0; iCached < 2; iCached++)
+    {
+        const char*                           szCache = iCached ? "Cached" : "NoCache";
+        char                                  szName[64];
+        CFacilityCache                        cache (1);
+        std::chrono::steady_clock::time_point t0;
+
+        EvictFromCache (szPath);
+        t0 = std::chrono::steady_clock::now ();
+        cache.Open (hSimConnect, "DemoRudderPosBench", &open);
+
+        while (cache.Find (SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT, szAirport) == NULL && cache.IsRefreshing ())
+        {
+            SimConnect_CallDispatch (hSimConnect, FacilitiesDispatchProc, &cache);
+        }
+        snprintf (szName, sizeof (szName), "Facilities/%s/FirstFind", szCache);
+        Record (szName, std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - t0).count (), "ms");
+
+        while (cache.IsRefreshing ()) SimConnect_CallDispatch (hSimConnect, FacilitiesDispatchProc, &cache);
+        snprintf (szName, sizeof (szName), "Facilities/%s/Refresh", szCache);
+        Record (szName, std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - t0).count (), "ms");
+
+        // Waits for the file to be written, if it is being
+        t0 = std::chrono::steady_clock::now ();
+        cache.Close ();
+        snprintf (szName, sizeof (szName), "Facilities/%s/Close", szCache);
+        Record (szName, std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - t0).count (), "ms");
+    }
+
+    // A cache made not to refresh asks the sim for nothing once its file loads
+    CFacilityCache kept (1, false);
+    kept.Open (hSimConnect, "DemoRudderPosBench", &open);
+    Record ("Facilities/Kept/Refreshing", kept.IsRefreshing () ? 1.0 : 0.0, "caches");
+    kept.Close ();
+
+    // Lookups from the mapped file, before the refresh has replaced any of it
+    CFacilityCache cache (1);
+    cache.Open (hSimConnect, "DemoRudderPosBench", &open);
+
+    double dNs = MeasureNs (1 << 20, [&] (uint32_t i)
+    {
+        const SIMCONNECT_DATA_FACILITY_WAYPOINT& waypoint = waypoints[(i * 2654435761u) % waypoints.size ()];
+        const FacilityEntry*                     pEntry   = cache.Find (SIMCONNECT_FACILITY_LIST_TYPE_WAYPOINT, waypoint.Icao);
+
+        if (pEntry == NULL || pEntry->dLatitude != waypoint.Latitude) cMissing++;
+    });
+    Record ("Facilities/Find", dNs, "ns/lookup");
+    Record ("Facilities/Find/Missing", cMissing, "lookups");
+    Record ("Facilities/File", (double)(sizeof (FacilityCacheHeader) + (airports.size () + waypoints.size () + ndbs.size () + vors.size ()) * sizeof (FacilityEntry)) / 1e6, "MB");
+
+    cache.Close ();
+    SimConnect_Close (hSimConnect);
+    remove (szPath);
+}
+
+
+/**
+ * A facility list message with the facilities picked from all, as the sim sends in-range changes.
+ */
+template <typename TFacility>
+static void BuildFacilitiesList (SIMCONNECT_RECV_ID            eId,
+                                 DWORD                         idRequest,
+                                 const std::vector<TFacility>& all,
+                                 const std::vector<DWORD>&     picked,
+                                 std::vector<BYTE>&            message)
+{
+    message.assign (sizeof (SIMCONNECT_RECV_FACILITIES_LIST) + picked.size () * sizeof (TFacility), 0);
+
+    SIMCONNECT_RECV_FACILITIES_LIST* pList = (SIMCONNECT_RECV_FACILITIES_LIST*)message.data ();
+    pList->dwSize      = (DWORD)message.size ();
+    pList->dwID        = eId;
+    pList->dwRequestID = idRequest;
+    pList->dwArraySize = (DWORD)picked.size ();
+    pList->dwOutOf     = 1;
+
+    TFacility* pFacilities = (TFacility*)(pList + 1);
+    for (size_t i = 0; i < picked.size (); i++) pFacilities[i] = all[picked[i]];
+}
+
+/**
+ * The facilities of a type in range of a position, and the messages saying which came into and left range since
+ *  the last position.
+ */
+template <typename TFacility>
+static void StepFacilities (SIMCONNECT_RECV_ID                eId,
+                            DWORD                             idRequestIn,
+                            const std::vector<TFacility>&     all,
+                            double                            dLat,
+                            double                            dLon,
+                            std::vector<bool>&                inRange,
+                            std::vector<std::vector<BYTE>>&   messages,
+                            DWORD&                            cChanged)
+{
+    static const double s_dRangeDeg = 1.5;
+
+    std::vector<DWORD> entering;
+    std::vector<DWORD> leaving;
+
+    inRange.resize (all.size (), false);
+    for (DWORD i = 0; i < (DWORD)all.size (); i++)
+    {
+        bool bInRange = fabs (all[i].Latitude - dLat) < s_dRangeDeg && fabs (all[i].Longitude - dLon) < s_dRangeDeg;
+        if (bInRange == inRange[i]) continue;
+
+        (bInRange ? entering : leaving).push_back (i);
+        inRange[i] = bInRange;
+    }
+
+    cChanged += (DWORD)(entering.size () + leaving.size ());
+    if (!entering.empty ())
+    {
+        messages.push_back (std::vector<BYTE> ());
+        BuildFacilitiesList (eId, idRequestIn, all, entering, messages.back ());
+    }
+    if (!leaving.empty ())
+    {
+        messages.push_back (std::vector<BYTE> ());
+        BuildFacilitiesList (eId, idRequestIn + 1, all, leaving, messages.back ());
+    }
+}
+
+/**
+ * An aircraft crossing a region of facilities, with the set in range kept by CFacilityRange from what came into and
+ *  left range at each step, against building the set again from the whole in-range list each time, which is what
+ *  polling the full lists comes to. Then nearest-airport and nearest-navaid queries against a scan of the set.
+ */
+static void BenchFacilityRange ()
+{
+    const DWORD idRequestFirst = 10;
+    const int   cSteps         = 400;
+
+    std::vector<SIMCONNECT_DATA_FACILITY_AIRPORT>  airports;
+    std::vector<SIMCONNECT_DATA_FACILITY_WAYPOINT> waypoints;
+    std::vector<SIMCONNECT_DATA_FACILITY_NDB>      ndbs;
+    std::vector<SIMCONNECT_DATA_FACILITY_VOR>      vors;
+
+    SynthesizeFacilities (4000,  4, airports,  40.0, 50.0, -130.0, -110.0);
+    SynthesizeFacilities (40000, 5, waypoints, 40.0, 50.0, -130.0, -110.0);
+    SynthesizeFacilities (800,   3, ndbs,      40.0, 50.0, -130.0, -110.0);
+    SynthesizeFacilities (800,   3, vors,      40.0, 50.0, -130.0, -110.0);
+
+    // Eastwards along 45N, a step being some 20 s at 250 kt
+    std::vector<std::vector<std::vector<BYTE>>> steps (cSteps);
+    std::vector<bool>                           inRange[FACILITY_CACHE_TYPES];
+    DWORD                                       cChanged = 0;
+    DWORD                                       cInRange = 0;
+
+    for (int iStep = 0; iStep < cSteps; iStep++)
+    {
+        double dLon = -126.0 + iStep * 0.03;
+        StepFacilities (SIMCONNECT_RECV_ID_AIRPORT_LIST,  idRequestFirst + 2 * SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT,  airports,  45.0, dLon, inRange[0], steps[iStep], cChanged);
+        StepFacilities (SIMCONNECT_RECV_ID_WAYPOINT_LIST, idRequestFirst + 2 * SIMCONNECT_FACILITY_LIST_TYPE_WAYPOINT, waypoints, 45.0, dLon, inRange[1], steps[iStep], cChanged);
+        StepFacilities (SIMCONNECT_RECV_ID_NDB_LIST,      idRequestFirst + 2 * SIMCONNECT_FACILITY_LIST_TYPE_NDB,      ndbs,      45.0, dLon, inRange[2], steps[iStep], cChanged);
+        StepFacilities (SIMCONNECT_RECV_ID_VOR_LIST,      idRequestFirst + 2 * SIMCONNECT_FACILITY_LIST_TYPE_VOR,      vors,      45.0, dLon, inRange[3], steps[iStep], cChanged);
+    }
+    for (DWORD i = 0; i < FACILITY_CACHE_TYPES; i++) cInRange += (DWORD)std::count (inRange[i].begin (), inRange[i].end (), true);
+
+    // The first step brings in everything in range, as a full list would
+    CFacilityRange range (idRequestFirst);
+    double         dBestNs = 1e300;
+
+    for (int iRun = 0; iRun < 3; iRun++)
+    {
+        range.Close ();
+        for (size_t i = 0; i < steps[0].size (); i++) range.OnFacilitiesList ((const SIMCONNECT_RECV*)steps[0][i].data ());
+
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+        for (int iStep = 1; iStep < cSteps; iStep++)
+        {
+            for (size_t i = 0; i < steps[iStep].size (); i++) range.OnFacilitiesList ((const SIMCONNECT_RECV*)steps[iStep][i].data ());
+        }
+        dBestNs = std::min (dBestNs, std::chrono::duration<double, std::nano> (std::chrono::steady_clock::now () - t0).count ());
+    }
+    Record ("FacilityRange/Step/Incremental", dBestNs / (cSteps - 1) / 1e3, "us/step");
+
+    DWORD cSet = 0;
+    for (DWORD i = 0; i < FACILITY_CACHE_TYPES; i++) cSet += range.Count ((SIMCONNECT_FACILITY_LIST_TYPE)i);
+    Record ("FacilityRange/Missing", fabs ((double)cSet - (double)cInRange), "facilities");
+
+    // Everything in range at the last step, as one list per type, into an empty set
+    std::vector<std::vector<BYTE>> full;
+    std::vector<bool>              none[FACILITY_CACHE_TYPES];
+    DWORD                          cFull = 0;
+
+    StepFacilities (SIMCONNECT_RECV_ID_AIRPORT_LIST,  idRequestFirst + 2 * SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT,  airports,  45.0, -126.0 + (cSteps - 1) * 0.03, none[0], full, cFull);
+    StepFacilities (SIMCONNECT_RECV_ID_WAYPOINT_LIST, idRequestFirst + 2 * SIMCONNECT_FACILITY_LIST_TYPE_WAYPOINT, waypoints, 45.0, -126.0 + (cSteps - 1) * 0.03, none[1], full, cFull);
+    StepFacilities (SIMCONNECT_RECV_ID_NDB_LIST,      idRequestFirst + 2 * SIMCONNECT_FACILITY_LIST_TYPE_NDB,      ndbs,      45.0, -126.0 + (cSteps - 1) * 0.03, none[2], full, cFull);
+    StepFacilities (SIMCONNECT_RECV_ID_VOR_LIST,      idRequestFirst + 2 * SIMCONNECT_FACILITY_LIST_TYPE_VOR,      vors,      45.0, -126.0 + (cSteps - 1) * 0.03, none[3], full, cFull);
+
+    CFacilityRange rebuilt (idRequestFirst);
+    Record ("FacilityRange/Step/Rebuild", MeasureNs (20, [&] (uint32_t i)
+    {
+        rebuilt.Close ();
+        for (size_t j = 0; j < full.size (); j++) rebuilt.OnFacilitiesList ((const SIMCONNECT_RECV*)full[j].data ());
+    }) / 1e3, "us/step");
+    Record ("FacilityRange/Changed", (double)(cChanged - cFull) / (cSteps - 1), "facilities/step");
+    Record ("FacilityRange/InRange", cFull, "facilities");
+
+    // Nearest airport against a scan of those in range, around the last position
+    std::vector<CFacilityRange::Hit> hits;
+    std::mt19937                     rng (7);
+    std::vector<double>              lats (1024);
+    std::vector<double>              lons (1024);
+    DWORD                            cMismatched = 0;
+
+    for (size_t i = 0; i < lats.size (); i++)
+    {
+        lats[i] = 45.0 + std::uniform_real_distribution<double> (-1.0, 1.0) (rng);
+        lons[i] = -126.0 + (cSteps - 1) * 0.03 + std::uniform_real_distribution<double> (-1.0, 1.0) (rng);
+    }
+
+    double dKNearestNs = MeasureNs (10000, [&] (uint32_t i)
+    {
+        range.KNearest (SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT, lats[i % lats.size ()], lons[i % lons.size ()], 1, hits);
+    });
+    double dNavaidNs = MeasureNs (10000, [&] (uint32_t i)
+    {
+        s_dSink += range.NearestNavaid (lats[i % lats.size ()], lons[i % lons.size ()]) != NULL;
+    });
+
+    for (size_t i = 0; i < lats.size (); i++)
+    {
+        double dCosLat   = cos (lats[i] * M_PI / 180.0);
+        double dBestDist = 1e300;
+        DWORD  iBest     = 0;
+
+        for (DWORD j = 0; j < (DWORD)airports.size (); j++)
+        {
+            if (!inRange[0][j]) continue;
+
+            double dNorth = airports[j].Latitude - lats[i];
+            double dEast  = (airports[j].Longitude - lons[i]) * dCosLat;
+            double dDist  = dNorth * dNorth + dEast * dEast;
+            if (dDist < dBestDist)
+            {
+                dBestDist = dDist;
+                iBest     = j;
+            }
+        }
+
+        range.KNearest (SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT, lats[i], lons[i], 1, hits);
+        if (hits.empty () || strcmp (hits[0].pFacility->szIcao, airports[iBest].Icao) != 0) cMismatched++;
+    }
+    Report ("FacilityRange/NearestAirport", dKNearestNs, "query");
+    Report ("FacilityRange/NearestNavaid", dNavaidNs, "query");
+    Record ("FacilityRange/NearestAirport/Mismatched", cMismatched, "queries");
+}
+
+#ifdef SIM_MSFS2020
+/**
+ * A FACILITY_DATA message, as the sim sends for one item of an airport, appended to those before it.
+ */
+static void AppendFacilityData (std::vector<BYTE>&           messages,
+                                SIMCONNECT_FACILITY_DATA_TYPE eType,
+                                DWORD                        iItem,
+                                DWORD                        cItems,
+                                const void*                  pData,
+                                size_t                       cbData)
+{
+    size_t ibData  = sizeof (SIMCONNECT_RECV_FACILITY_DATA) - sizeof (DWORD);
+    size_t ibStart = messages.size ();
+
+    messages.resize (ibStart + ibData + cbData, 0);
+
+    SIMCONNECT_RECV_FACILITY_DATA* pFacility = (SIMCONNECT_RECV_FACILITY_DATA*)&messages[ibStart];
+    pFacility->dwSize     = (DWORD)(ibData + cbData);
+    pFacility->dwID       = SIMCONNECT_RECV_ID_FACILITY_DATA;
+    pFacility->Type       = eType;
+    pFacility->IsListItem = eType != SIMCONNECT_FACILITY_DATA_AIRPORT;
+    pFacility->ItemIndex  = iItem;
+    pFacility->ListSize   = cItems;
+    memcpy (&messages[ibStart + ibData], pData, cbData);
+}
+
+/**
+ * The replies for an airport laid out as a grid of taxiways, cCols taxi points by cRows, 60 m apart: a runway along
+ *  the southern row, whose paths are of the runway, and a parking spot north of each point of the northern row.
+ *  A fraction dClosed of the taxiways between points is left out, at random, for a network that winds.
+ */
+static void SynthesizeAirportLayout (double             dLat,
+                                     double             dLon,
+                                     DWORD              cCols,
+                                     DWORD              cRows,
+                                     std::vector<BYTE>& messages,
+                                     double             dClosed = 0.0)
+{
+    static const float s_fSpacingM = 60.0f;
+
+    std::mt19937                      rng (cCols * cRows);
+    std::vector<FacilityDataTaxiPath> paths;
+    FacilityDataAirport               airport;
+    FacilityDataRunway                runway;
+    float                             fWest  = -0.5f * s_fSpacingM * (cCols - 1);
+    float                             fSouth = -0.5f * s_fSpacingM * (cRows - 1);
+
+    for (DWORD iRow = 0; iRow < cRows; iRow++)
+    {
+        for (DWORD iCol = 0; iCol < cCols; iCol++)
+        {
+            DWORD                iPoint = iRow * cCols + iCol;
+            FacilityDataTaxiPath path   = { iRow == 0 ? AIRPORT_PATH_RUNWAY : AIRPORT_PATH_TAXI, iRow == 0 ? 45.0f : 23.0f, (int)iPoint, (int)iPoint + 1, (int)iRow };
+
+            bool                 bEastClosed  = iRow != 0 && std::uniform_real_distribution<double> (0.0, 1.0) (rng) < dClosed;
+            bool                 bNorthClosed = std::uniform_real_distribution<double> (0.0, 1.0) (rng) < dClosed;
+
+            if (iCol + 1 < cCols && !bEastClosed) paths.push_back (path);
+
+            path.nType      = AIRPORT_PATH_TAXI;
+            path.fWidth     = 23.0f;
+            path.nEnd       = (int)(iPoint + cCols);
+            path.nNameIndex = (int)(cRows + iCol);
+            if (iRow + 1 < cRows && !bNorthClosed) paths.push_back (path);
+        }
+    }
+    for (DWORD iCol = 0; iCol < cCols; iCol++)
+    {
+        FacilityDataTaxiPath path = { AIRPORT_PATH_PARKING, 15.0f, (int)((cRows - 1) * cCols + iCol), (int)iCol, 0 };
+        paths.push_back (path);
+    }
+
+    airport.dLatitude     = dLat;
+    airport.dLongitude    = dLon;
+    airport.dAltitude     = 120.0;
+    airport.nRunways      = 1;
+    airport.nTaxiPoints   = (int)(cCols * cRows);
+    airport.nTaxiParkings = (int)cCols;
+    airport.nTaxiPaths    = (int)paths.size ();
+    AppendFacilityData (messages, SIMCONNECT_FACILITY_DATA_AIRPORT, 0, 1, &airport, sizeof (airport));
+
+    runway.dLatitude        = dLat + CDistance::Meters (fSouth).Ft () / CGeodesy::FT_PER_DEG;
+    runway.dLongitude       = dLon;
+    runway.dAltitude        = airport.dAltitude;
+    runway.fHeading         = 90.0f;
+    runway.fLength          = s_fSpacingM * (cCols - 1);
+    runway.fWidth           = 45.0f;
+    runway.nPrimaryNumber   = 9;
+    runway.nSecondaryNumber = 27;
+    AppendFacilityData (messages, SIMCONNECT_FACILITY_DATA_RUNWAY, 0, 1, &runway, sizeof (runway));
+
+    for (DWORD iPoint = 0; iPoint < cCols * cRows; iPoint++)
+    {
+        FacilityDataTaxiPoint point = { 1, fWest + s_fSpacingM * (iPoint % cCols), fSouth + s_fSpacingM * (iPoint / cCols) };
+        AppendFacilityData (messages, SIMCONNECT_FACILITY_DATA_TAXI_POINT, iPoint, cCols * cRows, &point, sizeof (point));
+    }
+    for (DWORD iCol = 0; iCol < cCols; iCol++)
+    {
+        FacilityDataTaxiParking parking = { 4, 12, (int)iCol + 1, 180.0f, 18.0f, fWest + s_fSpacingM * iCol, -fSouth + 40.0f };
+        AppendFacilityData (messages, SIMCONNECT_FACILITY_DATA_TAXI_PARKING, iCol, cCols, &parking, sizeof (parking));
+    }
+    for (DWORD iPath = 0; iPath < (DWORD)paths.size (); iPath++)
+    {
+        AppendFacilityData (messages, SIMCONNECT_FACILITY_DATA_TAXI_PATH, iPath, (DWORD)paths.size (), &paths[iPath], sizeof (paths[iPath]));
+    }
+}
+
+static void CALLBACK FetcherDispatchProc (SIMCONNECT_RECV* pData,
+                                          DWORD            cbData,
+                                          void*            pContext)
+{
+    ((CFacilityFetcher*)pContext)->OnRecv (pData);
+}
+
+/**
+ * The ground layouts of the airports around, fetched through the stand-in with a window of requests in flight
+ *  against one at a time: the dispatches it takes, each being a round trip to the sim, and the time to assemble an
+ *  airport from its replies. Then the size of the models and lookups of them.
+ */
+static void BenchFacilityFetcher ()
+{
+    const DWORD cAirports = 48;
+
+    std::vector<SIMCONNECT_DATA_FACILITY_AIRPORT> airports;
+    std::vector<DWORD>                            cReplies (cAirports);
+    DWORD                                         cMessages = 0;
+
+    SynthesizeFacilities (cAirports, 4, airports, 45.0, 46.0, -123.0, -122.0);
+    for (DWORD i = 0; i < cAirports; i++)
+    {
+        std::vector<BYTE> messages;
+        SynthesizeAirportLayout (airports[i].Latitude, airports[i].Longitude, 8 + i % 9, 4 + i % 5, messages);
+        CSimConnectStandIn::SetFacilityData (airports[i].Icao, messages.data (), (DWORD)messages.size ());
+
+        for (size_t ib = 0; ib < messages.size (); ib += ((const SIMCONNECT_RECV*)&messages[ib])->dwSize) cMessages++;
+    }
+
+    HANDLE hSimConnect = NULL;
+    if (FAILED (SimConnect_Open (&hSimConnect, "BenchFetcher", NULL, 0, NULL, 0))) return;
+
+    static const DWORD s_rgcWindow[] = { 1, FACILITY_FETCH_WINDOW };
+    for (size_t iWindow = 0; iWindow < _countof (s_rgcWindow); iWindow++)
+    {
+        double dBestUs     = 1e300;
+        DWORD  cDispatches = 0;
+        char   szName[64];
+
+        for (int iRun = 0; iRun < 5; iRun++)
+        {
+            CFacilityFetcher fetcher (0, 100, s_rgcWindow[iWindow]);
+            fetcher.Open (hSimConnect, NULL, NULL);
+
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+            for (DWORD i = 0; i < cAirports; i++) fetcher.Fetch (airports[i].Icao, 0.0);
+            for (cDispatches = 0; fetcher.PendingCount () != 0; cDispatches++)
+            {
+                SimConnect_CallDispatch (hSimConnect, FetcherDispatchProc, &fetcher);
+            }
+            dBestUs = std::min (dBestUs, std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now () - t0).count ());
+        }
+
+        snprintf (szName, sizeof (szName), "FacilityFetcher/Window%u/Dispatches", s_rgcWindow[iWindow]);
+        Record (szName, cDispatches, "dispatches");
+        snprintf (szName, sizeof (szName), "FacilityFetcher/Window%u/Airport", s_rgcWindow[iWindow]);
+        Record (szName, dBestUs / cAirports, "us/airport");
+    }
+    Record ("FacilityFetcher/Replies", (double)cMessages / cAirports, "messages/airport");
+
+    // The models against what was sent
+    CFacilityFetcher fetcher (0, 100);
+    DWORD            cWrong = 0;
+
+    fetcher.Open (hSimConnect, NULL, NULL);
+    for (DWORD i = 0; i < cAirports; i++) fetcher.Fetch (airports[i].Icao, 0.0);
+    while (fetcher.PendingCount () != 0) SimConnect_CallDispatch (hSimConnect, FetcherDispatchProc, &fetcher);
+
+    for (DWORD i = 0; i < cAirports; i++)
+    {
+        const AirportModel* pAirport = fetcher.Find (airports[i].Icao);
+        DWORD               cCols    = 8 + i % 9;
+        DWORD               cRows    = 4 + i % 5;
+
+        if (pAirport == NULL || pAirport->dLatitude != airports[i].Latitude || pAirport->cRunways != 1 || pAirport->cTaxiPoints != cCols * cRows ||
+            pAirport->cParkings != cCols || pAirport->cTaxiPaths != (cCols - 1) * cRows + cCols * (cRows - 1) + cCols ||
+            pAirport->pTaxiPoints[cCols * cRows - 1].fX != -pAirport->pTaxiPoints[0].fX || pAirport->pParkings[cCols - 1].nNumber != cCols ||
+            pAirport->pTaxiPaths[pAirport->cTaxiPaths - 1].eType != AIRPORT_PATH_PARKING)
+        {
+            cWrong++;
+        }
+    }
+    Record ("FacilityFetcher/Wrong", cWrong, "airports");
+    Record ("FacilityFetcher/Arena", (double)fetcher.ArenaSize () / cAirports / 1e3, "KB/airport");
+
+    Report ("FacilityFetcher/Find", MeasureNs (1 << 20, [&] (uint32_t i)
+    {
+        s_dSink += fetcher.Find (airports[i % cAirports].Icao) != NULL;
+    }), "lookup");
+    fetcher.Close ();
+
+    // An airport given up on, whose replies come after the next airport was requested in its slot
+    CFacilityFetcher late (0, 100, 1);
+    const AirportModel* pLate;
+
+    late.Open (hSimConnect, NULL, NULL);
+    late.Fetch (airports[0].Icao, 0.0);
+    late.Expire (FACILITY_FETCH_TIMEOUT_SEC);
+    late.Fetch (airports[1].Icao, FACILITY_FETCH_TIMEOUT_SEC);
+    while (late.PendingCount () != 0) SimConnect_CallDispatch (hSimConnect, FetcherDispatchProc, &late);
+
+    pLate = late.Find (airports[1].Icao);
+    Record ("FacilityFetcher/Late/Wrong", late.Find (airports[0].Icao) != NULL || pLate == NULL || pLate->dLatitude != airports[1].Latitude, "airports");
+    late.Close ();
+
+    // Requests that fail are done with at once, as airports the sim does not have
+    late.Open (hSimConnect, NULL, NULL);
+    SimConnect_Close (hSimConnect);
+    for (DWORD i = 0; i < cAirports; i++) late.Fetch (airports[i].Icao, 0.0);
+    Record ("FacilityFetcher/Failed/Pending", late.PendingCount (), "airports");
+    late.Close ();
+}
+
+/**
+ * Routes over the taxiways of a large airport, read from DemoRudderPosBench.Airport.fixture next to the bench sources:
+ *  the FACILITY_DATA messages of an airport captured from the sim, back to back as it sends them. Without the file, a
+ *  synthetic airport stands in, some 5000 taxi points with a quarter of the taxiways closed. Routes between random
+ *  nodes, with the landmarks against plain A* and Dijkstra, which must find routes as short.
+ */
+static void BenchTaxiRouter ()
+{
+    const char* szIcao = "KBNCH";
+
+    // The directory of this file, as the compiler was given it
+    std::string       path (__FILE__);
+    size_t            iSlash = path.find_last_of ("/\\");
+    std::vector<BYTE> messages;
+
+    path.erase (iSlash == std::string::npos ? 0 : iSlash + 1);
+    path += "DemoRudderPosBench.Airport.fixture";
+
+    if (FILE* pFile = fopen (path.c_str (), "rb"))
+    {
+        BYTE   buffer[64 << 10];
+        size_t cbRead;
+        while ((cbRead = fread (buffer, 1, sizeof (buffer), pFile)) > 0) messages.insert (messages.end (), buffer, buffer + cbRead);
+        fclose (pFile);
+    }
+    Record ("TaxiRouter/Captured", messages.empty () ? 0.0 : 1.0, "airports");
+
+    if (messages.empty ()) SynthesizeAirportLayout (BENCH_LAT, BENCH_LON, 90, 60, messages, 0.25);
+    CSimConnectStandIn::SetFacilityData (szIcao, messages.data (), (DWORD)messages.size ());
+
+    HANDLE           hSimConnect = NULL;
+    CFacilityFetcher fetcher (0, 100);
+
+    if (FAILED (SimConnect_Open (&hSimConnect, "BenchRouter", NULL, 0, NULL, 0))) return;
+    fetcher.Open (hSimConnect, NULL, NULL);
+    fetcher.Fetch (szIcao, 0.0);
+    while (fetcher.PendingCount () != 0) SimConnect_CallDispatch (hSimConnect, FetcherDispatchProc, &fetcher);
+
+    const AirportModel* pAirport = fetcher.Find (szIcao);
+    CTaxiRouter         router;
+
+    if (pAirport == NULL)
+    {
+        SimConnect_Close (hSimConnect);
+        return;
+    }
+
+    Record ("TaxiRouter/Build", MeasureNs (5, [&] (uint32_t i)
+    {
+        router.Build (*pAirport);
+    }) / 1e6, "ms");
+    Record ("TaxiRouter/Nodes", router.NodeCount (), "nodes");
+    Record ("TaxiRouter/Edges", router.EdgeCount (), "edges");
+
+    // Connected pairs only; the router turns the rest down without a search
+    std::vector<std::pair<DWORD, DWORD>> pairs;
+    std::vector<double>                  lats;
+    std::vector<double>                  lons;
+    std::mt19937                         rng (11);
+
+    while (pairs.size () < 1000)
+    {
+        DWORD iFrom = std::uniform_int_distribution<DWORD> (0, router.NodeCount () - 1) (rng);
+        DWORD iTo   = std::uniform_int_distribution<DWORD> (0, router.NodeCount () - 1) (rng);
+        if (router.Route (iFrom, iTo, lats, lons)) pairs.push_back (std::make_pair (iFrom, iTo));
+    }
+
+    static const TAXI_ROUTE_MODE s_rgeModes[]     = { TAXI_ROUTE_MODE_DIJKSTRA, TAXI_ROUTE_MODE_EUCLIDEAN, TAXI_ROUTE_MODE_LANDMARKS };
+    static const char* const     s_rgszModes[]    = { "Dijkstra", "AStar", "Landmarks" };
+    std::vector<double>          lengths[_countof (s_rgeModes)];
+    DWORD                        cMismatched      = 0;
+
+    for (size_t iMode = 0; iMode < _countof (s_rgeModes); iMode++)
+    {
+        char     szName[64];
+        uint64_t cSettled = 0;
+
+        router.SetMode (s_rgeModes[iMode]);
+        for (size_t i = 0; i < pairs.size (); i++)
+        {
+            double dLengthFt = 0.0;
+            router.Route (pairs[i].first, pairs[i].second, lats, lons, &dLengthFt);
+            lengths[iMode].push_back (dLengthFt);
+            cSettled += router.Settled ();
+        }
+
+        double dNs = MeasureNs ((uint32_t)pairs.size (), [&] (uint32_t i)
+        {
+            router.Route (pairs[i].first, pairs[i].second, lats, lons);
+            s_dSink += lats.size ();
+        });
+        snprintf (szName, sizeof (szName), "TaxiRouter/%s", s_rgszModes[iMode]);
+        Record (szName, 1e9 / dNs, "routes/s");
+        snprintf (szName, sizeof (szName), "TaxiRouter/%s/Settled", s_rgszModes[iMode]);
+        Record (szName, (double)cSettled / pairs.size (), "nodes/route");
+    }
+    for (size_t i = 0; i < pairs.size (); i++)
+    {
+        if (fabs (lengths[2][i] - lengths[0][i]) > 1e-4 * lengths[0][i] + 0.01 || fabs (lengths[1][i] - lengths[0][i]) > 1e-4 * lengths[0][i] + 0.01) cMismatched++;
+    }
+    Record ("TaxiRouter/Mismatched", cMismatched, "routes");
+
+    Report ("TaxiRouter/NearestNode", MeasureNs (100000, [&] (uint32_t i)
+    {
+        s_dSink += router.NearestNode (BENCH_LAT + (i % 1000) * 1e-5 - 5e-3, BENCH_LON + (i % 997) * 1e-5 - 5e-3);
+    }), "query");
+
+    fetcher.Close ();
+    SimConnect_Close (hSimConnect);
+}
+#endif
+
+/**
+ * The wind the stand-in's sim has: from the west, veering and strengthening to the north, smooth over tens of miles.
+ */
+static void WindAt (double  dLat,
+                    double  dLon,
+                    double& dFromDeg,
+                    double& dKt)
+{
+    dFromDeg = 270.0 + 40.0 * sin ((dLat - BENCH_LAT) * 2.0) + 10.0 * cos ((dLon - BENCH_LON) * 3.0);
+    dKt      = 15.0 + 8.0 * (dLat - BENCH_LAT) + 3.0 * sin ((dLon - BENCH_LON) * 2.0);
+}
+
+static void CALLBACK SynthesizeMetar (float fLat,
+                                      float fLon,
+                                      float fAlt,
+                                      char* szMetar,
+                                      DWORD cchMetar,
+                                      void* pContext)
+{
+    double dFromDeg;
+    double dKt;
+
+    WindAt (fLat, fLon, dFromDeg, dKt);
+    snprintf (szMetar, cchMetar, "KBNC 011200Z %03d%02dKT&D980NG 9999&B-1500&D3048 FEW030&CU001FNMN000N 12/05 Q1015",
+              (int)lround (dFromDeg) % 360, (int)lround (dKt));
+}
+
+static void CALLBACK WeatherDispatchProc (SIMCONNECT_RECV* pData,
+                                          DWORD            cbData,
+                                          void*            pContext)
+{
+    ((CWeatherCache*)pContext)->OnRecv (pData);
+}
+
+/**
+ * Vehicles around the aircraft each asking for the wind every frame for a minute of sim time, through the cache,
+ *  against each asking the sim once a second: the requests that reach the sim, and how far the interpolated wind is
+ *  from the sim's own at the vehicles. Then the cost of a query and of parsing a METAR.
+ */
+static void BenchWeatherCache ()
+{
+    const DWORD  cVehicles = 200;
+    const int    cFrames   = 60 * 60;
+    const double dFrameSec = 1.0 / 60.0;
+
+    std::vector<double> lats (cVehicles);
+    std::vector<double> lons (cVehicles);
+    std::mt19937        rng (3);
+
+    for (DWORD i = 0; i < cVehicles; i++)
+    {
+        lats[i] = BENCH_LAT + std::uniform_real_distribution<double> (-0.3, 0.3) (rng);
+        lons[i] = BENCH_LON + std::uniform_real_distribution<double> (-0.3, 0.3) (rng);
+    }
+
+    CSimConnectStandIn::SetWeather (SynthesizeMetar, NULL);
+
+    HANDLE        hSimConnect = NULL;
+    CWeatherCache cache (10);
+
+    if (FAILED (SimConnect_Open (&hSimConnect, "BenchWeather", NULL, 0, NULL, 0))) return;
+    cache.Open (hSimConnect);
+
+    // The first frame alone: every vehicle misses, but each grid point is asked for once
+    WeatherSample sample;
+    DWORD         cAnswered = 0;
+    double        dErrorKt  = 0.0;
+
+    cache.Prefetch (BENCH_LAT, BENCH_LON, 0.0);
+    for (DWORD i = 0; i < cVehicles; i++) cache.Query (lats[i], lons[i], 0.0, sample);
+    Record ("Weather/FirstFrame/Points", cache.PendingCount (), "points");
+
+    for (int iFrame = 0; iFrame < cFrames; iFrame++)
+    {
+        double dNowSec = iFrame * dFrameSec;
+
+        SimConnect_CallDispatch (hSimConnect, WeatherDispatchProc, &cache);
+        if (iFrame % 60 == 0) cache.Prefetch (BENCH_LAT, BENCH_LON, dNowSec);
+
+        for (DWORD i = 0; i < cVehicles; i++)
+        {
+            if (!cache.Query (lats[i], lons[i], dNowSec, sample) || iFrame != cFrames - 1) continue;
+
+            double dFromDeg;
+            double dKt;
+            WindAt (lats[i], lons[i], dFromDeg, dKt);
+
+            double dNorth = -dKt * cos (dFromDeg * M_PI / 180.0) - sample.fWindNorthKt;
+            double dEast  = -dKt * sin (dFromDeg * M_PI / 180.0) - sample.fWindEastKt;
+            dErrorKt += sqrt (dNorth * dNorth + dEast * dEast);
+            cAnswered++;
+        }
+    }
+    Record ("Weather/Requests/Cached", cache.RequestCount (), "requests/min");
+    Record ("Weather/Requests/PerVehicle", cVehicles * 60, "requests/min");
+    Record ("Weather/Answered", cAnswered, "vehicles");
+    Record ("Weather/Error", cAnswered ? dErrorKt / cAnswered : 0.0, "kt");
+
+    Report ("Weather/Query", MeasureNs (1 << 20, [&] (uint32_t i)
+    {
+        cache.Query (lats[i % cVehicles], lons[i % cVehicles], cFrames * dFrameSec, sample);
+        s_dSink += sample.fWindNorthKt;
+    }), "query");
+
+    char szMetar[MAX_METAR_LENGTH];
+    SynthesizeMetar ((float)BENCH_LAT, (float)BENCH_LON, 0.0f, szMetar, MAX_METAR_LENGTH, NULL);
+    Report ("Weather/ParseMetar", MeasureNs (100000, [&] (uint32_t i)
+    {
+        ParseMetar (szMetar, sample);
+        s_dSink += sample.fWindEastKt;
+    }), "metar");
+    cache.Close ();
+
+    // Observations that come after their requests were given up on, once the next points are requested in their
+    //  slots, must not be taken for those; at the grid points themselves nothing is interpolated
+    CWeatherCache late (10);
+    double        dNowSec     = 0.0;
+    double        dMaxErrorKt = 0.0;
+    int32_t       iLat0       = (int32_t)floor ((BENCH_LAT + 90.0) / WEATHER_CELL_DEG);
+    int32_t       iLon0       = (int32_t)floor ((BENCH_LON + 180.0) / WEATHER_CELL_DEG);
+
+    late.Open (hSimConnect);
+    late.Prefetch (BENCH_LAT, BENCH_LON, dNowSec);
+    for (dNowSec = WEATHER_REQUEST_TIMEOUT_SEC; late.PendingCount () != 0 && dNowSec < WEATHER_TTL_SEC; dNowSec += 1.0)
+    {
+        late.Prefetch (BENCH_LAT, BENCH_LON, dNowSec);
+        SimConnect_CallDispatch (hSimConnect, WeatherDispatchProc, &late);
+    }
+    for (int32_t iLatOff = -WEATHER_PREFETCH_CELLS; iLatOff <= WEATHER_PREFETCH_CELLS + 1; iLatOff++)
+    {
+        for (int32_t iLonOff = -WEATHER_PREFETCH_CELLS; iLonOff <= WEATHER_PREFETCH_CELLS + 1; iLonOff++)
+        {
+            double dLat = (iLat0 + iLatOff) * WEATHER_CELL_DEG - 90.0 + 1e-9;
+            double dLon = (iLon0 + iLonOff) * WEATHER_CELL_DEG - 180.0 + 1e-9;
+            double dFromDeg;
+            double dKt;
+
+            if (!late.Query (dLat, dLon, dNowSec, sample)) continue;
+            WindAt (dLat, dLon, dFromDeg, dKt);
+
+            double dNorth = -dKt * cos (dFromDeg * M_PI / 180.0) - sample.fWindNorthKt;
+            double dEast  = -dKt * sin (dFromDeg * M_PI / 180.0) - sample.fWindEastKt;
+            dMaxErrorKt = std::max (dMaxErrorKt, sqrt (dNorth * dNorth + dEast * dEast));
+        }
+    }
+    Record ("Weather/Late/MaxError", dMaxErrorKt, "kt");
+    late.Close ();
+    SimConnect_Close (hSimConnect);
+    CSimConnectStandIn::SetWeather (NULL, NULL);
+}
+
+// The Cast cases read the data through a pointer of another type, which is what the demo used to do and what the
+//  Memcpy cases are measured against; -Wstrict-aliasing is that very access, so it is silenced here only.
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wstrict-aliasing"
+#endif
+
+/**
+ * GetExceptionStr, and copying the received data out of pObjData->dwData the way DispatchProc does.
+ */
+static void BenchDemo ()
+{
+    Report ("Demo/GetExceptionStr", MeasureNs (1000000, [&] (uint32_t i)
+    {
+        s_dSink = s_dSink + CDemoRudderPos::GetExceptionStr ((SIMCONNECT_EXCEPTION)(i % 40))[0];
+    }));
+
+    // Back-to-back SIMOBJECT_DATA messages carrying a DataUserObject, as in a receive buffer
+    const DWORD         cMessages = 1024;
+    const size_t        cbMessage = sizeof (SIMCONNECT_RECV_SIMOBJECT_DATA) - sizeof (DWORD) + sizeof (CDemoRudderPos::DataUserObject);
+    std::vector<BYTE>   buffer (cMessages * cbMessage);
+
+    for (DWORD i = 0; i < cMessages; i++)
+    {
+        SIMCONNECT_RECV_SIMOBJECT_DATA* pObjData = (SIMCONNECT_RECV_SIMOBJECT_DATA*)&buffer[i * cbMessage];
+        CDemoRudderPos::DataUserObject  data;
+
+        data.dLat  = BENCH_LAT;
+        data.dLon  = BENCH_LON;
+        data.dHead = i % 360;
+        data.dAlt  = 400.0;
+
+        InitRecv (*pObjData, SIMCONNECT_RECV_ID_SIMOBJECT_DATA);
+        pObjData->dwSize = (DWORD)cbMessage;
+        memcpy (&pObjData->dwData, &data, sizeof (data));
+    }
+
+    Report ("Copy/DataUserObject/Cast", MeasureNs (1000000, [&] (uint32_t i)
+    {
+        SIMCONNECT_RECV_SIMOBJECT_DATA* pObjData = (SIMCONNECT_RECV_SIMOBJECT_DATA*)&buffer[i % cMessages * cbMessage];
+        CDemoRudderPos::DataUserObject  data     = *((CDemoRudderPos::DataUserObject*)&pObjData->dwData);
+        s_dSink = s_dSink + data.dHead;
+    }), "msg");
+
+    Report ("Copy/DataUserObject/Memcpy", MeasureNs (1000000, [&] (uint32_t i)
+    {
+        SIMCONNECT_RECV_SIMOBJECT_DATA* pObjData = (SIMCONNECT_RECV_SIMOBJECT_DATA*)&buffer[i % cMessages * cbMessage];
+        CDemoRudderPos::DataUserObject  data;
+        memcpy ((void*)&data, &pObjData->dwData, sizeof (data));
+        s_dSink = s_dSink + data.dHead;
+    }), "msg");
+
+    Report ("Copy/DataGroundVehicle/Cast", MeasureNs (1000000, [&] (uint32_t i)
+    {
+        SIMCONNECT_RECV_SIMOBJECT_DATA*    pObjData = (SIMCONNECT_RECV_SIMOBJECT_DATA*)&buffer[i % cMessages * cbMessage];
+        CDemoRudderPos::DataGroundVehicle  data     = *((CDemoRudderPos::DataGroundVehicle*)&pObjData->dwData);
+        s_dSink = s_dSink + data.dRudderPos;
+    }), "msg");
+}
+
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+
+/**
+ * Prints a table of results, or with --json, a JSON document for comparing runs.
+ */
+int main (int argc, char* argv[])
+{
+    bool bJson = argc > 1 && strcmp (argv[1], "--json") == 0;
+
+    BenchSpatialGrid ();
+    BenchPathFollower ();
+    BenchLocalFrame ();
+    BenchGeodesy ();
+    BenchTrig ();
+    BenchFormation ();
+    BenchDeadReckoning ();
+    BenchKalman ();
+    BenchTimerWheel ();
+    BenchTelemetryBus ();
+    BenchRecorder ();
+    BenchArchive ();
+    BenchFacilityCache ();
+    BenchFacilityRange ();
+#ifdef SIM_MSFS2020
+    BenchFacilityFetcher ();
+    BenchTaxiRouter ();
+#endif
+    BenchWeatherCache ();
+    BenchDemo ();
+    BenchDispatch ();
+    BenchSubscriptionMux ();
+    BenchConnectionMux ();
+    BenchClientData ();
+    BenchNetwork ();
+
+    if (bJson)
+    {
+        PrintJson ();
+    }
+    else
+    {
+        PrintTable ();
+    }
+    return 0;
+}
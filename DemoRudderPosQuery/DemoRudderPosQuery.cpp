@@ -0,0 +1,161 @@
+#include <Windows.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include "TelemetryArchive.h"
+
+
+/**
+ * A run of matching samples of one series, printed once it ends.
+ */
+typedef struct MatchRun
+{
+    const RecIndexEntry* pBlock;
+    DWORD                iSampleLast;
+    DWORD                idObject;
+    DWORD                eKind;
+    int64_t              nTimeFirst;
+    int64_t              nTimeLast;
+    double               dPeak;         // Furthest past the threshold
+    ARCHIVE_OP           eOp;
+    ULONGLONG            cRuns;
+}
+MatchRun;
+
+static const char* const s_szKinds[] = { "*", "user", "vehicle", "scan", "rudder" };
+
+
+static void PrintRun (const MatchRun& run)
+{
+    printf ("%10lu %-8s %12.3f %12.3f %14.6f\n", (unsigned long)run.idObject, s_szKinds[run.eKind <= BUS_KIND_RUDDER ? run.eKind : 0],
+            run.nTimeFirst / 1e6, run.nTimeLast / 1e6, run.dPeak);
+}
+
+/**
+ * Whether pBlock is the block of the series of pPrev after it; both are in the index of the archive.
+ */
+static bool IsNextOfSeries (const RecIndexEntry* pPrev,
+                            const RecIndexEntry* pBlock)
+{
+    if (pBlock <= pPrev || pBlock->idObject != pPrev->idObject || pBlock->eKind != pPrev->eKind) return false;
+
+    for (const RecIndexEntry* p = pPrev + 1; p < pBlock; p++)
+    {
+        if (p->idObject == pPrev->idObject && p->eKind == pPrev->eKind) return false;
+    }
+    return true;
+}
+
+/**
+ * Extends the current run with a sample right after it in the same block, or in the next block of the series;
+ *  otherwise prints it and starts another.
+ */
+static void CALLBACK MatchProc (const RecIndexEntry* pBlock,
+                                DWORD                iSample,
+                                int64_t              nTime,
+                                double               dValue,
+                                void*                pContext)
+{
+    MatchRun* pRun  = (MatchRun*)pContext;
+    bool      bNext = pRun->pBlock == pBlock ? iSample == pRun->iSampleLast + 1 :
+                      pRun->pBlock != NULL && iSample == 0 && pRun->iSampleLast + 1 == pRun->pBlock->cSamples && IsNextOfSeries (pRun->pBlock, pBlock);
+
+    if (bNext)
+    {
+        pRun->nTimeLast = nTime;
+        pRun->dPeak     = pRun->eOp == ARCHIVE_OP_ABOVE ? std::max (pRun->dPeak, dValue) : std::min (pRun->dPeak, dValue);
+    }
+    else
+    {
+        if (pRun->pBlock != NULL) PrintRun (*pRun);
+
+        pRun->idObject   = pBlock->idObject;
+        pRun->eKind      = pBlock->eKind;
+        pRun->nTimeFirst = nTime;
+        pRun->nTimeLast  = nTime;
+        pRun->dPeak      = dValue;
+        pRun->cRuns++;
+    }
+    pRun->pBlock      = pBlock;
+    pRun->iSampleLast = iSample;
+}
+
+static int Usage ()
+{
+    printf ("Usage: DemoRudderPosQuery <recording> <object|*> <user|vehicle|scan|rudder|*> <field> <above|below> <threshold> [<from> <to>]\n");
+    printf ("\n");
+    printf ("Prints when the field, 0 to %d, of the samples of the object and kind was above or below the threshold, as\n", TELEMETRY_REC_FIELDS - 1);
+    printf ("runs of consecutive samples; from and to limit it to a span of sim time in seconds. For example, when the\n");
+    printf ("rudder of object 42 went past 0.8:\n");
+    printf ("\n");
+    printf ("    DemoRudderPosQuery run.trec 42 rudder 0 above 0.8\n");
+    return 2;
+}
+
+/**
+ * Queries a recording of CTelemetryRecorder from the command line.
+ */
+int __cdecl main (int argc, char* argv[])
+{
+    if (argc != 7 && argc != 9) return Usage ();
+
+    ArchiveQuery query;
+    DWORD        eKind;
+
+    query.idObject = strcmp (argv[2], "*") == 0 ? ARCHIVE_ANY_OBJECT : (DWORD)strtoul (argv[2], NULL, 10);
+
+    for (eKind = 0; eKind <= BUS_KIND_RUDDER && strcmp (argv[3], s_szKinds[eKind]) != 0; eKind++);
+    if (eKind > BUS_KIND_RUDDER) return Usage ();
+    query.eKind = eKind;
+
+    query.iField = (DWORD)strtoul (argv[4], NULL, 10);
+    if (query.iField >= TELEMETRY_REC_FIELDS) return Usage ();
+
+    if (strcmp (argv[5], "above") == 0)
+    {
+        query.eOp = ARCHIVE_OP_ABOVE;
+    }
+    else if (strcmp (argv[5], "below") == 0)
+    {
+        query.eOp = ARCHIVE_OP_BELOW;
+    }
+    else
+    {
+        return Usage ();
+    }
+    query.dThreshold = atof (argv[6]);
+
+    if (argc == 9)
+    {
+        query.nTimeFrom = (int64_t)floor (atof (argv[7]) * 1e6);
+        query.nTimeTo   = (int64_t)ceil (atof (argv[8]) * 1e6);
+    }
+
+    CTelemetryArchive archive;
+    if (!archive.Open (argv[1]))
+    {
+        printf ("%s is not a recording\n", argv[1]);
+        return 1;
+    }
+
+    MatchRun run;
+    memset (&run, 0, sizeof (run));
+    run.eOp = query.eOp;
+
+    printf ("%10s %-8s %12s %12s %14s\n", "Object", "Kind", "From (s)", "To (s)", "Peak");
+
+    std::chrono::steady_clock::time_point t0    = std::chrono::steady_clock::now ();
+    ArchiveStats                          stats = archive.Query (query, MatchProc, &run);
+    double                                dMs   = std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - t0).count ();
+
+    if (run.pBlock != NULL) PrintRun (run);
+
+    printf ("\n%llu samples in %llu runs; %lu of %lu blocks skipped by their zone maps, %llu samples decoded from %.1f MB of %.1f MB in %.1f ms\n",
+            (unsigned long long)stats.cMatches, (unsigned long long)run.cRuns, (unsigned long)stats.cBlocksSkipped, (unsigned long)stats.cBlocks,
+            (unsigned long long)stats.cSamples, stats.cbColumns / 1e6, archive.Size () / 1e6, dMs);
+    return 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/**
+ * The small part of Winsock that the stand-in server and its clients use, on top of BSD sockets.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#include "Windows.h"
+
+typedef int                 SOCKET;
+typedef unsigned long       u_long;
+
+typedef struct WSAData
+{
+    WORD wVersion;
+    WORD wHighVersion;
+}
+WSADATA;
+
+#define INVALID_SOCKET      (-1)
+#define SOCKET_ERROR        (-1)
+#define WSAEWOULDBLOCK      EWOULDBLOCK
+
+#define FD_READ             0x01
+#define FD_CLOSE            0x20
+
+#define MAKEWORD(a, b)      ((WORD)(((BYTE)(a)) | ((WORD)((BYTE)(b))) << 8))
+
+
+inline int WSAStartup (WORD     wVersionRequested,
+                       WSADATA* pData)
+{
+    pData->wVersion     = wVersionRequested;
+    pData->wHighVersion = wVersionRequested;
+    return 0;
+}
+
+inline int WSACleanup ()
+{
+    return 0;
+}
+
+inline int WSAGetLastError ()
+{
+    return errno;
+}
+
+inline int closesocket (SOCKET s)
+{
+    return close (s);
+}
+
+inline int ioctlsocket (SOCKET  s,
+                        long    cmd,
+                        u_long* pArg)
+{
+    int nArg = (int)*pArg;
+    return ioctl (s, cmd, &nArg);
+}
+
+/**
+ * Tie the event to the socket, so that waits on it also return while the socket has something to read (see
+ *  PosixEvent); lNetworkEvents 0 unties it. Unlike Winsock the socket is left as it was, blocking or not.
+ */
+inline int WSAEventSelect (SOCKET s,
+                           HANDLE hEventObject,
+                           long   lNetworkEvents)
+{
+    ((PosixEvent*)hEventObject)->fd = lNetworkEvents != 0 ? s : -1;
+    return 0;
+}
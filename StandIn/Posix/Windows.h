@@ -0,0 +1,169 @@
+#pragma once
+
+/**
+ * The small part of the Win32 API that the SimConnect headers and the demo use, so they compile on POSIX systems
+ *  against the SimConnect stand-in.
+ */
+
+#include <poll.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef uint32_t            DWORD;
+typedef uint8_t             BYTE;
+typedef uint16_t            WORD;
+typedef int32_t             BOOL;
+typedef int32_t             LONG;
+typedef uint32_t            UINT;
+typedef int32_t             INT32;
+typedef uint32_t            UINT32;
+typedef int64_t             LONGLONG;
+typedef uint64_t            ULONGLONG;
+typedef int32_t             HRESULT;
+typedef void*               HANDLE;
+typedef void*               HWND;
+typedef void*               LPVOID;
+typedef const char*         LPCSTR;
+typedef char*               LPSTR;
+
+typedef struct _GUID
+{
+    uint32_t Data1;
+    uint16_t Data2;
+    uint16_t Data3;
+    uint8_t  Data4[8];
+}
+GUID;
+
+#define __int64             long long
+#define CALLBACK
+#define WINAPI
+#define __cdecl
+#define __stdcall
+
+#define TRUE                1
+#define FALSE               0
+#define MAX_PATH            260
+
+#define S_OK                ((HRESULT)0)
+#define E_NOTIMPL           ((HRESULT)0x80004001)
+#define E_FAIL              ((HRESULT)0x80004005)
+#define SUCCEEDED(hr)       ((HRESULT)(hr) >= 0)
+#define FAILED(hr)          ((HRESULT)(hr) < 0)
+
+#define _countof(a)         (sizeof (a) / sizeof ((a)[0]))
+
+#define INFINITE            0xFFFFFFFF
+#define WAIT_OBJECT_0       0x00000000L
+#define WAIT_TIMEOUT        0x00000102L
+#define WAIT_FAILED         0xFFFFFFFF
+#define MAXIMUM_WAIT_OBJECTS 64
+
+
+inline void Sleep (DWORD dwMilliseconds)
+{
+    if (dwMilliseconds == 0) return;
+
+    struct timespec ts;
+    ts.tv_sec  = dwMilliseconds / 1000;
+    ts.tv_nsec = (long)(dwMilliseconds % 1000) * 1000000L;
+    nanosleep (&ts, NULL);
+}
+
+/**
+ * Events for a single thread: nothing can set one while WaitForSingleObject waits, so a wait on an event that is not
+ *  set just sleeps out the timeout (1 ms for INFINITE, which would otherwise never return). The exception is an event
+ *  tied to a socket with WSAEventSelect, which is also set while the socket has something to read or was closed by
+ *  the other end; waits on those poll the sockets instead of sleeping.
+ */
+typedef struct PosixEvent
+{
+    BOOL bManualReset;
+    BOOL bSet;
+    int  fd;            // -1 for none
+}
+PosixEvent;
+
+inline HANDLE CreateEvent (void*       pAttributes,
+                           BOOL        bManualReset,
+                           BOOL        bInitialState,
+                           const char* szName)
+{
+    PosixEvent* pEvent = (PosixEvent*)malloc (sizeof (PosixEvent));
+    pEvent->bManualReset = bManualReset;
+    pEvent->bSet         = bInitialState;
+    pEvent->fd           = -1;
+    return pEvent;
+}
+
+inline BOOL SetEvent (HANDLE hEvent)
+{
+    ((PosixEvent*)hEvent)->bSet = TRUE;
+    return TRUE;
+}
+
+/**
+ * Waits for any one of the events (bWaitAll is not supported) and returns WAIT_OBJECT_0 plus the index of the first
+ *  one that is set.
+ */
+inline DWORD WaitForMultipleObjects (DWORD         cHandles,
+                                     const HANDLE* phHandles,
+                                     BOOL          bWaitAll,
+                                     DWORD         dwMilliseconds)
+{
+    if (bWaitAll || cHandles == 0 || cHandles > MAXIMUM_WAIT_OBJECTS) return WAIT_FAILED;
+
+    for (DWORD i = 0; i < cHandles; i++)
+    {
+        PosixEvent* pEvent = (PosixEvent*)phHandles[i];
+        if (pEvent->bSet)
+        {
+            if (!pEvent->bManualReset) pEvent->bSet = FALSE;
+            return WAIT_OBJECT_0 + i;
+        }
+    }
+
+    // Only the sockets can set an event from here on
+    struct pollfd fds[MAXIMUM_WAIT_OBJECTS];
+    DWORD         iEvents[MAXIMUM_WAIT_OBJECTS];
+    nfds_t        cFds = 0;
+
+    for (DWORD i = 0; i < cHandles; i++)
+    {
+        PosixEvent* pEvent = (PosixEvent*)phHandles[i];
+        if (pEvent->fd < 0) continue;
+
+        fds[cFds].fd      = pEvent->fd;
+        fds[cFds].events  = POLLIN;
+        fds[cFds].revents = 0;
+        iEvents[cFds++]   = i;
+    }
+    if (cFds == 0)
+    {
+        Sleep (dwMilliseconds == INFINITE ? 1 : dwMilliseconds);
+        return WAIT_TIMEOUT;
+    }
+
+    if (poll (fds, cFds, dwMilliseconds == INFINITE ? -1 : (int)dwMilliseconds) > 0)
+    {
+        for (nfds_t i = 0; i < cFds; i++)
+        {
+            if (fds[i].revents & (POLLIN | POLLHUP)) return WAIT_OBJECT_0 + iEvents[i];
+        }
+    }
+    return WAIT_TIMEOUT;
+}
+
+inline DWORD WaitForSingleObject (HANDLE hEvent,
+                                  DWORD  dwMilliseconds)
+{
+    return WaitForMultipleObjects (1, &hEvent, FALSE, dwMilliseconds);
+}
+
+inline BOOL CloseHandle (HANDLE hObject)
+{
+    free (hObject);
+    return TRUE;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+/**
+ * socklen_t and inet_pton, which come with the BSD socket headers.
+ */
+
+#include "WinSock2.h"
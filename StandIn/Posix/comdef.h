@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <Windows.h>
+#include <tchar.h>
+
+
+/**
+ * Formats an HRESULT; there are no system message tables to look it up in.
+ */
+class _com_error
+{
+public:
+    explicit _com_error (HRESULT hr)
+    {
+        snprintf (m_szMessage, sizeof (m_szMessage), "HRESULT 0x%08X", (unsigned)hr);
+    }
+
+    const TCHAR* ErrorMessage () const
+    {
+        return m_szMessage;
+    }
+
+private:
+    TCHAR m_szMessage[32];
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+/**
+ * Narrow-character mappings of the generic-text macros.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+typedef char                TCHAR;
+typedef char                _TCHAR;
+
+#define _T(x)               x
+#define _tprintf            printf
+#define _tmain              main
@@ -0,0 +1,1319 @@
+#include <WinSock2.h>
+#include <Ws2tcpip.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SimConnectStandIn.h"
+#include "SimConnectStandInWire.h"
+
+#ifdef _WIN32
+#pragma comment (lib, "Ws2_32.lib")
+#endif
+
+
+namespace
+{
+    typedef struct ClientDatum
+    {
+        DWORD dwOffset;
+        DWORD cbSize;
+    }
+    ClientDatum;
+
+    typedef struct ClientDataRequest
+    {
+        DWORD idRequest;
+        DWORD idClientData;
+        DWORD idDefine;
+        DWORD dwFlags;
+        bool  bOnSet;           // Else it was once, and has been answered
+    }
+    ClientDataRequest;
+
+    typedef struct State
+    {
+        State () :
+            bOpen    (false),
+            bRepeat  (false),
+            bRemote  (false),
+            cCalls   (0),
+            dwSendID (0),
+            hEvent   (NULL),
+            sock     (INVALID_SOCKET)
+        {
+        }
+
+        bool                                    bOpen;
+        bool                                    bRepeat;
+        bool                                    bRemote;        // Opened to a stand-in server
+        DWORD                                   cCalls;
+        DWORD                                   dwSendID;       // Of the last packet sent to the server
+        HANDLE                                  hEvent;         // Set when a message is posted, like the sim does
+        SOCKET                                  sock;           // To the server; closed when the server goes away
+        std::vector<BYTE>                       queue;          // Messages back to back, each dwSize long
+        std::vector<BYTE>                       received;       // From the server, up to a partial message
+        std::vector<BYTE>                       packet;         // Scratch for packets followed by data
+        std::vector<DWORD>                      definitions;    // Field count per definition ID
+        std::vector<CSimConnectStandIn::Request> requests;
+        std::vector<DWORD>                      clientAreas;    // Index + 1 in Connections::areas per client data ID
+        std::vector<std::vector<ClientDatum>>   clientDefinitions;
+        std::vector<ClientDataRequest>          clientRequests;
+    }
+    State;
+
+    /**
+     * A client data area, shared by every connection that maps its name, like the sim shares it between add-ons.
+     */
+    typedef struct ClientDataArea
+    {
+        std::string       strName;
+        std::vector<BYTE> data;         // Empty until created
+        const State*      pCreator;
+        bool              bReadOnly;
+    }
+    ClientDataArea;
+
+    typedef struct Server
+    {
+        DWORD       dwConfigIndex;
+        sockaddr_in addr;
+    }
+    Server;
+
+    typedef struct Connections
+    {
+        Connections () :
+            pCurrent        (NULL),
+            bWinsock        (false),
+            pfnMetar        (NULL),
+            pMetarContext   (NULL)
+        {
+        }
+
+        ~Connections ()
+        {
+            for (size_t i = 0; i < states.size (); i++)
+            {
+                if (states[i]->sock != INVALID_SOCKET) closesocket (states[i]->sock);
+                delete states[i];
+            }
+            if (bWinsock) WSACleanup ();
+        }
+
+        std::vector<State*>         states;     // Closed ones are reused by the next open
+        State*                      pCurrent;   // The last one opened
+        std::vector<Server>         servers;
+        bool                        bWinsock;
+        std::vector<ClientDataArea> areas;
+        std::vector<BYTE>           message;    // Scratch for CLIENT_DATA messages
+        std::vector<BYTE>           facilities[4];  // Per SIMCONNECT_FACILITY_LIST_TYPE up to VOR, as sent
+        std::map<std::string, std::vector<BYTE>> facilityData;  // FACILITY_DATA messages per ICAO code
+        CSimConnectStandIn::MetarProc pfnMetar;
+        void*                       pMetarContext;
+    }
+    Connections;
+
+    Connections& GetConnections ()
+    {
+        static Connections s_connections;
+        return s_connections;
+    }
+
+    /**
+     * The connection the calls without a handle are about.
+     */
+    State& GetState ()
+    {
+        Connections& connections = GetConnections ();
+
+        if (connections.pCurrent == NULL)
+        {
+            connections.states.push_back (new State ());
+            connections.pCurrent = connections.states.back ();
+        }
+        return *connections.pCurrent;
+    }
+
+    /**
+     * The open connection of a handle, or NULL.
+     */
+    State* FindState (HANDLE hSimConnect)
+    {
+        Connections& connections = GetConnections ();
+
+        for (size_t i = 0; i < connections.states.size (); i++)
+        {
+            State* pState = connections.states[i];
+            if ((HANDLE)pState == hSimConnect) return pState->bOpen ? pState : NULL;
+        }
+        return NULL;
+    }
+
+    HRESULT Call (HANDLE hSimConnect)
+    {
+        State* pState = FindState (hSimConnect);
+        if (pState == NULL) return E_FAIL;
+
+        // Local calls are numbered too, for the exceptions the stand-in raises itself
+        pState->cCalls++;
+        if (!pState->bRemote) pState->dwSendID = pState->cCalls;
+        return S_OK;
+    }
+
+    void Enqueue (State&                 state,
+                  const SIMCONNECT_RECV* pData)
+    {
+        state.queue.insert (state.queue.end (), (const BYTE*)pData, (const BYTE*)pData + pData->dwSize);
+
+        if (state.hEvent != NULL) SetEvent (state.hEvent);
+    }
+
+    /**
+     * An exception about the last call, dwIndex being the number of the offending argument after the handle.
+     */
+    void PostException (State&               state,
+                        SIMCONNECT_EXCEPTION eException,
+                        DWORD                dwIndex)
+    {
+        SIMCONNECT_RECV_EXCEPTION ex;
+        memset (&ex, 0, sizeof (ex));
+        ex.dwSize      = sizeof (ex);
+        ex.dwVersion   = STANDIN_RECV_VERSION;
+        ex.dwID        = SIMCONNECT_RECV_ID_EXCEPTION;
+        ex.dwException = eException;
+        ex.dwSendID    = state.dwSendID;
+        ex.dwIndex     = dwIndex;
+        Enqueue (state, &ex);
+    }
+
+    DWORD ClientDatumSize (DWORD dwSizeOrType)
+    {
+        switch (dwSizeOrType)
+        {
+            case SIMCONNECT_CLIENTDATATYPE_INT8:    return 1;
+            case SIMCONNECT_CLIENTDATATYPE_INT16:   return 2;
+            case SIMCONNECT_CLIENTDATATYPE_INT32:   return 4;
+            case SIMCONNECT_CLIENTDATATYPE_INT64:   return 8;
+            case SIMCONNECT_CLIENTDATATYPE_FLOAT32: return 4;
+            case SIMCONNECT_CLIENTDATATYPE_FLOAT64: return 8;
+            default:                                return dwSizeOrType;
+        }
+    }
+
+    /**
+     * The area a connection has mapped a client data ID to, or NULL.
+     */
+    ClientDataArea* FindArea (const State& state,
+                              DWORD        idClientData)
+    {
+        if (idClientData >= state.clientAreas.size () || state.clientAreas[idClientData] == 0) return NULL;
+        return &GetConnections ().areas[state.clientAreas[idClientData] - 1];
+    }
+
+    const std::vector<ClientDatum>& FindClientDefinition (const State& state,
+                                                          DWORD        idDefine)
+    {
+        static const std::vector<ClientDatum> s_empty;
+        return idDefine < state.clientDefinitions.size () ? state.clientDefinitions[idDefine] : s_empty;
+    }
+
+    /**
+     * Whether every field of a definition lies within an area, and their total size.
+     */
+    bool FitsArea (const std::vector<ClientDatum>& definition,
+                   const ClientDataArea&           area,
+                   DWORD&                          cbTotal)
+    {
+        cbTotal = 0;
+        for (size_t i = 0; i < definition.size (); i++)
+        {
+            if (definition[i].dwOffset > area.data.size () || definition[i].cbSize > area.data.size () - definition[i].dwOffset) return false;
+            cbTotal += definition[i].cbSize;
+        }
+        return !definition.empty ();
+    }
+
+    /**
+     * Send the fields of a request's definition, as they are in the area now.
+     */
+    void SendClientData (State&                   state,
+                         const ClientDataRequest& request,
+                         const ClientDataArea&    area)
+    {
+        const std::vector<ClientDatum>& definition = FindClientDefinition (state, request.idDefine);
+        std::vector<BYTE>&              message    = GetConnections ().message;
+        DWORD                           cbData;
+
+        if (!FitsArea (definition, area, cbData))
+        {
+            PostException (state, SIMCONNECT_EXCEPTION_DATA_ERROR, 3);
+            return;
+        }
+
+        // The data in place of dwData, the last member of the packed message
+        message.assign (sizeof (SIMCONNECT_RECV_CLIENT_DATA) - sizeof (DWORD) + cbData, 0);
+
+        SIMCONNECT_RECV_CLIENT_DATA* pClientData = (SIMCONNECT_RECV_CLIENT_DATA*)&message[0];
+        pClientData->dwSize        = (DWORD)message.size ();
+        pClientData->dwVersion     = STANDIN_RECV_VERSION;
+        pClientData->dwID          = SIMCONNECT_RECV_ID_CLIENT_DATA;
+        pClientData->dwRequestID   = request.idRequest;
+        pClientData->dwObjectID    = request.idClientData;
+        pClientData->dwDefineID    = request.idDefine;
+        pClientData->dwentrynumber = 1;
+        pClientData->dwoutof       = 1;
+        pClientData->dwDefineCount = (DWORD)definition.size ();
+
+        BYTE* pField = (BYTE*)&pClientData->dwData;
+        for (size_t i = 0; i < definition.size (); i++)
+        {
+            memcpy (pField, &area.data[definition[i].dwOffset], definition[i].cbSize);
+            pField += definition[i].cbSize;
+        }
+        Enqueue (state, pClientData);
+    }
+
+    /**
+     * Size of an entry of a facility list, or 0 for a type the stand-in does not list.
+     */
+    DWORD FacilitySize (DWORD eType)
+    {
+        switch (eType)
+        {
+            case SIMCONNECT_FACILITY_LIST_TYPE_AIRPORT:  return sizeof (SIMCONNECT_DATA_FACILITY_AIRPORT);
+            case SIMCONNECT_FACILITY_LIST_TYPE_WAYPOINT: return sizeof (SIMCONNECT_DATA_FACILITY_WAYPOINT);
+            case SIMCONNECT_FACILITY_LIST_TYPE_NDB:      return sizeof (SIMCONNECT_DATA_FACILITY_NDB);
+            case SIMCONNECT_FACILITY_LIST_TYPE_VOR:      return sizeof (SIMCONNECT_DATA_FACILITY_VOR);
+            default:                                     return 0;
+        }
+    }
+
+    /**
+     * The facilities set for a type, in pages of up to 32 KB like the sim's; an empty list still gets one.
+     */
+    void SendFacilities (State&                     state,
+                         DWORD                      eType,
+                         SIMCONNECT_DATA_REQUEST_ID idRequest)
+    {
+        static const DWORD s_cbPageMax = 32768;
+
+        static const DWORD s_rgidList[] =
+        {
+            SIMCONNECT_RECV_ID_AIRPORT_LIST,
+            SIMCONNECT_RECV_ID_WAYPOINT_LIST,
+            SIMCONNECT_RECV_ID_NDB_LIST,
+            SIMCONNECT_RECV_ID_VOR_LIST
+        };
+
+        const std::vector<BYTE>& facilities = GetConnections ().facilities[eType];
+        std::vector<BYTE>&       message    = GetConnections ().message;
+        DWORD                    cbEntry    = FacilitySize (eType);
+        DWORD                    cEntries   = (DWORD)(facilities.size () / cbEntry);
+        DWORD                    cPerPage   = (s_cbPageMax - sizeof (SIMCONNECT_RECV_FACILITIES_LIST)) / cbEntry;
+        DWORD                    cPages     = std::max ((DWORD)1, (cEntries + cPerPage - 1) / cPerPage);
+
+        for (DWORD iPage = 0; iPage < cPages; iPage++)
+        {
+            DWORD iFirst = iPage * cPerPage;
+            DWORD cPage  = std::min (cPerPage, cEntries - iFirst);
+
+            message.assign (sizeof (SIMCONNECT_RECV_FACILITIES_LIST) + (size_t)cPage * cbEntry, 0);
+
+            SIMCONNECT_RECV_FACILITIES_LIST* pList = (SIMCONNECT_RECV_FACILITIES_LIST*)&message[0];
+            pList->dwSize        = (DWORD)message.size ();
+            pList->dwVersion     = STANDIN_RECV_VERSION;
+            pList->dwID          = s_rgidList[eType];
+            pList->dwRequestID   = idRequest;
+            pList->dwArraySize   = cPage;
+            pList->dwEntryNumber = iPage;
+            pList->dwOutOf       = cPages;
+            if (cPage > 0) memcpy (pList + 1, &facilities[(size_t)iFirst * cbEntry], (size_t)cPage * cbEntry);
+            Enqueue (state, pList);
+        }
+    }
+
+    template <typename TPacket>
+    void InitPacket (TPacket& packet)
+    {
+        memset (&packet, 0, sizeof (packet));
+    }
+
+    void CopyString (char        (&szTo)[STANDIN_WIRE_STRING],
+                     const char* szFrom)
+    {
+        if (szFrom != NULL) strncpy (szTo, szFrom, STANDIN_WIRE_STRING - 1);
+    }
+
+    bool SendAll (SOCKET      sock,
+                  const char* pData,
+                  int         cbData)
+    {
+        while (cbData > 0)
+        {
+            int cbSent = send (sock, pData, cbData, MSG_NOSIGNAL);
+            if (cbSent > 0)
+            {
+                pData  += cbSent;
+                cbData -= cbSent;
+            }
+            else if (cbSent < 0 && WSAGetLastError () == WSAEWOULDBLOCK)
+            {
+                // The server is behind; wait for it to take more
+                fd_set write;
+                FD_ZERO (&write);
+                FD_SET (sock, &write);
+                select ((int)sock + 1, NULL, &write, NULL, NULL);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Fill in the header of a packet and send it, cbPacket bytes from packet on.
+     */
+    HRESULT Send (State&      state,
+                  WIRE_ID     eId,
+                  WirePacket& packet,
+                  DWORD       cbPacket)
+    {
+        if (state.sock == INVALID_SOCKET) return E_FAIL;
+
+        packet.dwSize    = cbPacket;
+        packet.dwVersion = STANDIN_WIRE_VERSION;
+        packet.dwID      = eId;
+        packet.dwSendID  = ++state.dwSendID;
+        return SendAll (state.sock, (const char*)&packet, (int)cbPacket) ? S_OK : E_FAIL;
+    }
+
+    /**
+     * Close the connection to the server, untying the event from it first.
+     */
+    void Disconnect (State& state)
+    {
+        if (state.hEvent != NULL) WSAEventSelect (state.sock, state.hEvent, 0);
+        closesocket (state.sock);
+        state.sock = INVALID_SOCKET;
+    }
+
+    /**
+     * Move whatever the server has sent into the queue, whole messages only. When the server goes away the
+     *  connection gets a QUIT message, as when a sim exits, and the calls that would go to it fail from then on.
+     */
+    void Receive (State& state)
+    {
+        char buffer[65536];
+        bool bLost = false;
+
+        for (;;)
+        {
+            int cbReceived = recv (state.sock, buffer, sizeof (buffer), 0);
+            if (cbReceived > 0)
+            {
+                state.received.insert (state.received.end (), buffer, buffer + cbReceived);
+            }
+            else
+            {
+                bLost = cbReceived == 0 || WSAGetLastError () != WSAEWOULDBLOCK;
+                break;
+            }
+        }
+
+        size_t ib = 0;
+        while (state.received.size () - ib >= sizeof (DWORD))
+        {
+            DWORD cbMessage;
+            memcpy (&cbMessage, &state.received[ib], sizeof (cbMessage));
+            if (cbMessage < sizeof (SIMCONNECT_RECV))
+            {
+                bLost = true;
+                break;
+            }
+            if (state.received.size () - ib < cbMessage) break;
+
+            const BYTE* pMessage = &state.received[ib];
+            state.queue.insert (state.queue.end (), pMessage, pMessage + cbMessage);
+            ib += cbMessage;
+        }
+        state.received.erase (state.received.begin (), state.received.begin () + ib);
+
+        if (bLost)
+        {
+            SIMCONNECT_RECV quit;
+            memset (&quit, 0, sizeof (quit));
+            quit.dwSize    = sizeof (quit);
+            quit.dwVersion = STANDIN_RECV_VERSION;
+            quit.dwID      = SIMCONNECT_RECV_ID_QUIT;
+            state.queue.insert (state.queue.end (), (const BYTE*)&quit, (const BYTE*)&quit + sizeof (quit));
+
+            Disconnect (state);
+            state.received.clear ();
+        }
+    }
+}
+
+
+void CSimConnectStandIn::Post (const SIMCONNECT_RECV* pData)
+{
+    Enqueue (GetState (), pData);
+}
+
+void CSimConnectStandIn::Post (HANDLE                 hSimConnect,
+                               const SIMCONNECT_RECV* pData)
+{
+    State* pState = FindState (hSimConnect);
+    if (pState != NULL) Enqueue (*pState, pData);
+}
+
+void CSimConnectStandIn::Clear ()
+{
+    GetState ().queue.clear ();
+}
+
+void CSimConnectStandIn::SetRepeat (bool bRepeat)
+{
+    GetState ().bRepeat = bRepeat;
+}
+
+const CSimConnectStandIn::Request* CSimConnectStandIn::FindRequest (DWORD             idObject,
+                                                                    SIMCONNECT_PERIOD period,
+                                                                    DWORD             idRequestFirst)
+{
+    State& state = GetState ();
+
+    for (size_t i = 0; i < state.requests.size (); i++)
+    {
+        const Request& request = state.requests[i];
+        if (request.idObject == idObject && request.period == period && request.idRequest >= idRequestFirst) return &request;
+    }
+    return NULL;
+}
+
+DWORD CSimConnectStandIn::DefinitionSize (DWORD idDefine)
+{
+    State& state = GetState ();
+    return idDefine < state.definitions.size () ? state.definitions[idDefine] : 0;
+}
+
+DWORD CSimConnectStandIn::CallCount ()
+{
+    return GetState ().cCalls;
+}
+
+void CSimConnectStandIn::SetServer (DWORD       dwConfigIndex,
+                                    const char* szAddress,
+                                    WORD        wPort)
+{
+    Connections& connections = GetConnections ();
+
+    if (!connections.bWinsock)
+    {
+        WSADATA data;
+        connections.bWinsock = WSAStartup (MAKEWORD (2, 2), &data) == 0;
+    }
+
+    for (size_t i = 0; i < connections.servers.size (); i++)
+    {
+        if (connections.servers[i].dwConfigIndex == dwConfigIndex)
+        {
+            connections.servers.erase (connections.servers.begin () + i);
+            break;
+        }
+    }
+    if (wPort == 0) return;
+
+    Server server;
+    memset (&server, 0, sizeof (server));
+    server.dwConfigIndex        = dwConfigIndex;
+    server.addr.sin_family      = AF_INET;
+    server.addr.sin_port        = htons (wPort);
+    inet_pton (AF_INET, szAddress, &server.addr.sin_addr);
+    connections.servers.push_back (server);
+}
+
+void CSimConnectStandIn::SetFacilities (SIMCONNECT_FACILITY_LIST_TYPE eType,
+                                        const void*                   pEntries,
+                                        DWORD                         cEntries)
+{
+    DWORD cbEntry = FacilitySize (eType);
+    if (cbEntry == 0) return;
+
+    GetConnections ().facilities[eType].assign ((const BYTE*)pEntries, (const BYTE*)pEntries + (size_t)cEntries * cbEntry);
+}
+
+void CSimConnectStandIn::SetFacilityData (const char* szIcao,
+                                          const void* pMessages,
+                                          DWORD       cbMessages)
+{
+    GetConnections ().facilityData[szIcao].assign ((const BYTE*)pMessages, (const BYTE*)pMessages + cbMessages);
+}
+
+void CSimConnectStandIn::SetWeather (MetarProc pfnMetar,
+                                     void*     pContext)
+{
+    GetConnections ().pfnMetar      = pfnMetar;
+    GetConnections ().pMetarContext = pContext;
+}
+
+
+SIMCONNECTAPI SimConnect_Open (HANDLE* phSimConnect,
+                               LPCSTR  szName,
+                               HWND    hWnd,
+                               DWORD   UserEventWin32,
+                               HANDLE  hEventHandle,
+                               DWORD   ConfigIndex)
+{
+    Connections& connections = GetConnections ();
+    SOCKET       sock        = INVALID_SOCKET;
+
+    for (size_t i = 0; i < connections.servers.size (); i++)
+    {
+        if (connections.servers[i].dwConfigIndex != ConfigIndex) continue;
+
+        const sockaddr_in& addr = connections.servers[i].addr;
+        sock = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (sock == INVALID_SOCKET) return E_FAIL;
+
+        if (connect (sock, (const sockaddr*)&addr, sizeof (addr)) != 0)
+        {
+            closesocket (sock);
+            return E_FAIL;
+        }
+
+        // Packets are small and each is a call the client is waiting on; reads never block the client
+        int    nNoDelay      = 1;
+        u_long ulNonBlocking = 1;
+        setsockopt (sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&nNoDelay, sizeof (nNoDelay));
+        ioctlsocket (sock, FIONBIO, &ulNonBlocking);
+        break;
+    }
+
+    State* pState = NULL;
+
+    for (size_t i = 0; i < connections.states.size () && pState == NULL; i++)
+    {
+        if (!connections.states[i]->bOpen) pState = connections.states[i];
+    }
+    if (pState == NULL)
+    {
+        connections.states.push_back (new State ());
+        pState = connections.states.back ();
+    }
+
+    *pState = State ();
+    pState->bOpen        = true;
+    pState->bRemote      = sock != INVALID_SOCKET;
+    pState->hEvent       = hEventHandle;
+    pState->sock         = sock;
+    connections.pCurrent = pState;
+    *phSimConnect        = (HANDLE)pState;
+
+    if (pState->bRemote)
+    {
+        // The event is set when the server has sent something, as well as for posted messages
+        if (hEventHandle != NULL) WSAEventSelect (sock, hEventHandle, FD_READ | FD_CLOSE);
+
+        WireOpen packet;
+        InitPacket (packet);
+        CopyString (packet.szName, szName);
+
+        HRESULT hr = Send (*pState, WIRE_ID_OPEN, packet, sizeof (packet));
+        if (FAILED (hr))
+        {
+            SimConnect_Close (*phSimConnect);
+            *phSimConnect = NULL;
+            return hr;
+        }
+    }
+    return S_OK;
+}
+
+SIMCONNECTAPI SimConnect_Close (HANDLE hSimConnect)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State* pState = (State*)hSimConnect;
+    if (pState->sock != INVALID_SOCKET) Disconnect (*pState);
+
+    pState->bOpen  = false;
+    pState->hEvent = NULL;
+    return S_OK;
+}
+
+SIMCONNECTAPI SimConnect_CallDispatch (HANDLE       hSimConnect,
+                                       DispatchProc pfcnDispatch,
+                                       void*        pContext)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    // The dispatch procedure may post more messages, which are left for the next call
+    State&            state = *(State*)hSimConnect;
+    std::vector<BYTE> queue;
+
+    if (state.sock != INVALID_SOCKET) Receive (state);
+    queue.swap (state.queue);
+
+    for (size_t ib = 0; ib < queue.size (); )
+    {
+        SIMCONNECT_RECV* pData = (SIMCONNECT_RECV*)&queue[ib];
+        ib += pData->dwSize;
+        pfcnDispatch (pData, pData->dwSize, pContext);
+    }
+
+    if (state.bRepeat)
+    {
+        queue.insert (queue.end (), state.queue.begin (), state.queue.end ());
+        state.queue.swap (queue);
+    }
+    return S_OK;
+}
+
+SIMCONNECTAPI SimConnect_GetLastSentPacketID (HANDLE hSimConnect,
+                                              DWORD* pdwError)
+{
+    State* pState = FindState (hSimConnect);
+    if (pState == NULL) return E_FAIL;
+
+    *pdwError = pState->dwSendID;
+    return S_OK;
+}
+
+SIMCONNECTAPI SimConnect_MapClientEventToSimEvent (HANDLE                     hSimConnect,
+                                                   SIMCONNECT_CLIENT_EVENT_ID EventID,
+                                                   const char*                EventName)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    if (!state.bRemote) return S_OK;
+
+    WireMapClientEventToSimEvent packet;
+    InitPacket (packet);
+    packet.idEvent = EventID;
+    CopyString (packet.szEventName, EventName);
+    return Send (state, WIRE_ID_MAP_CLIENT_EVENT_TO_SIM_EVENT, packet, sizeof (packet));
+}
+
+SIMCONNECTAPI SimConnect_AddClientEventToNotificationGroup (HANDLE                          hSimConnect,
+                                                            SIMCONNECT_NOTIFICATION_GROUP_ID GroupID,
+                                                            SIMCONNECT_CLIENT_EVENT_ID      EventID,
+                                                            BOOL                            bMaskable)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    if (!state.bRemote) return S_OK;
+
+    WireAddClientEventToNotificationGroup packet;
+    InitPacket (packet);
+    packet.idGroup   = GroupID;
+    packet.idEvent   = EventID;
+    packet.bMaskable = bMaskable;
+    return Send (state, WIRE_ID_ADD_CLIENT_EVENT_TO_NOTIFICATION_GROUP, packet, sizeof (packet));
+}
+
+SIMCONNECTAPI SimConnect_MapInputEventToClientEvent (HANDLE                     hSimConnect,
+                                                     SIMCONNECT_INPUT_GROUP_ID  GroupID,
+                                                     const char*                szInputDefinition,
+                                                     SIMCONNECT_CLIENT_EVENT_ID DownEventID,
+                                                     DWORD                      DownValue,
+                                                     SIMCONNECT_CLIENT_EVENT_ID UpEventID,
+                                                     DWORD                      UpValue,
+                                                     BOOL                       bMaskable)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    if (!state.bRemote) return S_OK;
+
+    WireMapInputEventToClientEvent packet;
+    InitPacket (packet);
+    packet.idGroup     = GroupID;
+    packet.idDownEvent = DownEventID;
+    packet.dwDownValue = DownValue;
+    packet.idUpEvent   = UpEventID;
+    packet.dwUpValue   = UpValue;
+    packet.bMaskable   = bMaskable;
+    CopyString (packet.szInputDefinition, szInputDefinition);
+    return Send (state, WIRE_ID_MAP_INPUT_EVENT_TO_CLIENT_EVENT, packet, sizeof (packet));
+}
+
+SIMCONNECTAPI SimConnect_SetInputGroupState (HANDLE                    hSimConnect,
+                                             SIMCONNECT_INPUT_GROUP_ID GroupID,
+                                             DWORD                     dwState)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    if (!state.bRemote) return S_OK;
+
+    WireSetInputGroupState packet;
+    InitPacket (packet);
+    packet.idGroup = GroupID;
+    packet.dwState = dwState;
+    return Send (state, WIRE_ID_SET_INPUT_GROUP_STATE, packet, sizeof (packet));
+}
+
+SIMCONNECTAPI SimConnect_SubscribeToSystemEvent (HANDLE                     hSimConnect,
+                                                 SIMCONNECT_CLIENT_EVENT_ID EventID,
+                                                 const char*                SystemEventName)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    if (!state.bRemote) return S_OK;
+
+    WireSubscribeToSystemEvent packet;
+    InitPacket (packet);
+    packet.idEvent = EventID;
+    CopyString (packet.szSystemEventName, SystemEventName);
+    return Send (state, WIRE_ID_SUBSCRIBE_TO_SYSTEM_EVENT, packet, sizeof (packet));
+}
+
+SIMCONNECTAPI SimConnect_AddToDataDefinition (HANDLE                        hSimConnect,
+                                              SIMCONNECT_DATA_DEFINITION_ID DefineID,
+                                              const char*                   DatumName,
+                                              const char*                   UnitsName,
+                                              SIMCONNECT_DATATYPE           DatumType,
+                                              float                         fEpsilon,
+                                              DWORD                         DatumID)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    if (DefineID >= state.definitions.size ()) state.definitions.resize (DefineID + 1);
+    state.definitions[DefineID]++;
+    if (!state.bRemote) return S_OK;
+
+    WireAddToDataDefinition packet;
+    InitPacket (packet);
+    packet.idDefine    = DefineID;
+    packet.dwDatumType = DatumType;
+    packet.fEpsilon    = fEpsilon;
+    packet.idDatum     = DatumID;
+    CopyString (packet.szDatumName, DatumName);
+    CopyString (packet.szUnitsName, UnitsName);
+    return Send (state, WIRE_ID_ADD_TO_DATA_DEFINITION, packet, sizeof (packet));
+}
+
+SIMCONNECTAPI SimConnect_ClearDataDefinition (HANDLE                        hSimConnect,
+                                              SIMCONNECT_DATA_DEFINITION_ID DefineID)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    if (DefineID < state.definitions.size ()) state.definitions[DefineID] = 0;
+    if (!state.bRemote) return S_OK;
+
+    WireClearDataDefinition packet;
+    InitPacket (packet);
+    packet.idDefine = DefineID;
+    return Send (state, WIRE_ID_CLEAR_DATA_DEFINITION, packet, sizeof (packet));
+}
+
+SIMCONNECTAPI SimConnect_RequestDataOnSimObject (HANDLE                        hSimConnect,
+                                                 SIMCONNECT_DATA_REQUEST_ID    RequestID,
+                                                 SIMCONNECT_DATA_DEFINITION_ID DefineID,
+                                                 SIMCONNECT_OBJECT_ID          ObjectID,
+                                                 SIMCONNECT_PERIOD             Period,
+                                                 SIMCONNECT_DATA_REQUEST_FLAG  Flags,
+                                                 DWORD                         origin,
+                                                 DWORD                         interval,
+                                                 DWORD                         limit)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    // A request ID has one live request at a time; a new one replaces it, and PERIOD_NEVER just ends it
+    State& state = *(State*)hSimConnect;
+    for (size_t i = 0; i < state.requests.size (); i++)
+    {
+        if (state.requests[i].idRequest == RequestID)
+        {
+            state.requests.erase (state.requests.begin () + i);
+            break;
+        }
+    }
+
+    if (Period != SIMCONNECT_PERIOD_NEVER)
+    {
+        CSimConnectStandIn::Request request;
+        request.idRequest = RequestID;
+        request.idDefine  = DefineID;
+        request.idObject  = ObjectID;
+        request.period    = Period;
+        state.requests.push_back (request);
+    }
+    if (!state.bRemote) return S_OK;
+
+    WireRequestDataOnSimObject packet;
+    InitPacket (packet);
+    packet.idRequest  = RequestID;
+    packet.idDefine   = DefineID;
+    packet.idObject   = ObjectID;
+    packet.dwPeriod   = Period;
+    packet.dwFlags    = Flags;
+    packet.dwOrigin   = origin;
+    packet.dwInterval = interval;
+    packet.dwLimit    = limit;
+    return Send (state, WIRE_ID_REQUEST_DATA_ON_SIM_OBJECT, packet, sizeof (packet));
+}
+
+SIMCONNECTAPI SimConnect_RequestDataOnSimObjectType (HANDLE                        hSimConnect,
+                                                     SIMCONNECT_DATA_REQUEST_ID    RequestID,
+                                                     SIMCONNECT_DATA_DEFINITION_ID DefineID,
+                                                     DWORD                         dwRadiusMeters,
+                                                     SIMCONNECT_SIMOBJECT_TYPE     type)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    if (!state.bRemote) return S_OK;
+
+    WireRequestDataOnSimObjectType packet;
+    InitPacket (packet);
+    packet.idRequest      = RequestID;
+    packet.idDefine       = DefineID;
+    packet.dwRadiusMeters = dwRadiusMeters;
+    packet.dwType         = type;
+    return Send (state, WIRE_ID_REQUEST_DATA_ON_SIM_OBJECT_TYPE, packet, sizeof (packet));
+}
+
+SIMCONNECTAPI SimConnect_SetDataOnSimObject (HANDLE                        hSimConnect,
+                                             SIMCONNECT_DATA_DEFINITION_ID DefineID,
+                                             SIMCONNECT_OBJECT_ID          ObjectID,
+                                             SIMCONNECT_DATA_SET_FLAG      Flags,
+                                             DWORD                         ArrayCount,
+                                             DWORD                         cbUnitSize,
+                                             void*                         pDataSet)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    if (!state.bRemote) return S_OK;
+
+    DWORD cbData = (ArrayCount > 0 ? ArrayCount : 1) * cbUnitSize;
+    if (sizeof (WireSetDataOnSimObject) + cbData > STANDIN_WIRE_PACKET_MAX) return E_FAIL;
+
+    state.packet.resize (sizeof (WireSetDataOnSimObject) + cbData);
+
+    WireSetDataOnSimObject* pPacket = (WireSetDataOnSimObject*)&state.packet[0];
+    InitPacket (*pPacket);
+    pPacket->idDefine     = DefineID;
+    pPacket->idObject     = ObjectID;
+    pPacket->dwFlags      = Flags;
+    pPacket->dwArrayCount = ArrayCount;
+    pPacket->cbUnitSize   = cbUnitSize;
+    memcpy (pPacket + 1, pDataSet, cbData);
+    return Send (state, WIRE_ID_SET_DATA_ON_SIM_OBJECT, *pPacket, (DWORD)state.packet.size ());
+}
+
+SIMCONNECTAPI SimConnect_AICreateSimulatedObject (HANDLE                       hSimConnect,
+                                                  const char*                  szContainerTitle,
+                                                  SIMCONNECT_DATA_INITPOSITION InitPos,
+                                                  SIMCONNECT_DATA_REQUEST_ID   RequestID)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    if (!state.bRemote) return S_OK;
+
+    WireAICreateSimulatedObject packet;
+    InitPacket (packet);
+    packet.initPos   = InitPos;
+    packet.idRequest = RequestID;
+    CopyString (packet.szContainerTitle, szContainerTitle);
+    return Send (state, WIRE_ID_AI_CREATE_SIMULATED_OBJECT, packet, sizeof (packet));
+}
+
+SIMCONNECTAPI SimConnect_RequestFacilitiesList (HANDLE                        hSimConnect,
+                                                SIMCONNECT_FACILITY_LIST_TYPE type,
+                                                SIMCONNECT_DATA_REQUEST_ID    RequestID)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state   = *(State*)hSimConnect;
+    DWORD  cbEntry = FacilitySize (type);
+
+    if (cbEntry == 0)
+    {
+        PostException (state, SIMCONNECT_EXCEPTION_INVALID_ENUM, 1);
+        return S_OK;
+    }
+
+    SendFacilities (state, type, RequestID);
+    return S_OK;
+}
+
+SIMCONNECTAPI SimConnect_WeatherRequestInterpolatedObservation (HANDLE                     hSimConnect,
+                                                               SIMCONNECT_DATA_REQUEST_ID RequestID,
+                                                               float                      lat,
+                                                               float                      lon,
+                                                               float                      alt)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State&       state       = *(State*)hSimConnect;
+    Connections& connections = GetConnections ();
+
+    if (connections.pfnMetar == NULL)
+    {
+        PostException (state, SIMCONNECT_EXCEPTION_WEATHER_UNABLE_TO_GET_OBSERVATION, 1);
+        return S_OK;
+    }
+
+    char szMetar[MAX_METAR_LENGTH];
+    szMetar[0] = '\0';
+    connections.pfnMetar (lat, lon, alt, szMetar, MAX_METAR_LENGTH, connections.pMetarContext);
+    szMetar[MAX_METAR_LENGTH - 1] = '\0';
+
+    // The METAR and its terminator in place of szMetar, the single char at the end of the packed message
+    std::vector<BYTE>& message = connections.message;
+    size_t             ibMetar = sizeof (SIMCONNECT_RECV_WEATHER_OBSERVATION) - sizeof (char);
+
+    message.assign (ibMetar + strlen (szMetar) + 1, 0);
+
+    SIMCONNECT_RECV_WEATHER_OBSERVATION* pObservation = (SIMCONNECT_RECV_WEATHER_OBSERVATION*)message.data ();
+    pObservation->dwSize      = (DWORD)message.size ();
+    pObservation->dwVersion   = STANDIN_RECV_VERSION;
+    pObservation->dwID        = SIMCONNECT_RECV_ID_WEATHER_OBSERVATION;
+    pObservation->dwRequestID = RequestID;
+    memcpy (pObservation->szMetar, szMetar, strlen (szMetar) + 1);
+    Enqueue (state, pObservation);
+    return S_OK;
+}
+
+#ifdef SIM_MSFS2020
+SIMCONNECTAPI SimConnect_SubscribeToFacilities_EX1 (HANDLE                        hSimConnect,
+                                                    SIMCONNECT_FACILITY_LIST_TYPE type,
+                                                    SIMCONNECT_DATA_REQUEST_ID    newElemInRangeRequestID,
+                                                    SIMCONNECT_DATA_REQUEST_ID    oldElemOutRangeRequestID)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+
+    if (FacilitySize (type) == 0)
+    {
+        PostException (state, SIMCONNECT_EXCEPTION_INVALID_ENUM, 1);
+        return S_OK;
+    }
+
+    // Everything set is in range from the start; what comes and goes later is up to the client to post
+    SendFacilities (state, type, newElemInRangeRequestID);
+    return S_OK;
+}
+
+SIMCONNECTAPI SimConnect_UnsubscribeToFacilities_EX1 (HANDLE                        hSimConnect,
+                                                      SIMCONNECT_FACILITY_LIST_TYPE type,
+                                                      bool                          bUnsubscribeNewInRange,
+                                                      bool                          bUnsubscribeOldOutRange)
+{
+    return Call (hSimConnect);
+}
+
+SIMCONNECTAPI SimConnect_AddToFacilityDefinition (HANDLE                        hSimConnect,
+                                                  SIMCONNECT_DATA_DEFINITION_ID DefineID,
+                                                  const char*                   FieldName)
+{
+    return Call (hSimConnect);
+}
+
+SIMCONNECTAPI SimConnect_RequestFacilityData_EX1 (HANDLE                        hSimConnect,
+                                                  SIMCONNECT_DATA_DEFINITION_ID DefineID,
+                                                  SIMCONNECT_DATA_REQUEST_ID    RequestID,
+                                                  const char*                   ICAO,
+                                                  const char*                   Region,
+                                                  char                          Type)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State&                                                   state       = *(State*)hSimConnect;
+    std::map<std::string, std::vector<BYTE>>::const_iterator itMessages = GetConnections ().facilityData.find (ICAO);
+
+    if (itMessages != GetConnections ().facilityData.end ())
+    {
+        std::vector<BYTE> messages = itMessages->second;
+
+        for (size_t ib = 0; ib + sizeof (SIMCONNECT_RECV_FACILITY_DATA) <= messages.size (); )
+        {
+            SIMCONNECT_RECV_FACILITY_DATA* pData = (SIMCONNECT_RECV_FACILITY_DATA*)&messages[ib];
+            if (pData->dwSize < sizeof (SIMCONNECT_RECV) || pData->dwSize > messages.size () - ib) break;
+
+            pData->dwVersion     = STANDIN_RECV_VERSION;
+            pData->dwID          = SIMCONNECT_RECV_ID_FACILITY_DATA;
+            pData->UserRequestId = RequestID;
+            Enqueue (state, pData);
+            ib += pData->dwSize;
+        }
+    }
+
+    SIMCONNECT_RECV_FACILITY_DATA_END end;
+    memset (&end, 0, sizeof (end));
+    end.dwSize    = sizeof (end);
+    end.dwVersion = STANDIN_RECV_VERSION;
+    end.dwID      = SIMCONNECT_RECV_ID_FACILITY_DATA_END;
+    end.RequestId = RequestID;
+    Enqueue (state, &end);
+    return S_OK;
+}
+
+SIMCONNECTAPI SimConnect_RequestFacilityData (HANDLE                        hSimConnect,
+                                              SIMCONNECT_DATA_DEFINITION_ID DefineID,
+                                              SIMCONNECT_DATA_REQUEST_ID    RequestID,
+                                              const char*                   ICAO,
+                                              const char*                   Region)
+{
+    return SimConnect_RequestFacilityData_EX1 (hSimConnect, DefineID, RequestID, ICAO, Region, 0);
+}
+#endif
+
+SIMCONNECTAPI SimConnect_MapClientDataNameToID (HANDLE                    hSimConnect,
+                                                const char*               szClientDataName,
+                                                SIMCONNECT_CLIENT_DATA_ID ClientDataID)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State&       state       = *(State*)hSimConnect;
+    Connections& connections = GetConnections ();
+    DWORD        iArea       = 0;
+
+    while (iArea < connections.areas.size () && connections.areas[iArea].strName != szClientDataName) iArea++;
+    if (iArea == connections.areas.size ())
+    {
+        ClientDataArea area;
+        area.strName   = szClientDataName;
+        area.pCreator  = NULL;
+        area.bReadOnly = false;
+        connections.areas.push_back (area);
+    }
+
+    if (ClientDataID >= state.clientAreas.size ()) state.clientAreas.resize (ClientDataID + 1, 0);
+    if (state.clientAreas[ClientDataID] != 0 && state.clientAreas[ClientDataID] != iArea + 1)
+    {
+        PostException (state, SIMCONNECT_EXCEPTION_ALREADY_CREATED, 2);
+        return S_OK;
+    }
+    state.clientAreas[ClientDataID] = iArea + 1;
+    return S_OK;
+}
+
+SIMCONNECTAPI SimConnect_CreateClientData (HANDLE                             hSimConnect,
+                                           SIMCONNECT_CLIENT_DATA_ID          ClientDataID,
+                                           DWORD                              dwSize,
+                                           SIMCONNECT_CREATE_CLIENT_DATA_FLAG Flags)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State&          state = *(State*)hSimConnect;
+    ClientDataArea* pArea = FindArea (state, ClientDataID);
+
+    if (pArea == NULL)
+    {
+        PostException (state, SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID, 1);
+    }
+    else if (dwSize == 0 || dwSize > SIMCONNECT_CLIENTDATA_MAX_SIZE)
+    {
+        PostException (state, SIMCONNECT_EXCEPTION_OUT_OF_BOUNDS, 2);
+    }
+    else if (!pArea->data.empty ())
+    {
+        PostException (state, SIMCONNECT_EXCEPTION_ALREADY_CREATED, 1);
+    }
+    else
+    {
+        pArea->data.assign (dwSize, 0);
+        pArea->pCreator  = &state;
+        pArea->bReadOnly = (Flags & SIMCONNECT_CREATE_CLIENT_DATA_FLAG_READ_ONLY) != 0;
+    }
+    return S_OK;
+}
+
+SIMCONNECTAPI SimConnect_AddToClientDataDefinition (HANDLE                               hSimConnect,
+                                                    SIMCONNECT_CLIENT_DATA_DEFINITION_ID DefineID,
+                                                    DWORD                                dwOffset,
+                                                    DWORD                                dwSizeOrType,
+                                                    float                                fEpsilon,
+                                                    DWORD                                DatumID)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    if (DefineID >= state.clientDefinitions.size ()) state.clientDefinitions.resize (DefineID + 1);
+
+    std::vector<ClientDatum>& definition = state.clientDefinitions[DefineID];
+    ClientDatum               datum;
+
+    datum.cbSize   = ClientDatumSize (dwSizeOrType);
+    datum.dwOffset = dwOffset;
+    if (dwOffset == SIMCONNECT_CLIENTDATAOFFSET_AUTO)
+    {
+        datum.dwOffset = definition.empty () ? 0 : definition.back ().dwOffset + definition.back ().cbSize;
+    }
+    definition.push_back (datum);
+    return S_OK;
+}
+
+SIMCONNECTAPI SimConnect_ClearClientDataDefinition (HANDLE                               hSimConnect,
+                                                    SIMCONNECT_CLIENT_DATA_DEFINITION_ID DefineID)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    if (DefineID < state.clientDefinitions.size ()) state.clientDefinitions[DefineID].clear ();
+    return S_OK;
+}
+
+SIMCONNECTAPI SimConnect_RequestClientData (HANDLE                               hSimConnect,
+                                            SIMCONNECT_CLIENT_DATA_ID            ClientDataID,
+                                            SIMCONNECT_DATA_REQUEST_ID           RequestID,
+                                            SIMCONNECT_CLIENT_DATA_DEFINITION_ID DefineID,
+                                            SIMCONNECT_CLIENT_DATA_PERIOD        Period,
+                                            SIMCONNECT_CLIENT_DATA_REQUEST_FLAG  Flags,
+                                            DWORD                                origin,
+                                            DWORD                                interval,
+                                            DWORD                                limit)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State& state = *(State*)hSimConnect;
+    for (size_t i = 0; i < state.clientRequests.size (); i++)
+    {
+        if (state.clientRequests[i].idRequest == RequestID)
+        {
+            state.clientRequests.erase (state.clientRequests.begin () + i);
+            break;
+        }
+    }
+    if (Period == SIMCONNECT_CLIENT_DATA_PERIOD_NEVER) return S_OK;
+
+    ClientDataArea* pArea = FindArea (state, ClientDataID);
+    if (pArea == NULL || pArea->data.empty ())
+    {
+        PostException (state, SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID, 1);
+        return S_OK;
+    }
+
+    ClientDataRequest request;
+    request.idRequest    = RequestID;
+    request.idClientData = ClientDataID;
+    request.idDefine     = DefineID;
+    request.dwFlags      = Flags;
+    request.bOnSet       = Period != SIMCONNECT_CLIENT_DATA_PERIOD_ONCE;
+
+    SendClientData (state, request, *pArea);
+    if (request.bOnSet) state.clientRequests.push_back (request);
+    return S_OK;
+}
+
+SIMCONNECTAPI SimConnect_SetClientData (HANDLE                               hSimConnect,
+                                        SIMCONNECT_CLIENT_DATA_ID            ClientDataID,
+                                        SIMCONNECT_CLIENT_DATA_DEFINITION_ID DefineID,
+                                        SIMCONNECT_CLIENT_DATA_SET_FLAG      Flags,
+                                        DWORD                                dwReserved,
+                                        DWORD                                cbUnitSize,
+                                        void*                                pDataSet)
+{
+    HRESULT hr = Call (hSimConnect);
+    if (FAILED (hr)) return hr;
+
+    State&                          state      = *(State*)hSimConnect;
+    ClientDataArea*                 pArea      = FindArea (state, ClientDataID);
+    const std::vector<ClientDatum>& definition = FindClientDefinition (state, DefineID);
+    DWORD                           cbData;
+
+    if (pArea == NULL || pArea->data.empty ())
+    {
+        PostException (state, SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID, 1);
+        return S_OK;
+    }
+    if (pArea->bReadOnly && pArea->pCreator != &state)
+    {
+        PostException (state, SIMCONNECT_EXCEPTION_ERROR, 1);
+        return S_OK;
+    }
+    if (!FitsArea (definition, *pArea, cbData))
+    {
+        PostException (state, SIMCONNECT_EXCEPTION_DATA_ERROR, 2);
+        return S_OK;
+    }
+    if (cbUnitSize != cbData)
+    {
+        PostException (state, SIMCONNECT_EXCEPTION_SIZE_MISMATCH, 5);
+        return S_OK;
+    }
+
+    // The fields come one after the other; a field written with what it already held is not a change
+    const BYTE* pField  = (const BYTE*)pDataSet;
+    DWORD       ibFirst = (DWORD)pArea->data.size ();
+    DWORD       ibEnd   = 0;
+
+    for (size_t i = 0; i < definition.size (); i++)
+    {
+        BYTE* pTo = &pArea->data[definition[i].dwOffset];
+        if (memcmp (pTo, pField, definition[i].cbSize) != 0)
+        {
+            memcpy (pTo, pField, definition[i].cbSize);
+            ibFirst = std::min (ibFirst, definition[i].dwOffset);
+            ibEnd   = std::max (ibEnd, definition[i].dwOffset + definition[i].cbSize);
+        }
+        pField += definition[i].cbSize;
+    }
+
+    // Every connection's requests on the area, including this one's, get what it holds now. Those with the CHANGED
+    //  flag only if their fields overlap the bytes that changed, which is close enough for the stand-in.
+    Connections& connections = GetConnections ();
+    for (size_t iState = 0; iState < connections.states.size (); iState++)
+    {
+        State& other = *connections.states[iState];
+        if (!other.bOpen) continue;
+
+        for (size_t i = 0; i < other.clientRequests.size (); i++)
+        {
+            const ClientDataRequest& request = other.clientRequests[i];
+            if (FindArea (other, request.idClientData) != pArea) continue;
+
+            if (request.dwFlags & SIMCONNECT_CLIENT_DATA_REQUEST_FLAG_CHANGED)
+            {
+                const std::vector<ClientDatum>& fields   = FindClientDefinition (other, request.idDefine);
+                bool                            bChanged = false;
+
+                for (size_t j = 0; j < fields.size () && !bChanged; j++)
+                {
+                    bChanged = fields[j].dwOffset < ibEnd && fields[j].dwOffset + fields[j].cbSize > ibFirst;
+                }
+                if (!bChanged) continue;
+            }
+            SendClientData (other, request, *pArea);
+        }
+    }
+    return S_OK;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <Windows.h>
+#include <SimConnect.h>
+
+
+/**
+ * In-process stand-in for the SimConnect client library, for running code written against SimConnect without a
+ *  sim, e.g. benchmarks on Linux. Link SimConnectStandIn.cpp instead of SimConnect.lib.
+ *
+ * Calls that would go to the sim only record what the sim needs to know to answer them (data definitions and
+ *  requests). Messages posted with Post are delivered by the next SimConnect_CallDispatch as if the sim had sent
+ *  them, in order, and set the event handle passed to SimConnect_Open.
+ *
+ * Every SimConnect_Open makes a connection of its own, as if to a sim of its own. The methods that take no handle are
+ *  about the connection opened last. None of this is thread safe.
+ *
+ * A ConfigIndex can be pointed at a CStandInServer with SetServer; connections opened with it then send every call
+ *  to the server as a packet, and SimConnect_CallDispatch delivers what the server has sent back so far, after the
+ *  posted messages. The event handle is set when the server has sent something, as it is for posted messages, so a
+ *  client waiting on it, e.g. CConnectionMux, is woken for remote connections as for local ones.
+ *
+ * Client data areas are kept by the stand-in itself and shared by all of its connections, remote ones included, as
+ *  the sim shares them between add-ons. Requests for client data other than once are answered on every
+ *  SimConnect_SetClientData to the area, there being no frames; tagged data is not supported.
+ *
+ * Facility lists set with SetFacilities are likewise the stand-in's own, and every connection, remote ones included,
+ *  is sent them in pages, as the sim sends its lists. With MSFS, a subscription to the facilities in range gets them
+ *  all as coming into range; what comes and goes after that is for the client to Post. Requests for the data of a
+ *  facility are answered with the messages set for its ICAO code with SetFacilityData, whatever the definition.
+ *  Weather is whatever SetWeather says.
+ */
+class CSimConnectStandIn
+{
+public:
+    /**
+     * Writes the METAR the sim would observe at a position, at most cchMetar characters with the terminator.
+     */
+    typedef void (CALLBACK* MetarProc) (float fLat,
+                                        float fLon,
+                                        float fAlt,
+                                        char* szMetar,
+                                        DWORD cchMetar,
+                                        void* pContext);
+
+    typedef struct Request
+    {
+        DWORD             idRequest;
+        DWORD             idDefine;
+        DWORD             idObject;
+        SIMCONNECT_PERIOD period;
+    }
+    Request;
+
+    /**
+     * Queue a copy of a message; pData->dwSize bytes are copied.
+     */
+    static void Post (const SIMCONNECT_RECV* pData);
+
+    /**
+     * Queue a copy of a message on a given connection.
+     */
+    static void Post (HANDLE                 hSimConnect,
+                      const SIMCONNECT_RECV* pData);
+
+    /**
+     * Drop the queued messages.
+     */
+    static void Clear ();
+
+    /**
+     * With repeat on, SimConnect_CallDispatch delivers the queued messages without consuming them, so the same
+     *  messages can be replayed over and over.
+     */
+    static void SetRepeat (bool bRepeat);
+
+    /**
+     * The live periodic or one-shot data request on an object, or NULL if there is none. Only request IDs from
+     *  idRequestFirst on are considered, to tell apart requests made by different parts of the client.
+     */
+    static const Request* FindRequest (DWORD             idObject,
+                                       SIMCONNECT_PERIOD period,
+                                       DWORD             idRequestFirst = 0);
+
+    /**
+     * Number of fields in a data definition.
+     */
+    static DWORD DefinitionSize (DWORD idDefine);
+
+    /**
+     * Number of SimConnect calls made so far, which would each have been a message to the sim.
+     */
+    static DWORD CallCount ();
+
+    /**
+     * Connections opened with dwConfigIndex go to the server at szAddress (numeric IPv4) and wPort from now on, or to
+     *  the stand-in itself again for wPort 0, like the entries of SimConnect.cfg.
+     */
+    static void SetServer (DWORD       dwConfigIndex,
+                           const char* szAddress,
+                           WORD        wPort);
+
+    /**
+     * The facilities SimConnect_RequestFacilitiesList lists for a type from now on; pEntries points to cEntries
+     *  SIMCONNECT_DATA_FACILITY_AIRPORT, _WAYPOINT, _NDB or _VOR as the type has, which are copied.
+     */
+    static void SetFacilities (SIMCONNECT_FACILITY_LIST_TYPE eType,
+                               const void*                   pEntries,
+                               DWORD                         cEntries);
+
+    /**
+     * The FACILITY_DATA messages, back to back, that answer requests for the data of a facility from now on; their
+     *  request IDs are filled in, and FACILITY_DATA_END follows them. A facility without any gets only the end.
+     */
+    static void SetFacilityData (const char* szIcao,
+                                 const void* pMessages,
+                                 DWORD       cbMessages);
+
+    /**
+     * The weather from now on: requests for interpolated observations are answered with the METAR pfnMetar writes
+     *  for the position, or fail with an exception for NULL, the default.
+     */
+    static void SetWeather (MetarProc pfnMetar,
+                            void*     pContext);
+};
@@ -0,0 +1,812 @@
+#include <WinSock2.h>
+#include <Ws2tcpip.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "SimConnectStandInServer.h"
+#include "SimConnectStandInWire.h"
+
+#ifdef _WIN32
+#pragma comment (lib, "Ws2_32.lib")
+#endif
+
+
+namespace
+{
+    const DWORD  OBJECT_ID_FIRST = 0x10000;     // Of the objects the server makes up or creates
+    const double NEVER           = 1e300;
+
+    double Now ()
+    {
+        return std::chrono::duration<double> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+    }
+
+    /**
+     * System event names are not case sensitive.
+     */
+    bool SameName (const char* szA,
+                   const char* szB)
+    {
+        for (; *szA != '\0' && *szB != '\0'; szA++, szB++)
+        {
+            if (tolower ((unsigned char)*szA) != tolower ((unsigned char)*szB)) return false;
+        }
+        return *szA == *szB;
+    }
+
+    DWORD DatumSize (DWORD dwType)
+    {
+        switch (dwType)
+        {
+            case SIMCONNECT_DATATYPE_INT32:         return 4;
+            case SIMCONNECT_DATATYPE_FLOAT32:       return 4;
+            case SIMCONNECT_DATATYPE_STRING32:      return 32;
+            case SIMCONNECT_DATATYPE_STRING64:      return 64;
+            case SIMCONNECT_DATATYPE_STRING128:     return 128;
+            case SIMCONNECT_DATATYPE_STRING256:     return 256;
+            case SIMCONNECT_DATATYPE_STRING260:     return 260;
+            case SIMCONNECT_DATATYPE_INITPOSITION:  return sizeof (SIMCONNECT_DATA_INITPOSITION);
+            case SIMCONNECT_DATATYPE_LATLONALT:     return sizeof (SIMCONNECT_DATA_LATLONALT);
+            case SIMCONNECT_DATATYPE_XYZ:           return sizeof (SIMCONNECT_DATA_XYZ);
+            default:                                return 8;
+        }
+    }
+
+    /**
+     * One direction of the modelled link, with the messages under way on it. A message waits for the link to be
+     *  free, takes its size over the bandwidth to go onto it, then arrives after the latency.
+     */
+    class CLink
+    {
+    public:
+        CLink () :
+            m_dLatency     (0.0),
+            m_dBytesPerSec (0.0),
+            m_dFreeAt      (0.0),
+            m_ibFront      (0)
+        {
+        }
+
+        void Configure (double dLatency,
+                        double dBytesPerSec)
+        {
+            m_dLatency     = dLatency;
+            m_dBytesPerSec = dBytesPerSec;
+        }
+
+        void Push (double      dNow,
+                   const void* pData,
+                   size_t      cbData)
+        {
+            double dStart = std::max (dNow, m_dFreeAt);
+            m_dFreeAt = m_dBytesPerSec > 0.0 ? dStart + cbData / m_dBytesPerSec : dStart;
+
+            Entry entry;
+            entry.dArrival = m_dFreeAt + m_dLatency;
+            entry.cbData   = cbData;
+            m_entries.push_back (entry);
+            m_bytes.insert (m_bytes.end (), (const BYTE*)pData, (const BYTE*)pData + cbData);
+        }
+
+        double NextArrival () const
+        {
+            return m_entries.empty () ? NEVER : m_entries.front ().dArrival;
+        }
+
+        /**
+         * The first message under way if it has arrived by dNow, else NULL. Valid until the next Push or Pop.
+         */
+        const BYTE* Arrived (double  dNow,
+                             size_t& cbData) const
+        {
+            if (m_entries.empty () || m_entries.front ().dArrival > dNow) return NULL;
+
+            cbData = m_entries.front ().cbData;
+            return &m_bytes[m_ibFront];
+        }
+
+        void Pop ()
+        {
+            m_ibFront += m_entries.front ().cbData;
+            m_entries.pop_front ();
+
+            // Drop the bytes of the messages gone, once they are most of the buffer
+            if (m_entries.empty ())
+            {
+                m_bytes.clear ();
+                m_ibFront = 0;
+            }
+            else if (m_ibFront > 65536 && m_ibFront > m_bytes.size () / 2)
+            {
+                m_bytes.erase (m_bytes.begin (), m_bytes.begin () + m_ibFront);
+                m_ibFront = 0;
+            }
+        }
+
+    private:
+        typedef struct Entry
+        {
+            double dArrival;
+            size_t cbData;
+        }
+        Entry;
+
+
+        double              m_dLatency;
+        double              m_dBytesPerSec;
+        double              m_dFreeAt;
+        std::deque<Entry>   m_entries;
+        std::vector<BYTE>   m_bytes;        // Of the messages in m_entries, back to back from m_ibFront
+        size_t              m_ibFront;
+    };
+
+    typedef struct Request
+    {
+        DWORD idRequest;
+        DWORD idDefine;
+        DWORD idObject;
+        DWORD cFramesPeriod;
+        DWORD cFramesToNext;
+        DWORD cLeft;            // Sends left; 0 for no limit
+    }
+    Request;
+
+    typedef struct Subscription
+    {
+        DWORD idEvent;
+        DWORD cFramesPeriod;    // 0 for the frame event
+    }
+    Subscription;
+
+    typedef struct Client
+    {
+        Client () :
+            sock         (INVALID_SOCKET),
+            ibSending    (0),
+            idObjectNext (OBJECT_ID_FIRST),
+            bClosed      (false)
+        {
+        }
+
+        SOCKET                          sock;
+        std::vector<BYTE>               received;       // Up to a partial packet
+        CLink                           up;             // Packets on their way to the server
+        CLink                           down;           // Messages on their way to the client
+        std::vector<BYTE>               sending;        // Arrived, for the socket to take from ibSending on
+        size_t                          ibSending;
+        std::vector<std::vector<DWORD>> definitions;    // Datum types per definition ID
+        std::vector<Request>            requests;
+        std::vector<Subscription>       subscriptions;
+        DWORD                           idObjectNext;
+        bool                            bClosed;
+    }
+    Client;
+}
+
+
+struct CStandInServer::State
+{
+    State () :
+        sockListen (INVALID_SOCKET),
+        wPort      (0),
+        bWinsock   (false),
+        bStop      (false),
+        nFrame     (0),
+        cPackets   (0),
+        cbReceived (0),
+        cWrites    (0),
+        cMessages  (0),
+        cbSent     (0)
+    {
+    }
+
+    ~State ()
+    {
+        for (size_t i = 0; i < clients.size (); i++)
+        {
+            closesocket (clients[i]->sock);
+            delete clients[i];
+        }
+        if (sockListen != INVALID_SOCKET) closesocket (sockListen);
+        if (bWinsock) WSACleanup ();
+    }
+
+    void Run ()
+    {
+        double dFrame     = 1.0 / config.dFrameRate;
+        double dNextFrame = Now () + dFrame;
+
+        while (!bStop)
+        {
+            double dNow = Now ();
+
+            if (dNow >= dNextFrame)
+            {
+                OnFrame (dNow);
+
+                // After a stall, go on from now instead of catching up frame by frame
+                dNextFrame = dNow - dNextFrame > 1.0 ? dNow + dFrame : dNextFrame + dFrame;
+            }
+
+            double dWake = dNextFrame;
+            for (size_t i = 0; i < clients.size (); i++)
+            {
+                Client& client = *clients[i];
+                Deliver (client, dNow);
+                dWake = std::min (dWake, std::min (client.up.NextArrival (), client.down.NextArrival ()));
+            }
+
+            for (size_t i = clients.size (); i-- > 0; )
+            {
+                if (!clients[i]->bClosed) continue;
+
+                closesocket (clients[i]->sock);
+                delete clients[i];
+                clients.erase (clients.begin () + i);
+            }
+
+            Wait (dWake);
+        }
+    }
+
+    /**
+     * Handle the packets that have reached the server, and hand the messages that have reached the client to its
+     *  socket.
+     */
+    void Deliver (Client& client,
+                  double  dNow)
+    {
+        const BYTE* pData;
+        size_t      cbData;
+
+        while ((pData = client.up.Arrived (dNow, cbData)) != NULL)
+        {
+            OnPacket (client, pData, cbData, dNow);
+            client.up.Pop ();
+        }
+
+        while ((pData = client.down.Arrived (dNow, cbData)) != NULL)
+        {
+            client.sending.insert (client.sending.end (), pData, pData + cbData);
+            client.down.Pop ();
+        }
+
+        while (client.ibSending < client.sending.size ())
+        {
+            int cb = send (client.sock, (const char*)&client.sending[client.ibSending],
+                           (int)(client.sending.size () - client.ibSending), MSG_NOSIGNAL);
+            if (cb > 0)
+            {
+                client.ibSending += cb;
+                cbSent           += cb;
+            }
+            else
+            {
+                client.bClosed = cb == 0 || WSAGetLastError () != WSAEWOULDBLOCK;
+                break;
+            }
+        }
+
+        if (client.ibSending == client.sending.size ())
+        {
+            client.sending.clear ();
+            client.ibSending = 0;
+        }
+    }
+
+    /**
+     * Wait until dWake for a client to connect or send something, or for a socket to take more, but no longer than
+     *  a few milliseconds so that Stop is seen.
+     */
+    void Wait (double dWake)
+    {
+        fd_set read;
+        fd_set write;
+        SOCKET sockMax = sockListen;
+
+        FD_ZERO (&read);
+        FD_ZERO (&write);
+        FD_SET (sockListen, &read);
+
+        for (size_t i = 0; i < clients.size (); i++)
+        {
+            FD_SET (clients[i]->sock, &read);
+            if (clients[i]->ibSending < clients[i]->sending.size ()) FD_SET (clients[i]->sock, &write);
+            sockMax = std::max (sockMax, clients[i]->sock);
+        }
+
+        double  dWait = std::min (std::max (dWake - Now (), 0.0), 0.01);
+        timeval tv;
+        tv.tv_sec  = 0;
+        tv.tv_usec = (long)(dWait * 1e6);
+
+        if (select ((int)sockMax + 1, &read, &write, NULL, &tv) <= 0) return;
+
+        if (FD_ISSET (sockListen, &read)) Accept ();
+
+        double dNow = Now ();
+        for (size_t i = 0; i < clients.size (); i++)
+        {
+            if (FD_ISSET (clients[i]->sock, &read)) Receive (*clients[i], dNow);
+        }
+    }
+
+    void Accept ()
+    {
+        SOCKET sock = accept (sockListen, NULL, NULL);
+        if (sock == INVALID_SOCKET) return;
+
+        int    nNoDelay      = 1;
+        u_long ulNonBlocking = 1;
+        setsockopt (sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&nNoDelay, sizeof (nNoDelay));
+        ioctlsocket (sock, FIONBIO, &ulNonBlocking);
+
+        Client* pClient = new Client ();
+        pClient->sock = sock;
+        pClient->up.Configure (config.dLatencyMs / 1000.0, config.dBytesPerSec);
+        pClient->down.Configure (config.dLatencyMs / 1000.0, config.dBytesPerSec);
+        clients.push_back (pClient);
+    }
+
+    /**
+     * Read what the client has sent and put its whole packets on the link to the server.
+     */
+    void Receive (Client& client,
+                  double  dNow)
+    {
+        char buffer[65536];
+
+        for (;;)
+        {
+            int cb = recv (client.sock, buffer, sizeof (buffer), 0);
+            if (cb > 0)
+            {
+                client.received.insert (client.received.end (), buffer, buffer + cb);
+                cbReceived += cb;
+            }
+            else
+            {
+                client.bClosed = cb == 0 || WSAGetLastError () != WSAEWOULDBLOCK;
+                break;
+            }
+        }
+
+        size_t ib = 0;
+        while (client.received.size () - ib >= sizeof (WirePacket))
+        {
+            WirePacket header;
+            memcpy (&header, &client.received[ib], sizeof (header));
+            if (header.dwSize < sizeof (WirePacket) || header.dwSize > STANDIN_WIRE_PACKET_MAX)
+            {
+                client.bClosed = true;
+                break;
+            }
+            if (client.received.size () - ib < header.dwSize) break;
+
+            client.up.Push (dNow, &client.received[ib], header.dwSize);
+            ib += header.dwSize;
+        }
+        client.received.erase (client.received.begin (), client.received.begin () + ib);
+    }
+
+    void OnPacket (Client&     client,
+                   const BYTE* pData,
+                   size_t      cbData,
+                   double      dNow)
+    {
+        const WirePacket* pPacket = (const WirePacket*)pData;
+        cPackets++;
+
+        if (pPacket->dwVersion != STANDIN_WIRE_VERSION)
+        {
+            SendException (client, SIMCONNECT_EXCEPTION_VERSION_MISMATCH, pPacket->dwSendID, (DWORD)-1, dNow);
+            return;
+        }
+
+        switch (pPacket->dwID)
+        {
+            case WIRE_ID_OPEN:
+                if (cbData >= sizeof (WireOpen)) SendOpen (client, dNow);
+                break;
+
+            case WIRE_ID_SUBSCRIBE_TO_SYSTEM_EVENT:
+                if (cbData >= sizeof (WireSubscribeToSystemEvent)) Subscribe (client, *(const WireSubscribeToSystemEvent*)pPacket);
+                break;
+
+            case WIRE_ID_ADD_TO_DATA_DEFINITION:
+                if (cbData >= sizeof (WireAddToDataDefinition))
+                {
+                    const WireAddToDataDefinition* pAdd = (const WireAddToDataDefinition*)pPacket;
+                    if (pAdd->idDefine >= client.definitions.size ()) client.definitions.resize (pAdd->idDefine + 1);
+                    client.definitions[pAdd->idDefine].push_back (pAdd->dwDatumType);
+                }
+                break;
+
+            case WIRE_ID_CLEAR_DATA_DEFINITION:
+                if (cbData >= sizeof (WireClearDataDefinition))
+                {
+                    const WireClearDataDefinition* pClear = (const WireClearDataDefinition*)pPacket;
+                    if (pClear->idDefine < client.definitions.size ()) client.definitions[pClear->idDefine].clear ();
+                }
+                break;
+
+            case WIRE_ID_REQUEST_DATA_ON_SIM_OBJECT:
+                if (cbData >= sizeof (WireRequestDataOnSimObject)) RequestData (client, *(const WireRequestDataOnSimObject*)pPacket, dNow);
+                break;
+
+            case WIRE_ID_REQUEST_DATA_ON_SIM_OBJECT_TYPE:
+                if (cbData >= sizeof (WireRequestDataOnSimObjectType))
+                {
+                    const WireRequestDataOnSimObjectType* pRequest = (const WireRequestDataOnSimObjectType*)pPacket;
+                    if (!HasDefinition (client, pRequest->idDefine))
+                    {
+                        SendException (client, SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID, pPacket->dwSendID, 2, dNow);
+                        break;
+                    }
+                    for (DWORD i = 0; i < config.cObjects; i++)
+                    {
+                        SendData (client, SIMCONNECT_RECV_ID_SIMOBJECT_DATA_BYTYPE, pRequest->idRequest, pRequest->idDefine,
+                                  OBJECT_ID_FIRST + i, i + 1, config.cObjects, dNow);
+                    }
+                }
+                break;
+
+            case WIRE_ID_SET_DATA_ON_SIM_OBJECT:
+                cWrites++;
+                break;
+
+            case WIRE_ID_AI_CREATE_SIMULATED_OBJECT:
+                if (cbData >= sizeof (WireAICreateSimulatedObject))
+                {
+                    SIMCONNECT_RECV_ASSIGNED_OBJECT_ID assigned;
+                    InitRecv (assigned, SIMCONNECT_RECV_ID_ASSIGNED_OBJECT_ID);
+                    assigned.dwRequestID = ((const WireAICreateSimulatedObject*)pPacket)->idRequest;
+                    assigned.dwObjectID  = client.idObjectNext++;
+                    Push (client, &assigned, sizeof (assigned), dNow);
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void Subscribe (Client&                           client,
+                    const WireSubscribeToSystemEvent& packet)
+    {
+        DWORD cFramesPerSec = std::max (1, (int)(config.dFrameRate + 0.5));
+        DWORD cFramesPeriod;
+
+        if (SameName (packet.szSystemEventName, "Frame"))
+        {
+            cFramesPeriod = 0;
+        }
+        else if (SameName (packet.szSystemEventName, "6Hz"))
+        {
+            cFramesPeriod = std::max (1, (int)(config.dFrameRate / 6.0 + 0.5));
+        }
+        else if (SameName (packet.szSystemEventName, "1sec"))
+        {
+            cFramesPeriod = cFramesPerSec;
+        }
+        else if (SameName (packet.szSystemEventName, "4sec"))
+        {
+            cFramesPeriod = 4 * cFramesPerSec;
+        }
+        else
+        {
+            return;
+        }
+
+        Subscription subscription;
+        subscription.idEvent       = packet.idEvent;
+        subscription.cFramesPeriod = cFramesPeriod;
+        client.subscriptions.push_back (subscription);
+    }
+
+    void RequestData (Client&                           client,
+                      const WireRequestDataOnSimObject& packet,
+                      double                            dNow)
+    {
+        // A request ID has one live request at a time; a new one replaces it, and PERIOD_NEVER just ends it
+        for (size_t i = 0; i < client.requests.size (); i++)
+        {
+            if (client.requests[i].idRequest == packet.idRequest)
+            {
+                client.requests.erase (client.requests.begin () + i);
+                break;
+            }
+        }
+        if (packet.dwPeriod == SIMCONNECT_PERIOD_NEVER) return;
+
+        if (!HasDefinition (client, packet.idDefine))
+        {
+            SendException (client, SIMCONNECT_EXCEPTION_UNRECOGNIZED_ID, packet.dwSendID, 2, dNow);
+            return;
+        }
+
+        DWORD cFramesPeriod;
+        switch (packet.dwPeriod)
+        {
+            case SIMCONNECT_PERIOD_ONCE:
+                SendData (client, SIMCONNECT_RECV_ID_SIMOBJECT_DATA, packet.idRequest, packet.idDefine, packet.idObject, 1, 1, dNow);
+                return;
+
+            case SIMCONNECT_PERIOD_SECOND:
+                cFramesPeriod = std::max (1, (int)(config.dFrameRate + 0.5));
+                break;
+
+            default:
+                cFramesPeriod = 1;
+                break;
+        }
+
+        // Every interval + 1 periods, from origin periods on
+        Request request;
+        request.idRequest     = packet.idRequest;
+        request.idDefine      = packet.idDefine;
+        request.idObject      = packet.idObject;
+        request.cFramesPeriod = cFramesPeriod * (packet.dwInterval + 1);
+        request.cFramesToNext = 1 + cFramesPeriod * packet.dwOrigin;
+        request.cLeft         = packet.dwLimit;
+        client.requests.push_back (request);
+    }
+
+    void OnFrame (double dNow)
+    {
+        nFrame++;
+
+        for (size_t iClient = 0; iClient < clients.size (); iClient++)
+        {
+            Client& client = *clients[iClient];
+
+            for (size_t i = 0; i < client.subscriptions.size (); i++)
+            {
+                const Subscription& subscription = client.subscriptions[i];
+
+                if (subscription.cFramesPeriod == 0)
+                {
+                    SIMCONNECT_RECV_EVENT_FRAME evt;
+                    InitRecv (evt, SIMCONNECT_RECV_ID_EVENT_FRAME);
+                    evt.uGroupID   = SIMCONNECT_UNUSED;
+                    evt.uEventID   = subscription.idEvent;
+                    evt.fFrameRate = (float)config.dFrameRate;
+                    evt.fSimSpeed  = 1.0f;
+                    Push (client, &evt, sizeof (evt), dNow);
+                }
+                else if (nFrame % subscription.cFramesPeriod == 0)
+                {
+                    SIMCONNECT_RECV_EVENT evt;
+                    InitRecv (evt, SIMCONNECT_RECV_ID_EVENT);
+                    evt.uGroupID = SIMCONNECT_UNUSED;
+                    evt.uEventID = subscription.idEvent;
+                    Push (client, &evt, sizeof (evt), dNow);
+                }
+            }
+
+            for (size_t i = 0; i < client.requests.size (); )
+            {
+                Request& request = client.requests[i];
+
+                if (--request.cFramesToNext > 0)
+                {
+                    i++;
+                    continue;
+                }
+
+                SendData (client, SIMCONNECT_RECV_ID_SIMOBJECT_DATA, request.idRequest, request.idDefine, request.idObject, 1, 1, dNow);
+                request.cFramesToNext = request.cFramesPeriod;
+
+                if (request.cLeft > 0 && --request.cLeft == 0)
+                {
+                    client.requests.erase (client.requests.begin () + i);
+                }
+                else
+                {
+                    i++;
+                }
+            }
+        }
+    }
+
+    template <typename TRecv>
+    static void InitRecv (TRecv&             recv,
+                          SIMCONNECT_RECV_ID eId)
+    {
+        memset (&recv, 0, sizeof (recv));
+        recv.dwSize    = sizeof (recv);
+        recv.dwVersion = STANDIN_RECV_VERSION;
+        recv.dwID      = eId;
+    }
+
+    static bool HasDefinition (const Client& client,
+                               DWORD         idDefine)
+    {
+        return idDefine < client.definitions.size () && !client.definitions[idDefine].empty ();
+    }
+
+    void Push (Client&     client,
+               const void* pData,
+               size_t      cbData,
+               double      dNow)
+    {
+        client.down.Push (dNow, pData, cbData);
+        cMessages++;
+    }
+
+    void SendOpen (Client& client,
+                   double  dNow)
+    {
+        SIMCONNECT_RECV_OPEN open;
+        InitRecv (open, SIMCONNECT_RECV_ID_OPEN);
+        strncpy (open.szApplicationName, "SimConnect Stand-In Server", sizeof (open.szApplicationName) - 1);
+        open.dwApplicationVersionMajor = 1;
+        open.dwSimConnectVersionMajor  = STANDIN_WIRE_VERSION;
+        Push (client, &open, sizeof (open), dNow);
+    }
+
+    void SendException (Client&              client,
+                        SIMCONNECT_EXCEPTION eException,
+                        DWORD                dwSendID,
+                        DWORD                dwIndex,
+                        double               dNow)
+    {
+        SIMCONNECT_RECV_EXCEPTION ex;
+        InitRecv (ex, SIMCONNECT_RECV_ID_EXCEPTION);
+        ex.dwException = eException;
+        ex.dwSendID    = dwSendID;
+        ex.dwIndex     = dwIndex;
+        Push (client, &ex, sizeof (ex), dNow);
+    }
+
+    /**
+     * A SIMOBJECT_DATA or SIMOBJECT_DATA_BYTYPE message for a definition, every FLOAT64 field holding the frame
+     *  number and the others zero.
+     */
+    void SendData (Client&            client,
+                   SIMCONNECT_RECV_ID eId,
+                   DWORD              idRequest,
+                   DWORD              idDefine,
+                   DWORD              idObject,
+                   DWORD              iEntry,
+                   DWORD              cEntries,
+                   double             dNow)
+    {
+        const std::vector<DWORD>& types  = client.definitions[idDefine];
+        size_t                    cbData = 0;
+
+        for (size_t i = 0; i < types.size (); i++) cbData += DatumSize (types[i]);
+
+        // The data in place of dwData, the last member of the packed message
+        message.assign (sizeof (SIMCONNECT_RECV_SIMOBJECT_DATA) - sizeof (DWORD) + cbData, 0);
+
+        SIMCONNECT_RECV_SIMOBJECT_DATA* pObjData = (SIMCONNECT_RECV_SIMOBJECT_DATA*)&message[0];
+        pObjData->dwSize        = (DWORD)message.size ();
+        pObjData->dwVersion     = STANDIN_RECV_VERSION;
+        pObjData->dwID          = eId;
+        pObjData->dwRequestID   = idRequest;
+        pObjData->dwObjectID    = idObject;
+        pObjData->dwDefineID    = idDefine;
+        pObjData->dwentrynumber = iEntry;
+        pObjData->dwoutof       = cEntries;
+        pObjData->dwDefineCount = (DWORD)types.size ();
+
+        BYTE*  pField = (BYTE*)&pObjData->dwData;
+        double dValue = (double)nFrame;
+        for (size_t i = 0; i < types.size (); i++)
+        {
+            if (types[i] == SIMCONNECT_DATATYPE_FLOAT64) memcpy (pField, &dValue, sizeof (dValue));
+            pField += DatumSize (types[i]);
+        }
+
+        Push (client, &message[0], message.size (), dNow);
+    }
+
+
+    Config                  config;
+    SOCKET                  sockListen;
+    WORD                    wPort;
+    bool                    bWinsock;
+    std::atomic<bool>       bStop;
+    std::thread             thread;
+
+    // Owned by the server thread while it runs
+    std::vector<Client*>    clients;
+    ULONGLONG               nFrame;
+    std::vector<BYTE>       message;        // Scratch for SendData
+
+    std::atomic<ULONGLONG>  cPackets;
+    std::atomic<ULONGLONG>  cbReceived;
+    std::atomic<ULONGLONG>  cWrites;
+    std::atomic<ULONGLONG>  cMessages;
+    std::atomic<ULONGLONG>  cbSent;
+};
+
+
+CStandInServer::CStandInServer () :
+    m_pState (NULL)
+{
+}
+
+CStandInServer::~CStandInServer ()
+{
+    Stop ();
+}
+
+bool CStandInServer::Start (const Config& config,
+                            WORD          wPort)
+{
+    Stop ();
+
+    State*  pState = new State ();
+    WSADATA data;
+
+    pState->config   = config;
+    pState->bWinsock = WSAStartup (MAKEWORD (2, 2), &data) == 0;
+
+    sockaddr_in addr;
+    socklen_t   cbAddr = sizeof (addr);
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons (wPort);
+    inet_pton (AF_INET, "127.0.0.1", &addr.sin_addr);
+
+    int    nReuse        = 1;
+    u_long ulNonBlocking = 1;
+
+    pState->sockListen = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (pState->sockListen == INVALID_SOCKET
+        || setsockopt (pState->sockListen, SOL_SOCKET, SO_REUSEADDR, (const char*)&nReuse, sizeof (nReuse)) != 0
+        || bind (pState->sockListen, (const sockaddr*)&addr, sizeof (addr)) != 0
+        || listen (pState->sockListen, 16) != 0
+        || getsockname (pState->sockListen, (sockaddr*)&addr, &cbAddr) != 0
+        || ioctlsocket (pState->sockListen, FIONBIO, &ulNonBlocking) != 0)
+    {
+        delete pState;
+        return false;
+    }
+
+    pState->wPort  = ntohs (addr.sin_port);
+    pState->thread = std::thread (&State::Run, pState);
+    m_pState       = pState;
+    return true;
+}
+
+void CStandInServer::Stop ()
+{
+    if (m_pState == NULL) return;
+
+    m_pState->bStop = true;
+    m_pState->thread.join ();
+
+    delete m_pState;
+    m_pState = NULL;
+}
+
+WORD CStandInServer::Port () const
+{
+    return m_pState != NULL ? m_pState->wPort : 0;
+}
+
+CStandInServer::Stats CStandInServer::GetStats () const
+{
+    Stats stats;
+    memset (&stats, 0, sizeof (stats));
+
+    if (m_pState != NULL)
+    {
+        stats.cPackets   = m_pState->cPackets;
+        stats.cbReceived = m_pState->cbReceived;
+        stats.cWrites    = m_pState->cWrites;
+        stats.cMessages  = m_pState->cMessages;
+        stats.cbSent     = m_pState->cbSent;
+    }
+    return stats;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Windows.h>
+
+
+/**
+ * Stand-in for a sim reached over the network: a loopback TCP server, on a thread of its own, for stand-in
+ *  connections pointed at it with CSimConnectStandIn::SetServer. It speaks the packets of SimConnectStandInWire.h.
+ *
+ * It answers the open and keeps each client's data definitions, requests and system event subscriptions. Requested
+ *  data goes out once or on a fixed frame clock, every FLOAT64 field holding the frame number. "Frame", "6Hz",
+ *  "1sec" and "4sec" events follow the same clock. Created objects are assigned IDs, and writes are counted. The
+ *  other calls are accepted and ignored.
+ *
+ * Everything in both directions goes through a modelled link, which queues packets behind each other at the given
+ *  bandwidth and delivers them after the given latency. A client on the same machine so sees the round trips and
+ *  throughput of a remote sim.
+ */
+class CStandInServer
+{
+public:
+    typedef struct Config
+    {
+        Config () :
+            dLatencyMs   (0.0),
+            dBytesPerSec (0.0),
+            dFrameRate   (60.0),
+            cObjects     (16)
+        {
+        }
+
+        double dLatencyMs;      // One way
+        double dBytesPerSec;    // Each way; 0 for no limit
+        double dFrameRate;
+        DWORD  cObjects;        // In range for RequestDataOnSimObjectType
+    }
+    Config;
+
+    /**
+     * Totals over all clients so far.
+     */
+    typedef struct Stats
+    {
+        ULONGLONG cPackets;
+        ULONGLONG cbReceived;
+        ULONGLONG cWrites;
+        ULONGLONG cMessages;
+        ULONGLONG cbSent;
+    }
+    Stats;
+
+    CStandInServer ();
+    ~CStandInServer ();
+
+    /**
+     * Listen on 127.0.0.1 at wPort, or at a free port for 0, and start serving. Returns false if that failed.
+     */
+    bool Start (const Config& config,
+                WORD          wPort = 0);
+
+    /**
+     * Close the connections and stop serving; the clients see them closed.
+     */
+    void Stop ();
+
+    WORD Port () const;
+
+    Stats GetStats () const;
+
+private:
+    struct State;
+
+    CStandInServer (const CStandInServer&);
+    CStandInServer& operator= (const CStandInServer&);
+
+
+    State* m_pState;    // Shared with the server thread; NULL while stopped
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <Windows.h>
+#include <SimConnect.h>
+
+
+/**
+ * Packets between the stand-in client library and CStandInServer, modelled on the SimConnect network protocol: the
+ *  client sends one packet per call, a header followed by the arguments, with strings in fixed fields; the server
+ *  sends SIMCONNECT_RECV messages back to back, exactly as SimConnect_CallDispatch hands them out. The packet IDs and
+ *  layouts are the stand-in's own, so neither end can talk to the real thing.
+ */
+
+#define STANDIN_WIRE_VERSION        1
+#define STANDIN_WIRE_STRING         256
+#define STANDIN_WIRE_PACKET_MAX     (1 << 20)
+#define STANDIN_RECV_VERSION        4           // dwVersion of the SIMCONNECT_RECV messages back
+
+// For send, after the socket headers; Winsock has no SIGPIPE to suppress
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL                0
+#endif
+
+enum WIRE_ID
+{
+    WIRE_ID_OPEN = 1,
+    WIRE_ID_MAP_CLIENT_EVENT_TO_SIM_EVENT,
+    WIRE_ID_ADD_CLIENT_EVENT_TO_NOTIFICATION_GROUP,
+    WIRE_ID_MAP_INPUT_EVENT_TO_CLIENT_EVENT,
+    WIRE_ID_SET_INPUT_GROUP_STATE,
+    WIRE_ID_SUBSCRIBE_TO_SYSTEM_EVENT,
+    WIRE_ID_ADD_TO_DATA_DEFINITION,
+    WIRE_ID_CLEAR_DATA_DEFINITION,
+    WIRE_ID_REQUEST_DATA_ON_SIM_OBJECT,
+    WIRE_ID_REQUEST_DATA_ON_SIM_OBJECT_TYPE,
+    WIRE_ID_SET_DATA_ON_SIM_OBJECT,
+    WIRE_ID_AI_CREATE_SIMULATED_OBJECT
+};
+
+#pragma pack (push, 1)
+
+typedef struct WirePacket
+{
+    DWORD dwSize;       // Of the whole packet
+    DWORD dwVersion;    // STANDIN_WIRE_VERSION
+    DWORD dwID;         // WIRE_ID
+    DWORD dwSendID;     // Counts up from 1 per connection; see SimConnect_GetLastSentPacketID
+}
+WirePacket;
+
+typedef struct WireOpen : public WirePacket
+{
+    char szName[STANDIN_WIRE_STRING];
+}
+WireOpen;
+
+typedef struct WireMapClientEventToSimEvent : public WirePacket
+{
+    DWORD idEvent;
+    char  szEventName[STANDIN_WIRE_STRING];
+}
+WireMapClientEventToSimEvent;
+
+typedef struct WireAddClientEventToNotificationGroup : public WirePacket
+{
+    DWORD idGroup;
+    DWORD idEvent;
+    BOOL  bMaskable;
+}
+WireAddClientEventToNotificationGroup;
+
+typedef struct WireMapInputEventToClientEvent : public WirePacket
+{
+    DWORD idGroup;
+    char  szInputDefinition[STANDIN_WIRE_STRING];
+    DWORD idDownEvent;
+    DWORD dwDownValue;
+    DWORD idUpEvent;
+    DWORD dwUpValue;
+    BOOL  bMaskable;
+}
+WireMapInputEventToClientEvent;
+
+typedef struct WireSetInputGroupState : public WirePacket
+{
+    DWORD idGroup;
+    DWORD dwState;
+}
+WireSetInputGroupState;
+
+typedef struct WireSubscribeToSystemEvent : public WirePacket
+{
+    DWORD idEvent;
+    char  szSystemEventName[STANDIN_WIRE_STRING];
+}
+WireSubscribeToSystemEvent;
+
+typedef struct WireAddToDataDefinition : public WirePacket
+{
+    DWORD idDefine;
+    char  szDatumName[STANDIN_WIRE_STRING];
+    char  szUnitsName[STANDIN_WIRE_STRING];
+    DWORD dwDatumType;
+    float fEpsilon;
+    DWORD idDatum;
+}
+WireAddToDataDefinition;
+
+typedef struct WireClearDataDefinition : public WirePacket
+{
+    DWORD idDefine;
+}
+WireClearDataDefinition;
+
+typedef struct WireRequestDataOnSimObject : public WirePacket
+{
+    DWORD idRequest;
+    DWORD idDefine;
+    DWORD idObject;
+    DWORD dwPeriod;
+    DWORD dwFlags;
+    DWORD dwOrigin;
+    DWORD dwInterval;
+    DWORD dwLimit;
+}
+WireRequestDataOnSimObject;
+
+typedef struct WireRequestDataOnSimObjectType : public WirePacket
+{
+    DWORD idRequest;
+    DWORD idDefine;
+    DWORD dwRadiusMeters;
+    DWORD dwType;
+}
+WireRequestDataOnSimObjectType;
+
+/**
+ * Followed by the data: cbUnitSize bytes per array element, of which there is one for dwArrayCount 0.
+ */
+typedef struct WireSetDataOnSimObject : public WirePacket
+{
+    DWORD idDefine;
+    DWORD idObject;
+    DWORD dwFlags;
+    DWORD dwArrayCount;
+    DWORD cbUnitSize;
+}
+WireSetDataOnSimObject;
+
+typedef struct WireAICreateSimulatedObject : public WirePacket
+{
+    char                         szContainerTitle[STANDIN_WIRE_STRING];
+    SIMCONNECT_DATA_INITPOSITION initPos;
+    DWORD                        idRequest;
+}
+WireAICreateSimulatedObject;
+
+#pragma pack (pop)